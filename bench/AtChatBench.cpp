@@ -0,0 +1,404 @@
+#include "AtChatBench.h"
+#include "BenchData.h"
+#include "NetworkManager.h"
+#include "NetworkManager_p.h"
+#include "ConversationListModel.h"
+#include "ContactsModel.h"
+#include "LicenseManager.h"
+#include "MessageStore.h"
+#include "SearchIndex.h"
+#include "WireCodec.h"
+
+#include <QtTest>
+#include <QJsonDocument>
+#include <QStandardPaths>
+#include <QRandomGenerator>
+#include <QTemporaryDir>
+#include <QVector>
+
+namespace {
+
+const QString SELF = QStringLiteral("self");
+
+const int STORE_MESSAGES = 1000000;
+const int STORE_PEERS = 100;
+const int STORE_BATCH = 1000;
+
+// 1M 条消息、100 个会话交错写入的本地记录，首次使用时生成，之后的基准共用
+QString largeStore()
+{
+    static QTemporaryDir dir;
+    static bool ready = false;
+    if (!ready) {
+        qInfo() << "generating" << STORE_MESSAGES << "messages in" << dir.path();
+        MessageStore store;
+        store.open(SELF, dir.path());
+        for (int i = 0; i < STORE_MESSAGES; ++i) {
+            QString peer = BenchData::userId(i % STORE_PEERS);
+            bool incoming = i % 3 != 0;
+            store.append(BenchData::message(i + 1, incoming ? peer : SELF, incoming ? SELF : peer));
+        }
+        store.close();
+        ready = true;
+    }
+    return dir.path();
+}
+
+const int SEARCH_DOCUMENTS = 1000000;
+
+// 1M 条中英文文档分布在 STORE_PEERS 个会话中的搜索索引，首次使用时构建
+const TextIndex &largeSearchIndex()
+{
+    static TextIndex index;
+    if (index.size() == 0) {
+        qInfo() << "indexing" << SEARCH_DOCUMENTS << "documents";
+        for (int i = 0; i < SEARCH_DOCUMENTS; ++i) {
+            index.add(BenchData::userId(i % STORE_PEERS), i + 1, BenchData::searchDocument(i));
+        }
+    }
+    return index;
+}
+
+QVector<QJsonObject> frameBatch(const QString &kind, int count)
+{
+    QVector<QJsonObject> frames;
+    frames.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        QString peer = BenchData::userId(i % 200);
+        if (kind == "message") frames << BenchData::wsMessage(i + 1, peer, SELF);
+        else if (kind == "group_message") frames << BenchData::wsGroupMessage(i + 1, peer, BenchData::groupId(i % 20));
+        else if (kind == "status") frames << BenchData::wsStatus(peer, i % 2 == 0);
+        else if (kind == "ack") frames << BenchData::wsAck(QString("c%1").arg(i), i + 1);
+        else frames << BenchData::wsEvent(kind);
+    }
+    return frames;
+}
+
+}
+
+void AtChatBench::initTestCase()
+{
+    // 授权文件、设置与聊天记录写到测试目录，不碰真实数据
+    QStandardPaths::setTestModeEnabled(true);
+    NetworkManager::instance();
+}
+
+void AtChatBench::wsDispatch_data()
+{
+    QTest::addColumn<QString>("kind");
+    QTest::newRow("message") << "message";
+    QTest::newRow("group_message") << "group_message";
+    QTest::newRow("status") << "status";
+    QTest::newRow("ack") << "ack";
+    QTest::newRow("invalidate") << "group_update";
+}
+
+void AtChatBench::wsDispatch()
+{
+    QFETCH(QString, kind);
+    const QVector<QJsonObject> frames = frameBatch(kind, 1000);
+    WsFrameInjector injector(NetworkManager::instance());
+
+    QBENCHMARK {
+        for (const QJsonObject &frame : frames) injector.inject(frame);
+    }
+}
+
+void AtChatBench::parseHistory_data()
+{
+    QTest::addColumn<QByteArray>("payload");
+    for (int count : {50, 500, 5000}) {
+        QTest::addRow("%d", count) << BenchData::toJson(BenchData::messages(count, SELF, BenchData::userId(1)));
+    }
+}
+
+void AtChatBench::parseHistory()
+{
+    QFETCH(QByteArray, payload);
+    QBENCHMARK {
+        QJsonDocument doc = QJsonDocument::fromJson(payload);
+        Q_UNUSED(doc)
+    }
+}
+
+void AtChatBench::parseRoster_data()
+{
+    QTest::addColumn<QByteArray>("payload");
+    for (int count : {100, 1000, 10000}) {
+        QTest::addRow("users/%d", count) << BenchData::toJson(BenchData::users(count));
+        QTest::addRow("friends/%d", count) << BenchData::toJson(BenchData::friends(count, 10));
+    }
+}
+
+void AtChatBench::parseRoster()
+{
+    QFETCH(QByteArray, payload);
+    QBENCHMARK {
+        QJsonDocument doc = QJsonDocument::fromJson(payload);
+        Q_UNUSED(doc)
+    }
+}
+
+void AtChatBench::encodeFrame_data()
+{
+    QTest::addColumn<QJsonArray>("frames");
+    QTest::addColumn<int>("format");
+    // mix 是实时推送的典型构成；history 是一整页历史消息组成的大帧
+    const QJsonArray mix = BenchData::wsMix(1000);
+    const QJsonArray history{QJsonObject{{"action", "history"},
+                                         {"data", BenchData::messages(500, SELF, BenchData::userId(1))}}};
+    QTest::newRow("json/mix") << mix << int(WireCodec::Json);
+    QTest::newRow("cbor/mix") << mix << int(WireCodec::Cbor);
+    QTest::newRow("json/history") << history << int(WireCodec::Json);
+    QTest::newRow("cbor/history") << history << int(WireCodec::Cbor);
+}
+
+void AtChatBench::encodeFrame()
+{
+    QFETCH(QJsonArray, frames);
+    QFETCH(int, format);
+    QVector<QJsonObject> messages;
+    for (const QJsonValue &v : std::as_const(frames)) messages.append(v.toObject());
+
+    qsizetype bytes = 0;
+    QBENCHMARK {
+        for (const QJsonObject &message : std::as_const(messages)) {
+            bytes += WireCodec::encode(message, WireCodec::Format(format)).size();
+        }
+    }
+    QVERIFY(bytes > 0);
+}
+
+void AtChatBench::decodeFrame_data()
+{
+    encodeFrame_data();
+}
+
+void AtChatBench::decodeFrame()
+{
+    QFETCH(QJsonArray, frames);
+    QFETCH(int, format);
+    QVector<QByteArray> encoded;
+    for (const QJsonValue &v : std::as_const(frames)) {
+        encoded.append(WireCodec::encode(v.toObject(), WireCodec::Format(format)));
+    }
+
+    int decoded = 0;
+    QBENCHMARK {
+        for (const QByteArray &frame : std::as_const(encoded)) {
+            decoded += !WireCodec::decode(frame, WireCodec::Format(format)).isEmpty();
+        }
+    }
+    QVERIFY(decoded > 0);
+}
+
+void AtChatBench::conversationReset_data()
+{
+    QTest::addColumn<QJsonArray>("users");
+    for (int count : {100, 1000, 10000}) {
+        QTest::addRow("%d", count) << BenchData::users(count);
+    }
+}
+
+void AtChatBench::conversationReset()
+{
+    QFETCH(QJsonArray, users);
+    NetworkManager *net = NetworkManager::instance();
+    ConversationListModel *model = ConversationListModel::instance();
+
+    QBENCHMARK {
+        emit net->usersReceived(users);
+    }
+    QCOMPARE(model->rowCount(), int(users.size()));
+}
+
+void AtChatBench::conversationUpdate_data()
+{
+    QTest::addColumn<int>("conversations");
+    for (int count : {100, 1000, 10000}) {
+        QTest::addRow("%d", count) << count;
+    }
+}
+
+void AtChatBench::conversationUpdate()
+{
+    // 消息随机落在各个会话上，每条都会把会话移到顶部
+    QFETCH(int, conversations);
+    NetworkManager *net = NetworkManager::instance();
+    ConversationListModel::instance();
+    emit net->usersReceived(BenchData::users(conversations));
+
+    QVector<QJsonObject> messages;
+    QRandomGenerator rng(quint32(conversations));
+    for (int i = 0; i < 1000; ++i) {
+        messages << BenchData::message(i + 1, BenchData::userId(rng.bounded(conversations)), SELF);
+    }
+
+    QBENCHMARK {
+        for (const QJsonObject &message : messages) emit net->messageReceived(message);
+    }
+}
+
+void AtChatBench::contactsRebuild_data()
+{
+    QTest::addColumn<QJsonArray>("friends");
+    for (int count : {100, 1000, 10000}) {
+        QTest::addRow("%d", count) << BenchData::friends(count, 10);
+    }
+}
+
+void AtChatBench::contactsRebuild()
+{
+    QFETCH(QJsonArray, friends);
+    NetworkManager *net = NetworkManager::instance();
+    ContactsModel::instance();
+    emit net->friendGroupsReceived(BenchData::friendGroups(10));
+
+    QBENCHMARK {
+        emit net->friendsReceived(friends);
+    }
+}
+
+void AtChatBench::contactsPresence_data()
+{
+    QTest::addColumn<int>("friends");
+    QTest::addColumn<int>("changes");
+    QTest::newRow("1000/10") << 1000 << 10;
+    QTest::newRow("1000/100") << 1000 << 100;
+    QTest::newRow("10000/1000") << 10000 << 1000;
+}
+
+void AtChatBench::contactsPresence()
+{
+    QFETCH(int, friends);
+    QFETCH(int, changes);
+    NetworkManager *net = NetworkManager::instance();
+    ContactsModel::instance();
+    ConversationListModel::instance();
+    emit net->friendGroupsReceived(BenchData::friendGroups(10));
+    emit net->friendsReceived(BenchData::friends(friends, 10));
+    emit net->usersReceived(BenchData::users(friends));
+
+    // 交替上线、下线，保证每一轮都是真实的变化
+    Presence::Diff online;
+    Presence::Diff offline;
+    const int stride = friends / changes;
+    for (int i = 0; i < changes; ++i) {
+        online.insert(BenchData::userId(i * stride), true);
+        offline.insert(BenchData::userId(i * stride), false);
+    }
+
+    bool flip = false;
+    QBENCHMARK {
+        flip = !flip;
+        emit net->presence()->changed(flip ? online : offline);
+    }
+}
+
+void AtChatBench::storeInsert_data()
+{
+    QTest::addColumn<bool>("large");
+    QTest::newRow("empty") << false;
+    QTest::newRow("1M") << true;
+}
+
+void AtChatBench::storeInsert()
+{
+    // 每轮写入 1000 条新消息，包括每 4096 条一次的索引快照
+    QFETCH(bool, large);
+    QTemporaryDir empty;
+    MessageStore store;
+    QVERIFY(store.open(SELF, large ? largeStore() : empty.path()));
+
+    static qint64 nextId = STORE_MESSAGES + 1;
+    QBENCHMARK {
+        for (int i = 0; i < STORE_BATCH; ++i, ++nextId) {
+            QString peer = BenchData::userId(nextId % STORE_PEERS);
+            store.append(BenchData::message(nextId, peer, SELF));
+        }
+    }
+}
+
+void AtChatBench::storeRange_data()
+{
+    QTest::addColumn<bool>("backward");
+    QTest::addColumn<int>("limit");
+    for (int limit : {20, 200}) {
+        QTest::addRow("before/%d", limit) << true << limit;
+        QTest::addRow("after/%d", limit) << false << limit;
+    }
+}
+
+void AtChatBench::storeRange()
+{
+    // 在 1M 条记录中随机位置翻页，每轮 100 次
+    QFETCH(bool, backward);
+    QFETCH(int, limit);
+    MessageStore store;
+    QVERIFY(store.open(SELF, largeStore()));
+
+    QRandomGenerator rng(quint32(limit));
+    QVector<QPair<QString, qint64>> anchors;
+    for (int i = 0; i < 100; ++i) {
+        anchors.append({BenchData::userId(rng.bounded(STORE_PEERS)), 1 + rng.bounded(STORE_MESSAGES)});
+    }
+
+    qsizetype rows = 0;
+    QBENCHMARK {
+        for (const auto &anchor : std::as_const(anchors)) {
+            rows += backward ? store.before(anchor.first, anchor.second, limit).size()
+                             : store.after(anchor.first, anchor.second, limit).size();
+        }
+    }
+    QVERIFY(rows > 0);
+}
+
+void AtChatBench::searchQuery_data()
+{
+    QTest::addColumn<QString>("query");
+    QTest::addColumn<QString>("conversation");
+
+    // 查询取自已索引的文档，保证有命中
+    const QString cjk = BenchData::searchDocument(10);
+    const QString latin = BenchData::searchDocument(11);
+    const QString word = latin.section(' ', 0, 0);
+    QTest::newRow("cjk/char") << cjk.left(1) << QString();
+    QTest::newRow("cjk/bigram") << cjk.left(2) << QString();
+    QTest::newRow("cjk/phrase") << cjk.left(4) << QString();
+    QTest::newRow("latin/word") << word + " " << QString();
+    QTest::newRow("latin/prefix") << word.left(3) << QString();
+    QTest::newRow("latin/two-words") << latin.section(' ', 0, 1) + " " << QString();
+    QTest::newRow("cjk/bigram/conversation") << cjk.left(2) << BenchData::userId(10 % STORE_PEERS);
+}
+
+void AtChatBench::searchQuery()
+{
+    QFETCH(QString, query);
+    QFETCH(QString, conversation);
+    const TextIndex &index = largeSearchIndex();
+
+    QVector<TextIndex::Hit> hits;
+    QBENCHMARK {
+        hits = index.search(query, 50, conversation);
+    }
+    QVERIFY(!hits.isEmpty());
+}
+
+void AtChatBench::licenseLoad()
+{
+    // 启动时的开销：设备 id 与授权文件读取、校验
+    LicenseManager().removeLicense();
+    QBENCHMARK {
+        LicenseManager license;
+        Q_UNUSED(license)
+    }
+}
+
+void AtChatBench::licenseSave()
+{
+    // removeLicense 只重置字段后写一次授权文件
+    LicenseManager license;
+    QBENCHMARK {
+        license.removeLicense();
+    }
+}
@@ -0,0 +1,48 @@
+#ifndef ATCHATBENCH_H
+#define ATCHATBENCH_H
+
+#include <QObject>
+
+// 客户端热点路径的 QBENCHMARK 集合。
+// 按声明顺序运行：WebSocket 分发在模型创建之前测量，只包含 NetworkManager 自身的开销。
+class AtChatBench : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void wsDispatch_data();
+    void wsDispatch();
+
+    void parseHistory_data();
+    void parseHistory();
+    void parseRoster_data();
+    void parseRoster();
+    void encodeFrame_data();
+    void encodeFrame();
+    void decodeFrame_data();
+    void decodeFrame();
+
+    void conversationReset_data();
+    void conversationReset();
+    void conversationUpdate_data();
+    void conversationUpdate();
+    void contactsRebuild_data();
+    void contactsRebuild();
+    void contactsPresence_data();
+    void contactsPresence();
+
+    void storeInsert_data();
+    void storeInsert();
+    void storeRange_data();
+    void storeRange();
+
+    void searchQuery_data();
+    void searchQuery();
+
+    void licenseLoad();
+    void licenseSave();
+};
+
+#endif
@@ -0,0 +1,225 @@
+#include "BenchData.h"
+#include <QJsonDocument>
+#include <QRandomGenerator>
+#include <iterator>
+
+namespace {
+
+const qint64 BASE_TIMESTAMP = 1735689600000LL;  // 2025-01-01
+
+// 中英混排、长短不一的消息正文
+QString text(QRandomGenerator &rng)
+{
+    static const char *const WORDS[] = {
+        "好的", "明天", "会议", "下午", "文件", "已经", "发给你了", "收到",
+        "ok", "thanks", "see", "you", "later", "build", "release", "review",
+    };
+    const int count = 1 + rng.bounded(24);
+    QString result;
+    for (int i = 0; i < count; ++i) {
+        if (i > 0) result += QLatin1Char(' ');
+        result += QString::fromUtf8(WORDS[rng.bounded(int(std::size(WORDS)))]);
+    }
+    return result;
+}
+
+QJsonObject baseMessage(qint64 id, const QString &from, QRandomGenerator &rng)
+{
+    QJsonObject m;
+    m["id"] = id;
+    m["from"] = from;
+    m["content"] = text(rng);
+    m["type"] = "text";
+    m["timestamp"] = BASE_TIMESTAMP + id * 1000;
+    return m;
+}
+
+}
+
+namespace BenchData {
+
+QString userId(int index)
+{
+    return QString("u%1").arg(index, 8, 10, QLatin1Char('0'));
+}
+
+QString groupId(int index)
+{
+    return QString("g%1").arg(index, 6, 10, QLatin1Char('0'));
+}
+
+QJsonArray messages(int count, const QString &self, const QString &peer, qint64 firstId)
+{
+    QRandomGenerator rng(quint32(count));
+    QJsonArray array;
+    for (int i = 0; i < count; ++i) {
+        bool incoming = i % 2 == 0;
+        QJsonObject m = baseMessage(firstId + i, incoming ? peer : self, rng);
+        m["to"] = incoming ? self : peer;
+        array.append(m);
+    }
+    return array;
+}
+
+QJsonObject message(qint64 id, const QString &from, const QString &to)
+{
+    QRandomGenerator rng(quint32(id));
+    QJsonObject m = baseMessage(id, from, rng);
+    m["to"] = to;
+    return m;
+}
+
+QJsonObject groupMessage(qint64 id, const QString &from, const QString &groupId)
+{
+    QRandomGenerator rng(quint32(id));
+    QJsonObject m = baseMessage(id, from, rng);
+    m["group_id"] = groupId;
+    return m;
+}
+
+QJsonArray users(int count)
+{
+    QRandomGenerator rng(quint32(count));
+    QJsonArray array;
+    for (int i = 0; i < count; ++i) {
+        QJsonObject u;
+        u["id"] = userId(i);
+        u["username"] = QString("user%1").arg(i);
+        u["nickname"] = QString("用户%1").arg(i);
+        u["online"] = rng.bounded(4) == 0;
+        u["avatar"] = QString("/uploads/avatar/%1.png").arg(i);
+        u["signature"] = text(rng);
+        array.append(u);
+    }
+    return array;
+}
+
+QJsonArray friends(int count, int groupCount)
+{
+    QRandomGenerator rng(quint32(count));
+    QJsonArray array;
+    for (int i = 0; i < count; ++i) {
+        QJsonObject f;
+        f["friend_id"] = userId(i);
+        f["nickname"] = QString("用户%1").arg(i);
+        f["remark"] = i % 5 == 0 ? QString("备注%1").arg(i) : QString();
+        f["signature"] = text(rng);
+        f["group_id"] = groupCount > 0 ? groupId(i % groupCount) : QString();
+        f["online"] = rng.bounded(4) == 0;
+        f["is_mutual"] = true;
+        array.append(f);
+    }
+    return array;
+}
+
+QJsonArray friendGroups(int count)
+{
+    QJsonArray array;
+    for (int i = 0; i < count; ++i) {
+        QJsonObject g;
+        g["id"] = groupId(i);
+        g["name"] = QString("分组%1").arg(i);
+        g["sort_order"] = i;
+        array.append(g);
+    }
+    return array;
+}
+
+QJsonObject wsMessage(qint64 id, const QString &from, const QString &to)
+{
+    return QJsonObject{{"action", "message"}, {"data", message(id, from, to)}};
+}
+
+QJsonObject wsGroupMessage(qint64 id, const QString &from, const QString &groupId)
+{
+    return QJsonObject{{"action", "group_message"}, {"data", groupMessage(id, from, groupId)}};
+}
+
+QJsonObject wsStatus(const QString &userId, bool online)
+{
+    return QJsonObject{{"action", "status"}, {"data", QJsonObject{{"user_id", userId}, {"online", online}}}};
+}
+
+QJsonObject wsAck(const QString &clientId, qint64 id)
+{
+    return QJsonObject{{"action", "ack"}, {"data", QJsonObject{{"client_id", clientId}, {"id", id}}}};
+}
+
+QJsonObject wsEvent(const QString &action)
+{
+    return QJsonObject{{"action", action}, {"data", QJsonObject()}};
+}
+
+QJsonObject wsReceipt(const QString &from, const QString &to, qint64 readId)
+{
+    QJsonObject receipt{{"to", to}, {"delivered", readId}, {"read", readId}};
+    return QJsonObject{{"action", "receipt"},
+                       {"data", QJsonObject{{"from", from}, {"receipts", QJsonArray{receipt}}}}};
+}
+
+QJsonObject wsImage(qint64 id, const QString &from, const QString &to)
+{
+    QJsonObject m = message(id, from, to);
+    m["type"] = "image";
+    m["content"] = QString("/uploads/%1.jpg").arg(id);
+    m["file_name"] = QString("IMG_%1.jpg").arg(id);
+    m["file_size"] = 200000 + id % 100000;
+    m["width"] = 1280;
+    m["height"] = 960;
+    return QJsonObject{{"action", "message"}, {"data", m}};
+}
+
+QJsonArray wsMix(int count)
+{
+    // 私聊 40%、群聊 25%、ack 15%、状态 10%、回执 7%、图片 3%
+    QRandomGenerator rng(quint32(count));
+    QJsonArray frames;
+    for (int i = 0; i < count; ++i) {
+        const qint64 id = i + 1;
+        const QString peer = userId(rng.bounded(200));
+        const int roll = rng.bounded(100);
+        if (roll < 40) frames.append(wsMessage(id, peer, userId(0)));
+        else if (roll < 65) frames.append(wsGroupMessage(id, peer, groupId(rng.bounded(20))));
+        else if (roll < 80) frames.append(wsAck(QString("c%1").arg(id), id));
+        else if (roll < 90) frames.append(wsStatus(peer, rng.bounded(2) == 0));
+        else if (roll < 97) frames.append(wsReceipt(peer, userId(0), id));
+        else frames.append(wsImage(id, peer, userId(0)));
+    }
+    return frames;
+}
+
+QString searchDocument(int index)
+{
+    static const char *const SYLLABLES[] = {
+        "ka", "re", "lo", "min", "tes", "ar", "on", "vi", "del", "pro",
+        "su", "ne", "ta", "gram", "co", "in", "ble", "ser", "ver", "ist",
+    };
+    const int syllableCount = int(std::size(SYLLABLES));
+    QRandomGenerator rng(quint32(index) * 2654435761u);
+    auto skewed = [&rng](int range) { double u = rng.generateDouble(); return int(range * u * u); };
+
+    QString result;
+    if (index % 2 == 0) {
+        const int length = 8 + rng.bounded(32);
+        for (int i = 0; i < length; ++i) result += QChar(0x4E00 + skewed(2500));
+        return result;
+    }
+    const int words = 3 + rng.bounded(12);
+    for (int i = 0; i < words; ++i) {
+        // 词表中第 n 个词由 n 的三位二十进制数字对应的音节拼成
+        int word = skewed(20000);
+        if (i > 0) result += QLatin1Char(' ');
+        for (int part = 0; part < 3 && (part == 0 || word > 0); ++part) {
+            result += QLatin1String(SYLLABLES[word % syllableCount]);
+            word /= syllableCount;
+        }
+    }
+    return result;
+}
+
+QByteArray toJson(const QJsonArray &array)
+{
+    return QJsonDocument(array).toJson(QJsonDocument::Compact);
+}
+
+}
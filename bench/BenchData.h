@@ -0,0 +1,43 @@
+#ifndef BENCHDATA_H
+#define BENCHDATA_H
+
+#include <QByteArray>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QString>
+
+// 基准用的合成数据，字段与服务器下发的格式一致。
+// 同一参数总是生成相同内容（固定随机种子），便于在不同版本之间对比。
+namespace BenchData {
+
+QString userId(int index);
+QString groupId(int index);
+
+// 私聊消息：奇数条由 peer 发出，偶数条由 self 发出，id 从 firstId 递增
+QJsonArray messages(int count, const QString &self, const QString &peer, qint64 firstId = 1);
+QJsonObject message(qint64 id, const QString &from, const QString &to);
+QJsonObject groupMessage(qint64 id, const QString &from, const QString &groupId);
+
+QJsonArray users(int count);
+QJsonArray friends(int count, int groupCount);
+QJsonArray friendGroups(int count);
+
+// WebSocket 推送：{action, data}
+QJsonObject wsMessage(qint64 id, const QString &from, const QString &to);
+QJsonObject wsGroupMessage(qint64 id, const QString &from, const QString &groupId);
+QJsonObject wsStatus(const QString &userId, bool online);
+QJsonObject wsAck(const QString &clientId, qint64 id);
+QJsonObject wsEvent(const QString &action);
+QJsonObject wsReceipt(const QString &from, const QString &to, qint64 readId);
+QJsonObject wsImage(qint64 id, const QString &from, const QString &to);
+// 线上常见的帧构成：私聊、群聊、ack、状态、回执与图片按固定比例混合
+QJsonArray wsMix(int count);
+
+// 搜索用的文档：一半是 2500 个常用汉字组成的句子，一半是两万词表中的英文单词，用字、用词都偏向高频
+QString searchDocument(int index);
+
+QByteArray toJson(const QJsonArray &array);
+
+}
+
+#endif
@@ -0,0 +1,15 @@
+#include "AtChatBench.h"
+#include <QGuiApplication>
+#include <QtTest>
+
+// 与 QTEST_MAIN 相同，但在创建任何单例之前设置应用名，QSettings 与数据目录不与正式客户端共用
+int main(int argc, char *argv[])
+{
+    QGuiApplication app(argc, argv);
+    app.setOrganizationName("AtChat");
+    app.setApplicationName("AtChatBench");
+    QTEST_SET_MAIN_SOURCE_PATH
+
+    AtChatBench bench;
+    return QTest::qExec(&bench, argc, argv);
+}
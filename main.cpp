@@ -1,6 +1,19 @@
 #include "LicenseManager.h"
 #include "NetworkManager.h"
+#include "FriendRoster.h"
+#include "ConversationListModel.h"
+#include "MessageListModel.h"
+#include "GroupMemberModel.h"
+#include "ContactsModel.h"
+#include "MessageStore.h"
+#include "SearchIndex.h"
+#include "UploadManager.h"
+#include "MediaCache.h"
+#include "MediaImageProvider.h"
+#include "MediaPipeline.h"
 #include "AppInfo.h"
+#include "Trace.h"
+#include "Latency.h"
 
 #include <QGuiApplication>
 #include <QQmlApplicationEngine>
@@ -12,6 +25,12 @@ int main(int argc, char *argv[])
     app.setOrganizationName("AtChat");
     app.setApplicationName("AtChat");
 
+    // 本地聊天记录需要在登录前就开始监听 NetworkManager
+    MessageStore::instance();
+    SearchIndex::instance();
+    // 收到没有缩略图的图片消息时在后台预先生成
+    MediaPipeline::instance();
+
     qmlRegisterSingletonType<LicenseManager>("AtChat", 1, 0, "LicenseManager",
         [](QQmlEngine *engine, QJSEngine *scriptEngine) -> QObject * {
             Q_UNUSED(engine)
@@ -22,10 +41,46 @@ int main(int argc, char *argv[])
     qmlRegisterSingletonType<NetworkManager>("AtChat", 1, 0, "NetworkManager",
         NetworkManager::create);
 
+    qmlRegisterUncreatableType<FriendRoster>("AtChat", 1, 0, "FriendRoster",
+        "FriendRoster is owned by NetworkManager");
+    qmlRegisterUncreatableType<Presence>("AtChat", 1, 0, "Presence",
+        "Presence is owned by NetworkManager");
+
+    qmlRegisterSingletonType<ConversationListModel>("AtChat", 1, 0, "ConversationListModel",
+        ConversationListModel::create);
+
+    qmlRegisterType<MessageListModel>("AtChat", 1, 0, "MessageListModel");
+    qmlRegisterType<GroupMemberModel>("AtChat", 1, 0, "GroupMemberModel");
+
+    qmlRegisterSingletonType<ContactsModel>("AtChat", 1, 0, "ContactsModel",
+        ContactsModel::create);
+
+    qmlRegisterSingletonType<SearchIndex>("AtChat", 1, 0, "SearchIndex",
+        SearchIndex::create);
+
+    qmlRegisterSingletonType<UploadManager>("AtChat", 1, 0, "UploadManager",
+        UploadManager::create);
+
+    qmlRegisterSingletonType<MediaCache>("AtChat", 1, 0, "MediaCache",
+        MediaCache::create);
+
+    qmlRegisterSingletonType<MediaPipeline>("AtChat", 1, 0, "MediaPipeline",
+        MediaPipeline::create);
+
     qmlRegisterSingletonType<AppInfo>("AtChat", 1, 0, "AppInfo",
         AppInfo::create);
 
+    qmlRegisterSingletonType<Trace>("AtChat", 1, 0, "Trace",
+        Trace::create);
+
+    qmlRegisterSingletonType<Latency>("AtChat", 1, 0, "Latency",
+        Latency::create);
+
     QQmlApplicationEngine engine;
+    // 聊天图片统一通过 image://media/ 加载，引擎接管 provider 的所有权
+    engine.addImageProvider("media", new MediaImageProvider());
+    engine.addImageProvider("thumb", new MediaImageProvider(MediaImageResponse::Thumbnail));
+    engine.addImageProvider("blurhash", new BlurHashImageProvider());
     QObject::connect(
         &engine,
         &QQmlApplicationEngine::objectCreationFailed,
@@ -0,0 +1,94 @@
+import QtQuick 2.15
+import QtQuick.Layouts 1.15
+import QtQuick.Controls 2.15
+import FluentUI
+import AtChat 1.0
+
+// 群聊输入框的 @ 补全：输入 @ 时 loadAll 在后台补齐成员，候选来自 GroupMemberModel 的前缀索引。
+// 不抢输入焦点，继续输入时由调用方更新 query
+Popup {
+    id: root
+    width: 240
+    height: Math.max(36, Math.min(candidateView.contentHeight, 8 * 36)) + 2 * padding
+    padding: 4
+    closePolicy: Popup.CloseOnEscape | Popup.CloseOnPressOutsideParent
+
+    property alias groupId: members.groupId
+    property string query: ""
+    // [{userId, name}]，"所有人" 在前
+    property var candidates: []
+
+    signal memberSelected(string userId, string name)
+
+    GroupMemberModel {
+        id: members
+        onCountChanged: root.refresh()
+    }
+
+    onQueryChanged: refresh()
+
+    function show(prefix) {
+        query = prefix
+        members.loadAll()
+        refresh()
+        if (!visible) open()
+    }
+
+    function refresh() {
+        var list = []
+        var q = query.toLowerCase()
+        if ("所有人".indexOf(q) === 0 || "all".indexOf(q) === 0) {
+            list.push({userId: "all", name: qsTr("所有人")})
+        }
+        var matches = members.complete(query, 8)
+        for (var i = 0; i < matches.length; i++) list.push(matches[i])
+        candidates = list
+    }
+
+    background: Rectangle {
+        radius: 6
+        color: FluTheme.dark ? Qt.rgba(0.17, 0.17, 0.17, 1) : Qt.rgba(1, 1, 1, 1)
+        border.color: FluTheme.dividerColor
+    }
+
+    ListView {
+        id: candidateView
+        anchors.fill: parent
+        clip: true
+        model: root.candidates
+
+        delegate: Rectangle {
+            width: candidateView.width
+            height: 36
+            radius: 4
+            color: candidateMouse.containsMouse ? FluTheme.itemHoverColor : "transparent"
+
+            FluText {
+                anchors.verticalCenter: parent.verticalCenter
+                anchors.left: parent.left
+                anchors.leftMargin: 10
+                width: parent.width - 20
+                text: modelData.name
+                elide: Text.ElideRight
+            }
+
+            MouseArea {
+                id: candidateMouse
+                anchors.fill: parent
+                hoverEnabled: true
+                cursorShape: Qt.PointingHandCursor
+                onClicked: {
+                    root.memberSelected(modelData.userId, modelData.name)
+                    root.close()
+                }
+            }
+        }
+    }
+
+    FluText {
+        anchors.centerIn: parent
+        visible: root.candidates.length === 0
+        text: members.loading ? qsTr("正在加载成员...") : qsTr("没有匹配的成员")
+        color: FluTheme.fontSecondaryColor
+    }
+}
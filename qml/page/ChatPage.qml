@@ -1,6 +1,7 @@
 import QtQuick 2.15
 import QtQuick.Layouts 1.15
 import QtQuick.Controls 2.15
+import QtQuick.Dialogs
 import FluentUI
 import AtChat 1.0
 import "../global"
@@ -11,10 +12,14 @@ FluPage {
     title: qsTr("聊天")
     launchMode: FluPageType.SingleTask
 
-    property int currentChatIndex: -1
     property string currentChatId: ""
     property string currentChatName: ""
-    property bool currentIsFriend: false
+    property bool currentIsGroup: false
+    // 从补全中选中的成员：名字 → 用户 id，发送时正文里仍保留 "@名字" 的才算 @ 到
+    property var pendingMentions: ({})
+    // 好友名单由 NetworkManager 维护，切换会话只做一次查找
+    property bool currentIsFriend: NetworkManager.roster.revision >= 0
+                                   && NetworkManager.roster.isFriend(currentChatId)
 
     // 登录检查
     LoginRequired {}
@@ -32,6 +37,43 @@ FluPage {
         }
     }
 
+    // 原图查看，只在打开时按窗口尺寸解码
+    Popup {
+        id: imageViewer
+        property string url: ""
+        parent: Overlay.overlay
+        anchors.centerIn: parent
+        width: parent ? parent.width * 0.9 : 0
+        height: parent ? parent.height * 0.9 : 0
+        modal: true
+        padding: 0
+        background: Rectangle { color: Qt.rgba(0, 0, 0, 0.85) }
+
+        function show(url) {
+            imageViewer.url = url
+            open()
+        }
+
+        Image {
+            id: fullImage
+            anchors.fill: parent
+            asynchronous: true
+            fillMode: Image.PreserveAspectFit
+            source: imageViewer.visible && imageViewer.url !== "" ? "image://media/" + encodeURIComponent(imageViewer.url) : ""
+            sourceSize: Qt.size(width, height)
+        }
+
+        FluProgressRing {
+            anchors.centerIn: parent
+            visible: fullImage.status === Image.Loading
+        }
+
+        MouseArea {
+            anchors.fill: parent
+            onClicked: imageViewer.close()
+        }
+    }
+
     property bool usersLoaded: false
 
     Component.onCompleted: {
@@ -53,96 +95,6 @@ FluPage {
 
     Connections {
         target: NetworkManager
-        function onUsersReceived(users) {
-            chatListModel.clear()
-            for (var i = 0; i < users.length; i++) {
-                var u = users[i]
-                if (u.id !== NetworkManager.userId) {
-                    chatListModel.append({
-                        oderId: u.id,
-                        name: u.nickname || u.username,
-                        lastMessage: u.signature || "",
-                        time: "",
-                        unread: 0,
-                        online: u.online
-                    })
-                }
-            }
-        }
-        function onMessageReceived(msg) {
-            console.log("Message received:", JSON.stringify(msg))
-            var isMe = msg.from === NetworkManager.userId
-            var otherUserId = isMe ? msg.to : msg.from
-
-            // 如果是当前聊天，添加消息
-            if (currentChatId !== "" && currentChatId === otherUserId) {
-                var msgTime = msg.timestamp ? new Date(msg.timestamp) : new Date()
-                messageModel.append({
-                    isMe: isMe,
-                    content: msg.content,
-                    time: Qt.formatTime(msgTime, "hh:mm"),
-                    isRead: false
-                })
-                Qt.callLater(function() { messageListView.positionViewAtEnd() })
-            }
-
-            // 更新会话列表
-            var found = false
-            for (var i = 0; i < chatListModel.count; i++) {
-                if (chatListModel.get(i).oderId === otherUserId) {
-                    chatListModel.setProperty(i, "lastMessage", msg.content)
-                    chatListModel.setProperty(i, "time", Qt.formatTime(new Date(), "hh:mm"))
-                    if (!isMe && currentChatId !== otherUserId) {
-                        chatListModel.setProperty(i, "unread", chatListModel.get(i).unread + 1)
-                    }
-                    found = true
-                    break
-                }
-            }
-
-            // 如果会话列表中没有这个用户，添加它
-            if (!found && !isMe) {
-                chatListModel.insert(0, {
-                    oderId: otherUserId,
-                    name: otherUserId.substring(0, 8),
-                    lastMessage: msg.content,
-                    time: Qt.formatTime(new Date(), "hh:mm"),
-                    unread: currentChatId !== otherUserId ? 1 : 0,
-                    online: false
-                })
-            }
-        }
-        function onUserStatusChanged(userId, online) {
-            for (var i = 0; i < chatListModel.count; i++) {
-                if (chatListModel.get(i).oderId === userId) {
-                    chatListModel.setProperty(i, "online", online)
-                    break
-                }
-            }
-        }
-        function onHistoryReceived(messages) {
-            messageModel.clear()
-            var lastDate = ""
-            for (var i = 0; i < messages.length; i++) {
-                var msg = messages[i]
-                var msgDate = new Date(msg.timestamp)
-                var dateStr = Qt.formatDate(msgDate, "yyyy-MM-dd")
-                var timeStr = Qt.formatTime(msgDate, "hh:mm")
-
-                if (dateStr !== lastDate) {
-                    lastDate = dateStr
-                    timeStr = dateStr + " " + timeStr
-                }
-
-                messageModel.append({
-                    isMe: msg.from === NetworkManager.userId,
-                    content: msg.content,
-                    time: timeStr,
-                    isRead: msg.is_read
-                })
-            }
-            messageListView.positionViewAtEnd()
-        }
         function onMessagesDeleted(success) {
             if (success) {
                 showSuccess(qsTr("删除成功"))
@@ -153,45 +105,89 @@ FluPage {
         }
     }
 
-    ListModel { id: chatListModel }
-    ListModel { id: messageModel }
+    MessageListModel {
+        id: messageModel
+        group: root.currentIsGroup
+    }
 
     function sendMsg() {
         var text = inputBox.text.trim()
         if (text.length > 0 && currentChatId !== "") {
-            NetworkManager.sendMessage(currentChatId, text, "text")
+            if (currentIsGroup) {
+                var mentions = []
+                for (var name in pendingMentions) {
+                    var id = pendingMentions[name]
+                    if (text.indexOf("@" + name) >= 0 && mentions.indexOf(id) < 0) mentions.push(id)
+                }
+                NetworkManager.sendGroupMessage(currentChatId, text, "text", mentions)
+            } else {
+                NetworkManager.sendMessage(currentChatId, text, "text")
+            }
+            pendingMentions = {}
+            mentionPopup.close()
             inputBox.clear()
         }
     }
 
-    function loadMessages(chatIndex) {
-        messageModel.clear()
-        if (chatIndex >= 0 && chatIndex < chatListModel.count) {
-            var chat = chatListModel.get(chatIndex)
-            NetworkManager.fetchHistory(chat.oderId)
-            chatListModel.setProperty(chatIndex, "unread", 0)
-            checkFriendStatus(chat.oderId)
+    // 光标前最近的 @ 到光标之间没有空白时，视为正在输入 @ 的名字
+    function mentionStart() {
+        var before = inputBox.text.substring(0, inputBox.cursorPosition)
+        var at = before.lastIndexOf("@")
+        if (at < 0 || /\s/.test(before.substring(at + 1))) return -1
+        return at
+    }
+
+    function updateMention() {
+        var at = currentIsGroup ? mentionStart() : -1
+        if (at < 0) {
+            mentionPopup.close()
+            return
         }
+        mentionPopup.show(inputBox.text.substring(at + 1, inputBox.cursorPosition))
     }
 
-    function checkFriendStatus(userId) {
-        var xhr = new XMLHttpRequest()
-        xhr.open("GET", "http://localhost:8080/api/friends?user_id=" + NetworkManager.userId)
-        xhr.onreadystatechange = function() {
-            if (xhr.readyState === XMLHttpRequest.DONE && xhr.status === 200) {
-                var friends = JSON.parse(xhr.responseText)
-                root.currentIsFriend = false
-                if (friends && friends.length) {
-                    for (var i = 0; i < friends.length; i++) {
-                        if (friends[i].friend_id === userId) {
-                            root.currentIsFriend = true
-                            break
-                        }
-                    }
-                }
-            }
+    function insertMention(userId, name) {
+        var at = mentionStart()
+        if (at < 0) return
+        var cursor = inputBox.cursorPosition
+        inputBox.remove(at, cursor)
+        inputBox.insert(at, "@" + name + " ")
+        inputBox.cursorPosition = at + name.length + 2
+        var mentions = pendingMentions
+        mentions[name] = userId
+        pendingMentions = mentions
+        inputBox.forceActiveFocus()
+    }
+
+    property var searchResults: []
+
+    function runSearch() {
+        var query = searchBox.text.trim()
+        searchResults = query === "" ? [] : SearchIndex.search(query, 50)
+    }
+
+    function conversationName(conversationId) {
+        var row = ConversationListModel.indexOf(conversationId)
+        if (row >= 0) return ConversationListModel.get(row).name
+        return NetworkManager.roster.displayName(conversationId)
+    }
+
+    // 索引构建完成后刷新正在显示的结果
+    Connections {
+        target: SearchIndex
+        function onBuildingChanged() {
+            if (!SearchIndex.building) root.runSearch()
+        }
+    }
+
+    function loadMessages(chatId) {
+        var row = ConversationListModel.indexOf(chatId)
+        currentIsGroup = row >= 0 && ConversationListModel.get(row).isGroup
+        pendingMentions = {}
+        messageModel.conversationId = chatId
+        if (chatId !== "") {
+            ConversationListModel.activeConversation = chatId
         }
-        xhr.send()
     }
 
     RowLayout {
@@ -208,28 +204,101 @@ FluPage {
                 anchors.fill: parent
                 spacing: 0
 
-                // 搜索框
+                // 搜索框：在本地索引中搜索聊天记录
                 FluTextBox {
+                    id: searchBox
                     Layout.fillWidth: true
                     Layout.margins: 10
-                    placeholderText: qsTr("搜索")
+                    placeholderText: qsTr("搜索聊天记录")
                     iconSource: FluentIcons.Search
+                    onTextChanged: root.runSearch()
+                }
+
+                FluText {
+                    visible: searchBox.text.trim() !== "" && SearchIndex.building
+                    Layout.leftMargin: 12
+                    text: qsTr("正在建立索引，结果可能不完整")
+                    font: FluTextStyle.Caption
+                    color: FluTheme.fontSecondaryColor
+                }
+
+                // 搜索结果
+                ListView {
+                    id: searchResultView
+                    visible: searchBox.text.trim() !== ""
+                    Layout.fillWidth: true
+                    Layout.fillHeight: true
+                    model: root.searchResults
+                    clip: true
+
+                    delegate: Rectangle {
+                        width: searchResultView.width
+                        height: 60
+                        color: resultMouseArea.containsMouse ? FluTheme.itemHoverColor : "transparent"
+
+                        ColumnLayout {
+                            anchors.fill: parent
+                            anchors.margins: 10
+                            spacing: 4
+
+                            RowLayout {
+                                Layout.fillWidth: true
+                                FluText {
+                                    text: root.conversationName(modelData.conversationId)
+                                    font: FluTextStyle.BodyStrong
+                                    Layout.fillWidth: true
+                                    elide: Text.ElideRight
+                                }
+                                FluText {
+                                    text: modelData.time
+                                    font: FluTextStyle.Caption
+                                    color: FluTheme.fontSecondaryColor
+                                }
+                            }
+                            FluText {
+                                text: modelData.content
+                                font: FluTextStyle.Caption
+                                color: FluTheme.fontSecondaryColor
+                                Layout.fillWidth: true
+                                elide: Text.ElideRight
+                            }
+                        }
+
+                        MouseArea {
+                            id: resultMouseArea
+                            anchors.fill: parent
+                            hoverEnabled: true
+                            onClicked: {
+                                root.currentChatId = modelData.conversationId
+                                root.currentChatName = root.conversationName(modelData.conversationId)
+                                loadMessages(modelData.conversationId)
+                                searchBox.text = ""
+                            }
+                        }
+                    }
+
+                    FluText {
+                        anchors.centerIn: parent
+                        visible: searchResultView.count === 0
+                        text: qsTr("没有找到相关聊天记录")
+                        color: FluTheme.fontSecondaryColor
+                    }
                 }
 
                 // 会话列表
                 ListView {
                     id: chatListView
+                    visible: !searchResultView.visible
                     Layout.fillWidth: true
                     Layout.fillHeight: true
-                    model: chatListModel
+                    model: ConversationListModel
                     clip: true
-                    currentIndex: root.currentChatIndex
 
                     delegate: Rectangle {
                         width: chatListView.width
                         height: 70
                         color: {
-                            if (chatListView.currentIndex === index)
+                            if (model.conversationId === root.currentChatId)
                                 return FluTheme.dark ? Qt.rgba(0.1, 0.1, 0.1, 1) : Qt.rgba(0.9, 0.9, 0.9, 1)
                             if (mouseArea.containsMouse)
                                 return FluTheme.itemHoverColor
@@ -291,6 +360,12 @@ FluPage {
 
                                 RowLayout {
                                     Layout.fillWidth: true
+                                    FluText {
+                                        visible: model.mentioned
+                                        text: qsTr("[有人@我]")
+                                        font: FluTextStyle.Caption
+                                        color: "#F44336"
+                                    }
                                     FluText {
                                         text: model.lastMessage
                                         font: FluTextStyle.Caption
@@ -321,10 +396,9 @@ FluPage {
                             anchors.fill: parent
                             hoverEnabled: true
                             onClicked: {
-                                root.currentChatIndex = index
-                                root.currentChatId = model.oderId
+                                root.currentChatId = model.conversationId
                                 root.currentChatName = model.name
-                                loadMessages(index)
+                                loadMessages(model.conversationId)
                             }
                         }
                     }
@@ -395,12 +469,12 @@ FluPage {
 
                                 onNeutralClicked: {
                                     NetworkManager.deleteMessages(currentChatId, false)
-                                    messageModel.clear()
+                                    messageModel.deleteLocal()
                                 }
 
                                 onPositiveClicked: {
                                     NetworkManager.deleteMessages(currentChatId, true)
-                                    messageModel.clear()
+                                    messageModel.deleteLocal()
                                 }
                             }
                         }
@@ -459,6 +533,11 @@ FluPage {
                     model: messageModel
                     clip: true
                     spacing: 10
+                    // 行 0 为最新消息，向上翻页时已显示的消息位置保持不变
+                    verticalLayoutDirection: ListView.BottomToTop
+                    onAtYEndChanged: {
+                        if (atYEnd) messageModel.trimToWindow()
+                    }
 
                     delegate: Item {
                         width: messageListView.width
@@ -471,11 +550,11 @@ FluPage {
                             // 时间戳
                             FluText {
                                 id: timeText
-                                text: model.time
+                                text: model.dateLabel !== "" ? model.dateLabel + " " + model.time : model.time
                                 font: FluTextStyle.Caption
                                 color: FluTheme.fontSecondaryColor
                                 Layout.alignment: Qt.AlignHCenter
-                                visible: index === 0 || (index > 0 && model.time !== messageModel.get(index - 1).time)
+                                visible: model.showTime
                             }
 
                             RowLayout {
@@ -502,14 +581,53 @@ FluPage {
                                 // 消息气泡
                                 Rectangle {
                                     id: msgBubble
+                                    readonly property bool isImage: model.type === "image"
                                     Layout.maximumWidth: messageListView.width * 0.6
-                                    implicitWidth: msgText.implicitWidth + 24
-                                    implicitHeight: msgText.implicitHeight + 16
+                                    implicitWidth: isImage ? imageContent.width + 8 : msgText.implicitWidth + 24
+                                    implicitHeight: isImage ? imageContent.height + 8 : msgText.implicitHeight + 16
                                     radius: 8
                                     color: model.isMe ? FluTheme.primaryColor : (FluTheme.dark ? Qt.rgba(0.15, 0.15, 0.15, 1) : "white")
 
+                                    // 图片消息：先显示 blurhash 占位，缩略图解码完成后覆盖，点击才加载原图
+                                    Item {
+                                        id: imageContent
+                                        visible: msgBubble.isImage
+                                        anchors.centerIn: parent
+                                        readonly property real ratio: model.mediaWidth > 0 && model.mediaHeight > 0
+                                                                      ? model.mediaHeight / model.mediaWidth : 0.75
+                                        width: Math.min(240, messageListView.width * 0.6 - 8)
+                                        height: Math.min(320, width * ratio)
+
+                                        Image {
+                                            anchors.fill: parent
+                                            visible: thumbImage.status !== Image.Ready
+                                            source: msgBubble.isImage && model.blurhash !== ""
+                                                    ? "image://blurhash/" + encodeURIComponent(model.blurhash) : ""
+                                            sourceSize: Qt.size(32, 32)
+                                            smooth: true
+                                        }
+
+                                        Image {
+                                            id: thumbImage
+                                            anchors.fill: parent
+                                            asynchronous: true
+                                            fillMode: Image.PreserveAspectCrop
+                                            source: !msgBubble.isImage ? ""
+                                                    : model.thumbUrl !== "" ? "image://media/" + encodeURIComponent(model.thumbUrl)
+                                                    : "image://thumb/" + encodeURIComponent(model.content)
+                                            sourceSize: Qt.size(width, height)
+                                        }
+
+                                        MouseArea {
+                                            anchors.fill: parent
+                                            cursorShape: Qt.PointingHandCursor
+                                            onClicked: imageViewer.show(model.content)
+                                        }
+                                    }
+
                                     FluText {
                                         id: msgText
+                                        visible: !msgBubble.isImage
                                         anchors.centerIn: parent
                                         width: Math.min(implicitWidth, messageListView.width * 0.6 - 24)
                                         text: model.content
@@ -519,6 +637,31 @@ FluPage {
                                     }
                                 }
 
+                                // 发送状态
+                                FluText {
+                                    visible: model.isMe && model.status !== ""
+                                    text: {
+                                        switch (model.status) {
+                                        case "pending": return qsTr("发送中")
+                                        case "sent": return qsTr("已发送")
+                                        case "delivered": return qsTr("已送达")
+                                        case "read": return qsTr("已读")
+                                        case "failed": return qsTr("发送失败，点击重试")
+                                        }
+                                        return ""
+                                    }
+                                    font: FluTextStyle.Caption
+                                    color: model.status === "failed" ? "#F44336" : FluTheme.fontSecondaryColor
+                                    Layout.alignment: Qt.AlignBottom
+
+                                    MouseArea {
+                                        anchors.fill: parent
+                                        enabled: model.status === "failed"
+                                        cursorShape: enabled ? Qt.PointingHandCursor : Qt.ArrowCursor
+                                        onClicked: NetworkManager.resendMessage(model.clientId)
+                                    }
+                                }
+
                                 Item { Layout.fillWidth: true }
                             }
                         }
@@ -552,11 +695,24 @@ FluPage {
                                 iconSize: 18
                                 onClicked: emojiPicker.open()
                             }
-                            FluIconButton { iconSource: FluentIcons.Picture; iconSize: 18 }
+                            FluIconButton {
+                                iconSource: FluentIcons.Picture
+                                iconSize: 18
+                                onClicked: imageDialog.open()
+                            }
                             FluIconButton { iconSource: FluentIcons.Attach; iconSize: 18 }
                             FluIconButton { iconSource: FluentIcons.History; iconSize: 18 }
                         }
 
+                        FileDialog {
+                            id: imageDialog
+                            title: qsTr("选择图片")
+                            nameFilters: [qsTr("图片 (*.png *.jpg *.jpeg *.gif *.bmp *.webp)")]
+                            onAccepted: {
+                                if (currentChatId !== "") MediaPipeline.sendImage(currentChatId, selectedFile.toString(), currentIsGroup)
+                            }
+                        }
+
                         EmojiPicker {
                             id: emojiPicker
                             onEmojiSelected: function(emoji) {
@@ -578,6 +734,17 @@ FluPage {
                                 onCommit: function(text) {
                                     sendMsg()
                                 }
+                                onTextChanged: root.updateMention()
+                                onCursorPositionChanged: root.updateMention()
+
+                                MentionPopup {
+                                    id: mentionPopup
+                                    groupId: root.currentIsGroup ? root.currentChatId : ""
+                                    y: -height - 4
+                                    onMemberSelected: function(userId, name) {
+                                        root.insertMention(userId, name)
+                                    }
+                                }
                             }
 
                             FluFilledButton {
@@ -18,9 +18,6 @@ FluPage {
     AddFriendDialog { id: addFriendDialog }
     FriendRequestsPage { id: friendRequestsDialog }
 
-    ListModel { id: contactsModel }
-    ListModel { id: friendsModel }
-
     property bool friendsLoaded: false
 
     Component.onCompleted: {
@@ -38,77 +35,20 @@ FluPage {
                 friendsLoaded = true
             }
         }
-        function onFriendGroupsReceived(groups) {
-            contactsModel.clear()
-            for (var i = 0; i < groups.length; i++) {
-                contactsModel.append({groupName: groups[i].name, groupId: groups[i].id, expanded: true})
-            }
-        }
-        function onFriendsReceived(friends) {
-            friendsModel.clear()
-            for (var i = 0; i < friends.length; i++) {
-                var f = friends[i]
-                var groupName = getGroupNameById(f.group_id)
-                friendsModel.append({
-                    id: f.friend_id,
-                    name: f.remark || f.nickname,
-                    nickname: f.nickname,
-                    signature: f.signature,
-                    group: groupName,
-                    groupId: f.group_id,
-                    online: f.online,
-                    isMutual: f.is_mutual,
-                    remark: f.remark,
-                    note: f.note
-                })
-            }
-        }
-        function onFriendRequestHandled(success) {
-            if (success && !friendsLoaded) {
-                loadFriends()
-                friendsLoaded = true
+        function onUserChanged() {
+            if (NetworkManager.userId === "") {
+                friendsLoaded = false
+                currentContact = null
             }
         }
     }
 
+    // 分组与好友由 ContactsModel 组装，分组计数随在线状态增量更新
     function loadFriends() {
         NetworkManager.fetchFriendGroups()
         NetworkManager.fetchFriends()
     }
 
-    function getGroupNameById(groupId) {
-        for (var i = 0; i < contactsModel.count; i++) {
-            if (contactsModel.get(i).groupId === groupId) return contactsModel.get(i).groupName
-        }
-        return "我的好友"
-    }
-
-    function getFriendsByGroup(groupName) {
-        var friends = []
-        for (var i = 0; i < friendsModel.count; i++) {
-            var friend = friendsModel.get(i)
-            if (friend.group === groupName) friends.push(friend)
-        }
-        return friends
-    }
-
-    function getOnlineCount(groupName) {
-        var count = 0
-        for (var i = 0; i < friendsModel.count; i++) {
-            var friend = friendsModel.get(i)
-            if (friend.group === groupName && friend.online) count++
-        }
-        return count
-    }
-
-    function getTotalCount(groupName) {
-        var count = 0
-        for (var i = 0; i < friendsModel.count; i++) {
-            if (friendsModel.get(i).group === groupName) count++
-        }
-        return count
-    }
-
     RowLayout {
         anchors.fill: parent
         spacing: 0
@@ -181,20 +121,27 @@ FluPage {
                     }
                 }
 
-                // 好友分组列表
+                // 好友分组列表：分组标题与展开分组中的好友平铺为同一列表的行
                 ListView {
                     id: groupListView
                     Layout.fillWidth: true
                     Layout.fillHeight: true
-                    model: contactsModel
+                    model: ContactsModel
                     clip: true
 
-                    delegate: Column {
+                    delegate: Loader {
                         width: groupListView.width
+                        sourceComponent: model.isHeader ? groupHeader : friendItem
+
+                        // Loader 是所加载组件的上下文对象，组件内可直接访问这两个属性
+                        property int row: index
+                        property var entry: model
+                    }
+
+                    Component {
+                        id: groupHeader
 
-                        // 分组标题
                         Rectangle {
-                            width: parent.width
                             height: 36
                             color: groupMouse.containsMouse ? FluTheme.itemHoverColor : "transparent"
 
@@ -205,18 +152,18 @@ FluPage {
                                 spacing: 5
 
                                 FluIcon {
-                                    iconSource: model.expanded ? FluentIcons.ChevronDown : FluentIcons.ChevronRight
+                                    iconSource: entry.expanded ? FluentIcons.ChevronDown : FluentIcons.ChevronRight
                                     iconSize: 12
                                 }
 
                                 FluText {
-                                    text: model.groupName
+                                    text: entry.groupName
                                     font: FluTextStyle.Caption
                                     Layout.fillWidth: true
                                 }
 
                                 FluText {
-                                    text: getOnlineCount(model.groupName) + "/" + getTotalCount(model.groupName)
+                                    text: entry.onlineCount + "/" + entry.totalCount
                                     font: FluTextStyle.Caption
                                     color: FluTheme.fontSecondaryColor
                                 }
@@ -226,87 +173,84 @@ FluPage {
                                 id: groupMouse
                                 anchors.fill: parent
                                 hoverEnabled: true
-                                onClicked: {
-                                    contactsModel.setProperty(index, "expanded", !model.expanded)
-                                }
+                                onClicked: ContactsModel.toggleGroup(row)
                             }
                         }
+                    }
+
+                    Component {
+                        id: friendItem
+
+                        Rectangle {
+                            height: 55
+                            color: {
+                                if (currentContact && currentContact.id === entry.friendId)
+                                    return FluTheme.dark ? Qt.rgba(0.1, 0.1, 0.1, 1) : Qt.rgba(0.9, 0.9, 0.9, 1)
+                                if (friendMouse.containsMouse)
+                                    return FluTheme.itemHoverColor
+                                return "transparent"
+                            }
+
+                            RowLayout {
+                                anchors.fill: parent
+                                anchors.leftMargin: 20
+                                anchors.rightMargin: 10
+                                spacing: 10
+
+                                // 头像
+                                Rectangle {
+                                    width: 40
+                                    height: 40
+                                    radius: 4
+                                    color: entry.online ? FluTheme.primaryColor : "#9E9E9E"
+
+                                    FluText {
+                                        anchors.centerIn: parent
+                                        text: entry.name.charAt(0)
+                                        color: "white"
+                                        font.pixelSize: 16
+                                    }
 
-                        // 分组内的好友
-                        Repeater {
-                            model: parent.parent.model.expanded ? getFriendsByGroup(parent.parent.model.groupName) : []
-                            delegate: Rectangle {
-                                    width: groupListView.width
-                                    height: 55
-                                    color: {
-                                        if (currentContact && currentContact.name === modelData.name)
-                                            return FluTheme.dark ? Qt.rgba(0.1, 0.1, 0.1, 1) : Qt.rgba(0.9, 0.9, 0.9, 1)
-                                        if (friendMouse.containsMouse)
-                                            return FluTheme.itemHoverColor
-                                        return "transparent"
+                                    Rectangle {
+                                        visible: entry.online
+                                        width: 10
+                                        height: 10
+                                        radius: 5
+                                        color: "#4CAF50"
+                                        anchors.right: parent.right
+                                        anchors.bottom: parent.bottom
+                                        border.width: 2
+                                        border.color: FluTheme.dark ? "#1a1a1a" : "#f0f0f0"
                                     }
+                                }
+
+                                ColumnLayout {
+                                    Layout.fillWidth: true
+                                    spacing: 3
 
-                                    RowLayout {
-                                        anchors.fill: parent
-                                        anchors.leftMargin: 20
-                                        anchors.rightMargin: 10
-                                        spacing: 10
-
-                                        // 头像
-                                        Rectangle {
-                                            width: 40
-                                            height: 40
-                                            radius: 4
-                                            color: modelData.online ? FluTheme.primaryColor : "#9E9E9E"
-
-                                            FluText {
-                                                anchors.centerIn: parent
-                                                text: modelData.name.charAt(0)
-                                                color: "white"
-                                                font.pixelSize: 16
-                                            }
-
-                                            Rectangle {
-                                                visible: modelData.online
-                                                width: 10
-                                                height: 10
-                                                radius: 5
-                                                color: "#4CAF50"
-                                                anchors.right: parent.right
-                                                anchors.bottom: parent.bottom
-                                                border.width: 2
-                                                border.color: FluTheme.dark ? "#1a1a1a" : "#f0f0f0"
-                                            }
-                                        }
-
-                                        ColumnLayout {
-                                            Layout.fillWidth: true
-                                            spacing: 3
-
-                                            FluText {
-                                                text: modelData.name
-                                                font: FluTextStyle.Body
-                                            }
-
-                                            FluText {
-                                                text: modelData.signature || qsTr("[无签名]")
-                                                font: FluTextStyle.Caption
-                                                color: FluTheme.fontSecondaryColor
-                                                elide: Text.ElideRight
-                                                Layout.fillWidth: true
-                                            }
-                                        }
+                                    FluText {
+                                        text: entry.name
+                                        font: FluTextStyle.Body
                                     }
 
-                                    MouseArea {
-                                        id: friendMouse
-                                        anchors.fill: parent
-                                        hoverEnabled: true
-                                        onClicked: {
-                                            root.currentContact = modelData
-                                        }
+                                    FluText {
+                                        text: entry.signature || qsTr("[无签名]")
+                                        font: FluTextStyle.Caption
+                                        color: FluTheme.fontSecondaryColor
+                                        elide: Text.ElideRight
+                                        Layout.fillWidth: true
                                     }
                                 }
+                            }
+
+                            MouseArea {
+                                id: friendMouse
+                                anchors.fill: parent
+                                hoverEnabled: true
+                                onClicked: {
+                                    root.currentContact = ContactsModel.get(row)
+                                }
+                            }
                         }
                     }
                 }
@@ -479,7 +423,6 @@ FluPage {
                     onPositiveClicked: {
                         if (currentContact) {
                             NetworkManager.updateFriendRemark(currentContact.id, remarkInput.text)
-                            loadFriends()
                         }
                     }
                 }
@@ -322,26 +322,26 @@ FluPage {
         }
     }
 
+    // 资料来自 NetworkManager 维护的用户索引，未加载时请求一次用户列表
     function loadUserProfile() {
-        var xhr = new XMLHttpRequest()
-        xhr.open("GET", "http://localhost:8080/api/users")
-        xhr.onreadystatechange = function() {
-            if (xhr.readyState === XMLHttpRequest.DONE && xhr.status === 200) {
-                var users = JSON.parse(xhr.responseText)
-                if (users && users.length) {
-                    for (var i = 0; i < users.length; i++) {
-                        if (users[i].id === NetworkManager.userId) {
-                            signatureInput.text = users[i].signature || ""
-                            currentStatus = users[i].status || 0
-                            statusCombo.currentIndex = currentStatus
-                            likesText.text = users[i].likes || 0
-                            break
-                        }
-                    }
-                }
-            }
+        if (!applyProfile()) NetworkManager.fetchUsers()
+    }
+
+    function applyProfile() {
+        var me = NetworkManager.roster.user(NetworkManager.userId)
+        if (me.id === undefined) return false
+        signatureInput.text = me.signature || ""
+        currentStatus = me.status || 0
+        statusCombo.currentIndex = currentStatus
+        likesText.text = me.likes || 0
+        return true
+    }
+
+    Connections {
+        target: NetworkManager
+        function onUsersReceived() {
+            applyProfile()
         }
-        xhr.send()
     }
 
     Connections {
@@ -874,6 +874,173 @@ FluPage {
             }
         }
 
+        // 诊断
+        FluPivotItem {
+            title: qsTr("诊断")
+            contentItem: FluScrollablePage {
+                id: diagnostics
+                property var latency: []
+                property var socket: ({})
+                property var requests: []
+                property var ordering: ({})
+
+                function refresh() {
+                    latency = Latency.snapshot()
+                    socket = NetworkManager.socketStats()
+                    requests = NetworkManager.requestStats()
+                    ordering = NetworkManager.orderingStats()
+                }
+
+                function formatMs(value) {
+                    return value < 10 ? value.toFixed(2) : value.toFixed(0)
+                }
+
+                // 只在页面可见时刷新
+                Timer {
+                    interval: 1000
+                    repeat: true
+                    running: diagnostics.visible
+                    triggeredOnStart: true
+                    onTriggered: diagnostics.refresh()
+                }
+
+                ColumnLayout {
+                    width: parent.width
+                    spacing: 20
+
+                    // 消息链路各阶段耗时
+                    FluFrame {
+                        Layout.fillWidth: true
+                        Layout.topMargin: 10
+                        padding: 10
+
+                        ColumnLayout {
+                            width: parent.width
+                            spacing: 8
+
+                            FluText {
+                                text: qsTr("消息延迟（毫秒）")
+                                font: FluTextStyle.BodyStrong
+                            }
+
+                            GridLayout {
+                                columns: 7
+                                columnSpacing: 20
+                                rowSpacing: 6
+
+                                Repeater {
+                                    model: [qsTr("阶段"), qsTr("次数"), "p50", "p95", "p99", "p99.9", qsTr("最大")]
+                                    delegate: FluText {
+                                        text: modelData
+                                        color: FluColors.Grey120
+                                    }
+                                }
+
+                                Repeater {
+                                    model: diagnostics.latency
+                                    delegate: Repeater {
+                                        property var row: modelData
+                                        model: [row.stage, row.count,
+                                            diagnostics.formatMs(row.p50), diagnostics.formatMs(row.p95),
+                                            diagnostics.formatMs(row.p99), diagnostics.formatMs(row.p999),
+                                            diagnostics.formatMs(row.max)]
+                                        delegate: FluText {
+                                            text: modelData
+                                        }
+                                    }
+                                }
+                            }
+
+                            FluText {
+                                text: qsTr("transit 由服务器时间戳计算，客户端与服务器时钟不一致时仅供参考")
+                                color: FluColors.Grey120
+                                font: FluTextStyle.Caption
+                            }
+
+                            FluText {
+                                text: qsTr("frame 为消息持续到达期间相邻两帧的间隔，60Hz 屏幕上理想值约 16.7ms")
+                                color: FluColors.Grey120
+                                font: FluTextStyle.Caption
+                            }
+                        }
+                    }
+
+                    // 连接与请求统计
+                    FluFrame {
+                        Layout.fillWidth: true
+                        padding: 10
+
+                        ColumnLayout {
+                            width: parent.width
+                            spacing: 8
+
+                            FluText {
+                                text: qsTr("连接")
+                                font: FluTextStyle.BodyStrong
+                            }
+
+                            FluText {
+                                text: qsTr("格式 %1%2，收 %3 帧 %4 字节（解码后 %5），发 %6 帧 %7 字节（编码前 %8）")
+                                    .arg(diagnostics.socket.format || "-")
+                                    .arg(diagnostics.socket.compressed ? qsTr("，已压缩") : "")
+                                    .arg(diagnostics.socket.inFrames || 0)
+                                    .arg(diagnostics.socket.inWireBytes || 0)
+                                    .arg(diagnostics.socket.inDecodedBytes || 0)
+                                    .arg(diagnostics.socket.outFrames || 0)
+                                    .arg(diagnostics.socket.outWireBytes || 0)
+                                    .arg(diagnostics.socket.outDecodedBytes || 0)
+                                wrapMode: Text.WordWrap
+                                Layout.fillWidth: true
+                            }
+
+                            FluText {
+                                text: qsTr("消息排序：缓冲 %1，重排 %2，重复 %3，补拉 %4 次，跳过 %5")
+                                    .arg(diagnostics.ordering.buffered || 0)
+                                    .arg(diagnostics.ordering.reordered || 0)
+                                    .arg(diagnostics.ordering.duplicates || 0)
+                                    .arg(diagnostics.ordering.gapFetches || 0)
+                                    .arg(diagnostics.ordering.skipped || 0)
+                            }
+
+                            Repeater {
+                                model: diagnostics.requests
+                                delegate: FluText {
+                                    text: qsTr("%1：%2 次，平均 %3 ms，最大 %4 ms，缓存命中 %5，失败 %6")
+                                        .arg(modelData.endpoint).arg(modelData.requests)
+                                        .arg(modelData.avgMs).arg(modelData.maxMs)
+                                        .arg(modelData.cacheHits).arg(modelData.errors)
+                                }
+                            }
+                        }
+                    }
+
+                    Row {
+                        spacing: 10
+
+                        FluFilledButton {
+                            text: qsTr("导出 JSON")
+                            onClicked: {
+                                var path = Latency.exportToFile()
+                                if (path) {
+                                    showSuccess(qsTr("已导出到 %1").arg(path))
+                                } else {
+                                    showError(qsTr("导出失败"))
+                                }
+                            }
+                        }
+
+                        FluButton {
+                            text: qsTr("重置")
+                            onClicked: {
+                                Latency.reset()
+                                diagnostics.refresh()
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
         // 关于
         FluPivotItem {
             title: qsTr("关于")
@@ -3,6 +3,7 @@ import QtQuick.Controls 2.15
 import QtQuick.Layouts 1.15
 import FluentUI 1.0
 import Qt.labs.platform 1.0
+import AtChat 1.0
 import "../component"
 
 FluWindow {
@@ -64,7 +65,9 @@ FluWindow {
         FluButton{
             text: qsTr("Report Logs")
             onClicked: {
-                FluTools.showFileInFolder(crashFilePath)
+                // 导出内存中的跟踪事件并定位到该文件，崩溃日志在另一目录，写入失败时才退回崩溃日志
+                var tracePath = Trace.dumpToFile()
+                FluTools.showFileInFolder(tracePath !== "" ? tracePath : crashFilePath)
             }
         }
         Item{
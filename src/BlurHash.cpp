@@ -0,0 +1,185 @@
+#include "BlurHash.h"
+#include <QVector>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+const double PI = 3.14159265358979323846;
+
+const char CHARACTERS[] =
+    "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz#$%*+,-.:;=?@[]^_{|}~";
+
+struct Color {
+    double r = 0;
+    double g = 0;
+    double b = 0;
+};
+
+QString encode83(int value, int length)
+{
+    QString result(length, QChar('0'));
+    for (int i = length - 1; i >= 0; --i) {
+        result[i] = QLatin1Char(CHARACTERS[value % 83]);
+        value /= 83;
+    }
+    return result;
+}
+
+int decode83(QStringView str)
+{
+    int value = 0;
+    for (QChar c : str) {
+        if (c.unicode() == 0 || c.unicode() > 0x7f) return -1;
+        const char *found = std::strchr(CHARACTERS, c.toLatin1());
+        if (!found) return -1;
+        value = value * 83 + int(found - CHARACTERS);
+    }
+    return value;
+}
+
+double srgbToLinear(int value)
+{
+    double v = value / 255.0;
+    return v <= 0.04045 ? v / 12.92 : std::pow((v + 0.055) / 1.055, 2.4);
+}
+
+int linearToSrgb(double value)
+{
+    double v = qBound(0.0, value, 1.0);
+    if (v <= 0.0031308) return int(v * 12.92 * 255 + 0.5);
+    return int((1.055 * std::pow(v, 1 / 2.4) - 0.055) * 255 + 0.5);
+}
+
+double signPow(double value, double exp)
+{
+    return std::copysign(std::pow(std::abs(value), exp), value);
+}
+
+}
+
+namespace BlurHash {
+
+QString encode(const QImage &source, int componentsX, int componentsY)
+{
+    if (source.isNull() || componentsX < 1 || componentsX > 9 || componentsY < 1 || componentsY > 9) {
+        return QString();
+    }
+
+    // 分量只描述低频信息，缩小后计算结果几乎不变，开销降低几个数量级
+    QImage image = source.scaled(32, 32, Qt::KeepAspectRatio, Qt::SmoothTransformation)
+                       .convertToFormat(QImage::Format_RGB32);
+    const int width = image.width();
+    const int height = image.height();
+
+    QVector<double> linear(width * height * 3);
+    for (int y = 0; y < height; ++y) {
+        const QRgb *line = reinterpret_cast<const QRgb *>(image.constScanLine(y));
+        for (int x = 0; x < width; ++x) {
+            double *p = &linear[(y * width + x) * 3];
+            p[0] = srgbToLinear(qRed(line[x]));
+            p[1] = srgbToLinear(qGreen(line[x]));
+            p[2] = srgbToLinear(qBlue(line[x]));
+        }
+    }
+
+    QVector<Color> factors;
+    factors.reserve(componentsX * componentsY);
+    for (int j = 0; j < componentsY; ++j) {
+        for (int i = 0; i < componentsX; ++i) {
+            Color c;
+            for (int y = 0; y < height; ++y) {
+                double by = std::cos(PI * j * y / height);
+                for (int x = 0; x < width; ++x) {
+                    double basis = std::cos(PI * i * x / width) * by;
+                    const double *p = &linear[(y * width + x) * 3];
+                    c.r += basis * p[0];
+                    c.g += basis * p[1];
+                    c.b += basis * p[2];
+                }
+            }
+            double scale = (i == 0 && j == 0 ? 1.0 : 2.0) / (width * height);
+            c.r *= scale;
+            c.g *= scale;
+            c.b *= scale;
+            factors.append(c);
+        }
+    }
+
+    QString hash = encode83((componentsX - 1) + (componentsY - 1) * 9, 1);
+
+    double maxValue = 1;
+    if (factors.size() > 1) {
+        double actualMax = 0;
+        for (int k = 1; k < factors.size(); ++k) {
+            actualMax = qMax(actualMax, qMax(std::abs(factors[k].r),
+                                             qMax(std::abs(factors[k].g), std::abs(factors[k].b))));
+        }
+        int quantisedMax = qBound(0, int(std::floor(actualMax * 166 - 0.5)), 82);
+        maxValue = (quantisedMax + 1) / 166.0;
+        hash += encode83(quantisedMax, 1);
+    } else {
+        hash += encode83(0, 1);
+    }
+
+    const Color &dc = factors.first();
+    hash += encode83((linearToSrgb(dc.r) << 16) + (linearToSrgb(dc.g) << 8) + linearToSrgb(dc.b), 4);
+
+    for (int k = 1; k < factors.size(); ++k) {
+        auto quantise = [maxValue](double v) {
+            return qBound(0, int(std::floor(signPow(v / maxValue, 0.5) * 9 + 9.5)), 18);
+        };
+        const Color &ac = factors[k];
+        hash += encode83(quantise(ac.r) * 19 * 19 + quantise(ac.g) * 19 + quantise(ac.b), 2);
+    }
+    return hash;
+}
+
+QImage decode(const QString &hash, int width, int height, double punch)
+{
+    if (hash.size() < 6 || width <= 0 || height <= 0) return QImage();
+
+    int sizeFlag = decode83(QStringView(hash).left(1));
+    if (sizeFlag < 0) return QImage();
+    const int componentsY = sizeFlag / 9 + 1;
+    const int componentsX = sizeFlag % 9 + 1;
+    if (hash.size() != 4 + 2 * componentsX * componentsY) return QImage();
+
+    int quantisedMax = decode83(QStringView(hash).mid(1, 1));
+    if (quantisedMax < 0) return QImage();
+    double maxValue = (quantisedMax + 1) / 166.0 * punch;
+
+    QVector<Color> colors(componentsX * componentsY);
+    int dc = decode83(QStringView(hash).mid(2, 4));
+    if (dc < 0) return QImage();
+    colors[0] = {srgbToLinear(dc >> 16), srgbToLinear((dc >> 8) & 255), srgbToLinear(dc & 255)};
+    for (int k = 1; k < colors.size(); ++k) {
+        int ac = decode83(QStringView(hash).mid(4 + k * 2, 2));
+        if (ac < 0) return QImage();
+        colors[k] = {signPow((ac / (19 * 19) - 9) / 9.0, 2) * maxValue,
+                     signPow((ac / 19 % 19 - 9) / 9.0, 2) * maxValue,
+                     signPow((ac % 19 - 9) / 9.0, 2) * maxValue};
+    }
+
+    QImage image(width, height, QImage::Format_RGB32);
+    for (int y = 0; y < height; ++y) {
+        QRgb *line = reinterpret_cast<QRgb *>(image.scanLine(y));
+        for (int x = 0; x < width; ++x) {
+            Color c;
+            for (int j = 0; j < componentsY; ++j) {
+                double by = std::cos(PI * y * j / height);
+                for (int i = 0; i < componentsX; ++i) {
+                    double basis = std::cos(PI * x * i / width) * by;
+                    const Color &f = colors[j * componentsX + i];
+                    c.r += f.r * basis;
+                    c.g += f.g * basis;
+                    c.b += f.b * basis;
+                }
+            }
+            line[x] = qRgb(linearToSrgb(c.r), linearToSrgb(c.g), linearToSrgb(c.b));
+        }
+    }
+    return image;
+}
+
+}
@@ -0,0 +1,18 @@
+#ifndef BLURHASH_H
+#define BLURHASH_H
+
+#include <QImage>
+#include <QString>
+
+// BlurHash 占位图编解码（https://blurha.sh），几十个字符即可随消息一起发送
+namespace BlurHash {
+
+// 输入图片会先缩小到 32x32 左右再计算，调用方无需预先缩放
+QString encode(const QImage &image, int componentsX = 4, int componentsY = 3);
+
+// 哈希无效时返回空图片
+QImage decode(const QString &hash, int width, int height, double punch = 1.0);
+
+}
+
+#endif
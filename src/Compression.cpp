@@ -0,0 +1,131 @@
+#include "Compression.h"
+#include "Logging.h"
+
+#ifdef ATCHAT_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef ATCHAT_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace {
+
+// 防止压缩炸弹：单个响应解码后的上限
+const qsizetype MAX_DECODED_SIZE = 64 * 1024 * 1024;
+const qsizetype MIN_BUFFER_SIZE = 16 * 1024;
+
+// 输出缓冲区按倍数增长，超过上限返回 false
+bool grow(QByteArray &buffer, qsizetype used)
+{
+    if (used < buffer.size()) return true;
+    if (buffer.size() >= MAX_DECODED_SIZE) return false;
+    buffer.resize(qMin(qMax(buffer.size() * 2, MIN_BUFFER_SIZE), MAX_DECODED_SIZE));
+    return true;
+}
+
+#ifdef ATCHAT_HAVE_ZLIB
+// windowBits：15 为 zlib 格式，31 为 gzip，-15 为不带头的原始 deflate
+bool inflateData(const QByteArray &data, int windowBits, QByteArray *out)
+{
+    z_stream zs = {};
+    if (inflateInit2(&zs, windowBits) != Z_OK) return false;
+    zs.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data.constData()));
+    zs.avail_in = uInt(data.size());
+
+    QByteArray buffer(qMax(data.size() * 4, MIN_BUFFER_SIZE), Qt::Uninitialized);
+    bool ok = false;
+    for (;;) {
+        if (!grow(buffer, qsizetype(zs.total_out))) break;
+        zs.next_out = reinterpret_cast<Bytef *>(buffer.data()) + zs.total_out;
+        zs.avail_out = uInt(buffer.size() - qsizetype(zs.total_out));
+
+        int ret = inflate(&zs, Z_NO_FLUSH);
+        if (ret == Z_STREAM_END) {
+            ok = true;
+            break;
+        }
+        // 输入已经读完却没有结束标记，说明响应被截断
+        if (ret == Z_BUF_ERROR && zs.avail_out > 0) break;
+        if (ret != Z_OK && ret != Z_BUF_ERROR) break;
+    }
+    qsizetype size = qsizetype(zs.total_out);
+    inflateEnd(&zs);
+    if (!ok) return false;
+
+    buffer.resize(size);
+    *out = buffer;
+    return true;
+}
+#endif
+
+#ifdef ATCHAT_HAVE_ZSTD
+bool decodeZstd(const QByteArray &data, QByteArray *out)
+{
+    ZSTD_DStream *stream = ZSTD_createDStream();
+    if (!stream) return false;
+    ZSTD_initDStream(stream);
+
+    ZSTD_inBuffer in = {data.constData(), size_t(data.size()), 0};
+    QByteArray buffer(qMax(data.size() * 4, MIN_BUFFER_SIZE), Qt::Uninitialized);
+    qsizetype produced = 0;
+    bool ok = false;
+    for (;;) {
+        if (!grow(buffer, produced)) break;
+        ZSTD_outBuffer output = {buffer.data() + produced, size_t(buffer.size() - produced), 0};
+        size_t ret = ZSTD_decompressStream(stream, &output, &in);
+        produced += qsizetype(output.pos);
+        if (ZSTD_isError(ret)) break;
+        // 一帧结束；响应可能由多帧拼接
+        if (ret == 0 && in.pos == in.size) {
+            ok = true;
+            break;
+        }
+        if (in.pos == in.size && output.pos < output.size) break;
+    }
+    ZSTD_freeDStream(stream);
+    if (!ok) return false;
+
+    buffer.resize(produced);
+    *out = buffer;
+    return true;
+}
+#endif
+
+}
+
+namespace Compression {
+
+QByteArray acceptEncoding()
+{
+    QByteArrayList encodings;
+#ifdef ATCHAT_HAVE_ZSTD
+    encodings << "zstd";
+#endif
+#ifdef ATCHAT_HAVE_ZLIB
+    encodings << "gzip" << "deflate";
+#endif
+    return encodings.join(", ");
+}
+
+bool decode(const QByteArray &encoding, const QByteArray &data, QByteArray *out)
+{
+    QByteArray name = encoding.trimmed().toLower();
+    if (name.isEmpty() || name == "identity") {
+        *out = data;
+        return true;
+    }
+
+#ifdef ATCHAT_HAVE_ZLIB
+    if (name == "gzip" || name == "x-gzip") return inflateData(data, 15 + 16, out);
+    // 规范要求 zlib 格式，但有的服务器发送原始 deflate 流
+    if (name == "deflate") return inflateData(data, 15, out) || inflateData(data, -15, out);
+#endif
+#ifdef ATCHAT_HAVE_ZSTD
+    if (name == "zstd") return decodeZstd(data, out);
+#endif
+
+    qCWarning(lcNet) << "unsupported content encoding" << name;
+    return false;
+}
+
+}
@@ -0,0 +1,19 @@
+#ifndef COMPRESSION_H
+#define COMPRESSION_H
+
+#include <QByteArray>
+
+// HTTP 响应的内容编码：请求时自己声明 Accept-Encoding，QNetworkAccessManager 就不再自动解压，
+// 由网络线程解码，从而能同时统计线上字节数与解码后的字节数。
+// 可用的编码取决于构建时找到的库（ATCHAT_HAVE_ZLIB / ATCHAT_HAVE_ZSTD）。
+namespace Compression {
+
+// 优先级从高到低，例如 "zstd, gzip, deflate"；为空表示没有可用的解码器，交给 QNetworkAccessManager
+QByteArray acceptEncoding();
+
+// 按 Content-Encoding 解码，identity 或空编码原样返回；解码后超过上限视为失败
+bool decode(const QByteArray &encoding, const QByteArray &data, QByteArray *out);
+
+}
+
+#endif
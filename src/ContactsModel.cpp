@@ -0,0 +1,381 @@
+#include "ContactsModel.h"
+#include "NetworkManager.h"
+#include <algorithm>
+
+ContactsModel* ContactsModel::s_instance = nullptr;
+
+ContactsModel::ContactsModel(QObject *parent)
+    : QAbstractListModel(parent)
+    , m_rowCount(0)
+{
+    auto net = NetworkManager::instance();
+    connect(net, &NetworkManager::friendGroupsReceived, this, &ContactsModel::onFriendGroupsReceived);
+    connect(net, &NetworkManager::friendsReceived, this, &ContactsModel::onFriendsReceived);
+    connect(net->presence(), &Presence::changed, this, &ContactsModel::onPresenceChanged);
+    connect(net, &NetworkManager::directoryChanged, this, &ContactsModel::onDirectoryChanged);
+    connect(net, &NetworkManager::userChanged, this, [this, net]() {
+        if (!net->userId().isEmpty()) return;
+        m_groupData = QJsonArray();
+        m_friendData = QJsonArray();
+        m_expandedState.clear();
+        rebuild();
+    });
+
+    // 登录时本地副本已经发布过，QML 首次访问时才创建的模型从副本开始
+    auto directory = net->directory();
+    if (directory->isLoaded(DirectorySync::FriendGroups) || directory->isLoaded(DirectorySync::Friends)) {
+        m_groupData = directory->items(DirectorySync::FriendGroups);
+        m_friendData = directory->items(DirectorySync::Friends);
+        rebuild();
+    }
+}
+
+ContactsModel* ContactsModel::instance()
+{
+    if (!s_instance) s_instance = new ContactsModel();
+    return s_instance;
+}
+
+ContactsModel* ContactsModel::create(QQmlEngine*, QJSEngine*)
+{
+    return instance();
+}
+
+int ContactsModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid()) return 0;
+    return m_rowCount;
+}
+
+int ContactsModel::locate(int row, int *member) const
+{
+    // 标题行号单调递增，二分找到不大于 row 的最后一个分组
+    auto it = std::upper_bound(m_headerRows.cbegin(), m_headerRows.cend(), row);
+    int group = int(it - m_headerRows.cbegin()) - 1;
+    *member = row - m_headerRows.at(group) - 1;
+    return group;
+}
+
+QVariant ContactsModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_rowCount) return QVariant();
+
+    int member;
+    const Group &g = m_groups.at(locate(index.row(), &member));
+    switch (role) {
+    case IsHeaderRole: return member < 0;
+    case GroupIdRole: return g.id;
+    case GroupNameRole: return g.name;
+    case ExpandedRole: return g.expanded;
+    case OnlineCountRole: return g.online;
+    case TotalCountRole: return g.members.size();
+    }
+    if (member < 0) return QVariant();
+
+    const Contact &c = g.members.at(member);
+    switch (role) {
+    case FriendIdRole: return c.id;
+    case NameRole: return c.name;
+    case NicknameRole: return c.nickname;
+    case SignatureRole: return c.signature;
+    case OnlineRole: return c.online;
+    case IsMutualRole: return c.isMutual;
+    case RemarkRole: return c.remark;
+    case NoteRole: return c.note;
+    }
+    return QVariant();
+}
+
+QHash<int, QByteArray> ContactsModel::roleNames() const
+{
+    return {
+        {IsHeaderRole, "isHeader"},
+        {GroupIdRole, "groupId"},
+        {GroupNameRole, "groupName"},
+        {ExpandedRole, "expanded"},
+        {OnlineCountRole, "onlineCount"},
+        {TotalCountRole, "totalCount"},
+        {FriendIdRole, "friendId"},
+        {NameRole, "name"},
+        {NicknameRole, "nickname"},
+        {SignatureRole, "signature"},
+        {OnlineRole, "online"},
+        {IsMutualRole, "isMutual"},
+        {RemarkRole, "remark"},
+        {NoteRole, "note"}
+    };
+}
+
+void ContactsModel::toggleGroup(int row)
+{
+    if (row < 0 || row >= m_rowCount) return;
+    int member;
+    int group = locate(row, &member);
+    if (member >= 0) return;
+    setExpanded(m_groups.at(group).id, !m_groups.at(group).expanded);
+}
+
+void ContactsModel::setExpanded(const QString &groupId, bool expanded)
+{
+    for (int i = 0; i < m_groups.size(); ++i) {
+        Group &g = m_groups[i];
+        if (g.id != groupId) continue;
+        if (g.expanded == expanded) return;
+        m_expandedState.insert(groupId, expanded);
+
+        int header = headerRow(i);
+        if (!g.members.isEmpty()) {
+            if (expanded) beginInsertRows(QModelIndex(), header + 1, header + g.members.size());
+            else beginRemoveRows(QModelIndex(), header + 1, header + g.members.size());
+        }
+        g.expanded = expanded;
+        updateRows();
+        if (!g.members.isEmpty()) {
+            if (expanded) endInsertRows();
+            else endRemoveRows();
+        }
+
+        QModelIndex idx = index(header);
+        emit dataChanged(idx, idx, {ExpandedRole});
+        emit countChanged();
+        return;
+    }
+}
+
+QVariantMap ContactsModel::get(int row) const
+{
+    QVariantMap map;
+    if (row < 0 || row >= m_rowCount) return map;
+    int member;
+    const Group &g = m_groups.at(locate(row, &member));
+    if (member < 0) return map;
+
+    const Contact &c = g.members.at(member);
+    map["id"] = c.id;
+    map["name"] = c.name;
+    map["nickname"] = c.nickname;
+    map["signature"] = c.signature;
+    map["groupId"] = g.id;
+    map["group"] = g.name;
+    map["online"] = c.online;
+    map["isMutual"] = c.isMutual;
+    map["remark"] = c.remark;
+    map["note"] = c.note;
+    return map;
+}
+
+QString ContactsModel::groupName(const QString &groupId) const
+{
+    for (const Group &g : m_groups) {
+        if (g.id == groupId) return g.name;
+    }
+    return QString();
+}
+
+void ContactsModel::onFriendGroupsReceived(const QJsonArray &groups)
+{
+    m_groupData = groups;
+    rebuild();
+}
+
+void ContactsModel::onFriendsReceived(const QJsonArray &friends)
+{
+    m_friendData = friends;
+    rebuild();
+}
+
+void ContactsModel::onPresenceChanged(const Presence::Diff &diff)
+{
+    int first = m_rowCount;
+    int last = -1;
+    for (auto d = diff.cbegin(); d != diff.cend(); ++d) {
+        auto it = m_locations.constFind(d.key());
+        if (it == m_locations.cend()) continue;
+
+        Group &g = m_groups[it->group];
+        Contact &c = g.members[it->member];
+        if (c.online == d.value()) continue;
+        c.online = d.value();
+        g.online += c.online ? 1 : -1;
+
+        // 分组标题的计数总要更新；折叠分组中的好友没有行
+        int header = headerRow(it->group);
+        int row = g.expanded ? header + 1 + it->member : header;
+        first = qMin(first, header);
+        last = qMax(last, row);
+    }
+    if (last >= 0) emit dataChanged(index(first), index(last), {OnlineRole, OnlineCountRole});
+}
+
+void ContactsModel::onDirectoryChanged(const DirectorySync::Delta &delta)
+{
+    auto directory = NetworkManager::instance()->directory();
+    if (delta.collection == DirectorySync::FriendGroups) {
+        // 分组增删改名很少发生，整体重建
+        m_groupData = directory->items(DirectorySync::FriendGroups);
+        rebuild();
+        return;
+    }
+    if (delta.collection != DirectorySync::Friends) return;
+
+    // 保留完整列表，下次重建时使用
+    m_friendData = directory->items(DirectorySync::Friends);
+    for (const QString &id : delta.removed) removeContact(id);
+
+    for (const QJsonValue &value : delta.upserts) {
+        QJsonObject f = value.toObject();
+        int group = groupFor(f);
+        if (group < 0) {
+            rebuild();
+            return;
+        }
+
+        Contact c = toContact(f);
+        auto it = m_locations.constFind(c.id);
+        if (it != m_locations.cend() && it->group == group) {
+            updateContact(*it, c);
+            continue;
+        }
+        // 换了分组
+        if (it != m_locations.cend()) removeContact(c.id);
+        insertContact(group, c);
+    }
+    emit countChanged();
+}
+
+ContactsModel::Contact ContactsModel::toContact(const QJsonObject &f)
+{
+    Contact c;
+    c.id = f["friend_id"].toString();
+    c.nickname = f["nickname"].toString();
+    c.remark = f["remark"].toString();
+    c.name = c.remark.isEmpty() ? c.nickname : c.remark;
+    c.signature = f["signature"].toString();
+    c.note = f["note"].toString();
+    c.online = NetworkManager::instance()->presence()->isOnline(c.id, f["online"].toBool());
+    c.isMutual = f["is_mutual"].toBool();
+    return c;
+}
+
+int ContactsModel::groupFor(const QJsonObject &f) const
+{
+    QString groupId = f["group_id"].toVariant().toString();
+    int fallback = -1;
+    for (int i = 0; i < m_groups.size(); ++i) {
+        if (m_groups.at(i).id == groupId && !groupId.isEmpty()) return i;
+        if (fallback < 0 && m_groups.at(i).name == tr("我的好友")) fallback = i;
+    }
+    return fallback;
+}
+
+void ContactsModel::insertContact(int group, const Contact &c)
+{
+    Group &g = m_groups[group];
+    int header = headerRow(group);
+    int row = header + 1 + g.members.size();
+
+    if (g.expanded) beginInsertRows(QModelIndex(), row, row);
+    m_locations.insert(c.id, Location{group, int(g.members.size())});
+    if (c.online) g.online++;
+    g.members.append(c);
+    updateRows();
+    if (g.expanded) endInsertRows();
+
+    QModelIndex headerIdx = index(header);
+    emit dataChanged(headerIdx, headerIdx, {OnlineCountRole, TotalCountRole});
+}
+
+void ContactsModel::updateContact(const Location &location, const Contact &c)
+{
+    Group &g = m_groups[location.group];
+    Contact &current = g.members[location.member];
+    if (current.online != c.online) g.online += c.online ? 1 : -1;
+    current = c;
+
+    int header = headerRow(location.group);
+    int last = g.expanded ? header + 1 + location.member : header;
+    emit dataChanged(index(header), index(last));
+}
+
+void ContactsModel::removeContact(const QString &id)
+{
+    auto it = m_locations.find(id);
+    if (it == m_locations.end()) return;
+    Location location = *it;
+    m_locations.erase(it);
+
+    Group &g = m_groups[location.group];
+    int header = headerRow(location.group);
+    int row = header + 1 + location.member;
+
+    if (g.expanded) beginRemoveRows(QModelIndex(), row, row);
+    if (g.members.at(location.member).online) g.online--;
+    g.members.remove(location.member);
+    for (int i = location.member; i < g.members.size(); ++i) m_locations[g.members.at(i).id].member = i;
+    updateRows();
+    if (g.expanded) endRemoveRows();
+
+    QModelIndex headerIdx = index(header);
+    emit dataChanged(headerIdx, headerIdx, {OnlineCountRole, TotalCountRole});
+}
+
+void ContactsModel::rebuild()
+{
+    beginResetModel();
+    m_groups.clear();
+    m_locations.clear();
+
+    QHash<QString, int> groupIndex;
+    for (const QJsonValue &value : m_groupData) {
+        QJsonObject obj = value.toObject();
+        Group g;
+        g.id = obj["id"].toVariant().toString();
+        g.name = obj["name"].toString();
+        g.expanded = m_expandedState.value(g.id, true);
+        groupIndex.insert(g.id, m_groups.size());
+        m_groups.append(g);
+    }
+
+    // 分组不存在的好友归入默认分组
+    int fallback = -1;
+    for (int i = 0; i < m_groups.size() && fallback < 0; ++i) {
+        if (m_groups.at(i).name == tr("我的好友")) fallback = i;
+    }
+
+    for (const QJsonValue &value : m_friendData) {
+        QJsonObject f = value.toObject();
+        Contact c = toContact(f);
+
+        int group = groupIndex.value(f["group_id"].toVariant().toString(), -1);
+        if (group < 0) {
+            if (fallback < 0) {
+                Group g;
+                g.name = tr("我的好友");
+                g.expanded = m_expandedState.value(g.id, true);
+                fallback = m_groups.size();
+                m_groups.append(g);
+            }
+            group = fallback;
+        }
+
+        Group &g = m_groups[group];
+        if (c.online) g.online++;
+        m_locations.insert(c.id, Location{group, int(g.members.size())});
+        g.members.append(c);
+    }
+
+    updateRows();
+    endResetModel();
+    emit countChanged();
+}
+
+void ContactsModel::updateRows()
+{
+    m_headerRows.resize(m_groups.size());
+    int row = 0;
+    for (int i = 0; i < m_groups.size(); ++i) {
+        m_headerRows[i] = row;
+        row += 1 + (m_groups.at(i).expanded ? m_groups.at(i).members.size() : 0);
+    }
+    m_rowCount = row;
+}
@@ -0,0 +1,119 @@
+#ifndef CONTACTSMODEL_H
+#define CONTACTSMODEL_H
+
+#include <QAbstractListModel>
+#include <QHash>
+#include <QVector>
+#include <QJsonObject>
+#include <QJsonArray>
+
+#include "Presence.h"
+#include "DirectorySync.h"
+
+class QQmlEngine;
+class QJSEngine;
+
+// 通讯录分组模型：分组标题与展开分组中的好友按顺序平铺成一个列表，
+// 折叠的分组不产生行，也就不会创建委托。
+// 每个分组的在线数与总数随好友列表与在线状态变化增量维护，不再由绑定遍历计算；
+// 在线状态按帧批量到达，一批变化只发出一次 dataChanged；
+// 好友列表的增量同步只插入、删除或更新对应的行，分组变化时整体重建。
+class ContactsModel : public QAbstractListModel
+{
+    Q_OBJECT
+    Q_PROPERTY(int count READ count NOTIFY countChanged)
+    Q_PROPERTY(int friendCount READ friendCount NOTIFY countChanged)
+
+public:
+    enum Roles {
+        IsHeaderRole = Qt::UserRole + 1,
+        GroupIdRole,
+        GroupNameRole,
+        ExpandedRole,
+        OnlineCountRole,
+        TotalCountRole,
+        FriendIdRole,
+        NameRole,
+        NicknameRole,
+        SignatureRole,
+        OnlineRole,
+        IsMutualRole,
+        RemarkRole,
+        NoteRole
+    };
+    Q_ENUM(Roles)
+
+    explicit ContactsModel(QObject *parent = nullptr);
+    static ContactsModel* instance();
+    static ContactsModel* create(QQmlEngine*, QJSEngine*);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+    int count() const { return m_rowCount; }
+    int friendCount() const { return m_locations.size(); }
+
+    Q_INVOKABLE void toggleGroup(int row);
+    Q_INVOKABLE void setExpanded(const QString &groupId, bool expanded);
+    // 好友行返回 {id, name, nickname, signature, groupId, online, isMutual, remark, note}
+    Q_INVOKABLE QVariantMap get(int row) const;
+    Q_INVOKABLE QString groupName(const QString &groupId) const;
+
+signals:
+    void countChanged();
+
+private slots:
+    void onFriendGroupsReceived(const QJsonArray &groups);
+    void onFriendsReceived(const QJsonArray &friends);
+    void onPresenceChanged(const Presence::Diff &diff);
+    void onDirectoryChanged(const DirectorySync::Delta &delta);
+
+private:
+    struct Contact {
+        QString id;
+        QString name;
+        QString nickname;
+        QString signature;
+        QString remark;
+        QString note;
+        bool online = false;
+        bool isMutual = false;
+    };
+
+    struct Group {
+        QString id;
+        QString name;
+        bool expanded = true;
+        int online = 0;
+        QVector<Contact> members;
+    };
+
+    struct Location {
+        int group;
+        int member;
+    };
+
+    static Contact toContact(const QJsonObject &f);
+    void rebuild();
+    void updateRows();
+    // 好友应归入的分组，需要新建默认分组时返回 -1
+    int groupFor(const QJsonObject &f) const;
+    void insertContact(int group, const Contact &c);
+    void updateContact(const Location &location, const Contact &c);
+    void removeContact(const QString &id);
+    int headerRow(int group) const { return m_headerRows.at(group); }
+    // 返回所在分组，行号写入 member；-1 表示分组标题
+    int locate(int row, int *member) const;
+
+    static ContactsModel *s_instance;
+    QJsonArray m_groupData;
+    QJsonArray m_friendData;
+    QVector<Group> m_groups;
+    QVector<int> m_headerRows;                  // 每个分组标题所在的行
+    QHash<QString, Location> m_locations;       // 好友 id
+    QHash<QString, bool> m_expandedState;       // 重建时保留折叠状态
+    int m_rowCount;
+};
+
+#endif
@@ -0,0 +1,363 @@
+#include "ConversationListModel.h"
+#include "NetworkManager.h"
+#include "MessageUtils.h"
+#include <QSet>
+
+ConversationListModel* ConversationListModel::s_instance = nullptr;
+
+ConversationListModel::ConversationListModel(QObject *parent)
+    : QAbstractListModel(parent)
+{
+    auto net = NetworkManager::instance();
+    connect(net, &NetworkManager::usersReceived, this, &ConversationListModel::onUsersReceived);
+    connect(net, &NetworkManager::groupsReceived, this, &ConversationListModel::onGroupsReceived);
+    connect(net, &NetworkManager::groupCreated, this, &ConversationListModel::onGroupCreated);
+    connect(net, &NetworkManager::messageReceived, this, &ConversationListModel::onMessageReceived);
+    connect(net, &NetworkManager::groupMessageReceived, this, &ConversationListModel::onGroupMessageReceived);
+    connect(net->presence(), &Presence::changed, this, &ConversationListModel::onPresenceChanged);
+    connect(net, &NetworkManager::directoryChanged, this, &ConversationListModel::onDirectoryChanged);
+
+    // 登录时本地副本已经发布过，QML 首次访问时才创建的模型从副本开始
+    if (net->directory()->isLoaded(DirectorySync::Users)) {
+        onUsersReceived(net->directory()->items(DirectorySync::Users));
+    }
+}
+
+ConversationListModel* ConversationListModel::instance()
+{
+    if (!s_instance) s_instance = new ConversationListModel();
+    return s_instance;
+}
+
+ConversationListModel* ConversationListModel::create(QQmlEngine*, QJSEngine*)
+{
+    return instance();
+}
+
+int ConversationListModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid()) return 0;
+    return m_items.size();
+}
+
+QVariant ConversationListModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_items.size()) return QVariant();
+
+    const Conversation &c = m_items.at(index.row());
+    switch (role) {
+    case ConversationIdRole: return c.id;
+    case NameRole: return c.name;
+    case LastMessageRole: return c.lastMessage;
+    case TimeRole: return c.time;
+    case UnreadRole: return c.unread;
+    case MentionedRole: return c.mentioned;
+    case OnlineRole: return c.online;
+    case IsGroupRole: return c.isGroup;
+    }
+    return QVariant();
+}
+
+QHash<int, QByteArray> ConversationListModel::roleNames() const
+{
+    return {
+        {ConversationIdRole, "conversationId"},
+        {NameRole, "name"},
+        {LastMessageRole, "lastMessage"},
+        {TimeRole, "time"},
+        {UnreadRole, "unread"},
+        {OnlineRole, "online"},
+        {IsGroupRole, "isGroup"},
+        {MentionedRole, "mentioned"}
+    };
+}
+
+void ConversationListModel::setActiveConversation(const QString &id)
+{
+    if (m_active == id) return;
+    m_active = id;
+    clearUnread(id);
+    int row = indexOf(id);
+    if (row >= 0) NetworkManager::instance()->markRead(id, m_items.at(row).isGroup);
+    emit activeConversationChanged();
+}
+
+int ConversationListModel::indexOf(const QString &id) const
+{
+    return m_rows.value(id, -1);
+}
+
+QVariantMap ConversationListModel::get(int row) const
+{
+    QVariantMap map;
+    if (row < 0 || row >= m_items.size()) return map;
+
+    const QHash<int, QByteArray> roles = roleNames();
+    for (auto it = roles.cbegin(); it != roles.cend(); ++it) {
+        map.insert(QString::fromUtf8(it.value()), data(index(row), it.key()));
+    }
+    return map;
+}
+
+void ConversationListModel::clearUnread(const QString &id)
+{
+    int row = indexOf(id);
+    if (row < 0 || (m_items[row].unread == 0 && !m_items[row].mentioned)) return;
+
+    m_items[row].unread = 0;
+    m_items[row].mentioned = false;
+    emit dataChanged(index(row), index(row), {UnreadRole, MentionedRole});
+}
+
+void ConversationListModel::onUsersReceived(const QJsonArray &users)
+{
+    const QString self = NetworkManager::instance()->userId();
+
+    // 群会话来自群列表，用户名单整体替换时保留
+    QVector<Conversation> groups;
+    for (const Conversation &c : std::as_const(m_items)) {
+        if (c.isGroup) groups.append(c);
+    }
+
+    beginResetModel();
+    m_items = groups;
+    m_rows.clear();
+    reindex(0, m_items.size() - 1);
+    m_items.reserve(m_items.size() + users.size());
+    for (const QJsonValue &v : users) {
+        Conversation c = toConversation(v.toObject());
+        if (c.id == self) continue;
+        m_rows.insert(c.id, m_items.size());
+        m_items.append(c);
+    }
+    endResetModel();
+    emit countChanged();
+}
+
+ConversationListModel::Conversation ConversationListModel::toConversation(const QJsonObject &user)
+{
+    Conversation c;
+    c.id = user["id"].toString();
+    c.name = user["nickname"].toString();
+    if (c.name.isEmpty()) c.name = user["username"].toString();
+    c.lastMessage = user["signature"].toString();
+    c.online = NetworkManager::instance()->presence()->isOnline(c.id, user["online"].toBool());
+    return c;
+}
+
+ConversationListModel::Conversation ConversationListModel::toGroupConversation(const QJsonObject &group)
+{
+    Conversation c;
+    c.id = group["id"].toString();
+    c.name = group["name"].toString();
+    c.isGroup = true;
+    return c;
+}
+
+void ConversationListModel::onGroupsReceived(const QJsonArray &groups)
+{
+    int count = m_items.size();
+
+    QSet<QString> ids;
+    for (const QJsonValue &v : groups) {
+        Conversation c = toGroupConversation(v.toObject());
+        if (c.id.isEmpty()) continue;
+        ids.insert(c.id);
+        upsertGroup(c);
+    }
+
+    // 已退出或被解散的群
+    for (int row = m_items.size() - 1; row >= 0; --row) {
+        if (m_items.at(row).isGroup && !ids.contains(m_items.at(row).id)) removeRow(row);
+    }
+
+    if (m_items.size() != count) emit countChanged();
+}
+
+void ConversationListModel::onGroupCreated(const QJsonObject &group)
+{
+    Conversation c = toGroupConversation(group);
+    if (c.id.isEmpty()) return;
+    int count = m_items.size();
+    upsertGroup(c);
+    if (m_items.size() != count) emit countChanged();
+}
+
+void ConversationListModel::upsertGroup(const Conversation &group)
+{
+    int row = indexOf(group.id);
+    if (row < 0) {
+        beginInsertRows(QModelIndex(), m_items.size(), m_items.size());
+        m_rows.insert(group.id, m_items.size());
+        m_items.append(group);
+        endInsertRows();
+        return;
+    }
+
+    // 收到消息时补出的行只有临时名字，这里换成群名
+    Conversation &existing = m_items[row];
+    if (!group.name.isEmpty() && existing.name != group.name) {
+        existing.name = group.name;
+        emit dataChanged(index(row), index(row), {NameRole});
+    }
+}
+
+void ConversationListModel::removeRow(int row)
+{
+    beginRemoveRows(QModelIndex(), row, row);
+    m_rows.remove(m_items.at(row).id);
+    m_items.remove(row);
+    endRemoveRows();
+    reindex(row, m_items.size() - 1);
+}
+
+void ConversationListModel::onDirectoryChanged(const DirectorySync::Delta &delta)
+{
+    if (delta.collection != DirectorySync::Users) return;
+    const QString self = NetworkManager::instance()->userId();
+    int count = m_items.size();
+
+    for (const QString &id : delta.removed) {
+        int row = indexOf(id);
+        if (row < 0 || m_items.at(row).isGroup) continue;
+        removeRow(row);
+    }
+
+    for (const QJsonValue &value : delta.upserts) {
+        Conversation c = toConversation(value.toObject());
+        if (c.id.isEmpty() || c.id == self) continue;
+
+        int row = indexOf(c.id);
+        if (row < 0) {
+            beginInsertRows(QModelIndex(), m_items.size(), m_items.size());
+            m_rows.insert(c.id, m_items.size());
+            m_items.append(c);
+            endInsertRows();
+            continue;
+        }
+
+        // 未读数与最后一条消息属于会话本身，只更新资料
+        Conversation &existing = m_items[row];
+        QList<int> roles;
+        if (existing.name != c.name) {
+            existing.name = c.name;
+            roles << NameRole;
+        }
+        if (existing.time.isEmpty() && existing.lastMessage != c.lastMessage) {
+            existing.lastMessage = c.lastMessage;
+            roles << LastMessageRole;
+        }
+        if (!roles.isEmpty()) emit dataChanged(index(row), index(row), roles);
+    }
+
+    if (m_items.size() != count) emit countChanged();
+}
+
+void ConversationListModel::onMessageReceived(const QJsonObject &message)
+{
+    const QString self = NetworkManager::instance()->userId();
+    bool isMe = message["from"].toString() == self;
+    QString other = isMe ? message["to"].toString() : message["from"].toString();
+    applyMessage(other, message, !isMe, false);
+}
+
+void ConversationListModel::onGroupMessageReceived(const QJsonObject &message)
+{
+    const QString self = NetworkManager::instance()->userId();
+    bool isMe = message["from"].toString() == self;
+    applyMessage(message["group_id"].toString(), message, !isMe, true);
+}
+
+void ConversationListModel::onPresenceChanged(const Presence::Diff &diff)
+{
+    // 一帧内的所有变化合并为一次覆盖首尾行的 dataChanged
+    int first = m_items.size();
+    int last = -1;
+    for (auto it = diff.cbegin(); it != diff.cend(); ++it) {
+        int row = indexOf(it.key());
+        if (row < 0 || m_items[row].online == it.value()) continue;
+        m_items[row].online = it.value();
+        first = qMin(first, row);
+        last = qMax(last, row);
+    }
+    if (last >= 0) emit dataChanged(index(first), index(last), {OnlineRole});
+}
+
+void ConversationListModel::applyMessage(const QString &id, const QJsonObject &message, bool incoming, bool isGroup)
+{
+    if (id.isEmpty()) return;
+
+    QString content = message["content"].toString();
+    QString time = MessageUtils::formatTime(MessageUtils::timestamp(message["timestamp"]));
+    bool countUnread = incoming && id != m_active;
+    // 正在查看的会话收到消息即为已读
+    if (incoming && id == m_active) NetworkManager::instance()->markRead(id, isGroup, MessageUtils::messageId(message));
+
+    int row = indexOf(id);
+    if (row < 0) {
+        // 会话列表中还没有：私聊只补收到的消息；群聊在群列表返回前就可能收到消息，先用临时名字补出来
+        if (!isGroup && !incoming) return;
+
+        Conversation c;
+        c.id = id;
+        c.name = id.left(8);
+        c.lastMessage = content;
+        c.time = time;
+        c.unread = countUnread ? 1 : 0;
+        c.isGroup = isGroup;
+        if (countUnread && isGroup) {
+            auto net = NetworkManager::instance();
+            c.mentioned = MessageUtils::mentions(message, net->userId(), {net->nickname(), net->username()});
+        }
+
+        beginInsertRows(QModelIndex(), 0, 0);
+        m_items.prepend(c);
+        endInsertRows();
+        reindex(0, m_items.size() - 1);
+        emit countChanged();
+        return;
+    }
+
+    Conversation &c = m_items[row];
+    QList<int> roles;
+    if (c.lastMessage != content) {
+        c.lastMessage = content;
+        roles << LastMessageRole;
+    }
+    if (c.time != time) {
+        c.time = time;
+        roles << TimeRole;
+    }
+    if (countUnread) {
+        c.unread++;
+        roles << UnreadRole;
+    }
+    // 每条群消息只在这里扫描一次，界面直接读 mentioned
+    if (countUnread && isGroup && !c.mentioned) {
+        auto net = NetworkManager::instance();
+        if (MessageUtils::mentions(message, net->userId(), {net->nickname(), net->username()})) {
+            c.mentioned = true;
+            roles << MentionedRole;
+        }
+    }
+    if (!roles.isEmpty()) emit dataChanged(index(row), index(row), roles);
+
+    moveToTop(row);
+}
+
+void ConversationListModel::moveToTop(int row)
+{
+    if (row <= 0) return;
+
+    beginMoveRows(QModelIndex(), row, row, QModelIndex(), 0);
+    m_items.move(row, 0);
+    endMoveRows();
+    reindex(0, row);
+}
+
+void ConversationListModel::reindex(int first, int last)
+{
+    for (int i = first; i <= last; ++i) {
+        m_rows[m_items.at(i).id] = i;
+    }
+}
@@ -0,0 +1,93 @@
+#ifndef CONVERSATIONLISTMODEL_H
+#define CONVERSATIONLISTMODEL_H
+
+#include <QAbstractListModel>
+#include <QHash>
+#include <QVector>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QDateTime>
+
+#include "Presence.h"
+#include "DirectorySync.h"
+
+class QQmlEngine;
+class QJSEngine;
+
+class ConversationListModel : public QAbstractListModel
+{
+    Q_OBJECT
+    Q_PROPERTY(int count READ count NOTIFY countChanged)
+    Q_PROPERTY(QString activeConversation READ activeConversation WRITE setActiveConversation NOTIFY activeConversationChanged)
+
+public:
+    enum Roles {
+        ConversationIdRole = Qt::UserRole + 1,
+        NameRole,
+        LastMessageRole,
+        TimeRole,
+        UnreadRole,
+        OnlineRole,
+        IsGroupRole,
+        MentionedRole
+    };
+    Q_ENUM(Roles)
+
+    explicit ConversationListModel(QObject *parent = nullptr);
+    static ConversationListModel* instance();
+    static ConversationListModel* create(QQmlEngine*, QJSEngine*);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+    int count() const { return m_items.size(); }
+    QString activeConversation() const { return m_active; }
+    void setActiveConversation(const QString &id);
+
+    Q_INVOKABLE int indexOf(const QString &id) const;
+    Q_INVOKABLE QVariantMap get(int row) const;
+    Q_INVOKABLE void clearUnread(const QString &id);
+
+signals:
+    void countChanged();
+    void activeConversationChanged();
+
+private slots:
+    void onUsersReceived(const QJsonArray &users);
+    // 群列表整体替换群会话行，私聊行不受影响
+    void onGroupsReceived(const QJsonArray &groups);
+    void onGroupCreated(const QJsonObject &group);
+    void onMessageReceived(const QJsonObject &message);
+    void onGroupMessageReceived(const QJsonObject &message);
+    void onPresenceChanged(const Presence::Diff &diff);
+    // 用户目录的增量变化只插入、更新或删除对应的行
+    void onDirectoryChanged(const DirectorySync::Delta &delta);
+
+private:
+    struct Conversation {
+        QString id;
+        QString name;
+        QString lastMessage;
+        QString time;
+        int unread = 0;
+        bool online = false;
+        bool isGroup = false;
+        bool mentioned = false; // 未读消息中有人 @ 了自己，与未读数一起清除
+    };
+
+    static Conversation toConversation(const QJsonObject &user);
+    static Conversation toGroupConversation(const QJsonObject &group);
+    void upsertGroup(const Conversation &group);
+    void removeRow(int row);
+    void applyMessage(const QString &id, const QJsonObject &message, bool incoming, bool isGroup);
+    void moveToTop(int row);
+    void reindex(int first, int last);
+
+    static ConversationListModel *s_instance;
+    QVector<Conversation> m_items;
+    QHash<QString, int> m_rows;
+    QString m_active;
+};
+
+#endif
@@ -0,0 +1,261 @@
+#include "DirectorySync.h"
+#include "Logging.h"
+#include "Trace.h"
+#include <QStandardPaths>
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QCborArray>
+#include <QCborMap>
+#include <QCborValue>
+#include <algorithm>
+
+namespace {
+
+// 推送可能连续到达，副本落盘稍作合并
+const int SAVE_DELAY_MS = 1000;
+
+// 在线状态变化不推进版本号，留在副本里只会是上次会话的旧值，也会让状态变化被当成内容变化
+QJsonObject withoutPresence(QJsonObject item)
+{
+    item.remove(QLatin1String("online"));
+    return item;
+}
+
+}
+
+DirectorySync::DirectorySync(QObject *parent)
+    : QObject(parent)
+{
+    m_saveTimer.setSingleShot(true);
+    m_saveTimer.setInterval(SAVE_DELAY_MS);
+    connect(&m_saveTimer, &QTimer::timeout, this, &DirectorySync::save);
+}
+
+DirectorySync::~DirectorySync()
+{
+    if (m_saveTimer.isActive()) save();
+}
+
+void DirectorySync::open(const QString &accountId)
+{
+    close();
+    for (Table &table : m_tables) table = Table();
+
+    QString dir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/sync";
+    QDir().mkpath(dir);
+    m_path = dir + "/" + accountId + ".cbor";
+    load();
+}
+
+void DirectorySync::close()
+{
+    if (m_path.isEmpty()) return;
+
+    save();
+    for (Table &table : m_tables) table = Table();
+    m_path.clear();
+}
+
+const char *DirectorySync::name(Collection collection)
+{
+    switch (collection) {
+    case Users: return "users";
+    case Friends: return "friends";
+    case FriendGroups: return "friend_groups";
+    case CollectionCount: break;
+    }
+    return "";
+}
+
+QString DirectorySync::itemId(Collection collection, const QJsonObject &item)
+{
+    // 分组 id 可能是数值
+    return item[collection == Friends ? "friend_id" : "id"].toVariant().toString();
+}
+
+QJsonArray DirectorySync::items(Collection collection) const
+{
+    QJsonArray array;
+    for (const QJsonObject &item : m_tables[collection].items) array.append(item);
+    return array;
+}
+
+DirectorySync::Delta DirectorySync::applyResponse(Collection collection, const QJsonDocument &doc)
+{
+    // 旧接口直接返回完整数组，没有版本号
+    if (doc.isArray()) return apply(collection, true, 0, doc.array(), QJsonArray());
+
+    QJsonObject obj = doc.object();
+    const Table &table = m_tables[collection];
+    qint64 version = obj["version"].toInteger();
+    bool reset = obj["reset"].toBool() || !table.loaded;
+
+    // 推送已经把版本推进到更新的位置，迟到的响应不再应用
+    if (!reset && version <= table.version) {
+        Delta delta;
+        delta.collection = collection;
+        delta.version = table.version;
+        return delta;
+    }
+    return apply(collection, reset, version, obj["upserts"].toArray(), obj["removed"].toArray());
+}
+
+DirectorySync::PushResult DirectorySync::applyPush(const QJsonObject &data, Delta *delta)
+{
+    QString collectionName = data["collection"].toString();
+    int collection = 0;
+    while (collection < CollectionCount && collectionName != QLatin1String(name(Collection(collection)))) {
+        collection++;
+    }
+    if (collection == CollectionCount) {
+        qCWarning(lcNet) << "unknown sync collection" << collectionName;
+        return Stale;
+    }
+
+    delta->collection = Collection(collection);
+    const Table &table = m_tables[collection];
+    qint64 version = data["version"].toInteger();
+    // 还没有获取过的集合不需要跟踪，首次获取时拿到的就是最新的完整列表
+    if (!table.loaded || version <= table.version) return Stale;
+    if (data["base_version"].toInteger() != table.version) {
+        qCInfo(lcNet) << "sync gap in" << collectionName << "local" << table.version
+                      << "push base" << data["base_version"].toInteger();
+        return Gap;
+    }
+
+    *delta = apply(Collection(collection), false, version, data["upserts"].toArray(), data["removed"].toArray());
+    return Applied;
+}
+
+DirectorySync::Delta DirectorySync::apply(Collection collection, bool reset, qint64 version,
+                                          const QJsonArray &upserts, const QJsonArray &removed)
+{
+    Table &table = m_tables[collection];
+    Delta delta;
+    delta.collection = collection;
+    delta.version = version;
+
+    if (reset) {
+        table.items.clear();
+        table.rows.clear();
+        table.items.reserve(upserts.size());
+        for (const QJsonValue &value : upserts) {
+            QJsonObject item = withoutPresence(value.toObject());
+            QString id = itemId(collection, item);
+            if (id.isEmpty() || table.rows.contains(id)) continue;
+            table.rows.insert(id, table.items.size());
+            table.items.append(item);
+        }
+        table.version = version;
+        table.loaded = true;
+        delta.reset = true;
+        ATCHAT_TRACE("sync.reset", collection, version);
+        scheduleSave();
+        return delta;
+    }
+
+    // 删除先置空再统一压缩，避免逐个移动
+    int firstRemoved = table.items.size();
+    for (const QJsonValue &value : removed) {
+        QString id = value.toVariant().toString();
+        auto it = table.rows.find(id);
+        if (it == table.rows.end()) continue;
+        firstRemoved = qMin(firstRemoved, *it);
+        table.items[*it] = QJsonObject();
+        table.rows.erase(it);
+        delta.removed.append(id);
+    }
+    if (!delta.removed.isEmpty()) {
+        table.items.erase(std::remove_if(table.items.begin() + firstRemoved, table.items.end(),
+                                         [](const QJsonObject &item) { return item.isEmpty(); }),
+                          table.items.end());
+        reindex(collection, firstRemoved);
+    }
+
+    for (const QJsonValue &value : upserts) {
+        QJsonObject item = withoutPresence(value.toObject());
+        QString id = itemId(collection, item);
+        if (id.isEmpty()) continue;
+        auto it = table.rows.constFind(id);
+        if (it == table.rows.cend()) {
+            table.rows.insert(id, table.items.size());
+            table.items.append(item);
+        } else if (table.items.at(*it) != item) {
+            table.items[*it] = item;
+        } else {
+            continue;
+        }
+        delta.upserts.append(item);
+    }
+
+    table.version = qMax(table.version, version);
+    ATCHAT_TRACE("sync.delta", delta.upserts.size(), delta.removed.size(), QLatin1String(name(collection)));
+    scheduleSave();
+    return delta;
+}
+
+void DirectorySync::reindex(Collection collection, int from)
+{
+    Table &table = m_tables[collection];
+    for (int i = from; i < table.items.size(); ++i) {
+        table.rows[itemId(collection, table.items.at(i))] = i;
+    }
+}
+
+void DirectorySync::scheduleSave()
+{
+    if (!m_path.isEmpty() && !m_saveTimer.isActive()) m_saveTimer.start();
+}
+
+void DirectorySync::save()
+{
+    m_saveTimer.stop();
+    if (m_path.isEmpty()) return;
+
+    QCborMap root;
+    for (int i = 0; i < CollectionCount; ++i) {
+        const Table &table = m_tables[i];
+        if (!table.loaded) continue;
+        QCborArray items;
+        for (const QJsonObject &item : table.items) items.append(QCborMap::fromJsonObject(item));
+        QCborMap entry;
+        entry[QLatin1String("version")] = table.version;
+        entry[QLatin1String("items")] = items;
+        root[QLatin1String(name(Collection(i)))] = entry;
+    }
+
+    QSaveFile file(m_path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qCWarning(lcStore) << "cannot save directory" << m_path << file.errorString();
+        return;
+    }
+    file.write(QCborValue(root).toCbor());
+    if (!file.commit()) qCWarning(lcStore) << "cannot save directory" << m_path << file.errorString();
+}
+
+void DirectorySync::load()
+{
+    QFile file(m_path);
+    if (!file.open(QIODevice::ReadOnly)) return;
+
+    const QCborMap root = QCborValue::fromCbor(file.readAll()).toMap();
+    for (int i = 0; i < CollectionCount; ++i) {
+        QCborValue entry = root.value(QLatin1String(name(Collection(i))));
+        if (!entry.isMap()) continue;
+
+        Table &table = m_tables[i];
+        table.version = entry[QLatin1String("version")].toInteger();
+        table.loaded = true;
+        const QCborArray items = entry[QLatin1String("items")].toArray();
+        table.items.reserve(items.size());
+        for (const QCborValue &value : items) {
+            // 旧版本保存的副本里还带着 online
+            QJsonObject item = withoutPresence(value.toMap().toJsonObject());
+            QString id = itemId(Collection(i), item);
+            if (id.isEmpty() || table.rows.contains(id)) continue;
+            table.rows.insert(id, table.items.size());
+            table.items.append(item);
+        }
+    }
+}
@@ -0,0 +1,86 @@
+#ifndef DIRECTORYSYNC_H
+#define DIRECTORYSYNC_H
+
+#include <QObject>
+#include <QHash>
+#include <QVector>
+#include <QStringList>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QTimer>
+
+// 用户目录、好友与好友分组的本地副本，按服务器版本号增量同步。
+// 请求时带上 since=<版本>，服务器返回
+//   {version, reset, upserts: [完整对象], removed: [id]}
+// reset 为 true（或本地没有版本）时 upserts 是完整列表；旧接口直接返回数组，按完整列表处理。
+// WebSocket 推送 {action: "sync", data: {collection, base_version, version, upserts, removed}}，
+// base_version 与本地版本不一致说明漏了推送，由调用方按 since 补拉。
+// 副本按账号保存，重新登录时先用本地副本显示，再只请求此后的变化。
+// online 字段不进副本，在线状态只由 Presence 根据服务器响应与状态帧维护。
+class DirectorySync : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Collection {
+        Users,
+        Friends,
+        FriendGroups,
+        CollectionCount
+    };
+
+    struct Delta {
+        Collection collection = Users;
+        bool reset = false;         // true 时以 items() 为准整体替换
+        QJsonArray upserts;         // 新增或内容有变化的对象
+        QStringList removed;        // 确实存在并被删除的 id
+        qint64 version = 0;
+
+        bool isEmpty() const { return !reset && upserts.isEmpty() && removed.isEmpty(); }
+    };
+
+    enum PushResult {
+        Applied,
+        Stale,      // 已经包含的旧版本
+        Gap         // 中间缺了版本，需要补拉
+    };
+
+    explicit DirectorySync(QObject *parent = nullptr);
+    ~DirectorySync();
+
+    void open(const QString &accountId);
+    void close();
+
+    static const char *name(Collection collection);
+    static QString itemId(Collection collection, const QJsonObject &item);
+
+    bool isLoaded(Collection collection) const { return m_tables[collection].loaded; }
+    qint64 version(Collection collection) const { return m_tables[collection].version; }
+    QJsonArray items(Collection collection) const;
+
+    // 应用 HTTP 响应，delta 中只包含真正发生的变化
+    Delta applyResponse(Collection collection, const QJsonDocument &doc);
+    PushResult applyPush(const QJsonObject &data, Delta *delta);
+
+private:
+    struct Table {
+        qint64 version = 0;
+        bool loaded = false;
+        QVector<QJsonObject> items;
+        QHash<QString, int> rows;   // id → items 下标
+    };
+
+    Delta apply(Collection collection, bool reset, qint64 version,
+                const QJsonArray &upserts, const QJsonArray &removed);
+    void reindex(Collection collection, int from);
+    void scheduleSave();
+    void save();
+    void load();
+
+    Table m_tables[CollectionCount];
+    QString m_path;
+    QTimer m_saveTimer;
+};
+
+#endif
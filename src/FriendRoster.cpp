@@ -0,0 +1,137 @@
+#include "FriendRoster.h"
+
+namespace {
+
+bool applyDelta(QHash<QString, QJsonObject> &table, const char *idField,
+                const QJsonArray &upserts, const QStringList &removed)
+{
+    bool dirty = false;
+    for (const QString &id : removed) {
+        if (table.remove(id)) dirty = true;
+    }
+    for (const QJsonValue &value : upserts) {
+        QJsonObject item = value.toObject();
+        QString id = item[idField].toString();
+        if (id.isEmpty()) continue;
+        table.insert(id, item);
+        dirty = true;
+    }
+    return dirty;
+}
+
+}
+
+FriendRoster::FriendRoster(QObject *parent)
+    : QObject(parent)
+    , m_friendsLoaded(false)
+    , m_revision(0)
+{
+}
+
+QVariantMap FriendRoster::friendInfo(const QString &userId) const
+{
+    return m_friends.value(userId).toVariantMap();
+}
+
+QVariantMap FriendRoster::user(const QString &userId) const
+{
+    return m_users.value(userId).toVariantMap();
+}
+
+QString FriendRoster::displayName(const QString &userId) const
+{
+    auto f = m_friends.constFind(userId);
+    if (f != m_friends.cend()) {
+        QString remark = (*f)["remark"].toString();
+        if (!remark.isEmpty()) return remark;
+        QString nickname = (*f)["nickname"].toString();
+        if (!nickname.isEmpty()) return nickname;
+    }
+    auto u = m_users.constFind(userId);
+    if (u != m_users.cend()) {
+        QString nickname = (*u)["nickname"].toString();
+        return nickname.isEmpty() ? (*u)["username"].toString() : nickname;
+    }
+    return userId;
+}
+
+void FriendRoster::setFriends(const QJsonArray &friends)
+{
+    m_friends.clear();
+    m_friends.reserve(friends.size());
+    for (const QJsonValue &value : friends) {
+        QJsonObject f = value.toObject();
+        QString id = f["friend_id"].toString();
+        if (!id.isEmpty()) m_friends.insert(id, f);
+    }
+    m_friendsLoaded = true;
+    bump();
+}
+
+void FriendRoster::setUsers(const QJsonArray &users)
+{
+    m_users.clear();
+    m_users.reserve(users.size());
+    for (const QJsonValue &value : users) {
+        QJsonObject u = value.toObject();
+        QString id = u["id"].toString();
+        if (!id.isEmpty()) m_users.insert(id, u);
+    }
+    bump();
+}
+
+void FriendRoster::applyFriends(const QJsonArray &upserts, const QStringList &removed)
+{
+    if (applyDelta(m_friends, "friend_id", upserts, removed)) bump();
+}
+
+void FriendRoster::applyUsers(const QJsonArray &upserts, const QStringList &removed)
+{
+    if (applyDelta(m_users, "id", upserts, removed)) bump();
+}
+
+void FriendRoster::removeFriend(const QString &userId)
+{
+    if (m_friends.remove(userId)) bump();
+}
+
+void FriendRoster::updateUser(const QString &userId, const QString &field, const QJsonValue &value)
+{
+    auto it = m_users.find(userId);
+    if (it == m_users.end() || (*it)[field] == value) return;
+    (*it)[field] = value;
+    bump();
+}
+
+void FriendRoster::applyPresence(const Presence::Diff &diff)
+{
+    bool dirty = false;
+    for (auto it = diff.cbegin(); it != diff.cend(); ++it) {
+        auto f = m_friends.find(it.key());
+        if (f != m_friends.end()) {
+            (*f)["online"] = it.value();
+            dirty = true;
+        }
+        auto u = m_users.find(it.key());
+        if (u != m_users.end()) {
+            (*u)["online"] = it.value();
+            dirty = true;
+        }
+    }
+    // 一批状态变化只递增一次 revision
+    if (dirty) bump();
+}
+
+void FriendRoster::clear()
+{
+    m_friends.clear();
+    m_users.clear();
+    m_friendsLoaded = false;
+    bump();
+}
+
+void FriendRoster::bump()
+{
+    m_revision++;
+    emit changed();
+}
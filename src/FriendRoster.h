@@ -0,0 +1,62 @@
+#ifndef FRIENDROSTER_H
+#define FRIENDROSTER_H
+
+#include <QObject>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QStringList>
+#include <QVariantMap>
+
+#include "Presence.h"
+
+// 好友与用户资料的内存索引，由 NetworkManager 在获取列表时填充、收到变更时更新。
+// 切换会话、打开资料页只做哈希查找，不再为一个布尔值下载整张列表。
+// QML 中以 NetworkManager.roster 访问，绑定里引用 revision 以便数据变化后重新求值。
+class FriendRoster : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(int revision READ revision NOTIFY changed)
+    Q_PROPERTY(bool friendsLoaded READ friendsLoaded NOTIFY changed)
+    Q_PROPERTY(int friendCount READ friendCount NOTIFY changed)
+
+public:
+    explicit FriendRoster(QObject *parent = nullptr);
+
+    int revision() const { return m_revision; }
+    bool friendsLoaded() const { return m_friendsLoaded; }
+    int friendCount() const { return m_friends.size(); }
+
+    Q_INVOKABLE bool isFriend(const QString &userId) const { return m_friends.contains(userId); }
+    // 未找到时返回空对象
+    Q_INVOKABLE QVariantMap friendInfo(const QString &userId) const;
+    Q_INVOKABLE QVariantMap user(const QString &userId) const;
+    // 备注优先，其次昵称，最后用户名
+    Q_INVOKABLE QString displayName(const QString &userId) const;
+
+    QJsonObject friendObject(const QString &userId) const { return m_friends.value(userId); }
+    QJsonObject userObject(const QString &userId) const { return m_users.value(userId); }
+
+    void setFriends(const QJsonArray &friends);
+    void setUsers(const QJsonArray &users);
+    // 增量同步：upserts 为完整对象，removed 为 id
+    void applyFriends(const QJsonArray &upserts, const QStringList &removed);
+    void applyUsers(const QJsonArray &upserts, const QStringList &removed);
+    void removeFriend(const QString &userId);
+    void updateUser(const QString &userId, const QString &field, const QJsonValue &value);
+    void applyPresence(const Presence::Diff &diff);
+    void clear();
+
+signals:
+    void changed();
+
+private:
+    void bump();
+
+    QHash<QString, QJsonObject> m_friends;  // friend_id
+    QHash<QString, QJsonObject> m_users;    // id
+    bool m_friendsLoaded;
+    int m_revision;
+};
+
+#endif
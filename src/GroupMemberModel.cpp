@@ -0,0 +1,174 @@
+#include "GroupMemberModel.h"
+#include "NetworkManager.h"
+
+namespace {
+
+const int LOAD_ALL_PAGE_SIZE = 500;
+
+}
+
+GroupMemberModel::GroupMemberModel(QObject *parent)
+    : QAbstractListModel(parent)
+    , m_offset(0)
+    , m_total(-1)
+    , m_pageSize(100)
+    , m_loading(false)
+    , m_loadAll(false)
+{
+    connect(NetworkManager::instance(), &NetworkManager::groupMembersReceived,
+            this, &GroupMemberModel::onMembersReceived);
+}
+
+int GroupMemberModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid()) return 0;
+    return m_members.size();
+}
+
+QVariant GroupMemberModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_members.size()) return QVariant();
+
+    const Member &m = m_members.at(index.row());
+    switch (role) {
+    case UserIdRole: return m.userId;
+    case NameRole: return m.name;
+    case NicknameRole: return m.nickname;
+    case UsernameRole: return m.username;
+    case MemberRoleRole: return m.role;
+    }
+    return QVariant();
+}
+
+QHash<int, QByteArray> GroupMemberModel::roleNames() const
+{
+    return {
+        {UserIdRole, "userId"},
+        {NameRole, "name"},
+        {NicknameRole, "nickname"},
+        {UsernameRole, "username"},
+        {MemberRoleRole, "memberRole"}
+    };
+}
+
+bool GroupMemberModel::canFetchMore(const QModelIndex &parent) const
+{
+    if (parent.isValid() || m_groupId.isEmpty()) return false;
+    return !isComplete() && !m_loading;
+}
+
+void GroupMemberModel::fetchMore(const QModelIndex &parent)
+{
+    if (!canFetchMore(parent)) return;
+    requestPage();
+}
+
+void GroupMemberModel::setGroupId(const QString &id)
+{
+    if (m_groupId == id) return;
+    m_groupId = id;
+    emit groupIdChanged();
+    reload();
+}
+
+void GroupMemberModel::setPageSize(int size)
+{
+    if (size <= 0 || m_pageSize == size) return;
+    m_pageSize = size;
+    emit pageSizeChanged();
+}
+
+void GroupMemberModel::reload()
+{
+    beginResetModel();
+    m_members.clear();
+    m_ids.clear();
+    m_index.clear();
+    m_offset = 0;
+    m_total = -1;
+    m_loadAll = false;
+    endResetModel();
+    setLoading(false);
+    emit countChanged();
+
+    if (!m_groupId.isEmpty()) requestPage();
+}
+
+void GroupMemberModel::loadAll()
+{
+    if (m_groupId.isEmpty() || isComplete()) return;
+    m_loadAll = true;
+    if (!m_loading) requestPage();
+}
+
+void GroupMemberModel::requestPage()
+{
+    setLoading(true);
+    int limit = m_loadAll ? qMax(m_pageSize, LOAD_ALL_PAGE_SIZE) : m_pageSize;
+    NetworkManager::instance()->fetchGroupMembers(m_groupId, m_offset, limit);
+}
+
+void GroupMemberModel::onMembersReceived(const QString &groupId, int offset, const QJsonArray &members, int total)
+{
+    // 切换群或重新加载之前发出的请求
+    if (groupId != m_groupId || offset != m_offset || !m_loading) return;
+    setLoading(false);
+    if (total < 0) {
+        m_loadAll = false;
+        return;
+    }
+
+    auto roster = NetworkManager::instance()->roster();
+    QVector<Member> page;
+    page.reserve(members.size());
+    for (const QJsonValue &value : members) {
+        QJsonObject obj = value.toObject();
+        Member m;
+        m.userId = obj["user_id"].toString();
+        // 翻页期间有人退群时，后一页可能与前一页重叠
+        if (m.userId.isEmpty() || m_ids.contains(m.userId)) continue;
+        m.nickname = obj["nickname"].toString();
+        m.username = obj["username"].toString();
+        m.role = obj["role"].toString("member");
+        QString remark = roster->isFriend(m.userId) ? roster->friendInfo(m.userId)["remark"].toString() : QString();
+        m.name = !remark.isEmpty() ? remark : (!m.nickname.isEmpty() ? m.nickname : m.username);
+
+        m_ids.insert(m.userId);
+        m_index.add(m_members.size() + page.size(), {remark, m.nickname, m.username});
+        page.append(m);
+    }
+    m_index.commit();
+
+    m_offset += members.size();
+    // 空页说明服务器的总数已经过时
+    m_total = members.isEmpty() ? m_offset : total;
+    if (!page.isEmpty()) {
+        beginInsertRows(QModelIndex(), m_members.size(), m_members.size() + page.size() - 1);
+        m_members.append(page);
+        endInsertRows();
+    }
+    emit countChanged();
+
+    if (isComplete()) m_loadAll = false;
+    else if (m_loadAll) requestPage();
+}
+
+QVariantList GroupMemberModel::complete(const QString &prefix, int limit) const
+{
+    QVariantList list;
+    for (int row : m_index.complete(prefix, limit)) {
+        const Member &m = m_members.at(row);
+        QVariantMap entry;
+        entry["userId"] = m.userId;
+        entry["name"] = m.name;
+        list.append(entry);
+    }
+    return list;
+}
+
+void GroupMemberModel::setLoading(bool loading)
+{
+    if (m_loading == loading) return;
+    m_loading = loading;
+    emit loadingChanged();
+}
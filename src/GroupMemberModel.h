@@ -0,0 +1,88 @@
+#ifndef GROUPMEMBERMODEL_H
+#define GROUPMEMBERMODEL_H
+
+#include <QAbstractListModel>
+#include <QSet>
+#include <QVector>
+#include <QJsonArray>
+
+#include "MentionIndex.h"
+
+// 群成员模型：每个群一个实例，成员按页从服务器取回，列表滚动到底时由 fetchMore 续取。
+// 取回的成员同时进入 MentionIndex，@ 补全只查前缀索引；输入 @ 时 loadAll 在后台以大页补齐剩余成员。
+class GroupMemberModel : public QAbstractListModel
+{
+    Q_OBJECT
+    Q_PROPERTY(QString groupId READ groupId WRITE setGroupId NOTIFY groupIdChanged)
+    Q_PROPERTY(int count READ count NOTIFY countChanged)
+    Q_PROPERTY(int total READ total NOTIFY countChanged)
+    Q_PROPERTY(int pageSize READ pageSize WRITE setPageSize NOTIFY pageSizeChanged)
+    Q_PROPERTY(bool loading READ loading NOTIFY loadingChanged)
+
+public:
+    enum Roles {
+        UserIdRole = Qt::UserRole + 1,
+        NameRole,
+        NicknameRole,
+        UsernameRole,
+        MemberRoleRole
+    };
+    Q_ENUM(Roles)
+
+    explicit GroupMemberModel(QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+
+    QString groupId() const { return m_groupId; }
+    void setGroupId(const QString &id);
+    int count() const { return m_members.size(); }
+    // 未知时为已加载的数量
+    int total() const { return m_total < 0 ? int(m_members.size()) : m_total; }
+    int pageSize() const { return m_pageSize; }
+    void setPageSize(int size);
+    bool loading() const { return m_loading; }
+
+    Q_INVOKABLE void reload();
+    Q_INVOKABLE void loadAll();
+    // 前缀匹配备注、昵称或用户名的成员 [{userId, name}]；未加载完时结果随 countChanged 变多
+    Q_INVOKABLE QVariantList complete(const QString &prefix, int limit = 8) const;
+
+signals:
+    void groupIdChanged();
+    void countChanged();
+    void pageSizeChanged();
+    void loadingChanged();
+
+private slots:
+    void onMembersReceived(const QString &groupId, int offset, const QJsonArray &members, int total);
+
+private:
+    struct Member {
+        QString userId;
+        QString name;       // 好友备注优先，其次昵称、用户名
+        QString nickname;
+        QString username;
+        QString role;       // owner / admin / member
+    };
+
+    bool isComplete() const { return m_total >= 0 && m_offset >= m_total; }
+    void requestPage();
+    void setLoading(bool loading);
+
+    QString m_groupId;
+    QVector<Member> m_members;
+    QSet<QString> m_ids;
+    MentionIndex m_index;
+    int m_offset;           // 下一页在服务器上的偏移
+    int m_total;            // -1 表示未知
+    int m_pageSize;
+    bool m_loading;
+    bool m_loadAll;
+};
+
+#endif
@@ -0,0 +1,296 @@
+#include "Latency.h"
+#include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QGuiApplication>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QQuickWindow>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <atomic>
+#include <iterator>
+#include <memory>
+
+namespace {
+
+// 值以微秒计：小于 128 的每微秒一格，之后每个 2 的幂区间 64 格，最大约 2^40 微秒
+const int SUB_BITS = 7;
+const int SUB_COUNT = 1 << SUB_BITS;
+const int HALF_COUNT = SUB_COUNT / 2;
+const int MAX_SHIFT = 34;
+const int BUCKET_COUNT = SUB_COUNT + MAX_SHIFT * HALF_COUNT;
+
+// 等待插入或绘制的消息超过该时间即丢弃（例如消息属于未打开的会话）
+const qint64 PENDING_TIMEOUT_NS = 30LL * 1000 * 1000 * 1000;
+const int MAX_PENDING = 4096;
+// 上一条消息到达后这段时间内交换的帧算作忙碌帧；相邻两帧都忙碌时才记录间隔，空闲后的第一帧不计
+const qint64 FLOOD_IDLE_NS = 500LL * 1000 * 1000;
+
+const char *const STAGE_NAMES[] = {
+    "queue", "socket_write", "ack", "round_trip", "parse", "dispatch", "insert", "paint", "transit", "frame",
+};
+static_assert(std::size(STAGE_NAMES) == Latency::StageCount, "stage names out of sync");
+
+struct Histogram {
+    std::atomic<quint64> counts[BUCKET_COUNT];
+    std::atomic<quint64> total{0};
+    std::atomic<qint64> sum{0};
+    std::atomic<qint64> max{0};
+};
+
+Histogram g_histograms[Latency::StageCount];
+
+int bucketFor(qint64 us)
+{
+    if (us < SUB_COUNT) return int(qMax<qint64>(us, 0));
+    int shift = 64 - qCountLeadingZeroBits(quint64(us)) - SUB_BITS;
+    if (shift > MAX_SHIFT) return BUCKET_COUNT - 1;
+    return SUB_COUNT + (shift - 1) * HALF_COUNT + int((us >> shift) - HALF_COUNT);
+}
+
+// 格内的中间值
+double bucketValue(int bucket)
+{
+    if (bucket < SUB_COUNT) return bucket;
+    int shift = (bucket - SUB_COUNT) / HALF_COUNT + 1;
+    qint64 sub = (bucket - SUB_COUNT) % HALF_COUNT + HALF_COUNT;
+    return double(sub << shift) + double((1LL << shift) - 1) / 2;
+}
+
+struct Summary {
+    quint64 count = 0;
+    double p50 = 0;
+    double p95 = 0;
+    double p99 = 0;
+    double p999 = 0;
+    double max = 0;
+    double mean = 0;
+};
+
+// 单位毫秒
+Summary summarize(const Histogram &h)
+{
+    Summary s;
+    quint64 counts[BUCKET_COUNT];
+    for (int i = 0; i < BUCKET_COUNT; ++i) {
+        counts[i] = h.counts[i].load(std::memory_order_relaxed);
+        s.count += counts[i];
+    }
+    if (s.count == 0) return s;
+
+    const double ps[] = {0.5, 0.95, 0.99, 0.999};
+    double *out[] = {&s.p50, &s.p95, &s.p99, &s.p999};
+    quint64 seen = 0;
+    int next = 0;
+    for (int i = 0; i < BUCKET_COUNT && next < 4; ++i) {
+        seen += counts[i];
+        while (next < 4 && seen >= quint64(ps[next] * s.count + 0.5)) {
+            *out[next++] = bucketValue(i) / 1000;
+        }
+    }
+    s.max = h.max.load(std::memory_order_relaxed) / 1000.0;
+    s.mean = double(h.sum.load(std::memory_order_relaxed)) / h.total.load(std::memory_order_relaxed) / 1000;
+    return s;
+}
+
+const QElapsedTimer &clock()
+{
+    static QElapsedTimer timer = []() {
+        QElapsedTimer t;
+        t.start();
+        return t;
+    }();
+    return timer;
+}
+
+}
+
+Latency* Latency::s_instance = nullptr;
+
+Latency::Latency(QObject *parent)
+    : QObject(parent)
+{
+}
+
+Latency* Latency::instance()
+{
+    if (!s_instance) s_instance = new Latency();
+    return s_instance;
+}
+
+Latency* Latency::create(QQmlEngine*, QJSEngine*)
+{
+    QQmlEngine::setObjectOwnership(instance(), QQmlEngine::CppOwnership);
+    return instance();
+}
+
+qint64 Latency::now()
+{
+    return clock().nsecsElapsed();
+}
+
+void Latency::record(Stage stage, qint64 nanoseconds)
+{
+    if (nanoseconds < 0) return;
+    qint64 us = nanoseconds / 1000;
+    Histogram &h = g_histograms[stage];
+    h.counts[bucketFor(us)].fetch_add(1, std::memory_order_relaxed);
+    h.total.fetch_add(1, std::memory_order_relaxed);
+    h.sum.fetch_add(us, std::memory_order_relaxed);
+    qint64 max = h.max.load(std::memory_order_relaxed);
+    while (us > max && !h.max.compare_exchange_weak(max, us, std::memory_order_relaxed)) {
+    }
+}
+
+void Latency::markReceived(qint64 messageId, qint64 receivedAt)
+{
+    if (messageId <= 0 || receivedAt <= 0) return;
+    m_lastReceivedAt = receivedAt;
+    // 聊天窗口没有打开时也要统计帧间隔
+    if (m_windows.isEmpty()) watchWindows();
+    if (m_received.size() >= MAX_PENDING) {
+        qint64 cutoff = now() - PENDING_TIMEOUT_NS;
+        m_received.removeIf([cutoff](const QHash<qint64, qint64>::iterator it) { return it.value() < cutoff; });
+        if (m_received.size() >= MAX_PENDING) m_received.clear();
+    }
+    m_received.insert(messageId, receivedAt);
+}
+
+void Latency::markInserted(qint64 messageId)
+{
+    auto it = m_received.find(messageId);
+    if (it == m_received.end()) return;
+    qint64 receivedAt = it.value();
+    m_received.erase(it);
+
+    qint64 t = now();
+    record(Insert, t - receivedAt);
+    if (m_painting.size() < MAX_PENDING) m_painting.append({receivedAt, t});
+    watchWindows();
+}
+
+void Latency::watchWindows()
+{
+    // 窗口由 QML 动态创建，插入消息时顺便接上新窗口
+    for (QWindow *window : QGuiApplication::topLevelWindows()) {
+        auto quick = qobject_cast<QQuickWindow *>(window);
+        if (!quick) continue;
+        bool known = false;
+        for (const QPointer<QQuickWindow> &w : std::as_const(m_windows)) known = known || w == quick;
+        if (known) continue;
+        m_windows.append(quick);
+
+        // 同步与交换在渲染线程发生：同步前插入的行才会出现在这一帧
+        auto syncedAt = std::make_shared<std::atomic<qint64>>(0);
+        auto lastSwap = std::make_shared<qint64>(0);
+        connect(quick, &QQuickWindow::afterSynchronizing, this, [syncedAt]() {
+            syncedAt->store(now(), std::memory_order_relaxed);
+        }, Qt::DirectConnection);
+        // frameSwapped 总在同一个渲染线程发出，lastSwap 只在那里读写
+        connect(quick, &QQuickWindow::frameSwapped, this, [this, syncedAt, lastSwap]() {
+            qint64 synced = syncedAt->load(std::memory_order_relaxed);
+            qint64 swapped = now();
+            qint64 interval = *lastSwap > 0 ? swapped - *lastSwap : 0;
+            *lastSwap = swapped;
+            QMetaObject::invokeMethod(this, [this, synced, swapped, interval]() {
+                onFrameSwapped(synced, swapped, interval);
+            }, Qt::QueuedConnection);
+        }, Qt::DirectConnection);
+    }
+}
+
+void Latency::onFrameSwapped(qint64 syncedAt, qint64 swappedAt, qint64 interval)
+{
+    bool busy = m_lastReceivedAt > 0 && swappedAt - m_lastReceivedAt < FLOOD_IDLE_NS;
+    if (busy && m_lastFrameBusy && interval > 0) record(Frame, interval);
+    m_lastFrameBusy = busy;
+
+    if (m_painting.isEmpty()) return;
+    qint64 cutoff = swappedAt - PENDING_TIMEOUT_NS;
+    m_painting.removeIf([this, syncedAt, swappedAt, cutoff](const Painting &p) {
+        if (p.insertedAt < syncedAt) {
+            record(Paint, swappedAt - p.receivedAt);
+            return true;
+        }
+        return p.insertedAt < cutoff;
+    });
+}
+
+QVariantList Latency::snapshot() const
+{
+    QVariantList list;
+    for (int i = 0; i < StageCount; ++i) {
+        Summary s = summarize(g_histograms[i]);
+        QVariantMap entry;
+        entry["stage"] = STAGE_NAMES[i];
+        entry["count"] = s.count;
+        entry["p50"] = s.p50;
+        entry["p95"] = s.p95;
+        entry["p99"] = s.p99;
+        entry["p999"] = s.p999;
+        entry["max"] = s.max;
+        entry["mean"] = s.mean;
+        list.append(entry);
+    }
+    return list;
+}
+
+QString Latency::toJson() const
+{
+    QJsonObject stages;
+    for (int i = 0; i < StageCount; ++i) {
+        const Histogram &h = g_histograms[i];
+        Summary s = summarize(h);
+        QJsonObject stage;
+        stage["count"] = qint64(s.count);
+        stage["p50_ms"] = s.p50;
+        stage["p95_ms"] = s.p95;
+        stage["p99_ms"] = s.p99;
+        stage["p999_ms"] = s.p999;
+        stage["max_ms"] = s.max;
+        stage["mean_ms"] = s.mean;
+        // 非空的格 [下界微秒, 计数]，便于监控端合并多份直方图
+        QJsonArray buckets;
+        for (int b = 0; b < BUCKET_COUNT; ++b) {
+            quint64 count = h.counts[b].load(std::memory_order_relaxed);
+            if (count == 0) continue;
+            qint64 lower = b < SUB_COUNT ? b
+                : qint64((b - SUB_COUNT) % HALF_COUNT + HALF_COUNT) << ((b - SUB_COUNT) / HALF_COUNT + 1);
+            buckets.append(QJsonArray{lower, qint64(count)});
+        }
+        stage["buckets"] = buckets;
+        stages[STAGE_NAMES[i]] = stage;
+    }
+
+    QJsonObject root;
+    root["generated_at"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODateWithMs);
+    root["uptime_ms"] = clock().elapsed();
+    root["sub_buckets"] = HALF_COUNT;
+    root["stages"] = stages;
+    return QString::fromUtf8(QJsonDocument(root).toJson(QJsonDocument::Indented));
+}
+
+QString Latency::exportToFile() const
+{
+    QString dir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/diagnostics";
+    QDir().mkpath(dir);
+    QString path = dir + "/latency-" + QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss") + ".json";
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) return QString();
+    file.write(toJson().toUtf8());
+    if (!file.commit()) return QString();
+    return path;
+}
+
+void Latency::reset()
+{
+    for (Histogram &h : g_histograms) {
+        for (auto &count : h.counts) count.store(0, std::memory_order_relaxed);
+        h.total.store(0, std::memory_order_relaxed);
+        h.sum.store(0, std::memory_order_relaxed);
+        h.max.store(0, std::memory_order_relaxed);
+    }
+}
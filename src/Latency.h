@@ -0,0 +1,75 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QPointer>
+#include <QVariantList>
+#include <QVector>
+#include <QQmlEngine>
+
+class QQuickWindow;
+
+// 消息链路各阶段的耗时直方图（HDR 风格：按 2 的幂分段，每段 64 格，相对误差约 1.6%）。
+// record() 无锁，可在网络线程调用；界面以 Latency 单例读取各阶段的 p50/p95/p99，并可导出 JSON。
+// 发送：入队 → 交给套接字 → 写出 → 服务器确认；接收：收到帧 → 解码 → 主线程分发 → 插入模型 → 首次绘制。
+// 另记消息持续到达期间相邻两帧的间隔，用来对比消息洪峰下界面是否掉帧。
+class Latency : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Stage {
+        Queue,          // sendMessage 入队到交给网络线程
+        SocketWrite,    // 交给网络线程到写入套接字
+        Ack,            // 写出到收到服务器确认
+        RoundTrip,      // 入队到收到服务器确认
+        Parse,          // 收到帧到解码完成（网络线程）
+        Dispatch,       // 解码完成到主线程开始处理
+        Insert,         // 收到帧到插入打开的聊天窗口
+        Paint,          // 收到帧到插入后的第一帧画面
+        Transit,        // 服务器时间戳到收到帧，跨机器时包含时钟偏差
+        Frame,          // 消息持续到达期间相邻两帧的间隔
+        StageCount
+    };
+    Q_ENUM(Stage)
+
+    static Latency* instance();
+    static Latency* create(QQmlEngine*, QJSEngine*);
+
+    // 单调时钟，纳秒
+    static qint64 now();
+    static void record(Stage stage, qint64 nanoseconds);
+
+    // 以下只在主线程调用：记下收到时刻，插入模型与之后的首帧据此计时
+    void markReceived(qint64 messageId, qint64 receivedAt);
+    void markInserted(qint64 messageId);
+
+    // [{stage, count, p50, p95, p99, p999, max, mean}]，单位毫秒
+    Q_INVOKABLE QVariantList snapshot() const;
+    Q_INVOKABLE QString toJson() const;
+    // 写入 AppDataLocation/diagnostics，返回文件路径，失败返回空串
+    Q_INVOKABLE QString exportToFile() const;
+    Q_INVOKABLE void reset();
+
+private:
+    struct Painting {
+        qint64 receivedAt;
+        qint64 insertedAt;
+    };
+
+    explicit Latency(QObject *parent = nullptr);
+
+    void watchWindows();
+    void onFrameSwapped(qint64 syncedAt, qint64 swappedAt, qint64 interval);
+
+    static Latency *s_instance;
+    QHash<qint64, qint64> m_received;       // 消息 id → 收到时刻
+    QVector<Painting> m_painting;           // 已插入、等待绘制
+    QList<QPointer<QQuickWindow>> m_windows;
+    qint64 m_lastReceivedAt = 0;
+    bool m_lastFrameBusy = false;
+};
+
+#endif
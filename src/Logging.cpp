@@ -0,0 +1,8 @@
+#include "Logging.h"
+
+// 默认只输出 info 及以上，debug 需要通过日志规则显式打开
+Q_LOGGING_CATEGORY(lcNet, "atchat.net", QtInfoMsg)
+Q_LOGGING_CATEGORY(lcWs, "atchat.ws", QtInfoMsg)
+Q_LOGGING_CATEGORY(lcOutbox, "atchat.outbox", QtInfoMsg)
+Q_LOGGING_CATEGORY(lcStore, "atchat.store", QtInfoMsg)
+Q_LOGGING_CATEGORY(lcModel, "atchat.model", QtInfoMsg)
@@ -0,0 +1,14 @@
+#ifndef LOGGING_H
+#define LOGGING_H
+
+#include <QLoggingCategory>
+
+// 日志分类，运行时可通过 QT_LOGGING_RULES 调整，例如 "atchat.ws.debug=true"。
+// 低于 ATCHAT_LOG_LEVEL 的级别在编译期去除（见 CMakeLists.txt）。
+Q_DECLARE_LOGGING_CATEGORY(lcNet)
+Q_DECLARE_LOGGING_CATEGORY(lcWs)
+Q_DECLARE_LOGGING_CATEGORY(lcOutbox)
+Q_DECLARE_LOGGING_CATEGORY(lcStore)
+Q_DECLARE_LOGGING_CATEGORY(lcModel)
+
+#endif
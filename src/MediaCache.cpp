@@ -0,0 +1,241 @@
+#include "MediaCache.h"
+#include "NetworkManager.h"
+#include "Logging.h"
+#include "Trace.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QTextStream>
+#include <QSet>
+#include <algorithm>
+
+namespace {
+
+const qint64 MEMORY_BUDGET = 64 * 1024 * 1024;
+const qint64 DISK_BUDGET = 512 * 1024 * 1024;
+
+}
+
+MediaCache* MediaCache::s_instance = nullptr;
+
+MediaCache::MediaCache(QObject *parent)
+    : QObject(parent)
+    , m_memory(MEMORY_BUDGET)
+    , m_diskBytes(0)
+{
+    m_dir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/media";
+    QDir().mkpath(m_dir);
+    loadIndex();
+}
+
+MediaCache* MediaCache::instance()
+{
+    if (!s_instance) s_instance = new MediaCache();
+    return s_instance;
+}
+
+MediaCache* MediaCache::create(QQmlEngine*, QJSEngine*)
+{
+    return instance();
+}
+
+QImage MediaCache::image(const QString &key)
+{
+    QMutexLocker locker(&m_memoryLock);
+    if (QImage *cached = m_memory.object(key)) {
+        m_memoryHits++;
+        return *cached;
+    }
+    return QImage();
+}
+
+void MediaCache::insertImage(const QString &key, const QImage &image)
+{
+    if (image.isNull()) return;
+    QMutexLocker locker(&m_memoryLock);
+    // 成本按解码后的字节数计算，超出预算时 QCache 淘汰最久未用的图片
+    m_memory.insert(key, new QImage(image), qMax<qsizetype>(1, image.sizeInBytes()));
+}
+
+QByteArray MediaCache::readDisk(const QString &url)
+{
+    QString path;
+    {
+        QMutexLocker locker(&m_diskLock);
+        auto hash = m_urlToHash.constFind(url);
+        if (hash == m_urlToHash.cend()) return QByteArray();
+        auto blob = m_blobs.find(*hash);
+        if (blob == m_blobs.end()) return QByteArray();
+        blob->lastUsed = QDateTime::currentMSecsSinceEpoch();
+        path = blobPath(*hash);
+    }
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return QByteArray();
+    m_diskHits++;
+    return file.readAll();
+}
+
+bool MediaCache::containsDisk(const QString &url) const
+{
+    QMutexLocker locker(&m_diskLock);
+    auto hash = m_urlToHash.constFind(url);
+    return hash != m_urlToHash.cend() && m_blobs.contains(*hash);
+}
+
+QString MediaCache::storeDisk(const QString &url, const QByteArray &data)
+{
+    QString hash = QString::fromLatin1(QCryptographicHash::hash(data, QCryptographicHash::Sha256).toHex());
+
+    QMutexLocker locker(&m_diskLock);
+    if (!m_blobs.contains(hash)) {
+        QString path = blobPath(hash);
+        QDir().mkpath(QFileInfo(path).path());
+        QSaveFile file(path);
+        if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit()) {
+            qCWarning(lcNet) << "media cache write failed" << path << file.errorString();
+            return QString();
+        }
+        m_blobs.insert(hash, Blob{data.size(), QDateTime::currentMSecsSinceEpoch()});
+        m_diskBytes += data.size();
+    }
+    if (m_urlToHash.value(url) != hash) {
+        m_urlToHash.insert(url, hash);
+        appendIndex(url, hash);
+    }
+    if (m_diskBytes > DISK_BUDGET) evictDisk();
+    return hash;
+}
+
+void MediaCache::fetch(const QString &url, const FetchCallback &callback)
+{
+    m_misses++;
+    auto pending = m_fetching.find(url);
+    if (pending != m_fetching.end()) {
+        pending->append(callback);
+        return;
+    }
+    m_fetching.insert(url, {callback});
+
+    HttpRequest req;
+    req.verb = "GET";
+    req.path = url;
+    req.rawBody = true;
+    NetworkManager::instance()->sendRequest(req, [this, url](const HttpResult &reply) {
+        const QList<FetchCallback> callbacks = m_fetching.take(url);
+        QString error = reply.ok() ? QString() : reply.errorString;
+        if (reply.ok()) m_downloadedBytes += reply.body.size();
+        ATCHAT_TRACE("media.fetch", reply.body.size(), reply.status, url);
+        for (const FetchCallback &callback : callbacks) callback(reply.body, error);
+    });
+}
+
+QVariantMap MediaCache::stats() const
+{
+    QVariantMap map;
+    map["memoryHits"] = qint64(m_memoryHits);
+    map["diskHits"] = qint64(m_diskHits);
+    map["misses"] = qint64(m_misses);
+    map["downloadedBytes"] = qint64(m_downloadedBytes);
+    {
+        QMutexLocker locker(&m_memoryLock);
+        map["memoryBytes"] = m_memory.totalCost();
+        map["memoryImages"] = m_memory.count();
+    }
+    {
+        QMutexLocker locker(&m_diskLock);
+        map["diskBytes"] = m_diskBytes;
+        map["diskFiles"] = m_blobs.size();
+    }
+    return map;
+}
+
+void MediaCache::clear()
+{
+    {
+        QMutexLocker locker(&m_memoryLock);
+        m_memory.clear();
+    }
+    QMutexLocker locker(&m_diskLock);
+    for (auto it = m_blobs.cbegin(); it != m_blobs.cend(); ++it) QFile::remove(blobPath(it.key()));
+    m_blobs.clear();
+    m_urlToHash.clear();
+    m_diskBytes = 0;
+    rewriteIndex();
+}
+
+QString MediaCache::blobPath(const QString &hash) const
+{
+    // 按哈希前两位分目录，避免单个目录文件过多
+    return m_dir + "/" + hash.left(2) + "/" + hash;
+}
+
+void MediaCache::loadIndex()
+{
+    QFile file(m_dir + "/index");
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) return;
+
+    // 每行 "哈希 地址"，后写入的覆盖先写入的
+    QTextStream in(&file);
+    while (!in.atEnd()) {
+        QString line = in.readLine();
+        int space = line.indexOf(' ');
+        if (space <= 0) continue;
+        QString hash = line.left(space);
+        if (!m_blobs.contains(hash)) {
+            QFileInfo info(blobPath(hash));
+            if (!info.exists()) continue;
+            m_blobs.insert(hash, Blob{info.size(), info.lastModified().toMSecsSinceEpoch()});
+            m_diskBytes += info.size();
+        }
+        m_urlToHash.insert(line.mid(space + 1), hash);
+    }
+    file.close();
+
+    // 启动时压缩掉被覆盖的旧行
+    rewriteIndex();
+    if (m_diskBytes > DISK_BUDGET) evictDisk();
+}
+
+void MediaCache::appendIndex(const QString &url, const QString &hash)
+{
+    QFile file(m_dir + "/index");
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)) return;
+    file.write((hash + " " + url + "\n").toUtf8());
+}
+
+void MediaCache::rewriteIndex()
+{
+    QSaveFile file(m_dir + "/index");
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) return;
+    for (auto it = m_urlToHash.cbegin(); it != m_urlToHash.cend(); ++it) {
+        file.write((it.value() + " " + it.key() + "\n").toUtf8());
+    }
+    file.commit();
+}
+
+void MediaCache::evictDisk()
+{
+    // 淘汰到预算的 90%，避免每次写入都触发淘汰
+    QVector<QPair<qint64, QString>> order;
+    order.reserve(m_blobs.size());
+    for (auto it = m_blobs.cbegin(); it != m_blobs.cend(); ++it) order.append({it->lastUsed, it.key()});
+    std::sort(order.begin(), order.end());
+
+    QSet<QString> evicted;
+    for (const auto &entry : std::as_const(order)) {
+        if (m_diskBytes <= DISK_BUDGET * 9 / 10) break;
+        m_diskBytes -= m_blobs.take(entry.second).size;
+        QFile::remove(blobPath(entry.second));
+        evicted.insert(entry.second);
+    }
+    for (auto it = m_urlToHash.begin(); it != m_urlToHash.end();) {
+        if (evicted.contains(it.value())) it = m_urlToHash.erase(it);
+        else ++it;
+    }
+    rewriteIndex();
+}
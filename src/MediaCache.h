@@ -0,0 +1,75 @@
+#ifndef MEDIACACHE_H
+#define MEDIACACHE_H
+
+#include <QObject>
+#include <QCache>
+#include <QHash>
+#include <QImage>
+#include <QMutex>
+#include <QVariantMap>
+#include <QQmlEngine>
+#include <atomic>
+#include <functional>
+
+// 两级媒体缓存：
+// - 内存中按字节预算淘汰的 LRU，保存已解码、已缩放的图片，键为 地址@尺寸；
+// - 磁盘上按内容 SHA-256 寻址的原始文件，不同地址的相同内容只存一份。
+// 读取接口可在任意线程调用；fetch 只能在 GUI 线程调用，同一地址的并发下载会合并。
+class MediaCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    using FetchCallback = std::function<void(const QByteArray &data, const QString &error)>;
+
+    static MediaCache* instance();
+    static MediaCache* create(QQmlEngine*, QJSEngine*);
+
+    QImage image(const QString &key);
+    void insertImage(const QString &key, const QImage &image);
+
+    // 磁盘缓存中的文件内容，未命中返回空
+    QByteArray readDisk(const QString &url);
+    bool containsDisk(const QString &url) const;
+    // 写入磁盘缓存，返回内容哈希
+    QString storeDisk(const QString &url, const QByteArray &data);
+
+    void fetch(const QString &url, const FetchCallback &callback);
+
+    Q_INVOKABLE QVariantMap stats() const;
+    Q_INVOKABLE void clear();
+
+private:
+    struct Blob {
+        qint64 size = 0;
+        qint64 lastUsed = 0;
+    };
+
+    explicit MediaCache(QObject *parent = nullptr);
+
+    QString blobPath(const QString &hash) const;
+    void loadIndex();
+    void appendIndex(const QString &url, const QString &hash);
+    void rewriteIndex();
+    void evictDisk();
+
+    static MediaCache *s_instance;
+
+    mutable QMutex m_memoryLock;
+    QCache<QString, QImage> m_memory;
+
+    mutable QMutex m_diskLock;
+    QString m_dir;
+    QHash<QString, QString> m_urlToHash;
+    QHash<QString, Blob> m_blobs;
+    qint64 m_diskBytes;
+
+    QHash<QString, QList<FetchCallback>> m_fetching;
+
+    std::atomic<qint64> m_memoryHits{0};
+    std::atomic<qint64> m_diskHits{0};
+    std::atomic<qint64> m_misses{0};
+    std::atomic<qint64> m_downloadedBytes{0};
+};
+
+#endif
@@ -0,0 +1,196 @@
+#include "MediaImageProvider.h"
+#include "MediaCache.h"
+#include "MediaPipeline.h"
+#include "BlurHash.h"
+#include <QBuffer>
+#include <QFile>
+#include <QImageReader>
+#include <QThread>
+#include <QUrl>
+
+namespace {
+
+bool isLocalFile(const QString &url)
+{
+    return url.startsWith("file:") || QFile::exists(url);
+}
+
+// 只缩小不放大；一边为 0 时按比例计算另一边
+QSize targetSize(const QSize &original, const QSize &requested)
+{
+    if (!original.isValid()) return QSize();
+    int w = requested.width();
+    int h = requested.height();
+    if (w <= 0 && h <= 0) return QSize();
+    if (w <= 0) w = original.width() * h / original.height();
+    if (h <= 0) h = original.height() * w / original.width();
+    QSize target = original.scaled(w, h, Qt::KeepAspectRatio);
+    if (target.width() >= original.width()) return QSize();
+    return target.expandedTo(QSize(1, 1));
+}
+
+}
+
+MediaImageResponse::MediaImageResponse(const QString &url, const QSize &requestedSize, QThreadPool *pool,
+                                       Source source)
+    : m_url(url)
+    , m_key(QString("%1@%2x%3")
+                .arg(source == Thumbnail ? MediaPipeline::thumbnailKey(url) : url)
+                .arg(requestedSize.width()).arg(requestedSize.height()))
+    , m_requestedSize(requestedSize)
+    , m_pool(pool)
+    , m_source(source)
+{
+    // 引擎在 finished 之后才销毁本对象，取消时也必须发出 finished
+    m_pool->start([this]() {
+        if (m_source == Thumbnail) {
+            lookupThumbnail();
+        } else {
+            lookup();
+        }
+    });
+}
+
+QQuickTextureFactory *MediaImageResponse::textureFactory() const
+{
+    return QQuickTextureFactory::textureFactoryForImage(m_image);
+}
+
+void MediaImageResponse::cancel()
+{
+    m_cancelled = true;
+}
+
+void MediaImageResponse::lookup()
+{
+    if (m_cancelled) {
+        deliver(QImage(), "cancelled");
+        return;
+    }
+
+    auto cache = MediaCache::instance();
+    QImage cached = cache->image(m_key);
+    if (!cached.isNull()) {
+        deliver(cached, QString());
+        return;
+    }
+
+    if (isLocalFile(m_url)) {
+        QFile file(m_url.startsWith("file:") ? QUrl(m_url).toLocalFile() : m_url);
+        if (!file.open(QIODevice::ReadOnly)) {
+            deliver(QImage(), file.errorString());
+            return;
+        }
+        decode(file.readAll(), false);
+        return;
+    }
+
+    QByteArray data = cache->readDisk(m_url);
+    if (!data.isEmpty()) {
+        decode(data, false);
+        return;
+    }
+
+    // 下载在网络线程完成，回到线程池解码
+    QMetaObject::invokeMethod(cache, [this, cache]() {
+        cache->fetch(m_url, [this](const QByteArray &data, const QString &error) {
+            if (!error.isEmpty() || data.isEmpty()) {
+                deliver(QImage(), error.isEmpty() ? QString("empty response") : error);
+                return;
+            }
+            m_pool->start([this, data]() { decode(data, true); });
+        });
+    }, Qt::QueuedConnection);
+}
+
+void MediaImageResponse::lookupThumbnail()
+{
+    if (m_cancelled) {
+        deliver(QImage(), "cancelled");
+        return;
+    }
+
+    auto cache = MediaCache::instance();
+    QImage cached = cache->image(m_key);
+    if (!cached.isNull()) {
+        deliver(cached, QString());
+        return;
+    }
+
+    QByteArray data = cache->readDisk(MediaPipeline::thumbnailKey(m_url));
+    if (!data.isEmpty()) {
+        decode(data, false);
+        return;
+    }
+
+    auto pipeline = MediaPipeline::instance();
+    QMetaObject::invokeMethod(pipeline, [this, pipeline]() {
+        pipeline->requestThumbnail(m_url, [this](const QByteArray &jpeg) {
+            if (jpeg.isEmpty()) {
+                deliver(QImage(), QString("thumbnail unavailable"));
+                return;
+            }
+            m_pool->start([this, jpeg]() { decode(jpeg, false); });
+        });
+    }, Qt::QueuedConnection);
+}
+
+void MediaImageResponse::decode(const QByteArray &data, bool store)
+{
+    if (store) MediaCache::instance()->storeDisk(m_url, data);
+    if (m_cancelled) {
+        deliver(QImage(), "cancelled");
+        return;
+    }
+
+    QBuffer buffer;
+    buffer.setData(data);
+    buffer.open(QIODevice::ReadOnly);
+    QImageReader reader(&buffer);
+    reader.setAutoTransform(true);
+
+    // 让解码器直接输出目标尺寸，JPEG 等格式可以跳过大部分像素
+    QSize target = targetSize(reader.size(), m_requestedSize);
+    if (target.isValid()) reader.setScaledSize(target);
+
+    QImage image = reader.read();
+    if (image.isNull()) {
+        deliver(QImage(), reader.errorString());
+        return;
+    }
+    MediaCache::instance()->insertImage(m_key, image);
+    deliver(image, QString());
+}
+
+void MediaImageResponse::deliver(const QImage &image, const QString &error)
+{
+    m_image = image;
+    m_error = error;
+    emit finished();
+}
+
+MediaImageProvider::MediaImageProvider(MediaImageResponse::Source source)
+    : m_source(source)
+{
+    m_pool.setMaxThreadCount(qMax(2, QThread::idealThreadCount() / 2));
+}
+
+QQuickImageResponse *MediaImageProvider::requestImageResponse(const QString &id, const QSize &requestedSize)
+{
+    return new MediaImageResponse(QUrl::fromPercentEncoding(id.toUtf8()), requestedSize, &m_pool, m_source);
+}
+
+BlurHashImageProvider::BlurHashImageProvider()
+    : QQuickImageProvider(QQuickImageProvider::Image)
+{
+}
+
+QImage BlurHashImageProvider::requestImage(const QString &id, QSize *size, const QSize &requestedSize)
+{
+    // 占位图只含低频信息，32 像素足够，放大交给 GPU
+    int width = requestedSize.width() > 0 ? qMin(requestedSize.width(), 32) : 32;
+    int height = requestedSize.height() > 0 ? qMin(requestedSize.height(), 32) : 32;
+    QImage image = BlurHash::decode(QUrl::fromPercentEncoding(id.toUtf8()), width, height);
+    if (size) *size = image.size();
+    return image;
+}
@@ -0,0 +1,69 @@
+#ifndef MEDIAIMAGEPROVIDER_H
+#define MEDIAIMAGEPROVIDER_H
+
+#include <QQuickAsyncImageProvider>
+#include <QQuickImageProvider>
+#include <QQuickImageResponse>
+#include <QThreadPool>
+#include <QImage>
+#include <QSize>
+#include <atomic>
+
+// image://media/<百分号编码的地址>：先查内存，再查磁盘，最后下载；
+// image://thumb/<百分号编码的地址>：本地生成的缩略图，缺失时由 MediaPipeline 生成。
+// 解码与缩放在线程池中完成，只按请求的尺寸解码
+class MediaImageResponse : public QQuickImageResponse
+{
+    Q_OBJECT
+
+public:
+    enum Source {
+        Original,
+        Thumbnail
+    };
+
+    MediaImageResponse(const QString &url, const QSize &requestedSize, QThreadPool *pool,
+                       Source source = Original);
+
+    QQuickTextureFactory *textureFactory() const override;
+    QString errorString() const override { return m_error; }
+    void cancel() override;
+
+private:
+    void lookup();
+    void lookupThumbnail();
+    void decode(const QByteArray &data, bool store);
+    void deliver(const QImage &image, const QString &error);
+
+    QString m_url;
+    QString m_key;
+    QSize m_requestedSize;
+    QThreadPool *m_pool;
+    Source m_source;
+    QImage m_image;
+    QString m_error;
+    std::atomic_bool m_cancelled{false};
+};
+
+class MediaImageProvider : public QQuickAsyncImageProvider
+{
+public:
+    explicit MediaImageProvider(MediaImageResponse::Source source = MediaImageResponse::Original);
+
+    QQuickImageResponse *requestImageResponse(const QString &id, const QSize &requestedSize) override;
+
+private:
+    MediaImageResponse::Source m_source;
+    QThreadPool m_pool;
+};
+
+// image://blurhash/<哈希>：把几十个字符的哈希解码成小图，由 Image 拉伸显示
+class BlurHashImageProvider : public QQuickImageProvider
+{
+public:
+    BlurHashImageProvider();
+
+    QImage requestImage(const QString &id, QSize *size, const QSize &requestedSize) override;
+};
+
+#endif
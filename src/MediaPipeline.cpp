@@ -0,0 +1,295 @@
+#include "MediaPipeline.h"
+#include "MediaCache.h"
+#include "UploadManager.h"
+#include "NetworkManager.h"
+#include "BlurHash.h"
+#include "Logging.h"
+#include "Trace.h"
+#include <QBuffer>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QFutureWatcher>
+#include <QImageReader>
+#include <QJsonDocument>
+#include <QMimeDatabase>
+#include <QStandardPaths>
+#include <QUrl>
+#include <QtConcurrent>
+
+namespace {
+
+const int THUMBNAIL_EDGE = 320;
+const int THUMBNAIL_QUALITY = 80;
+
+QString metaKey(const QString &url)
+{
+    return "meta:" + url;
+}
+
+}
+
+MediaPipeline* MediaPipeline::s_instance = nullptr;
+
+MediaPipeline::MediaPipeline(QObject *parent)
+    : QObject(parent)
+{
+    // 缩略图生成占满 CPU 时也不能拖慢图片解码线程池
+    m_pool.setMaxThreadCount(2);
+
+    auto net = NetworkManager::instance();
+    connect(net, &NetworkManager::messageReceived, this, &MediaPipeline::onMessage);
+    connect(net, &NetworkManager::groupMessageReceived, this, &MediaPipeline::onMessage);
+
+    auto uploads = UploadManager::instance();
+    connect(uploads, &UploadManager::finished, this, &MediaPipeline::onUploadFinished);
+    connect(uploads, &UploadManager::failed, this, &MediaPipeline::onUploadFailed);
+    connect(uploads, &UploadManager::cancelled, this, &MediaPipeline::onUploadFailed);
+}
+
+MediaPipeline* MediaPipeline::instance()
+{
+    if (!s_instance) s_instance = new MediaPipeline();
+    return s_instance;
+}
+
+MediaPipeline* MediaPipeline::create(QQmlEngine*, QJSEngine*)
+{
+    return instance();
+}
+
+bool MediaPipeline::isImageFile(const QString &filePath)
+{
+    return QMimeDatabase().mimeTypeForFile(filePath).name().startsWith("image/");
+}
+
+MediaPipeline::Generated MediaPipeline::generate(const QByteArray &data)
+{
+    Generated result;
+
+    QBuffer buffer;
+    buffer.setData(data);
+    buffer.open(QIODevice::ReadOnly);
+    QImageReader reader(&buffer);
+    reader.setAutoTransform(true);
+
+    QSize original = reader.size();
+    if (!original.isValid()) return result;
+    if (reader.transformation() & QImageIOHandler::TransformationRotate90) original.transpose();
+
+    // 解码时直接缩小，12 MB 的照片也不会在内存中展开成原始尺寸
+    QSize target = original.scaled(THUMBNAIL_EDGE, THUMBNAIL_EDGE, Qt::KeepAspectRatio);
+    if (target.width() < original.width()) {
+        QSize scaled = target;
+        if (reader.transformation() & QImageIOHandler::TransformationRotate90) scaled.transpose();
+        reader.setScaledSize(scaled);
+    }
+    QImage thumbnail = reader.read();
+    if (thumbnail.isNull()) return result;
+
+    QBuffer out(&result.thumbnail);
+    out.open(QIODevice::WriteOnly);
+    thumbnail.save(&out, "JPEG", THUMBNAIL_QUALITY);
+    result.blurhash = BlurHash::encode(thumbnail);
+    result.size = original;
+    return result;
+}
+
+void MediaPipeline::prepareUpload(const QString &taskId, const QString &filePath)
+{
+    if (!isImageFile(filePath)) return;
+
+    PendingUpload &upload = m_uploads[taskId];
+    upload.filePath = filePath;
+
+    auto watcher = new QFutureWatcher<Generated>(this);
+    connect(watcher, &QFutureWatcher<Generated>::finished, this, [this, watcher, taskId]() {
+        watcher->deleteLater();
+        onGenerated(taskId, watcher->result());
+    });
+    watcher->setFuture(QtConcurrent::run(&m_pool, [filePath]() {
+        QFile file(filePath);
+        if (!file.open(QIODevice::ReadOnly)) return Generated();
+        return generate(file.readAll());
+    }));
+}
+
+QString MediaPipeline::sendImage(const QString &to, const QString &fileUrl, bool group)
+{
+    // QML 的文件对话框给出的是 file: 地址
+    QString filePath = fileUrl.startsWith("file:") ? QUrl(fileUrl).toLocalFile() : fileUrl;
+    QString taskId = NetworkManager::instance()->uploadFile(filePath);
+    auto it = m_uploads.find(taskId);
+    if (it == m_uploads.end()) {
+        qCWarning(lcNet) << "not an image" << filePath;
+        UploadManager::instance()->cancel(taskId);
+        return QString();
+    }
+    it->to = to;
+    it->group = group;
+    it->send = true;
+    return taskId;
+}
+
+void MediaPipeline::onGenerated(const QString &taskId, const Generated &generated)
+{
+    auto it = m_uploads.find(taskId);
+    if (it == m_uploads.end()) return;
+    it->generated = true;
+    it->preview = generated;
+    ATCHAT_TRACE("media.thumbnail", generated.thumbnail.size(), 0, taskId);
+
+    // 要发送消息的图片把缩略图也上传，接收方无需下载原图
+    if (it->send && !generated.thumbnail.isEmpty()) {
+        QString dir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/thumbnails";
+        QDir().mkpath(dir);
+        QString path = dir + "/" + taskId + ".jpg";
+        QFile file(path);
+        if (file.open(QIODevice::WriteOnly) && file.write(generated.thumbnail) == generated.thumbnail.size()) {
+            file.close();
+            it->thumbTaskId = UploadManager::instance()->upload(path);
+            m_thumbUploads.insert(it->thumbTaskId, taskId);
+            return;
+        }
+    }
+    tryFinishUpload(taskId);
+}
+
+void MediaPipeline::onUploadFinished(const QString &taskId, const QJsonObject &fileInfo)
+{
+    QString url = fileInfo["url"].toString();
+
+    auto thumb = m_thumbUploads.constFind(taskId);
+    if (thumb != m_thumbUploads.cend()) {
+        QString originalTask = m_thumbUploads.take(taskId);
+        QFile::remove(QStandardPaths::writableLocation(QStandardPaths::CacheLocation)
+                      + "/thumbnails/" + originalTask + ".jpg");
+        auto it = m_uploads.find(originalTask);
+        if (it == m_uploads.end()) return;
+        it->thumbTaskId.clear();
+        it->thumbUrl = url;
+        tryFinishUpload(originalTask);
+        return;
+    }
+
+    auto it = m_uploads.find(taskId);
+    if (it == m_uploads.end()) return;
+    it->url = url;
+    tryFinishUpload(taskId);
+}
+
+void MediaPipeline::onUploadFailed(const QString &taskId)
+{
+    // 缩略图上传失败不影响发送，只是接收方需要自己生成
+    if (m_thumbUploads.contains(taskId)) {
+        QString originalTask = m_thumbUploads.take(taskId);
+        auto it = m_uploads.find(originalTask);
+        if (it == m_uploads.end()) return;
+        it->thumbTaskId.clear();
+        tryFinishUpload(originalTask);
+        return;
+    }
+    m_uploads.remove(taskId);
+}
+
+void MediaPipeline::tryFinishUpload(const QString &taskId)
+{
+    auto it = m_uploads.find(taskId);
+    if (it == m_uploads.end()) return;
+    if (it->url.isEmpty() || !it->generated || !it->thumbTaskId.isEmpty()) return;
+
+    PendingUpload upload = m_uploads.take(taskId);
+    const Generated &preview = upload.preview;
+    if (!preview.thumbnail.isEmpty()) {
+        auto cache = MediaCache::instance();
+        cache->storeDisk(thumbnailKey(upload.url), preview.thumbnail);
+        if (!upload.thumbUrl.isEmpty()) cache->storeDisk(upload.thumbUrl, preview.thumbnail);
+        remember(upload.url, preview);
+    }
+    if (!upload.send) return;
+
+    QJsonObject media;
+    media["type"] = "image";
+    media["content"] = upload.url;
+    if (!upload.thumbUrl.isEmpty()) media["thumb_url"] = upload.thumbUrl;
+    if (!preview.blurhash.isEmpty()) media["blurhash"] = preview.blurhash;
+    if (preview.size.isValid()) {
+        media["width"] = preview.size.width();
+        media["height"] = preview.size.height();
+    }
+    NetworkManager::instance()->sendMediaMessage(upload.to, media, upload.group);
+}
+
+void MediaPipeline::onMessage(const QJsonObject &message)
+{
+    if (message["type"].toString() != "image") return;
+
+    QString url = message["content"].toString();
+    if (url.isEmpty() || message.contains("thumb_url")) return;
+    if (MediaCache::instance()->containsDisk(thumbnailKey(url))) return;
+    requestThumbnail(url);
+}
+
+void MediaPipeline::requestThumbnail(const QString &url, const ThumbnailCallback &callback)
+{
+    auto cache = MediaCache::instance();
+    QByteArray cached = cache->readDisk(thumbnailKey(url));
+    if (!cached.isEmpty()) {
+        if (callback) callback(cached);
+        return;
+    }
+
+    auto waiting = m_waiting.find(url);
+    if (waiting != m_waiting.end()) {
+        if (callback) waiting->append(callback);
+        return;
+    }
+    m_waiting.insert(url, callback ? QList<ThumbnailCallback>{callback} : QList<ThumbnailCallback>());
+
+    auto done = [this, url](const QByteArray &thumbnail) {
+        const QList<ThumbnailCallback> callbacks = m_waiting.take(url);
+        for (const ThumbnailCallback &cb : callbacks) cb(thumbnail);
+    };
+
+    cache->fetch(url, [this, url, done](const QByteArray &data, const QString &error) {
+        if (!error.isEmpty() || data.isEmpty()) {
+            done(QByteArray());
+            return;
+        }
+
+        auto watcher = new QFutureWatcher<Generated>(this);
+        connect(watcher, &QFutureWatcher<Generated>::finished, this, [this, watcher, url, done]() {
+            watcher->deleteLater();
+            Generated generated = watcher->result();
+            if (!generated.thumbnail.isEmpty()) remember(url, generated);
+            done(generated.thumbnail);
+        });
+        watcher->setFuture(QtConcurrent::run(&m_pool, [url, data]() {
+            // 原图顺带写入磁盘缓存，之后打开大图不必再下载
+            auto cache = MediaCache::instance();
+            cache->storeDisk(url, data);
+            Generated generated = generate(data);
+            if (!generated.thumbnail.isEmpty()) cache->storeDisk(thumbnailKey(url), generated.thumbnail);
+            return generated;
+        }));
+    });
+}
+
+void MediaPipeline::remember(const QString &url, const Generated &generated)
+{
+    QVariantMap preview;
+    preview["blurhash"] = generated.blurhash;
+    preview["width"] = generated.size.width();
+    preview["height"] = generated.size.height();
+    m_previews.insert(url, preview);
+    MediaCache::instance()->storeDisk(metaKey(url),
+        QJsonDocument(QJsonObject::fromVariantMap(preview)).toJson(QJsonDocument::Compact));
+    emit previewReady(url, generated.blurhash, generated.size.width(), generated.size.height());
+}
+
+QVariantMap MediaPipeline::preview(const QString &url) const
+{
+    auto found = m_previews.constFind(url);
+    if (found != m_previews.cend()) return *found;
+    return QJsonDocument::fromJson(MediaCache::instance()->readDisk(metaKey(url))).object().toVariantMap();
+}
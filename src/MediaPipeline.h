@@ -0,0 +1,81 @@
+#ifndef MEDIAPIPELINE_H
+#define MEDIAPIPELINE_H
+
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QSize>
+#include <QThreadPool>
+#include <QJsonObject>
+#include <QVariantMap>
+#include <QQmlEngine>
+#include <functional>
+
+// 图片缩略图与 BlurHash 占位图流水线，在独立线程池中生成：
+// - 发送图片时与原图上传并行生成，缩略图单独上传，消息携带 thumb_url 与 blurhash；
+// - 收到没有缩略图的图片消息时，下载一次原图在本地生成并缓存。
+// 气泡先显示 blurhash，再显示缩略图，只有打开大图时才加载原图。
+class MediaPipeline : public QObject
+{
+    Q_OBJECT
+
+public:
+    using ThumbnailCallback = std::function<void(const QByteArray &jpeg)>;
+
+    static MediaPipeline* instance();
+    static MediaPipeline* create(QQmlEngine*, QJSEngine*);
+
+    static bool isImageFile(const QString &filePath);
+    static QString thumbnailKey(const QString &url) { return "thumb:" + url; }
+
+    // NetworkManager::uploadFile 调用：上传开始时即从本地文件生成预览
+    void prepareUpload(const QString &taskId, const QString &filePath);
+    // 确保 url 的本地缩略图存在，回调在 GUI 线程执行，失败时数据为空
+    void requestThumbnail(const QString &url, const ThumbnailCallback &callback = ThumbnailCallback());
+
+    // 上传图片并在预览就绪后发送图片消息，返回上传任务 id；接受本地路径或 file: 地址
+    Q_INVOKABLE QString sendImage(const QString &to, const QString &fileUrl, bool group = false);
+    // 已知的预览信息 {blurhash, width, height}
+    Q_INVOKABLE QVariantMap preview(const QString &url) const;
+
+signals:
+    void previewReady(const QString &url, const QString &blurhash, int width, int height);
+
+private:
+    struct Generated {
+        QByteArray thumbnail;
+        QString blurhash;
+        QSize size;
+    };
+
+    struct PendingUpload {
+        QString filePath;
+        QString to;
+        bool group = false;
+        bool send = false;
+        bool generated = false;
+        Generated preview;
+        QString url;                // 原图上传完成后的地址
+        QString thumbTaskId;
+        QString thumbUrl;
+    };
+
+    explicit MediaPipeline(QObject *parent = nullptr);
+
+    static Generated generate(const QByteArray &data);
+    void onMessage(const QJsonObject &message);
+    void onUploadFinished(const QString &taskId, const QJsonObject &fileInfo);
+    void onUploadFailed(const QString &taskId);
+    void onGenerated(const QString &taskId, const Generated &generated);
+    void tryFinishUpload(const QString &taskId);
+    void remember(const QString &url, const Generated &generated);
+
+    static MediaPipeline *s_instance;
+    QThreadPool m_pool;
+    QHash<QString, PendingUpload> m_uploads;            // 原图上传任务 id
+    QHash<QString, QString> m_thumbUploads;             // 缩略图上传任务 id → 原图任务 id
+    QHash<QString, QList<ThumbnailCallback>> m_waiting; // 正在生成缩略图的地址
+    QHash<QString, QVariantMap> m_previews;
+};
+
+#endif
@@ -0,0 +1,56 @@
+#include "MentionIndex.h"
+#include <QSet>
+#include <algorithm>
+
+void MentionIndex::add(int member, const QStringList &names)
+{
+    QSet<QString> seen;
+    for (const QString &name : names) {
+        QString key = name.trimmed().toCaseFolded();
+        if (key.isEmpty()) continue;
+        seen.insert(key);
+        // "Alice Wang" 也能用 "wang" 找到
+        const QStringList parts = key.split(' ', Qt::SkipEmptyParts);
+        if (parts.size() > 1) {
+            for (const QString &part : parts) seen.insert(part);
+        }
+    }
+    for (const QString &key : std::as_const(seen)) m_keys.append({key, member});
+}
+
+void MentionIndex::commit()
+{
+    if (m_sorted == m_keys.size()) return;
+
+    // 新加入的一批单独排序后与已有部分合并
+    auto less = [](const Key &a, const Key &b) { return a.text < b.text; };
+    auto middle = m_keys.begin() + m_sorted;
+    std::sort(middle, m_keys.end(), less);
+    std::inplace_merge(m_keys.begin(), middle, m_keys.end(), less);
+    m_sorted = m_keys.size();
+}
+
+QVector<int> MentionIndex::complete(const QString &prefix, int limit) const
+{
+    QVector<int> result;
+    QString key = prefix.trimmed().toCaseFolded();
+    auto end = m_keys.cbegin() + m_sorted;
+    auto it = key.isEmpty() ? m_keys.cbegin()
+        : std::lower_bound(m_keys.cbegin(), end, key,
+                           [](const Key &k, const QString &v) { return k.text < v; });
+
+    QSet<int> seen;
+    for (; it != end && int(result.size()) < limit; ++it) {
+        if (!it->text.startsWith(key)) break;
+        if (seen.contains(it->member)) continue;
+        seen.insert(it->member);
+        result.append(it->member);
+    }
+    return result;
+}
+
+void MentionIndex::clear()
+{
+    m_keys.clear();
+    m_sorted = 0;
+}
@@ -0,0 +1,32 @@
+#ifndef MENTIONINDEX_H
+#define MENTIONINDEX_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// @ 补全用的前缀索引：成员的备注、昵称、用户名（以及其中空格分隔的各段）小写后放进有序数组，
+// 查询时二分定位到前缀起点再顺序取出，几千人的群也不需要逐个比较。
+// 成员以调用方的下标标识；一批成员加入后排序一次。
+class MentionIndex
+{
+public:
+    void add(int member, const QStringList &names);
+    // add 之后、查询之前调用
+    void commit();
+    // 前缀匹配的成员下标，按匹配到的名字排序、去重，最多 limit 个
+    QVector<int> complete(const QString &prefix, int limit) const;
+    void clear();
+    int size() const { return m_keys.size(); }
+
+private:
+    struct Key {
+        QString text;
+        int member;
+    };
+
+    QVector<Key> m_keys;
+    int m_sorted = 0;       // [0, m_sorted) 已排序
+};
+
+#endif
@@ -0,0 +1,467 @@
+#include "MessageListModel.h"
+#include "MessageStore.h"
+#include "NetworkManager.h"
+#include "MessageUtils.h"
+#include "Latency.h"
+
+#include <QSet>
+#include <climits>
+
+namespace {
+
+int statusRank(const QString &status)
+{
+    if (status == "read") return 3;
+    if (status == "delivered") return 2;
+    if (status == "sent") return 1;
+    return 0;
+}
+
+}
+
+MessageListModel::MessageListModel(QObject *parent)
+    : QAbstractListModel(parent)
+    , m_group(false)
+    , m_hasOlder(false)
+    , m_serverHasOlder(false)
+    , m_fetch(FetchNone)
+    , m_newerFrom(0)
+    , m_olderRevalidated(false)
+    , m_pageSize(50)
+    , m_loading(false)
+{
+    connect(MessageStore::instance(), &MessageStore::conversationUpdated,
+            this, &MessageListModel::onConversationUpdated);
+    connect(NetworkManager::instance(), &NetworkManager::historyReceived,
+            this, &MessageListModel::onHistoryReceived);
+    connect(NetworkManager::instance(), &NetworkManager::groupHistoryReceived,
+            this, &MessageListModel::onHistoryReceived);
+    connect(NetworkManager::instance(), &NetworkManager::messageQueued,
+            this, &MessageListModel::onMessageQueued);
+    connect(NetworkManager::instance(), &NetworkManager::messageStatusChanged,
+            this, &MessageListModel::onMessageStatusChanged);
+    connect(NetworkManager::instance()->receipts(), &Receipts::changed,
+            this, &MessageListModel::onReceiptsChanged);
+    connect(NetworkManager::instance(), &NetworkManager::connectionError, this, [this]() {
+        m_fetch = FetchNone;
+        setLoading(false);
+    });
+}
+
+int MessageListModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid()) return 0;
+    return count();
+}
+
+QVariant MessageListModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= count()) return QVariant();
+
+    const Message &m = messageAt(index.row());
+    switch (role) {
+    case MessageIdRole: return m.id;
+    case FromRole: return m.from;
+    case IsMeRole: return m.isMe;
+    case ContentRole: return m.content;
+    case TypeRole: return m.type;
+    case TimeRole: return m.time;
+    case ShowTimeRole: return m.showTime;
+    case DateLabelRole: return m.dateLabel;
+    case IsReadRole: return m.isRead;
+    case StatusRole: return m.status;
+    case ThumbUrlRole: return m.thumbUrl;
+    case BlurHashRole: return m.blurhash;
+    case MediaWidthRole: return m.mediaWidth;
+    case MediaHeightRole: return m.mediaHeight;
+    case ClientIdRole: return m.clientId;
+    }
+    return QVariant();
+}
+
+QHash<int, QByteArray> MessageListModel::roleNames() const
+{
+    return {
+        {MessageIdRole, "messageId"},
+        {FromRole, "from"},
+        {IsMeRole, "isMe"},
+        {ContentRole, "content"},
+        {TypeRole, "type"},
+        {TimeRole, "time"},
+        {ShowTimeRole, "showTime"},
+        {DateLabelRole, "dateLabel"},
+        {IsReadRole, "isRead"},
+        {StatusRole, "status"},
+        {ThumbUrlRole, "thumbUrl"},
+        {BlurHashRole, "blurhash"},
+        {MediaWidthRole, "mediaWidth"},
+        {MediaHeightRole, "mediaHeight"},
+        {ClientIdRole, "clientId"}
+    };
+}
+
+bool MessageListModel::canFetchMore(const QModelIndex &parent) const
+{
+    if (parent.isValid()) return false;
+    return m_hasOlder || (m_serverHasOlder && m_fetch == FetchNone);
+}
+
+void MessageListModel::fetchMore(const QModelIndex &parent)
+{
+    if (parent.isValid() || m_rows.isEmpty()) return;
+    if (loadOlder()) return;
+
+    // 本地已翻到顶，向服务器取更早的一页
+    if (m_serverHasOlder && m_fetch == FetchNone) {
+        m_fetch = FetchOlder;
+        m_olderRevalidated = false;
+        setLoading(true);
+        fetchHistory(0, m_rows.first().id);
+    }
+}
+
+bool MessageListModel::loadOlder()
+{
+    if (m_rows.isEmpty()) return false;
+
+    // 多读一条作为日期分隔的参照
+    auto objs = MessageStore::instance()->before(m_conversationId, m_rows.first().id, m_pageSize + 1);
+    m_hasOlder = objs.size() > m_pageSize;
+    QVector<Message> page = makePage(objs, m_pageSize, nullptr);
+    if (page.isEmpty()) return false;
+
+    beginInsertRows(QModelIndex(), count(), count() + page.size() - 1);
+    page.append(m_rows);
+    m_rows.swap(page);
+    endInsertRows();
+    emit countChanged();
+    return true;
+}
+
+void MessageListModel::setConversationId(const QString &id)
+{
+    if (m_conversationId == id) return;
+    m_conversationId = id;
+    emit conversationIdChanged();
+    reload();
+}
+
+void MessageListModel::setGroup(bool group)
+{
+    if (m_group == group) return;
+    m_group = group;
+    emit groupChanged();
+}
+
+void MessageListModel::setPageSize(int size)
+{
+    if (size <= 0 || m_pageSize == size) return;
+    m_pageSize = size;
+    emit pageSizeChanged();
+}
+
+void MessageListModel::reload()
+{
+    if (m_conversationId.isEmpty()) {
+        clear();
+        return;
+    }
+
+    // 先从本地渲染，再向服务器请求本地没有的新消息
+    m_fetch = FetchNone;
+    m_serverHasOlder = false;
+    loadNewest();
+    requestNewer();
+}
+
+void MessageListModel::requestNewer()
+{
+    qint64 lastId = MessageStore::instance()->lastId(m_conversationId);
+    m_fetch = lastId > 0 ? FetchNewer : FetchNewest;
+    m_newerFrom = lastId;
+    if (lastId > 0) m_serverHasOlder = true;
+    setLoading(true);
+    fetchHistory(lastId, 0);
+}
+
+void MessageListModel::fetchHistory(qint64 since, qint64 before, bool fresh)
+{
+    auto net = NetworkManager::instance();
+    if (m_group) {
+        net->fetchGroupHistory(m_conversationId, since, before, m_pageSize, fresh);
+    } else {
+        net->fetchHistory(m_conversationId, since, before, m_pageSize, fresh);
+    }
+}
+
+void MessageListModel::onHistoryReceived(const QString &conversationId, const QJsonArray &messages, bool hasMore)
+{
+    // 之前会话的迟到响应（包括空页与 304）不能消耗当前会话的请求
+    if (m_fetch == FetchNone || conversationId != m_conversationId) return;
+
+    // MessageStore 先于本模型处理该信号，新消息此时已经入库
+    FetchMode mode = m_fetch;
+    m_fetch = FetchNone;
+    switch (mode) {
+    case FetchNewest:
+        m_serverHasOlder = hasMore;
+        break;
+    case FetchNewer:
+        // 本地最新 id 没有前进（写入失败、记录已关闭或缓存的 304）时继续请求只会原地循环
+        if (hasMore && MessageStore::instance()->lastId(m_conversationId) > m_newerFrom) {
+            requestNewer();
+            return;
+        }
+        break;
+    case FetchOlder:
+        m_serverHasOlder = hasMore;
+        if (!loadOlder() && hasMore && !m_rows.isEmpty()) {
+            // 304 只说明服务器上这一页没变；校验值比本地记录活得久时（例如只删了本地）本地已没有这些行，
+            // 不带 If-None-Match 重取一次
+            if (messages.isEmpty() && !m_olderRevalidated) {
+                m_olderRevalidated = true;
+                m_fetch = FetchOlder;
+                fetchHistory(0, m_rows.first().id, true);
+                return;
+            }
+            // 重取后仍没有前进（或写入本地失败），停止向上翻页，避免原地循环
+            m_serverHasOlder = false;
+        }
+        break;
+    case FetchNone:
+        break;
+    }
+    setLoading(false);
+}
+
+void MessageListModel::clear()
+{
+    beginResetModel();
+    m_rows.clear();
+    m_pending.clear();
+    m_hasOlder = false;
+    endResetModel();
+    emit countChanged();
+}
+
+void MessageListModel::deleteLocal()
+{
+    MessageStore::instance()->clearConversation(m_conversationId);
+    clear();
+}
+
+void MessageListModel::trimToWindow()
+{
+    if (m_rows.size() <= m_pageSize) return;
+
+    beginRemoveRows(QModelIndex(), m_pending.size() + m_pageSize, count() - 1);
+    m_rows.remove(0, m_rows.size() - m_pageSize);
+    m_hasOlder = true;
+    endRemoveRows();
+    emit countChanged();
+}
+
+void MessageListModel::onConversationUpdated(const QString &conversationId)
+{
+    if (conversationId != m_conversationId) return;
+
+    if (m_rows.isEmpty()) {
+        loadNewest();
+        return;
+    }
+
+    auto store = MessageStore::instance();
+    auto objs = store->after(m_conversationId, m_rows.last().id, INT_MAX);
+    m_hasOlder = store->hasBefore(m_conversationId, m_rows.first().id);
+    if (objs.isEmpty()) return;
+
+    QVector<Message> page = makePage(objs, objs.size(), &m_rows.last());
+    beginInsertRows(QModelIndex(), m_pending.size(), m_pending.size() + page.size() - 1);
+    m_rows.append(page);
+    endInsertRows();
+
+    // 服务器回显了自己发出的消息，替换对应的待发送行
+    for (const Message &m : std::as_const(page)) {
+        Latency::instance()->markInserted(m.id);
+        if (!m.clientId.isEmpty()) removePending(m.clientId);
+    }
+    emit countChanged();
+}
+
+void MessageListModel::onMessageQueued(const QJsonObject &message)
+{
+    if (message["to"].toString() != m_conversationId && message["group_id"].toString() != m_conversationId) return;
+
+    Message m = makePending(message);
+    beginInsertRows(QModelIndex(), 0, 0);
+    m_pending.append(m);
+    endInsertRows();
+    emit countChanged();
+}
+
+void MessageListModel::onMessageStatusChanged(const QString &clientId, const QString &status)
+{
+    for (int i = m_pending.size() - 1; i >= 0; --i) {
+        if (m_pending[i].clientId != clientId) continue;
+        m_pending[i].status = status;
+        QModelIndex idx = index(m_pending.size() - 1 - i);
+        emit dataChanged(idx, idx, {StatusRole});
+        return;
+    }
+
+    // 已入库的消息只会从 sent 前进到 delivered
+    for (int i = m_rows.size() - 1; i >= 0; --i) {
+        Message &m = m_rows[i];
+        if (m.clientId != clientId) continue;
+        if (m.status == "read") return;
+        m.status = status;
+        QModelIndex idx = index(m_pending.size() + m_rows.size() - 1 - i);
+        emit dataChanged(idx, idx, {StatusRole});
+        return;
+    }
+}
+
+bool MessageListModel::applyWatermark(Message &m, const Receipts::Watermark &w)
+{
+    // 状态只前进，不会因为较旧的回执退回
+    QString status = m.id <= w.read ? "read" : (m.id <= w.delivered ? "delivered" : "");
+    if (status.isEmpty() || statusRank(m.status) >= statusRank(status)) return false;
+    m.status = status;
+    m.isRead = m.id <= w.read;
+    return true;
+}
+
+void MessageListModel::onReceiptsChanged(const Receipts::Diff &diff)
+{
+    auto it = diff.constFind(m_conversationId);
+    if (it == diff.cend()) return;
+
+    // 从最新一行往旧处走，遇到已读的行即可停止：水位线只前进，更早的行已经是已读
+    int first = -1;
+    int last = -1;
+    for (int i = m_rows.size() - 1; i >= 0; --i) {
+        Message &m = m_rows[i];
+        if (!m.isMe || m.id > it->delivered) continue;
+        if (m.status == "read") break;
+        if (!applyWatermark(m, *it)) continue;
+        int row = m_pending.size() + m_rows.size() - 1 - i;
+        if (first < 0) first = row;
+        last = row;
+    }
+    if (first >= 0) emit dataChanged(index(first), index(last), {StatusRole, IsReadRole});
+}
+
+void MessageListModel::removePending(const QString &clientId)
+{
+    for (int i = 0; i < m_pending.size(); ++i) {
+        if (m_pending[i].clientId != clientId) continue;
+        int row = m_pending.size() - 1 - i;
+        beginRemoveRows(QModelIndex(), row, row);
+        m_pending.remove(i);
+        endRemoveRows();
+        return;
+    }
+}
+
+void MessageListModel::loadPending()
+{
+    m_pending.clear();
+    if (m_conversationId.isEmpty()) return;
+
+    QSet<QString> stored;
+    for (const Message &m : std::as_const(m_rows)) {
+        if (!m.clientId.isEmpty()) stored.insert(m.clientId);
+    }
+    for (const QJsonObject &obj : NetworkManager::instance()->pendingMessages(m_conversationId)) {
+        if (stored.contains(obj["client_id"].toString())) continue;
+        m_pending.append(makePending(obj));
+    }
+}
+
+MessageListModel::Message MessageListModel::makePending(const QJsonObject &obj) const
+{
+    const Message *previous = nullptr;
+    if (!m_pending.isEmpty()) previous = &m_pending.last();
+    else if (!m_rows.isEmpty()) previous = &m_rows.last();
+
+    Message m = makeMessage(obj, previous);
+    m.status = obj["status"].toString("pending");
+    return m;
+}
+
+void MessageListModel::loadNewest()
+{
+    auto objs = MessageStore::instance()->before(m_conversationId, 0, m_pageSize + 1);
+    QVector<Message> page = makePage(objs, m_pageSize, nullptr);
+
+    beginResetModel();
+    m_rows.swap(page);
+    m_hasOlder = objs.size() > m_pageSize;
+    loadPending();
+    endResetModel();
+    emit countChanged();
+}
+
+QVector<MessageListModel::Message> MessageListModel::makePage(const QVector<QJsonObject> &objs, int limit,
+                                                              const Message *previous) const
+{
+    QVector<Message> page;
+    page.reserve(qMin(limit, int(objs.size())));
+
+    // 超出 limit 的第一条只用来计算分隔，不进入窗口
+    int skip = qMax(0, int(objs.size()) - limit);
+    Message anchor;
+    if (skip > 0) {
+        anchor = makeMessage(objs.at(skip - 1), nullptr);
+        previous = &anchor;
+    }
+    for (int i = skip; i < objs.size(); ++i) {
+        page.append(makeMessage(objs.at(i), page.isEmpty() ? previous : &page.last()));
+    }
+    return page;
+}
+
+MessageListModel::Message MessageListModel::makeMessage(const QJsonObject &obj, const Message *previous) const
+{
+    Message m;
+    m.id = MessageUtils::messageId(obj);
+    m.from = obj["from"].toString();
+    m.content = obj["content"].toString();
+    m.type = obj["type"].toString("text");
+    m.timestamp = MessageUtils::timestamp(obj["timestamp"]);
+    m.time = MessageUtils::formatTime(m.timestamp);
+    m.isMe = m.from == NetworkManager::instance()->userId();
+    m.clientId = obj["client_id"].toString();
+    m.isRead = obj["is_read"].toBool();
+    if (m.isMe) {
+        m.status = m.isRead ? "read" : "sent";
+        applyWatermark(m, NetworkManager::instance()->receipts()->watermark(m_conversationId));
+    }
+    if (m.type == "image") {
+        m.thumbUrl = obj["thumb_url"].toString();
+        m.blurhash = obj["blurhash"].toString();
+        m.mediaWidth = obj["width"].toInt();
+        m.mediaHeight = obj["height"].toInt();
+    }
+
+    // 日期分隔与时间显示只在入库时计算一次
+    if (!previous || previous->timestamp.date() != m.timestamp.date()) {
+        m.dateLabel = m.timestamp.toString("yyyy-MM-dd");
+    }
+    m.showTime = !previous || !m.dateLabel.isEmpty() || previous->time != m.time;
+    return m;
+}
+
+const MessageListModel::Message &MessageListModel::messageAt(int row) const
+{
+    if (row < m_pending.size()) return m_pending.at(m_pending.size() - 1 - row);
+    row -= m_pending.size();
+    return m_rows.at(m_rows.size() - 1 - row);
+}
+
+void MessageListModel::setLoading(bool loading)
+{
+    if (m_loading == loading) return;
+    m_loading = loading;
+    emit loadingChanged();
+}
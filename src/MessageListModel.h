@@ -0,0 +1,139 @@
+#ifndef MESSAGELISTMODEL_H
+#define MESSAGELISTMODEL_H
+
+#include <QAbstractListModel>
+#include <QVector>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QDateTime>
+
+#include "Receipts.h"
+
+// 聊天消息模型：行 0 为最新消息，配合 ListView.BottomToTop 使用，
+// 向上翻页时新行追加在末尾，已显示的消息位置保持不变。
+// 数据来自 MessageStore，只在内存中保留当前窗口内的消息；
+// 发件箱中的消息排在最前，服务器回显同一 client_id 后被入库消息替换。
+class MessageListModel : public QAbstractListModel
+{
+    Q_OBJECT
+    Q_PROPERTY(QString conversationId READ conversationId WRITE setConversationId NOTIFY conversationIdChanged)
+    // 群聊从群历史接口同步，需在 conversationId 之前设置
+    Q_PROPERTY(bool group READ group WRITE setGroup NOTIFY groupChanged)
+    Q_PROPERTY(int count READ count NOTIFY countChanged)
+    Q_PROPERTY(int pageSize READ pageSize WRITE setPageSize NOTIFY pageSizeChanged)
+    Q_PROPERTY(bool loading READ loading NOTIFY loadingChanged)
+
+public:
+    enum Roles {
+        MessageIdRole = Qt::UserRole + 1,
+        FromRole,
+        IsMeRole,
+        ContentRole,
+        TypeRole,
+        TimeRole,
+        ShowTimeRole,
+        DateLabelRole,
+        IsReadRole,
+        StatusRole,
+        ThumbUrlRole,
+        BlurHashRole,
+        MediaWidthRole,
+        MediaHeightRole,
+        ClientIdRole
+    };
+    Q_ENUM(Roles)
+
+    explicit MessageListModel(QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+
+    QString conversationId() const { return m_conversationId; }
+    void setConversationId(const QString &id);
+    bool group() const { return m_group; }
+    void setGroup(bool group);
+    int count() const { return m_rows.size() + m_pending.size(); }
+    int pageSize() const { return m_pageSize; }
+    void setPageSize(int size);
+    bool loading() const { return m_loading; }
+
+    Q_INVOKABLE void reload();
+    Q_INVOKABLE void clear();
+    // 删除本地聊天记录
+    Q_INVOKABLE void deleteLocal();
+    // 回到最新消息时调用，丢弃窗口外较旧的行
+    Q_INVOKABLE void trimToWindow();
+
+signals:
+    void conversationIdChanged();
+    void groupChanged();
+    void countChanged();
+    void pageSizeChanged();
+    void loadingChanged();
+
+private slots:
+    void onConversationUpdated(const QString &conversationId);
+    void onHistoryReceived(const QString &conversationId, const QJsonArray &messages, bool hasMore);
+    void onMessageQueued(const QJsonObject &message);
+    void onMessageStatusChanged(const QString &clientId, const QString &status);
+    // 对方的水位线前进：水位线以下自己发出的行一次性更新，只发一个覆盖首尾行的 dataChanged
+    void onReceiptsChanged(const Receipts::Diff &diff);
+
+private:
+    enum FetchMode {
+        FetchNone,
+        FetchNewest,    // 本地没有记录，取服务器最新一页
+        FetchNewer,     // 从本地最新 id 向后增量同步
+        FetchOlder      // 本地翻到顶后向服务器取更早的一页
+    };
+
+    struct Message {
+        qint64 id = 0;
+        QString clientId;
+        QString from;
+        QString content;
+        QString type;
+        QDateTime timestamp;
+        QString time;
+        QString dateLabel;
+        bool showTime = true;
+        bool isMe = false;
+        bool isRead = false;
+        QString status;     // 自己发出的消息：pending / sent / delivered / read
+        QString thumbUrl;   // 图片消息：服务器缩略图，为空时使用本地生成的缩略图
+        QString blurhash;
+        int mediaWidth = 0;
+        int mediaHeight = 0;
+    };
+
+    Message makeMessage(const QJsonObject &obj, const Message *previous) const;
+    static bool applyWatermark(Message &m, const Receipts::Watermark &w);
+    QVector<Message> makePage(const QVector<QJsonObject> &objs, int limit, const Message *previous) const;
+    const Message &messageAt(int row) const;
+    void loadNewest();
+    void loadPending();
+    Message makePending(const QJsonObject &obj) const;
+    void removePending(const QString &clientId);
+    bool loadOlder();
+    void requestNewer();
+    void fetchHistory(qint64 since, qint64 before, bool fresh = false);
+    void setLoading(bool loading);
+
+    QString m_conversationId;
+    bool m_group;
+    QVector<Message> m_rows;    // 按时间顺序
+    QVector<Message> m_pending; // 发件箱中尚未回显的消息，显示在最新一侧
+    bool m_hasOlder;
+    bool m_serverHasOlder;
+    FetchMode m_fetch;
+    qint64 m_newerFrom;         // FetchNewer 请求时本地的最新 id
+    bool m_olderRevalidated;    // 本次向上翻页已经不带 ETag 重取过
+    int m_pageSize;
+    bool m_loading;
+};
+
+#endif
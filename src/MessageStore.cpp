@@ -0,0 +1,408 @@
+#include "MessageStore.h"
+#include "Logging.h"
+#include "Trace.h"
+#include "NetworkManager.h"
+#include "MessageUtils.h"
+
+#include <QStandardPaths>
+#include <QDir>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QCborValue>
+#include <QtEndian>
+#include <algorithm>
+
+namespace {
+
+const quint32 INDEX_MAGIC = 0x41434958; // "ACIX"
+const quint32 INDEX_VERSION = 1;
+const int HEADER_SIZE = 6;              // quint32 长度 + quint16 校验
+const int INDEX_SAVE_INTERVAL = 4096;
+// 索引文件里每个会话至少占会话名长度与条数 8 字节，每条索引 id + offset 16 字节
+const qint64 MIN_CONVERSATION_SIZE = 8;
+const qint64 INDEX_ENTRY_SIZE = 16;
+
+}
+
+MessageStore* MessageStore::s_instance = nullptr;
+
+MessageStore::MessageStore(QObject *parent)
+    : QObject(parent)
+    , m_unsavedEntries(0)
+{
+    auto net = NetworkManager::instance();
+    connect(net, &NetworkManager::userChanged, this, [this, net]() {
+        if (net->userId().isEmpty()) {
+            close();
+        } else if (net->userId() != m_selfId || !isOpen()) {
+            open(net->userId());
+        }
+    });
+    connect(net, &NetworkManager::messageReceived, this, [this](const QJsonObject &msg) { append(msg); });
+    connect(net, &NetworkManager::groupMessageReceived, this, [this](const QJsonObject &msg) { append(msg); });
+    connect(net, &NetworkManager::historyReceived, this,
+            [this](const QString &, const QJsonArray &msgs) { append(msgs); });
+    connect(net, &NetworkManager::groupHistoryReceived, this,
+            [this](const QString &, const QJsonArray &msgs) { append(msgs); });
+}
+
+MessageStore::~MessageStore()
+{
+    close();
+}
+
+MessageStore* MessageStore::instance()
+{
+    if (!s_instance) s_instance = new MessageStore();
+    return s_instance;
+}
+
+bool MessageStore::open(const QString &accountId, const QString &dirPath)
+{
+    close();
+
+    m_selfId = accountId;
+    m_dir = dirPath;
+    if (m_dir.isEmpty()) {
+        m_dir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)
+                + "/messages/" + accountId;
+    }
+    QDir().mkpath(m_dir);
+
+    m_log.setFileName(m_dir + "/messages.log");
+    if (!m_log.open(QIODevice::ReadWrite | QIODevice::Unbuffered)) {
+        qCWarning(lcStore) << "cannot open" << m_log.fileName() << m_log.errorString();
+        return false;
+    }
+    m_reader.setFileName(m_log.fileName());
+    if (!m_reader.open(QIODevice::ReadOnly | QIODevice::Unbuffered)) {
+        m_log.close();
+        return false;
+    }
+
+    // 先加载索引快照，再重放快照之后追加的日志
+    qint64 covered = 0;
+    if (!loadIndex(&covered)) {
+        m_index.clear();
+        covered = 0;
+    }
+    scanLog(covered);
+    m_log.seek(m_log.size());
+    emit opened();
+    return true;
+}
+
+void MessageStore::close()
+{
+    if (!isOpen()) return;
+
+    emit closing();
+    flushIndex();
+    m_log.close();
+    m_reader.close();
+    m_index.clear();
+    m_selfId.clear();
+    m_unsavedEntries = 0;
+}
+
+QString MessageStore::conversationFor(const QJsonObject &message) const
+{
+    QString groupId = message["group_id"].toString();
+    if (!groupId.isEmpty()) return groupId;
+
+    QString from = message["from"].toString();
+    return from == m_selfId ? message["to"].toString() : from;
+}
+
+bool MessageStore::append(const QJsonObject &message)
+{
+    QSet<QString> touched;
+    if (!insert(message, &touched)) return false;
+
+    for (const QString &conv : std::as_const(touched)) emit conversationUpdated(conv);
+    return true;
+}
+
+int MessageStore::append(const QJsonArray &messages)
+{
+    QSet<QString> touched;
+    int inserted = 0;
+    for (const QJsonValue &v : messages) {
+        if (insert(v.toObject(), &touched)) inserted++;
+    }
+
+    for (const QString &conv : std::as_const(touched)) emit conversationUpdated(conv);
+    return inserted;
+}
+
+bool MessageStore::insert(const QJsonObject &message, QSet<QString> *touched)
+{
+    if (!isOpen()) return false;
+
+    qint64 id = MessageUtils::messageId(message);
+    QString conv = conversationFor(message);
+    if (id <= 0 || conv.isEmpty()) return false;
+
+    // 已存在的消息不重复写入
+    const QVector<Entry> &entries = m_index[conv];
+    auto it = std::lower_bound(entries.cbegin(), entries.cend(), id,
+                               [](const Entry &e, qint64 v) { return e.id < v; });
+    if (it != entries.cend() && it->id == id) return false;
+
+    qint64 offset;
+    if (!writeRecord(id, conv, QCborValue::fromJsonValue(message).toCbor(), &offset)) return false;
+    ATCHAT_TRACE("store.append", id, offset, conv);
+
+    indexEntry(conv, id, offset);
+    touched->insert(conv);
+    emit messageStored(conv, id, message);
+
+    if (++m_unsavedEntries >= INDEX_SAVE_INTERVAL) flushIndex();
+    return true;
+}
+
+void MessageStore::clearConversation(const QString &conversationId)
+{
+    if (!isOpen() || !m_index.contains(conversationId)) return;
+
+    qint64 offset;
+    if (!writeRecord(0, conversationId, QByteArray(), &offset)) return;
+    m_index.remove(conversationId);
+    m_unsavedEntries++;
+    emit conversationCleared(conversationId);
+    emit conversationUpdated(conversationId);
+}
+
+bool MessageStore::writeRecord(qint64 id, const QString &conversationId, const QByteArray &payload, qint64 *offset)
+{
+    QByteArray body;
+    QDataStream out(&body, QIODevice::WriteOnly);
+    out << id << conversationId.toUtf8() << payload;
+
+    QByteArray record(HEADER_SIZE, Qt::Uninitialized);
+    qToLittleEndian<quint32>(body.size(), record.data());
+    qToLittleEndian<quint16>(qChecksum(body), record.data() + 4);
+    record.append(body);
+
+    // 单次 write 写入整条记录，崩溃时最多留下一条残缺的尾部记录
+    *offset = m_log.size();
+    m_log.seek(*offset);
+    if (m_log.write(record) != record.size()) {
+        qCWarning(lcStore) << "write failed" << m_log.errorString();
+        m_log.resize(*offset);
+        return false;
+    }
+    return true;
+}
+
+bool MessageStore::indexEntry(const QString &conversationId, qint64 id, qint64 offset)
+{
+    if (id == 0) {
+        m_index.remove(conversationId);
+        return true;
+    }
+
+    QVector<Entry> &entries = m_index[conversationId];
+    if (entries.isEmpty() || entries.last().id < id) {
+        entries.append({id, offset});
+        return true;
+    }
+
+    auto it = std::lower_bound(entries.begin(), entries.end(), id,
+                               [](const Entry &e, qint64 v) { return e.id < v; });
+    if (it != entries.end() && it->id == id) {
+        it->offset = offset;
+        return false;
+    }
+    entries.insert(it, {id, offset});
+    return true;
+}
+
+QVector<QJsonObject> MessageStore::before(const QString &conversationId, qint64 beforeId, int limit) const
+{
+    QVector<QJsonObject> result;
+    auto found = m_index.constFind(conversationId);
+    if (found == m_index.cend() || limit <= 0) return result;
+
+    const QVector<Entry> &entries = found.value();
+    auto end = entries.cend();
+    if (beforeId > 0) {
+        end = std::lower_bound(entries.cbegin(), entries.cend(), beforeId,
+                               [](const Entry &e, qint64 v) { return e.id < v; });
+    }
+    auto begin = end - qMin<qsizetype>(limit, end - entries.cbegin());
+
+    result.reserve(end - begin);
+    for (auto it = begin; it != end; ++it) result.append(readAt(it->offset));
+    return result;
+}
+
+QVector<QJsonObject> MessageStore::after(const QString &conversationId, qint64 afterId, int limit) const
+{
+    QVector<QJsonObject> result;
+    auto found = m_index.constFind(conversationId);
+    if (found == m_index.cend() || limit <= 0) return result;
+
+    const QVector<Entry> &entries = found.value();
+    auto begin = std::upper_bound(entries.cbegin(), entries.cend(), afterId,
+                                  [](qint64 v, const Entry &e) { return v < e.id; });
+    auto end = begin + qMin<qsizetype>(limit, entries.cend() - begin);
+
+    result.reserve(end - begin);
+    for (auto it = begin; it != end; ++it) result.append(readAt(it->offset));
+    return result;
+}
+
+bool MessageStore::hasBefore(const QString &conversationId, qint64 id) const
+{
+    auto found = m_index.constFind(conversationId);
+    return found != m_index.cend() && !found->isEmpty() && found->first().id < id;
+}
+
+qint64 MessageStore::lastId(const QString &conversationId) const
+{
+    auto found = m_index.constFind(conversationId);
+    if (found == m_index.cend() || found->isEmpty()) return 0;
+    return found->last().id;
+}
+
+int MessageStore::count(const QString &conversationId) const
+{
+    return m_index.value(conversationId).size();
+}
+
+QJsonObject MessageStore::message(const QString &conversationId, qint64 id) const
+{
+    auto found = m_index.constFind(conversationId);
+    if (found == m_index.cend()) return QJsonObject();
+
+    auto it = std::lower_bound(found->cbegin(), found->cend(), id,
+                               [](const Entry &e, qint64 v) { return e.id < v; });
+    if (it == found->cend() || it->id != id) return QJsonObject();
+    return readAt(it->offset);
+}
+
+QJsonObject MessageStore::readAt(qint64 offset) const
+{
+    if (!m_reader.seek(offset)) return QJsonObject();
+
+    QByteArray header = m_reader.read(HEADER_SIZE);
+    if (header.size() != HEADER_SIZE) return QJsonObject();
+    quint32 size = qFromLittleEndian<quint32>(header.constData());
+    QByteArray body = m_reader.read(size);
+    if (body.size() != qsizetype(size)) return QJsonObject();
+
+    QDataStream in(body);
+    qint64 id;
+    QByteArray conv, cbor;
+    in >> id >> conv >> cbor;
+    return QCborValue::fromCbor(cbor).toJsonValue().toObject();
+}
+
+bool MessageStore::loadIndex(qint64 *covered)
+{
+    QFile file(m_dir + "/index.dat");
+    if (!file.open(QIODevice::ReadOnly)) return false;
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_6_0);
+
+    quint32 magic, version, conversations;
+    in >> magic >> version >> *covered >> conversations;
+    if (magic != INDEX_MAGIC || version != INDEX_VERSION || *covered > m_log.size()) return false;
+    // 数量来自磁盘，按文件剩余大小检查后再分配，损坏的索引不会触发巨大的分配
+    if (in.status() != QDataStream::Ok || conversations > (file.size() - file.pos()) / MIN_CONVERSATION_SIZE) {
+        return false;
+    }
+
+    m_index.clear();
+    m_index.reserve(conversations);
+    for (quint32 i = 0; i < conversations && in.status() == QDataStream::Ok; ++i) {
+        QString conv;
+        quint32 n;
+        in >> conv >> n;
+        if (in.status() != QDataStream::Ok || n > (file.size() - file.pos()) / INDEX_ENTRY_SIZE) return false;
+        QVector<Entry> &entries = m_index[conv];
+        entries.resize(n);
+        for (quint32 j = 0; j < n; ++j) in >> entries[j].id >> entries[j].offset;
+    }
+    return in.status() == QDataStream::Ok;
+}
+
+void MessageStore::flushIndex()
+{
+    if (!isOpen() || m_unsavedEntries == 0) return;
+
+    QSaveFile file(m_dir + "/index.dat");
+    if (!file.open(QIODevice::WriteOnly)) return;
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << INDEX_MAGIC << INDEX_VERSION << m_log.size() << quint32(m_index.size());
+    for (auto it = m_index.cbegin(); it != m_index.cend(); ++it) {
+        out << it.key() << quint32(it->size());
+        for (const Entry &e : it.value()) out << e.id << e.offset;
+    }
+
+    if (file.commit()) m_unsavedEntries = 0;
+}
+
+void MessageStore::scanLog(qint64 from)
+{
+    qint64 size = m_log.size();
+    if (from >= size) return;
+
+    uchar *data = m_reader.map(0, size);
+    if (!data) return;
+
+    qint64 pos = scanRecords(data, from, size, false,
+                             [this](qint64 offset, qint64 id, const QString &conv, const QByteArray &) {
+        if (indexEntry(conv, id, offset)) m_unsavedEntries++;
+        return true;
+    });
+    m_reader.unmap(data);
+
+    // 丢弃崩溃时写了一半的尾部
+    if (pos < size) {
+        qCWarning(lcStore) << "truncating" << (size - pos) << "bytes of torn log tail";
+        m_log.resize(pos);
+    }
+}
+
+qint64 MessageStore::scanRecords(const uchar *data, qint64 from, qint64 size, bool withPayload,
+                                 const RecordVisitor &visitor)
+{
+    qint64 pos = from;
+    while (pos + HEADER_SIZE <= size) {
+        quint32 len = qFromLittleEndian<quint32>(data + pos);
+        quint16 crc = qFromLittleEndian<quint16>(data + pos + 4);
+        if (pos + HEADER_SIZE + len > size) break;
+
+        QByteArrayView body(reinterpret_cast<const char *>(data + pos + HEADER_SIZE), len);
+        if (qChecksum(body) != crc) break;
+
+        QDataStream in(body.toByteArray());
+        qint64 id;
+        QByteArray conv, payload;
+        in >> id >> conv;
+        if (withPayload) in >> payload;
+        if (!visitor(pos, id, QString::fromUtf8(conv), payload)) break;
+        pos += HEADER_SIZE + len;
+    }
+    return pos;
+}
+
+qint64 MessageStore::scanFile(const QString &logPath, qint64 from, qint64 to, const RecordVisitor &visitor)
+{
+    QFile file(logPath);
+    if (!file.open(QIODevice::ReadOnly)) return from;
+
+    qint64 size = qMin(to, file.size());
+    if (from >= size) return from;
+    uchar *data = file.map(0, size);
+    if (!data) return from;
+
+    qint64 pos = scanRecords(data, from, size, true, visitor);
+    file.unmap(data);
+    return pos;
+}
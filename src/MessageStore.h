@@ -0,0 +1,88 @@
+#ifndef MESSAGESTORE_H
+#define MESSAGESTORE_H
+
+#include <QObject>
+#include <QFile>
+#include <QHash>
+#include <QVector>
+#include <QSet>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <functional>
+
+// 本地聊天记录：每个账号一个只追加日志文件 + 按会话、按消息ID排序的索引。
+// 记录带长度和校验，重新打开时丢弃写了一半的尾部记录；索引快照通过 QSaveFile 原子替换。
+class MessageStore : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit MessageStore(QObject *parent = nullptr);
+    ~MessageStore();
+    static MessageStore* instance();
+
+    // dirPath 为空时使用 AppDataLocation/messages/<accountId>
+    bool open(const QString &accountId, const QString &dirPath = QString());
+    void close();
+    bool isOpen() const { return m_log.isOpen(); }
+    QString directory() const { return m_dir; }
+    QString logPath() const { return m_log.fileName(); }
+    qint64 logSize() const { return m_log.size(); }
+
+    QString conversationFor(const QJsonObject &message) const;
+
+    bool append(const QJsonObject &message);
+    int append(const QJsonArray &messages);
+    // 写入一条清空标记，重放日志时该会话之前的记录全部失效
+    void clearConversation(const QString &conversationId);
+
+    // 按时间顺序返回 id < beforeId 的最新 limit 条（beforeId <= 0 表示从最新开始）
+    QVector<QJsonObject> before(const QString &conversationId, qint64 beforeId, int limit) const;
+    // 按时间顺序返回 id > afterId 的最早 limit 条
+    QVector<QJsonObject> after(const QString &conversationId, qint64 afterId, int limit) const;
+
+    bool hasBefore(const QString &conversationId, qint64 id) const;
+    qint64 lastId(const QString &conversationId) const;
+    int count(const QString &conversationId) const;
+    QJsonObject message(const QString &conversationId, qint64 id) const;
+    void flushIndex();
+
+    // 逐条回调日志 [from, to) 中的完整记录，id 为 0 表示清空标记，回调返回 false 时停止；
+    // 自行打开文件，可在其他线程读取正在追加的日志。返回扫描停止的位置
+    using RecordVisitor = std::function<bool(qint64 offset, qint64 id, const QString &conversationId,
+                                             const QByteArray &payload)>;
+    static qint64 scanFile(const QString &logPath, qint64 from, qint64 to, const RecordVisitor &visitor);
+
+signals:
+    void opened();
+    void closing();
+    void conversationUpdated(const QString &conversationId);
+    // 新写入一条消息 / 清空一个会话，日志顺序与信号顺序一致
+    void messageStored(const QString &conversationId, qint64 id, const QJsonObject &message);
+    void conversationCleared(const QString &conversationId);
+
+private:
+    struct Entry {
+        qint64 id;
+        qint64 offset;
+    };
+
+    bool insert(const QJsonObject &message, QSet<QString> *touched);
+    bool writeRecord(qint64 id, const QString &conversationId, const QByteArray &payload, qint64 *offset);
+    bool indexEntry(const QString &conversationId, qint64 id, qint64 offset);
+    QJsonObject readAt(qint64 offset) const;
+    bool loadIndex(qint64 *covered);
+    void scanLog(qint64 from);
+    static qint64 scanRecords(const uchar *data, qint64 from, qint64 size, bool withPayload,
+                              const RecordVisitor &visitor);
+
+    static MessageStore *s_instance;
+    QString m_dir;
+    QString m_selfId;
+    QFile m_log;
+    mutable QFile m_reader;
+    QHash<QString, QVector<Entry>> m_index;
+    int m_unsavedEntries;
+};
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef MESSAGEUTILS_H
+#define MESSAGEUTILS_H
+
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QDateTime>
+#include <QString>
+#include <QStringList>
+
+namespace MessageUtils {
+
+// 服务端时间戳可能是毫秒/秒数值，也可能是 RFC3339 字符串
+inline QDateTime timestamp(const QJsonValue &value)
+{
+    if (value.isDouble()) {
+        qint64 t = static_cast<qint64>(value.toDouble());
+        if (t < 100000000000LL) t *= 1000;
+        return QDateTime::fromMSecsSinceEpoch(t);
+    }
+    if (value.isString()) {
+        QDateTime dt = QDateTime::fromString(value.toString(), Qt::ISODateWithMs);
+        if (dt.isValid()) return dt.toLocalTime();
+    }
+    return QDateTime::currentDateTime();
+}
+
+// 消息ID按时间递增，可能以数值或字符串形式下发
+inline qint64 messageId(const QJsonObject &msg)
+{
+    const QJsonValue id = msg["id"];
+    if (id.isString()) return id.toString().toLongLong();
+    return id.toInteger();
+}
+
+inline QString formatTime(const QDateTime &dt)
+{
+    return dt.toString("hh:mm");
+}
+
+// 消息是否 @ 了 userId：新消息带 mentions 字段（用户 id，"all" 为全体成员）；
+// 没有该字段的旧消息在正文中匹配 "@名字"，names 为自己的昵称、用户名等
+inline bool mentions(const QJsonObject &message, const QString &userId, const QStringList &names)
+{
+    const QJsonValue structured = message["mentions"];
+    if (structured.isArray()) {
+        for (const QJsonValue &v : structured.toArray()) {
+            QString id = v.toString();
+            if (id == userId || id == QLatin1String("all")) return true;
+        }
+        return false;
+    }
+    if (message["type"].toString("text") != QLatin1String("text")) return false;
+
+    const QString content = message["content"].toString();
+    QStringList candidates = names;
+    candidates << QStringLiteral("all");
+    for (qsizetype at = content.indexOf('@'); at >= 0; at = content.indexOf('@', at + 1)) {
+        QStringView rest = QStringView(content).mid(at + 1);
+        if (rest.startsWith(u"所有人")) return true;
+        for (const QString &name : std::as_const(candidates)) {
+            if (name.isEmpty() || !rest.startsWith(name, Qt::CaseInsensitive)) continue;
+            // 英文名要求完整匹配（@bob 不算 @bobby），中文名后常直接接正文
+            QChar last = name.back();
+            if (rest.size() == name.size() || last.unicode() > 0x7f || !rest.at(name.size()).isLetterOrNumber()) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+}
+
+#endif
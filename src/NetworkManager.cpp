@@ -1,26 +1,105 @@
 #include "NetworkManager.h"
-#include <QNetworkReply>
+#include "Logging.h"
+#include "Trace.h"
+#include "Latency.h"
+#include "MessageUtils.h"
+#include "MessageStore.h"
+#include "UploadManager.h"
+#include "MediaPipeline.h"
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonArray>
-#include <QFile>
-#include <QFileInfo>
-#include <QHttpMultiPart>
-#include <QHttpPart>
+#include <QDateTime>
+#include <QSettings>
+
+namespace {
+
+// 收到的最新消息 id 最多延迟这么久写盘，洪峰下不会每条消息写一次设置文件
+const int LAST_SEEN_SAVE_MS = 2000;
+
+QString cursorQuery(qint64 since, qint64 before, int limit)
+{
+    QString query;
+    if (since > 0) query += QString("&since=%1").arg(since);
+    if (before > 0) query += QString("&before=%1").arg(before);
+    if (limit > 0) query += QString("&limit=%1").arg(limit);
+    return query;
+}
+
+}
 
 NetworkManager* NetworkManager::s_instance = nullptr;
 
 NetworkManager::NetworkManager(QObject *parent)
     : QObject(parent)
-    , m_http(new QNetworkAccessManager(this))
-    , m_ws(new QWebSocket(QString(), QWebSocketProtocol::VersionLatest, this))
+    , m_worker(new NetworkWorker())
     , m_serverUrl("http://localhost:8080")
     , m_connected(false)
+    , m_wireFormat(WireCodec::Json)
+    , m_wireCompressed(false)
+    , m_nextRequestId(1)
+    , m_historyValidators(512)
+    , m_requests([this](const HttpRequest &req, const ReplyHandler &handler) { return sendRequest(req, handler); })
+    , m_lastSeenId(0)
+    , m_savedLastSeenId(0)
+{
+    qRegisterMetaType<HttpRequest>();
+    qRegisterMetaType<HttpResult>();
+
+    // 套接字 I/O 与 JSON 解析都在网络线程完成，这里只接收排队投递的结果。
+    // ATCHAT_NETWORK_THREAD=0 时留在主线程，仅用于对比消息洪峰下的帧间隔
+    bool ok = false;
+    bool threaded = qEnvironmentVariableIntValue("ATCHAT_NETWORK_THREAD", &ok) != 0 || !ok;
+    if (threaded) {
+        m_thread.setObjectName("AtChatNetwork");
+        m_worker->moveToThread(&m_thread);
+        connect(&m_thread, &QThread::finished, m_worker, &QObject::deleteLater);
+    } else {
+        qCInfo(lcNet) << "network worker runs on the GUI thread";
+        m_worker->setParent(this);
+    }
+    connect(m_worker, &NetworkWorker::replyFinished, this, &NetworkManager::onReplyFinished);
+    connect(m_worker, &NetworkWorker::socketConnected, this, &NetworkManager::onWsConnected);
+    connect(m_worker, &NetworkWorker::socketDisconnected, this, &NetworkManager::onWsDisconnected);
+    connect(m_worker, &NetworkWorker::socketMessage, this, &NetworkManager::handleWsMessage);
+    connect(m_worker, &NetworkWorker::socketError, this, &NetworkManager::onWsError);
+    connect(m_worker, &NetworkWorker::uploadProgress, this, &NetworkManager::uploadProgress);
+    if (threaded) m_thread.start();
+
+    connect(&m_outbox, &Outbox::frameReady, this, &NetworkManager::sendWsFrame);
+    connect(&m_outbox, &Outbox::statusChanged, this, &NetworkManager::messageStatusChanged);
+    connect(&m_outbox, &Outbox::pendingCountChanged, this, &NetworkManager::pendingCountChanged);
+    connect(&m_outbox, &Outbox::acknowledged, this, &NetworkManager::onMessageAcked);
+    connect(&m_receipts, &Receipts::frameReady, this, &NetworkManager::sendWsFrame);
+    connect(&m_sequencer, &Sequencer::ready, this, &NetworkManager::deliverMessage);
+    connect(&m_sequencer, &Sequencer::gapDetected, this, &NetworkManager::fetchGap);
+    m_sequencer.setBaseline([](const QString &conversationId) {
+        auto store = MessageStore::instance();
+        return store->message(conversationId, store->lastId(conversationId));
+    });
+    connect(&m_reconnector, &Reconnector::connectRequested, this, &NetworkManager::openWebSocket);
+    connect(&m_reconnector, &Reconnector::retryScheduled, this, &NetworkManager::reconnecting);
+    connect(&m_reconnector, &Reconnector::statsChanged, this, &NetworkManager::reconnectStatsChanged);
+    connect(&m_presence, &Presence::changed, &m_roster, &FriendRoster::applyPresence);
+    m_lastSeenTimer.setSingleShot(true);
+    m_lastSeenTimer.setInterval(LAST_SEEN_SAVE_MS);
+    connect(&m_lastSeenTimer, &QTimer::timeout, this, &NetworkManager::saveLastSeen);
+    // 网络故障与超时统一在这里提示一次，各接口回调只处理自己的结果
+    connect(&m_requests, &RequestEngine::failed, this, [this](const QString &, const QString &error) {
+        emit connectionError(error);
+    });
+
+    QMetaObject::invokeMethod(m_worker, &NetworkWorker::init, Qt::QueuedConnection);
+    QMetaObject::invokeMethod(m_worker, [w = m_worker, url = m_serverUrl]() { w->setServerUrl(url); },
+                              Qt::QueuedConnection);
+}
+
+NetworkManager::~NetworkManager()
 {
-    connect(m_ws, &QWebSocket::connected, this, &NetworkManager::onWsConnected);
-    connect(m_ws, &QWebSocket::disconnected, this, &NetworkManager::onWsDisconnected);
-    connect(m_ws, &QWebSocket::textMessageReceived, this, &NetworkManager::onWsTextReceived);
-    connect(m_ws, &QWebSocket::errorOccurred, this, &NetworkManager::onWsError);
+    saveLastSeen();
+    m_thread.quit();
+    m_thread.wait();
+    if (s_instance == this) s_instance = nullptr;
 }
 
 NetworkManager* NetworkManager::instance()
@@ -37,13 +116,63 @@ NetworkManager* NetworkManager::create(QQmlEngine*, QJSEngine*)
 void NetworkManager::setServerUrl(const QString &url)
 {
     m_serverUrl = url;
+    QMetaObject::invokeMethod(m_worker, [w = m_worker, url]() { w->setServerUrl(url); },
+                              Qt::QueuedConnection);
 }
 
-QNetworkRequest NetworkManager::createRequest(const QString &path)
+void NetworkManager::setBinaryProtocolEnabled(bool enabled)
 {
-    QNetworkRequest req(QUrl(m_serverUrl + path));
-    req.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
-    return req;
+    QMetaObject::invokeMethod(m_worker, [w = m_worker, enabled]() { w->setBinaryProtocolEnabled(enabled); },
+                              Qt::QueuedConnection);
+}
+
+void NetworkManager::setCompressionEnabled(bool enabled)
+{
+    QMetaObject::invokeMethod(m_worker, [w = m_worker, enabled]() { w->setCompressionEnabled(enabled); },
+                              Qt::QueuedConnection);
+}
+
+QVariantMap NetworkManager::socketStats() const
+{
+    // 计数器是原子量，直接从 GUI 线程读取
+    SocketStats s = m_worker->socketStats();
+    QVariantMap stats;
+    stats["format"] = wireFormat();
+    stats["compressed"] = m_connected && m_wireCompressed;
+    stats["inFrames"] = s.inFrames;
+    stats["inWireBytes"] = s.inWire;
+    stats["inDecodedBytes"] = s.inDecoded;
+    stats["outFrames"] = s.outFrames;
+    stats["outWireBytes"] = s.outWire;
+    stats["outDecodedBytes"] = s.outDecoded;
+    stats["compressedIn"] = s.compressedIn;
+    stats["compressedOut"] = s.compressedOut;
+    return stats;
+}
+
+quint64 NetworkManager::sendRequest(HttpRequest req, const ReplyHandler &handler)
+{
+    req.id = m_nextRequestId++;
+    m_pending.insert(req.id, handler);
+    ATCHAT_TRACE("http.send", req.id, 0, req.path);
+
+    QMetaObject::invokeMethod(m_worker, [w = m_worker, req]() { w->request(req); }, Qt::QueuedConnection);
+    return req.id;
+}
+
+void NetworkManager::onReplyFinished(const HttpResult &result)
+{
+    ATCHAT_TRACE("http.done", result.id, result.status);
+    ReplyHandler handler = m_pending.take(result.id);
+    if (handler) handler(result);
+}
+
+void NetworkManager::sendWsFrame(const QJsonObject &msg)
+{
+    QMetaObject::invokeMethod(m_worker, [w = m_worker, msg, queuedAt = Latency::now()]() {
+        w->sendFrame(msg, queuedAt);
+    },
+                              Qt::QueuedConnection);
 }
 
 void NetworkManager::login(const QString &username, const QString &password)
@@ -52,32 +181,49 @@ void NetworkManager::login(const QString &username, const QString &password)
     body["username"] = username;
     body["password"] = password;
 
-    auto reply = m_http->post(createRequest("/api/login"), QJsonDocument(body).toJson());
-    connect(reply, &QNetworkReply::finished, this, [=]() {
-        auto data = QJsonDocument::fromJson(reply->readAll()).object();
-        reply->deleteLater();
+    m_requests.post(Endpoint::Login, "/api/login", body, [=](const ApiResult<QJsonObject> &reply) {
+        auto data = reply.data;
 
-        if (data["success"].toBool()) {
+        if (reply.ok()) {
             m_token = data["token"].toString();
             auto user = data["user"].toObject();
+            saveLastSeen();
             m_userId = user["id"].toString();
             m_username = user["username"].toString();
             m_nickname = user["nickname"].toString();
 
             // 先断开旧连接
-            if (m_ws->state() == QAbstractSocket::ConnectedState) {
-                m_ws->close();
+            if (m_connected) {
+                disconnectWebSocket();
             }
 
+            m_lastSeenId = QSettings().value(QString("session/%1/lastSeenId").arg(m_userId)).toLongLong();
+            m_savedLastSeenId = m_lastSeenId;
+            m_outbox.open(m_userId);
+            m_directory.open(m_userId);
+            m_sequencer.clear();
+            m_sequencer.setSelfId(m_userId);
+            m_receipts.clear();
+            m_receipts.setSelfId(m_userId);
             emit userChanged();
             emit loginSuccess(user);
+            // 本地副本先交给界面，再请求此后的变化；好友名单总要同步一次，之后由推送维护
+            for (int i = 0; i < DirectorySync::CollectionCount; ++i) {
+                auto collection = DirectorySync::Collection(i);
+                if (!m_directory.isLoaded(collection)) continue;
+                DirectorySync::Delta snapshot;
+                snapshot.collection = collection;
+                snapshot.reset = true;
+                snapshot.version = m_directory.version(collection);
+                publish(snapshot);
+                if (collection != DirectorySync::Friends) syncDirectory(collection);
+            }
+            fetchFriends();
+            fetchGroups();
 
-            // 延迟连接 WebSocket
-            QTimer::singleShot(500, this, [this]() {
-                connectWebSocket();
-            });
+            m_reconnector.start();
         } else {
-            emit loginFailed(data["error"].toString());
+            emit loginFailed(reply.error);
         }
     });
 }
@@ -89,15 +235,11 @@ void NetworkManager::registerUser(const QString &username, const QString &passwo
     body["password"] = password;
     body["nickname"] = nickname;
 
-    auto reply = m_http->post(createRequest("/api/register"), QJsonDocument(body).toJson());
-    connect(reply, &QNetworkReply::finished, this, [=]() {
-        auto data = QJsonDocument::fromJson(reply->readAll()).object();
-        reply->deleteLater();
-
-        if (data["success"].toBool()) {
-            emit registerSuccess(data["user"].toObject());
+    m_requests.post(Endpoint::Register, "/api/register", body, [=](const ApiResult<QJsonObject> &reply) {
+        if (reply.ok()) {
+            emit registerSuccess(reply.data["user"].toObject());
         } else {
-            emit registerFailed(data["error"].toString());
+            emit registerFailed(reply.error);
         }
     });
 }
@@ -105,130 +247,372 @@ void NetworkManager::registerUser(const QString &username, const QString &passwo
 void NetworkManager::connectWebSocket()
 {
     if (m_userId.isEmpty()) {
-        qDebug() << "Cannot connect WebSocket: userId is empty";
+        qCWarning(lcWs) << "Cannot connect WebSocket: userId is empty";
         return;
     }
 
-    // 如果已连接，先断开
-    if (m_ws->state() == QAbstractSocket::ConnectedState) {
-        qDebug() << "WebSocket already connected, closing first";
-        m_ws->close();
-        QTimer::singleShot(100, this, &NetworkManager::connectWebSocket);
-        return;
-    }
+    if (m_reconnector.state() == Reconnector::Idle) m_reconnector.start();
+    else m_reconnector.retryNow();
+}
 
+void NetworkManager::openWebSocket()
+{
     QString wsUrl = m_serverUrl;
     wsUrl.replace("http://", "ws://").replace("https://", "wss://");
-    QString fullUrl = wsUrl + "/ws?user_id=" + m_userId;
-    qDebug() << "Connecting WebSocket to:" << fullUrl;
-    m_ws->open(QUrl(fullUrl));
+    QString query = "/ws?user_id=" + m_userId;
+    // 握手时带上最后收到的消息 id，服务器只补发断线期间的消息
+    if (m_lastSeenId > 0) query += QString("&last_id=%1").arg(m_lastSeenId);
+    QUrl fullUrl(wsUrl + query);
+    qCInfo(lcWs) << "Connecting WebSocket to:" << fullUrl << "attempt:" << m_reconnector.attempts();
+    ATCHAT_TRACE("ws.connect", m_reconnector.attempts(), m_lastSeenId);
+    // 网络线程中如已连接会先断开旧连接
+    QMetaObject::invokeMethod(m_worker, [w = m_worker, fullUrl]() { w->openSocket(fullUrl); },
+                              Qt::QueuedConnection);
 }
 
 void NetworkManager::disconnectWebSocket()
 {
-    m_ws->close();
+    m_reconnector.stop();
+    QMetaObject::invokeMethod(m_worker, &NetworkWorker::closeSocket, Qt::QueuedConnection);
 }
 
-void NetworkManager::sendMessage(const QString &to, const QString &content, const QString &type)
+QString NetworkManager::sendMessage(const QString &to, const QString &content, const QString &type)
 {
-    if (!m_connected || m_ws->state() != QAbstractSocket::ConnectedState) {
-        qDebug() << "WebSocket not connected, reconnecting...";
-        connectWebSocket();
-        return;
-    }
-
     QJsonObject data;
     data["to"] = to;
     data["content"] = content;
     data["type"] = type;
 
-    QJsonObject msg;
-    msg["action"] = "message";
-    msg["data"] = data;
+    return enqueueMessage("message", data);
+}
+
+QString NetworkManager::enqueueMessage(const QString &action, const QJsonObject &data)
+{
+    // 未连接时消息留在发件箱，连接建立后统一发送
+    if (!m_connected) m_reconnector.retryNow();
+    QString clientId = m_outbox.enqueue(action, data);
+    ATCHAT_TRACE("msg.queued", 0, 0, clientId);
 
-    QString jsonStr = QJsonDocument(msg).toJson(QJsonDocument::Compact);
-    qDebug() << "Sending message:" << jsonStr;
-    m_ws->sendTextMessage(jsonStr);
+    QJsonObject message = data;
+    message["client_id"] = clientId;
+    message["from"] = m_userId;
+    message["timestamp"] = QDateTime::currentMSecsSinceEpoch();
+    emit messageQueued(message);
+    return clientId;
+}
+
+QVector<QJsonObject> NetworkManager::pendingMessages(const QString &conversationId) const
+{
+    QVector<QJsonObject> messages;
+    for (QJsonObject message : m_outbox.pending()) {
+        if (message["to"].toString() != conversationId && message["group_id"].toString() != conversationId) continue;
+        message["from"] = m_userId;
+        messages.append(message);
+    }
+    return messages;
 }
 
 void NetworkManager::fetchUsers()
 {
-    auto reply = m_http->get(createRequest("/api/users"));
-    connect(reply, &QNetworkReply::finished, this, [=]() {
-        auto data = QJsonDocument::fromJson(reply->readAll()).array();
-        reply->deleteLater();
-        emit usersReceived(data);
+    syncDirectory(DirectorySync::Users);
+}
+
+void NetworkManager::syncDirectory(DirectorySync::Collection collection)
+{
+    QString path;
+    Endpoint endpoint;
+    switch (collection) {
+    case DirectorySync::Users:
+        path = "/api/users";
+        endpoint = Endpoint::Users;
+        break;
+    case DirectorySync::Friends:
+        path = QString("/api/friends?user_id=%1").arg(m_userId);
+        endpoint = Endpoint::Friends;
+        break;
+    default:
+        path = QString("/api/friends/groups?user_id=%1").arg(m_userId);
+        endpoint = Endpoint::FriendGroups;
+        break;
+    }
+    qint64 version = m_directory.version(collection);
+    if (version > 0) path += (path.contains('?') ? "&since=" : "?since=") + QString::number(version);
+
+    QString userId = m_userId;
+    m_requests.get(endpoint, path, [=](const ApiResult<QJsonDocument> &reply) {
+        // 请求期间切换了账号
+        if (!reply.ok() || userId != m_userId) return;
+        seedPresence(collection, reply.data.isArray() ? reply.data.array() : reply.data.object()["upserts"].toArray());
+        publish(m_directory.applyResponse(collection, reply.data));
     });
 }
 
-void NetworkManager::fetchHistory(const QString &otherUserId)
+void NetworkManager::seedPresence(DirectorySync::Collection collection, const QJsonArray &items)
+{
+    // 只取服务器返回的 online，本地副本里没有在线状态
+    switch (collection) {
+    case DirectorySync::Users: m_presence.seed(items, "id"); break;
+    case DirectorySync::Friends: m_presence.seed(items, "friend_id"); break;
+    default: break;
+    }
+}
+
+void NetworkManager::publish(const DirectorySync::Delta &delta)
+{
+    if (delta.isEmpty()) return;
+
+    const QJsonArray items = delta.reset ? m_directory.items(delta.collection) : delta.upserts;
+    switch (delta.collection) {
+    case DirectorySync::Users:
+        if (delta.reset) m_roster.setUsers(items);
+        else m_roster.applyUsers(delta.upserts, delta.removed);
+        break;
+    case DirectorySync::Friends:
+        if (delta.reset) m_roster.setFriends(items);
+        else m_roster.applyFriends(delta.upserts, delta.removed);
+        break;
+    default:
+        break;
+    }
+
+    if (!delta.reset) {
+        emit directoryChanged(delta);
+        return;
+    }
+    switch (delta.collection) {
+    case DirectorySync::Users: emit usersReceived(items); break;
+    case DirectorySync::Friends: emit friendsReceived(items); break;
+    default: emit friendGroupsReceived(items); break;
+    }
+}
+
+void NetworkManager::fetchHistory(const QString &otherUserId, qint64 since, qint64 before, int limit, bool fresh)
 {
     QString path = QString("/api/history?user1=%1&user2=%2").arg(m_userId, otherUserId);
-    auto reply = m_http->get(createRequest(path));
-    connect(reply, &QNetworkReply::finished, this, [=]() {
-        auto data = QJsonDocument::fromJson(reply->readAll()).array();
-        reply->deleteLater();
-        emit historyReceived(data);
-    });
+    fetchHistoryPage(otherUserId, path + cursorQuery(since, before, limit), limit, false, fresh);
+}
+
+void NetworkManager::fetchHistoryPage(const QString &conversationId, const QString &path, int limit, bool group,
+                                      bool fresh)
+{
+    QList<QPair<QByteArray, QByteArray>> headers;
+    if (fresh) {
+        m_historyValidators.remove(path);
+    } else if (auto validator = m_historyValidators.object(path)) {
+        headers.append({"If-None-Match", validator->etag});
+    }
+
+    m_requests.get(Endpoint::History, path, [=](const ApiResult<QJsonDocument> &reply) {
+        // 未变化：网络线程不会读取、解析响应体
+        if (reply.status == 304) {
+            auto validator = m_historyValidators.object(path);
+            bool hasMore = validator && validator->hasMore;
+            if (group) emit groupHistoryReceived(conversationId, QJsonArray(), hasMore);
+            else emit historyReceived(conversationId, QJsonArray(), hasMore);
+            return;
+        }
+        if (!reply.ok()) return;
+
+        // 新版接口返回 {messages, has_more}，兼容直接返回数组的旧接口
+        const QJsonDocument &doc = reply.data;
+        QJsonArray messages;
+        bool hasMore;
+        if (doc.isObject()) {
+            messages = doc.object()["messages"].toArray();
+            hasMore = doc.object()["has_more"].toBool();
+        } else {
+            messages = doc.array();
+            hasMore = limit > 0 && messages.size() >= limit;
+        }
+
+        if (!reply.etag.isEmpty()) m_historyValidators.insert(path, new HistoryValidator{reply.etag, hasMore});
+
+        if (group) emit groupHistoryReceived(conversationId, messages, hasMore);
+        else emit historyReceived(conversationId, messages, hasMore);
+    }, fresh ? RequestEngine::Refresh : RequestEngine::UseCache, headers);
 }
 
 void NetworkManager::logout()
 {
     disconnectWebSocket();
+    saveLastSeen();
+    m_outbox.close();
+    m_sequencer.clear();
+    m_receipts.clear();
     m_userId.clear();
     m_username.clear();
     m_nickname.clear();
     m_token.clear();
+    m_requests.clear();
+    m_roster.clear();
+    m_presence.clear();
+    m_directory.close();
     emit userChanged();
 }
 
-void NetworkManager::onWsConnected()
+void NetworkManager::onWsConnected(const QString &subprotocol)
 {
     m_connected = true;
-    qDebug() << "WebSocket connected for user:" << m_userId;
+    m_wireFormat = WireCodec::formatForSubprotocol(subprotocol);
+    m_wireCompressed = WireCodec::compressionForSubprotocol(subprotocol);
+    qCInfo(lcWs) << "WebSocket connected for user:" << m_userId << "protocol:" << wireFormat()
+                 << "compressed:" << m_wireCompressed;
+    ATCHAT_TRACE("ws.connected", m_wireFormat);
+    m_reconnector.connected();
     emit connectedChanged();
+    // 协商到 atchat 子协议的服务器才会回 ack、认识 batch
+    m_outbox.setAckSupported(!subprotocol.isEmpty());
+    m_outbox.setConnected(true);
+    m_receipts.setConnected(true);
+
+    // 断线期间可能漏掉增量推送，按本地版本补拉
+    for (int i = 0; i < DirectorySync::CollectionCount; ++i) {
+        if (m_directory.isLoaded(DirectorySync::Collection(i))) syncDirectory(DirectorySync::Collection(i));
+    }
 }
 
 void NetworkManager::onWsDisconnected()
 {
     m_connected = false;
-    qDebug() << "WebSocket disconnected";
+    m_outbox.setConnected(false);
+    m_receipts.setConnected(false);
+    m_reconnector.failed();
+    saveLastSeen();
+    qCInfo(lcWs) << "WebSocket disconnected";
+    ATCHAT_TRACE("ws.disconnected");
     emit connectedChanged();
 }
 
-void NetworkManager::onWsTextReceived(const QString &message)
+void NetworkManager::onWsError(const QString &error)
 {
-    qDebug() << "WebSocket received:" << message;
-    auto msg = QJsonDocument::fromJson(message.toUtf8()).object();
-    handleWsMessage(msg);
+    qCWarning(lcWs) << "WebSocket error:" << error;
+    ATCHAT_TRACE("ws.error", 0, 0, error);
+    // 重试过程中的失败不再逐次提示
+    bool notify = m_reconnector.state() == Reconnector::Connected || m_reconnector.attempts() == 1;
+    m_reconnector.failed();
+    if (notify) emit connectionError(error);
 }
 
-void NetworkManager::onWsError(QAbstractSocket::SocketError error)
-{
-    qDebug() << "WebSocket error:" << error << m_ws->errorString();
-    emit connectionError(m_ws->errorString());
-}
-
-void NetworkManager::handleWsMessage(const QJsonObject &msg)
+void NetworkManager::handleWsMessage(const QJsonObject &msg, qint64 receivedAt)
 {
     QString action = msg["action"].toString();
-    qDebug() << "Received WS message, action:" << action;
+    ATCHAT_TRACE("ws.dispatch", MessageUtils::messageId(msg["data"].toObject()), 0, action);
+    if (receivedAt > 0) Latency::record(Latency::Dispatch, Latency::now() - receivedAt);
 
-    if (action == "message") {
-        emit messageReceived(msg["data"].toObject());
-    } else if (action == "group_message") {
-        emit groupMessageReceived(msg["data"].toObject());
+    if (action == "message" || action == "group_message") {
+        // 按会话排回发送顺序后由 deliverMessage 发出
+        auto data = msg["data"].toObject();
+        markReceived(data, receivedAt);
+        m_sequencer.push(data);
     } else if (action == "status") {
         auto data = msg["data"].toObject();
-        emit userStatusChanged(data["user_id"].toString(), data["online"].toBool());
+        m_presence.update(data["user_id"].toString(), data["online"].toBool());
+    } else if (action == "ack") {
+        m_outbox.handleAck(msg["data"].toObject());
+    } else if (action == "receipt") {
+        m_receipts.handleReceipts(msg["data"].toObject());
     } else if (action == "error") {
         auto data = msg["data"].toObject();
         QString errorMsg = data["error"].toString();
-        qDebug() << "Server error:" << errorMsg;
+        qCWarning(lcWs) << "Server error:" << errorMsg;
         emit connectionError(errorMsg);
+    } else if (action == "sync") {
+        DirectorySync::Delta delta;
+        auto data = msg["data"].toObject();
+        switch (m_directory.applyPush(data, &delta)) {
+        case DirectorySync::Applied:
+            seedPresence(delta.collection, data["upserts"].toArray());
+            publish(delta);
+            break;
+        case DirectorySync::Gap: syncDirectory(delta.collection); break;
+        case DirectorySync::Stale: break;
+        }
+    } else {
+        // 群组、好友请求等变更通知只用于让缓存失效，下次获取时重新请求
+        if (m_requests.invalidateForEvent(action)) ATCHAT_TRACE("http.invalidate", 0, 0, action);
+        // 不推送增量的服务器只发变更通知，按版本补拉一次
+        if (action.startsWith("friend_") && action != "friend_request"
+            && m_directory.isLoaded(DirectorySync::Friends)) {
+            syncDirectory(DirectorySync::Friends);
+        } else if (action == "user_update" && m_directory.isLoaded(DirectorySync::Users)) {
+            syncDirectory(DirectorySync::Users);
+        }
     }
 }
 
+void NetworkManager::markReceived(const QJsonObject &message, qint64 receivedAt)
+{
+    if (receivedAt <= 0) return;
+    Latency::instance()->markReceived(MessageUtils::messageId(message), receivedAt);
+
+    // 服务器时间戳换算到收到帧的时刻；超出一分钟多半是时钟不同步或离线补发，不计入
+    const QJsonValue stamp = message["timestamp"];
+    if (stamp.isUndefined() || stamp.isNull()) return;
+    qint64 sinceReceived = (Latency::now() - receivedAt) / 1000000;
+    qint64 transitMs = QDateTime::currentMSecsSinceEpoch() - sinceReceived
+        - MessageUtils::timestamp(stamp).toMSecsSinceEpoch();
+    if (transitMs >= 0 && transitMs < 60 * 1000) Latency::record(Latency::Transit, transitMs * 1000000);
+}
+
+void NetworkManager::deliverMessage(const QJsonObject &message)
+{
+    // 只在按序放行后推进，缺口未补上时重连仍会从缺口之前补发
+    updateLastSeen(message);
+    bool group = !message["group_id"].toString().isEmpty();
+    if (message["from"].toString() != m_userId) {
+        m_receipts.markDelivered(m_sequencer.conversationFor(message), group, MessageUtils::messageId(message));
+    }
+    if (group) emit groupMessageReceived(message);
+    else emit messageReceived(message);
+}
+
+void NetworkManager::markRead(const QString &conversationId, bool group, qint64 upToId)
+{
+    if (upToId <= 0) upToId = MessageStore::instance()->lastId(conversationId);
+    m_receipts.markRead(conversationId, group, upToId);
+}
+
+void NetworkManager::onMessageAcked(const QString &action, const QJsonObject &data, qint64 id, qint64 seq)
+{
+    if (action != "message" && action != "group_message") return;
+    // 服务器不把自己的消息推回发送它的连接，不占位的话对方下一条回复会被当成缺口等待并补拉
+    QString groupId = data["group_id"].toString();
+    m_sequencer.advance(groupId.isEmpty() ? data["to"].toString() : groupId, !groupId.isEmpty(), seq, id);
+}
+
+void NetworkManager::fetchGap(const QString &conversationId, bool group, qint64 afterId, qint64 beforeId,
+                              int missing)
+{
+    QString path = group ? QString("/api/groups/history?group_id=%1").arg(conversationId)
+                         : QString("/api/history?user1=%1&user2=%2").arg(m_userId, conversationId);
+    path += cursorQuery(afterId, beforeId, missing);
+
+    m_requests.get(Endpoint::History, path, [this, conversationId](const ApiResult<QJsonDocument> &reply) {
+        if (!reply.ok()) {
+            m_sequencer.fill(conversationId, QJsonArray(), false);
+            return;
+        }
+        const QJsonDocument &doc = reply.data;
+        m_sequencer.fill(conversationId, doc.isObject() ? doc.object()["messages"].toArray() : doc.array(), true);
+    }, RequestEngine::Refresh);
+}
+
+void NetworkManager::updateLastSeen(const QJsonObject &message)
+{
+    qint64 id = MessageUtils::messageId(message);
+    if (id <= m_lastSeenId) return;
+    m_lastSeenId = id;
+    if (!m_lastSeenTimer.isActive()) m_lastSeenTimer.start();
+}
+
+void NetworkManager::saveLastSeen()
+{
+    m_lastSeenTimer.stop();
+    if (m_userId.isEmpty() || m_lastSeenId <= m_savedLastSeenId) return;
+    QSettings().setValue(QString("session/%1/lastSeenId").arg(m_userId), m_lastSeenId);
+    m_savedLastSeenId = m_lastSeenId;
+}
+
 void NetworkManager::createGroup(const QString &name, const QStringList &members)
 {
     QJsonObject body;
@@ -236,79 +620,80 @@ void NetworkManager::createGroup(const QString &name, const QStringList &members
     body["members"] = QJsonArray::fromStringList(members);
 
     QString path = QString("/api/groups?user_id=%1").arg(m_userId);
-    auto reply = m_http->post(createRequest(path), QJsonDocument(body).toJson());
-    connect(reply, &QNetworkReply::finished, this, [=]() {
-        auto data = QJsonDocument::fromJson(reply->readAll()).object();
-        reply->deleteLater();
-        if (data["success"].toBool()) {
-            emit groupCreated(data["group"].toObject());
-        }
-    });
+    m_requests.post(Endpoint::GroupCreate, path, body, [=](const ApiResult<QJsonObject> &reply) {
+        if (reply.ok()) emit groupCreated(reply.data["group"].toObject());
+    }, {Endpoint::Groups});
 }
 
 void NetworkManager::fetchGroups()
 {
     QString path = QString("/api/groups?user_id=%1").arg(m_userId);
-    auto reply = m_http->get(createRequest(path));
-    connect(reply, &QNetworkReply::finished, this, [=]() {
-        auto data = QJsonDocument::fromJson(reply->readAll()).array();
-        reply->deleteLater();
-        emit groupsReceived(data);
+    m_requests.getArray(Endpoint::Groups, path, [=](const ApiResult<QJsonArray> &reply) {
+        if (reply.ok()) emit groupsReceived(reply.data);
     });
 }
 
-void NetworkManager::fetchGroupHistory(const QString &groupId)
+void NetworkManager::fetchGroupHistory(const QString &groupId, qint64 since, qint64 before, int limit, bool fresh)
 {
     QString path = QString("/api/groups/history?group_id=%1").arg(groupId);
-    auto reply = m_http->get(createRequest(path));
-    connect(reply, &QNetworkReply::finished, this, [=]() {
-        auto data = QJsonDocument::fromJson(reply->readAll()).array();
-        reply->deleteLater();
-        emit groupHistoryReceived(data);
+    fetchHistoryPage(groupId, path + cursorQuery(since, before, limit), limit, true, fresh);
+}
+
+void NetworkManager::fetchGroupMembers(const QString &groupId, int offset, int limit)
+{
+    QString path = QString("/api/groups/members?user_id=%1&group_id=%2&offset=%3&limit=%4")
+        .arg(m_userId, groupId).arg(offset).arg(limit);
+    m_requests.getObject(Endpoint::GroupMembers, path, [=](const ApiResult<QJsonObject> &reply) {
+        if (!reply.ok()) {
+            emit groupMembersReceived(groupId, offset, QJsonArray(), -1);
+            return;
+        }
+        QJsonArray members = reply.data["members"].toArray();
+        emit groupMembersReceived(groupId, offset, members, reply.data["total"].toInt(offset + members.size()));
     });
 }
 
-void NetworkManager::sendGroupMessage(const QString &groupId, const QString &content, const QString &type)
+QString NetworkManager::sendGroupMessage(const QString &groupId, const QString &content, const QString &type,
+                                         const QStringList &mentions)
 {
     QJsonObject data;
     data["group_id"] = groupId;
     data["content"] = content;
     data["type"] = type;
+    if (!mentions.isEmpty()) data["mentions"] = QJsonArray::fromStringList(mentions);
+
+    return enqueueMessage("group_message", data);
+}
 
-    QJsonObject msg;
-    msg["action"] = "group_message";
-    msg["data"] = data;
+QString NetworkManager::sendMediaMessage(const QString &to, const QJsonObject &media, bool group)
+{
+    QJsonObject data = media;
+    data[group ? "group_id" : "to"] = to;
 
-    m_ws->sendTextMessage(QJsonDocument(msg).toJson(QJsonDocument::Compact));
+    return enqueueMessage(group ? "group_message" : "message", data);
 }
 
-void NetworkManager::uploadFile(const QString &filePath)
+QString NetworkManager::uploadFile(const QString &filePath)
 {
-    QFile *file = new QFile(filePath);
-    if (!file->open(QIODevice::ReadOnly)) {
-        delete file;
-        return;
-    }
+    // 图片的缩略图与占位图和上传并行生成
+    QString taskId = UploadManager::instance()->upload(filePath);
+    MediaPipeline::instance()->prepareUpload(taskId, filePath);
+    return taskId;
+}
 
-    QHttpMultiPart *multiPart = new QHttpMultiPart(QHttpMultiPart::FormDataType);
-    QHttpPart filePart;
-    filePart.setHeader(QNetworkRequest::ContentDispositionHeader,
-        QString("form-data; name=\"file\"; filename=\"%1\"").arg(QFileInfo(filePath).fileName()));
-    filePart.setBodyDevice(file);
-    file->setParent(multiPart);
-    multiPart->append(filePart);
-
-    QNetworkRequest req(QUrl(m_serverUrl + "/api/upload"));
-    auto reply = m_http->post(req, multiPart);
-    multiPart->setParent(reply);
-
-    connect(reply, &QNetworkReply::finished, this, [=]() {
-        auto data = QJsonDocument::fromJson(reply->readAll()).object();
-        reply->deleteLater();
-        if (data["success"].toBool()) {
-            emit fileUploaded(data);
-        }
-    });
+quint64 NetworkManager::uploadMultipart(const QString &filePath, const ReplyHandler &handler)
+{
+    quint64 id = m_nextRequestId++;
+    m_pending.insert(id, handler);
+    QMetaObject::invokeMethod(m_worker, [w = m_worker, id, filePath]() { w->upload(id, filePath); },
+                              Qt::QueuedConnection);
+    return id;
+}
+
+void NetworkManager::abortRequest(quint64 id)
+{
+    if (!m_pending.contains(id)) return;
+    QMetaObject::invokeMethod(m_worker, [w = m_worker, id]() { w->abort(id); }, Qt::QueuedConnection);
 }
 
 void NetworkManager::updateNickname(const QString &nickname)
@@ -317,15 +702,12 @@ void NetworkManager::updateNickname(const QString &nickname)
     body["nickname"] = nickname;
 
     QString path = QString("/api/profile/nickname?user_id=%1").arg(m_userId);
-    auto reply = m_http->post(createRequest(path), QJsonDocument(body).toJson());
-    connect(reply, &QNetworkReply::finished, this, [=]() {
-        auto data = QJsonDocument::fromJson(reply->readAll()).object();
-        reply->deleteLater();
-        if (data["success"].toBool()) {
-            m_nickname = nickname;
-            emit userChanged();
-        }
-    });
+    m_requests.post(Endpoint::Profile, path, body, [=](const ApiResult<QJsonObject> &reply) {
+        if (!reply.ok()) return;
+        m_nickname = nickname;
+        m_roster.updateUser(m_userId, "nickname", nickname);
+        emit userChanged();
+    }, {Endpoint::Users});
 }
 
 void NetworkManager::updateSignature(const QString &signature)
@@ -334,7 +716,9 @@ void NetworkManager::updateSignature(const QString &signature)
     body["signature"] = signature;
 
     QString path = QString("/api/profile/signature?user_id=%1").arg(m_userId);
-    m_http->post(createRequest(path), QJsonDocument(body).toJson())->deleteLater();
+    m_requests.post(Endpoint::Profile, path, body, [=](const ApiResult<QJsonObject> &reply) {
+        if (reply.ok()) m_roster.updateUser(m_userId, "signature", signature);
+    }, {Endpoint::Users});
 }
 
 void NetworkManager::updateStatus(int status)
@@ -343,7 +727,9 @@ void NetworkManager::updateStatus(int status)
     body["status"] = status;
 
     QString path = QString("/api/profile/status?user_id=%1").arg(m_userId);
-    m_http->post(createRequest(path), QJsonDocument(body).toJson())->deleteLater();
+    m_requests.post(Endpoint::Profile, path, body, [=](const ApiResult<QJsonObject> &reply) {
+        if (reply.ok()) m_roster.updateUser(m_userId, "status", status);
+    }, {Endpoint::Users});
 }
 
 void NetworkManager::changePassword(const QString &oldPassword, const QString &newPassword)
@@ -353,11 +739,8 @@ void NetworkManager::changePassword(const QString &oldPassword, const QString &n
     body["new_password"] = newPassword;
 
     QString path = QString("/api/profile/password?user_id=%1").arg(m_userId);
-    auto reply = m_http->post(createRequest(path), QJsonDocument(body).toJson());
-    connect(reply, &QNetworkReply::finished, this, [=]() {
-        auto data = QJsonDocument::fromJson(reply->readAll()).object();
-        reply->deleteLater();
-        emit passwordChanged(data["success"].toBool(), data["error"].toString());
+    m_requests.post(Endpoint::Profile, path, body, [=](const ApiResult<QJsonObject> &reply) {
+        emit passwordChanged(reply.ok(), reply.error);
     });
 }
 
@@ -368,22 +751,16 @@ void NetworkManager::sendFriendRequest(const QString &friendId, const QString &m
     body["message"] = message;
 
     QString path = QString("/api/friends/request?user_id=%1").arg(m_userId);
-    auto reply = m_http->post(createRequest(path), QJsonDocument(body).toJson());
-    connect(reply, &QNetworkReply::finished, this, [=]() {
-        auto data = QJsonDocument::fromJson(reply->readAll()).object();
-        reply->deleteLater();
-        emit friendRequestSent(data["success"].toBool());
+    m_requests.post(Endpoint::FriendRequestSend, path, body, [=](const ApiResult<QJsonObject> &reply) {
+        emit friendRequestSent(reply.ok());
     });
 }
 
 void NetworkManager::fetchFriendRequests()
 {
     QString path = QString("/api/friends/requests?user_id=%1").arg(m_userId);
-    auto reply = m_http->get(createRequest(path));
-    connect(reply, &QNetworkReply::finished, this, [=]() {
-        auto data = QJsonDocument::fromJson(reply->readAll()).array();
-        reply->deleteLater();
-        emit friendRequestsReceived(data);
+    m_requests.getArray(Endpoint::FriendRequests, path, [=](const ApiResult<QJsonArray> &reply) {
+        if (reply.ok()) emit friendRequestsReceived(reply.data);
     });
 }
 
@@ -395,35 +772,29 @@ void NetworkManager::handleFriendRequest(const QString &requestId, bool accept,
     if (!groupId.isEmpty()) body["group_id"] = groupId;
 
     QString path = QString("/api/friends/handle?user_id=%1").arg(m_userId);
-    auto reply = m_http->post(createRequest(path), QJsonDocument(body).toJson());
-    connect(reply, &QNetworkReply::finished, this, [=]() {
-        auto data = QJsonDocument::fromJson(reply->readAll()).object();
-        reply->deleteLater();
-        emit friendRequestHandled(data["success"].toBool());
-    });
+    m_requests.post(Endpoint::FriendRequestHandle, path, body, [=](const ApiResult<QJsonObject> &reply) {
+        if (reply.ok() && accept) fetchFriends();
+        emit friendRequestHandled(reply.ok());
+    }, {Endpoint::FriendRequests, Endpoint::Friends});
 }
 
 void NetworkManager::fetchFriends()
 {
-    QString path = QString("/api/friends?user_id=%1").arg(m_userId);
-    auto reply = m_http->get(createRequest(path));
-    connect(reply, &QNetworkReply::finished, this, [=]() {
-        auto data = QJsonDocument::fromJson(reply->readAll()).array();
-        reply->deleteLater();
-        emit friendsReceived(data);
-    });
+    syncDirectory(DirectorySync::Friends);
 }
 
 void NetworkManager::deleteFriend(const QString &friendId)
 {
     QString path = QString("/api/friends/%1?user_id=%2").arg(friendId, m_userId);
-    QNetworkRequest req(QUrl(m_serverUrl + path));
-    auto reply = m_http->deleteResource(req);
-    connect(reply, &QNetworkReply::finished, this, [=]() {
-        auto data = QJsonDocument::fromJson(reply->readAll()).object();
-        reply->deleteLater();
-        emit friendDeleted(data["success"].toBool());
-    });
+    m_requests.deleteResource(Endpoint::FriendUpdate, path, [=](const ApiResult<QJsonObject> &reply) {
+        if (!reply.ok()) {
+            emit friendDeleted(false);
+            return;
+        }
+        m_roster.removeFriend(friendId);
+        fetchFriends();
+        emit friendDeleted(true);
+    }, {Endpoint::Friends});
 }
 
 void NetworkManager::updateFriendRemark(const QString &friendId, const QString &remark)
@@ -432,7 +803,10 @@ void NetworkManager::updateFriendRemark(const QString &friendId, const QString &
     body["remark"] = remark;
 
     QString path = QString("/api/friends/%1/remark?user_id=%2").arg(friendId, m_userId);
-    m_http->post(createRequest(path), QJsonDocument(body).toJson())->deleteLater();
+    // 缓存在回调前已失效，重新获取的列表同时刷新好友名单与通讯录
+    m_requests.post(Endpoint::FriendUpdate, path, body, [=](const ApiResult<QJsonObject> &reply) {
+        if (reply.ok()) fetchFriends();
+    }, {Endpoint::Friends});
 }
 
 void NetworkManager::updateFriendNote(const QString &friendId, const QString &note)
@@ -441,7 +815,9 @@ void NetworkManager::updateFriendNote(const QString &friendId, const QString &no
     body["note"] = note;
 
     QString path = QString("/api/friends/%1/note?user_id=%2").arg(friendId, m_userId);
-    m_http->post(createRequest(path), QJsonDocument(body).toJson())->deleteLater();
+    m_requests.post(Endpoint::FriendUpdate, path, body, [=](const ApiResult<QJsonObject> &reply) {
+        if (reply.ok()) fetchFriends();
+    }, {Endpoint::Friends});
 }
 
 void NetworkManager::updateFriendGroup(const QString &friendId, const QString &groupId)
@@ -450,18 +826,14 @@ void NetworkManager::updateFriendGroup(const QString &friendId, const QString &g
     body["group_id"] = groupId;
 
     QString path = QString("/api/friends/%1/group?user_id=%2").arg(friendId, m_userId);
-    m_http->post(createRequest(path), QJsonDocument(body).toJson())->deleteLater();
+    m_requests.post(Endpoint::FriendUpdate, path, body, [=](const ApiResult<QJsonObject> &reply) {
+        if (reply.ok()) fetchFriends();
+    }, {Endpoint::Friends});
 }
 
 void NetworkManager::fetchFriendGroups()
 {
-    QString path = QString("/api/friends/groups?user_id=%1").arg(m_userId);
-    auto reply = m_http->get(createRequest(path));
-    connect(reply, &QNetworkReply::finished, this, [=]() {
-        auto data = QJsonDocument::fromJson(reply->readAll()).array();
-        reply->deleteLater();
-        emit friendGroupsReceived(data);
-    });
+    syncDirectory(DirectorySync::FriendGroups);
 }
 
 void NetworkManager::createFriendGroup(const QString &name)
@@ -470,31 +842,29 @@ void NetworkManager::createFriendGroup(const QString &name)
     body["name"] = name;
 
     QString path = QString("/api/friends/groups?user_id=%1").arg(m_userId);
-    auto reply = m_http->post(createRequest(path), QJsonDocument(body).toJson());
-    connect(reply, &QNetworkReply::finished, this, [=]() {
-        auto data = QJsonDocument::fromJson(reply->readAll()).object();
-        reply->deleteLater();
-        if (data["success"].toBool()) {
-            emit friendGroupCreated(data["group"].toObject());
-        }
-    });
+    m_requests.post(Endpoint::FriendUpdate, path, body, [=](const ApiResult<QJsonObject> &reply) {
+        if (!reply.ok()) return;
+        fetchFriendGroups();
+        emit friendGroupCreated(reply.data["group"].toObject());
+    }, {Endpoint::FriendGroups});
 }
 
 void NetworkManager::deleteFriendGroup(const QString &groupId)
 {
     QString path = QString("/api/friends/groups/%1?user_id=%2").arg(groupId, m_userId);
-    QNetworkRequest req(QUrl(m_serverUrl + path));
-    m_http->deleteResource(req)->deleteLater();
+    m_requests.deleteResource(Endpoint::FriendUpdate, path, [=](const ApiResult<QJsonObject> &reply) {
+        if (!reply.ok()) return;
+        fetchFriendGroups();
+        fetchFriends();
+    }, {Endpoint::FriendGroups, Endpoint::Friends});
 }
 
 void NetworkManager::searchUser(const QString &userId)
 {
     QString path = QString("/api/friends/search?user_id=%1&target_id=%2").arg(m_userId, userId);
-    auto reply = m_http->get(createRequest(path));
-    connect(reply, &QNetworkReply::finished, this, [=]() {
-        auto data = QJsonDocument::fromJson(reply->readAll()).object();
-        reply->deleteLater();
-        emit userSearchResult(data);
+    m_requests.getObject(Endpoint::UserSearch, path, [=](const ApiResult<QJsonObject> &reply) {
+        // 查无此人时服务器返回 404，界面据此提示
+        emit userSearchResult(reply.data);
     });
 }
 
@@ -502,11 +872,7 @@ void NetworkManager::deleteMessages(const QString &otherUser, bool deleteServer)
 {
     QString path = QString("/api/messages?user_id=%1&other_user=%2&delete_server=%3")
         .arg(m_userId, otherUser, deleteServer ? "true" : "false");
-    QNetworkRequest req(QUrl(m_serverUrl + path));
-    auto reply = m_http->deleteResource(req);
-    connect(reply, &QNetworkReply::finished, this, [=]() {
-        auto data = QJsonDocument::fromJson(reply->readAll()).object();
-        reply->deleteLater();
-        emit messagesDeleted(data["success"].toBool());
+    m_requests.deleteResource(Endpoint::Messages, path, [=](const ApiResult<QJsonObject> &reply) {
+        emit messagesDeleted(reply.ok());
     });
 }
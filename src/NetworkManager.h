@@ -2,15 +2,27 @@
 #define NETWORKMANAGER_H
 
 #include <QObject>
-#include <QNetworkAccessManager>
-#include <QWebSocket>
+#include <QThread>
+#include <QHash>
 #include <QJsonObject>
 #include <QJsonArray>
+#include <functional>
+
+#include "NetworkWorker.h"
+#include "Outbox.h"
+#include "Reconnector.h"
+#include "RequestEngine.h"
+#include "FriendRoster.h"
+#include "Presence.h"
+#include "DirectorySync.h"
+#include "Sequencer.h"
+#include "Receipts.h"
 
 #include <QGuiApplication>
 #include <QQmlApplicationEngine>
 #include <QQmlContext>
 #include <QTimer>
+#include <QCache>
 
 class NetworkManager : public QObject
 {
@@ -19,9 +31,18 @@ class NetworkManager : public QObject
     Q_PROPERTY(QString userId READ userId NOTIFY userChanged)
     Q_PROPERTY(QString username READ username NOTIFY userChanged)
     Q_PROPERTY(QString nickname READ nickname NOTIFY userChanged)
+    Q_PROPERTY(QString wireFormat READ wireFormat NOTIFY connectedChanged)
+    Q_PROPERTY(int pendingCount READ pendingCount NOTIFY pendingCountChanged)
+    Q_PROPERTY(int reconnectAttempts READ reconnectAttempts NOTIFY reconnectStatsChanged)
+    Q_PROPERTY(qint64 lastRecoveryMs READ lastRecoveryMs NOTIFY reconnectStatsChanged)
+    Q_PROPERTY(FriendRoster* roster READ roster CONSTANT)
+    Q_PROPERTY(Presence* presence READ presence CONSTANT)
 
 public:
+    using ReplyHandler = std::function<void(const HttpResult &)>;
+
     explicit NetworkManager(QObject *parent = nullptr);
+    ~NetworkManager();
     static NetworkManager* instance();
     static NetworkManager* create(QQmlEngine*, QJSEngine*);
 
@@ -29,25 +50,70 @@ public:
     QString userId() const { return m_userId; }
     QString username() const { return m_username; }
     QString nickname() const { return m_nickname; }
+    QString wireFormat() const { return m_wireFormat == WireCodec::Cbor ? "cbor" : "json"; }
+    int pendingCount() const { return m_outbox.pendingCount(); }
+    int reconnectAttempts() const { return m_reconnector.attempts(); }
+    qint64 lastRecoveryMs() const { return m_reconnector.lastRecoveryMs(); }
+    FriendRoster *roster() { return &m_roster; }
+    // 在线状态按帧合并后通过 Presence::changed 批量通知
+    Presence *presence() { return &m_presence; }
+    // 用户目录、好友与分组的本地副本，按版本号增量同步
+    DirectorySync *directory() { return &m_directory; }
+    // 已送达 / 已读水位线，对方的回执按帧合并后通过 Receipts::changed 通知
+    Receipts *receipts() { return &m_receipts; }
+    // 指定会话中仍在发件箱里等待确认的消息
+    QVector<QJsonObject> pendingMessages(const QString &conversationId) const;
+
+    // 供 UploadManager 等子系统直接发送请求，回调在 GUI 线程执行
+    quint64 sendRequest(HttpRequest req, const ReplyHandler &handler);
+    quint64 uploadMultipart(const QString &filePath, const ReplyHandler &handler);
+    void abortRequest(quint64 id);
+    // 各接口的请求数、合并数、缓存命中、错误与耗时
+    Q_INVOKABLE QVariantList requestStats() const { return m_requests.stats(); }
+    // WebSocket 收发的帧数与线上/解压后字节数
+    Q_INVOKABLE QVariantMap socketStats() const;
+    // 实时消息的重排、去重与补拉次数
+    Q_INVOKABLE QVariantMap orderingStats() const { return m_sequencer.stats(); }
+    // 会话已读到 upToId，0 表示本地最新一条；回执合并后发送
+    Q_INVOKABLE void markRead(const QString &conversationId, bool group, qint64 upToId = 0);
 
     Q_INVOKABLE void setServerUrl(const QString &url);
+    // 下次连接时是否尝试协商 CBOR 二进制帧
+    Q_INVOKABLE void setBinaryProtocolEnabled(bool enabled);
+    // 下次连接时是否协商压缩子协议
+    Q_INVOKABLE void setCompressionEnabled(bool enabled);
     Q_INVOKABLE void login(const QString &username, const QString &password);
     Q_INVOKABLE void registerUser(const QString &username, const QString &password, const QString &nickname);
+    // 由重连状态机负责实际连接；等待重试期间调用会立即重试
     Q_INVOKABLE void connectWebSocket();
     Q_INVOKABLE void disconnectWebSocket();
-    Q_INVOKABLE void sendMessage(const QString &to, const QString &content, const QString &type = "text");
+    // 消息先进入发件箱，返回 client_id，发送状态通过 messageStatusChanged 通知
+    Q_INVOKABLE QString sendMessage(const QString &to, const QString &content, const QString &type = "text");
+    // 重发 messageStatusChanged 报告为 failed 的消息
+    Q_INVOKABLE bool resendMessage(const QString &clientId) { return m_outbox.retry(clientId); }
+    // 用户、好友与分组列表只请求本地版本之后的变化
     Q_INVOKABLE void fetchUsers();
-    Q_INVOKABLE void fetchHistory(const QString &otherUserId);
+    // since > 0 向后取 id > since 的消息；before > 0 向前取 id < before 的消息；都为 0 取最新一页。
+    // fresh 为 true 时丢弃该页的 ETag，不带 If-None-Match 取回完整响应
+    Q_INVOKABLE void fetchHistory(const QString &otherUserId, qint64 since = 0, qint64 before = 0, int limit = 0,
+                                  bool fresh = false);
     Q_INVOKABLE void logout();
 
     // Group APIs
     Q_INVOKABLE void createGroup(const QString &name, const QStringList &members);
     Q_INVOKABLE void fetchGroups();
-    Q_INVOKABLE void fetchGroupHistory(const QString &groupId);
-    Q_INVOKABLE void sendGroupMessage(const QString &groupId, const QString &content, const QString &type = "text");
-
-    // File upload
-    Q_INVOKABLE void uploadFile(const QString &filePath);
+    Q_INVOKABLE void fetchGroupHistory(const QString &groupId, qint64 since = 0, qint64 before = 0, int limit = 0,
+                                       bool fresh = false);
+    // 按成员分页，offset 从 0 开始；结果通过 groupMembersReceived 返回
+    Q_INVOKABLE void fetchGroupMembers(const QString &groupId, int offset, int limit);
+    // mentions 为 @ 到的成员 id，"all" 表示全体成员；接收方据此标记会话，不必扫描正文
+    Q_INVOKABLE QString sendGroupMessage(const QString &groupId, const QString &content, const QString &type = "text",
+                                         const QStringList &mentions = QStringList());
+    // 带附加字段（缩略图、尺寸等）的媒体消息，media 至少包含 type 与 content
+    QString sendMediaMessage(const QString &to, const QJsonObject &media, bool group);
+
+    // File upload，分块上传由 UploadManager 完成，返回任务 id
+    Q_INVOKABLE QString uploadFile(const QString &filePath);
 
     // Profile
     Q_INVOKABLE void updateNickname(const QString &nickname);
@@ -79,18 +145,27 @@ signals:
     void registerFailed(const QString &error);
     void messageReceived(const QJsonObject &message);
     void usersReceived(const QJsonArray &users);
-    void historyReceived(const QJsonArray &messages);
-    void userStatusChanged(const QString &userId, bool online);
+    // conversationId 为请求时的对方 id 或群 id，空页与 304 也据此归属到会话
+    void historyReceived(const QString &conversationId, const QJsonArray &messages, bool hasMore);
     void connectionError(const QString &error);
+    void messageQueued(const QJsonObject &message);
+    // status: pending / sent / delivered
+    void messageStatusChanged(const QString &clientId, const QString &status);
+    void pendingCountChanged();
+    void reconnecting(int attempt, int delayMs);
+    void reconnectStatsChanged();
 
     // Group signals
     void groupCreated(const QJsonObject &group);
     void groupsReceived(const QJsonArray &groups);
-    void groupHistoryReceived(const QJsonArray &messages);
+    // total 为群成员总数，-1 表示请求失败
+    void groupMembersReceived(const QString &groupId, int offset, const QJsonArray &members, int total);
+    void groupHistoryReceived(const QString &groupId, const QJsonArray &messages, bool hasMore);
     void groupMessageReceived(const QJsonObject &message);
 
     // File signals
     void fileUploaded(const QJsonObject &fileInfo);
+    void uploadProgress(quint64 requestId, qint64 sent, qint64 total);
 
     // Profile signals
     void passwordChanged(bool success, const QString &error);
@@ -105,26 +180,66 @@ signals:
     void friendGroupCreated(const QJsonObject &group);
     void userSearchResult(const QJsonObject &user);
     void messagesDeleted(bool success);
+    // 增量变化；整体替换仍通过 usersReceived / friendsReceived / friendGroupsReceived 通知
+    void directoryChanged(const DirectorySync::Delta &delta);
 
 private slots:
-    void onWsConnected();
+    // receivedAt 为网络线程收到帧的时刻，0 表示不计时
+    void handleWsMessage(const QJsonObject &msg, qint64 receivedAt = 0);
+    void onWsConnected(const QString &subprotocol);
     void onWsDisconnected();
-    void onWsTextReceived(const QString &message);
-    void onWsError(QAbstractSocket::SocketError error);
+    void onWsError(const QString &error);
+    void onReplyFinished(const HttpResult &result);
 
 private:
-    void handleWsMessage(const QJsonObject &msg);
-    QNetworkRequest createRequest(const QString &path);
+    // 测试接缝，定义在 NetworkManager_p.h，正式代码不使用
+    friend class WsFrameInjector;
+
+    struct HistoryValidator {
+        QByteArray etag;
+        bool hasMore;
+    };
+
+    void openWebSocket();
+    void updateLastSeen(const QJsonObject &message);
+    void saveLastSeen();
+    void markReceived(const QJsonObject &message, qint64 receivedAt);
+    void deliverMessage(const QJsonObject &message);
+    void onMessageAcked(const QString &action, const QJsonObject &data, qint64 id, qint64 seq);
+    void fetchGap(const QString &conversationId, bool group, qint64 afterId, qint64 beforeId, int missing);
+    void sendWsFrame(const QJsonObject &msg);
+    QString enqueueMessage(const QString &action, const QJsonObject &data);
+    void fetchHistoryPage(const QString &conversationId, const QString &path, int limit, bool group, bool fresh);
+    void syncDirectory(DirectorySync::Collection collection);
+    void seedPresence(DirectorySync::Collection collection, const QJsonArray &items);
+    void publish(const DirectorySync::Delta &delta);
 
     static NetworkManager *s_instance;
-    QNetworkAccessManager *m_http;
-    QWebSocket *m_ws;
+    QThread m_thread;
+    NetworkWorker *m_worker;
     QString m_serverUrl;
     QString m_userId;
     QString m_username;
     QString m_nickname;
     QString m_token;
     bool m_connected;
+    WireCodec::Format m_wireFormat;
+    bool m_wireCompressed;
+    quint64 m_nextRequestId;
+    QHash<quint64, ReplyHandler> m_pending;
+    QCache<QString, HistoryValidator> m_historyValidators;
+    RequestEngine m_requests;
+    FriendRoster m_roster;
+    Presence m_presence;
+    DirectorySync m_directory;
+    Outbox m_outbox;
+    Sequencer m_sequencer;
+    Receipts m_receipts;
+    Reconnector m_reconnector;
+    qint64 m_lastSeenId;
+    // 已写入 QSettings 的值；收到消息只更新内存，定时、断线与登出时写盘
+    qint64 m_savedLastSeenId;
+    QTimer m_lastSeenTimer;
 };
 
 #endif
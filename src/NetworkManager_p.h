@@ -0,0 +1,28 @@
+#ifndef NETWORKMANAGER_P_H
+#define NETWORKMANAGER_P_H
+
+//
+// 仅供 bench/ 与 tests/ 使用，正式代码不包含此头文件。
+//
+
+#include <QJsonObject>
+
+#include "NetworkManager.h"
+
+// 把 WebSocket 帧直接交给 NetworkManager::handleWsMessage 分发，与网络线程投递的帧走同一条路径，
+// 只是同线程直接调用，测量的是分发本身的开销。直接调用成员函数，槽的签名变化在编译期就会报错
+class WsFrameInjector
+{
+public:
+    explicit WsFrameInjector(NetworkManager *net)
+        : m_net(net)
+    {
+    }
+
+    void inject(const QJsonObject &msg) { m_net->handleWsMessage(msg, 0); }
+
+private:
+    NetworkManager *m_net;
+};
+
+#endif
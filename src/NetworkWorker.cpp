@@ -0,0 +1,296 @@
+#include "NetworkWorker.h"
+#include "Trace.h"
+#include "Compression.h"
+#include "Logging.h"
+#include "Latency.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QSignalBlocker>
+#include <QHttpMultiPart>
+#include <QHttpPart>
+#include <QWebSocketHandshakeOptions>
+
+NetworkWorker::NetworkWorker(QObject *parent)
+    : QObject(parent)
+    , m_http(nullptr)
+    , m_ws(nullptr)
+    , m_binaryEnabled(true)
+    , m_compressEnabled(true)
+    , m_format(WireCodec::Json)
+    , m_compress(false)
+    , m_inFrames(0)
+    , m_inWire(0)
+    , m_inDecoded(0)
+    , m_outFrames(0)
+    , m_outWire(0)
+    , m_outDecoded(0)
+    , m_compressedIn(0)
+    , m_compressedOut(0)
+{
+}
+
+SocketStats NetworkWorker::socketStats() const
+{
+    SocketStats stats;
+    stats.inFrames = m_inFrames.load(std::memory_order_relaxed);
+    stats.inWire = m_inWire.load(std::memory_order_relaxed);
+    stats.inDecoded = m_inDecoded.load(std::memory_order_relaxed);
+    stats.outFrames = m_outFrames.load(std::memory_order_relaxed);
+    stats.outWire = m_outWire.load(std::memory_order_relaxed);
+    stats.outDecoded = m_outDecoded.load(std::memory_order_relaxed);
+    stats.compressedIn = m_compressedIn.load(std::memory_order_relaxed);
+    stats.compressedOut = m_compressedOut.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void NetworkWorker::init()
+{
+    // 必须在网络线程中创建，保证套接字事件在该线程处理
+    m_http = new QNetworkAccessManager(this);
+    m_acceptEncoding = Compression::acceptEncoding();
+    m_ws = new QWebSocket(QString(), QWebSocketProtocol::VersionLatest, this);
+
+    connect(m_ws, &QWebSocket::connected, this, [this]() {
+        // 服务器选中 CBOR 子协议时切换为二进制帧，否则保持 JSON 文本帧
+        m_format = WireCodec::formatForSubprotocol(m_ws->subprotocol());
+        m_compress = WireCodec::compressionForSubprotocol(m_ws->subprotocol());
+        emit socketConnected(m_ws->subprotocol());
+    });
+    connect(m_ws, &QWebSocket::disconnected, this, &NetworkWorker::socketDisconnected);
+    connect(m_ws, &QWebSocket::errorOccurred, this, [this]() {
+        emit socketError(m_ws->errorString());
+    });
+    connect(m_ws, &QWebSocket::textMessageReceived, this, [this](const QString &message) {
+        receiveFrame(message.toUtf8(), WireCodec::Json);
+    });
+    connect(m_ws, &QWebSocket::binaryMessageReceived, this, [this](const QByteArray &frame) {
+        receiveFrame(frame, WireCodec::Cbor);
+    });
+}
+
+void NetworkWorker::setServerUrl(const QString &url)
+{
+    m_serverUrl = url;
+}
+
+void NetworkWorker::setBinaryProtocolEnabled(bool enabled)
+{
+    m_binaryEnabled = enabled;
+}
+
+void NetworkWorker::setCompressionEnabled(bool enabled)
+{
+    // 下次握手生效
+    m_compressEnabled = enabled;
+}
+
+void NetworkWorker::request(const HttpRequest &req)
+{
+    QByteArray body = req.body;
+    if (!req.bodyFile.isEmpty()) {
+        QFile file(req.bodyFile);
+        if (!file.open(QIODevice::ReadOnly) || !file.seek(req.bodyOffset)) {
+            fail(req.id, QNetworkReply::ContentNotFoundError, file.errorString());
+            return;
+        }
+        body = file.read(req.bodyLength);
+        if (body.size() != req.bodyLength) {
+            fail(req.id, QNetworkReply::ContentNotFoundError, file.errorString());
+            return;
+        }
+    }
+
+    // 服务器返回的媒体地址可能是完整 URL
+    QUrl url = req.path.startsWith("http://") || req.path.startsWith("https://")
+        ? QUrl(req.path) : QUrl(m_serverUrl + req.path);
+    QNetworkRequest nr(url);
+    nr.setHeader(QNetworkRequest::ContentTypeHeader, req.contentType);
+    if (req.timeoutMs > 0) nr.setTransferTimeout(req.timeoutMs);
+    // 自己声明 Accept-Encoding 后 QNetworkAccessManager 不再自动解压，由 finish() 解码并统计字节数；
+    // 媒体多为已压缩格式，且按 Range 分段下载，要求原样返回
+    if (req.rawBody) nr.setRawHeader("Accept-Encoding", "identity");
+    else if (!m_acceptEncoding.isEmpty()) nr.setRawHeader("Accept-Encoding", m_acceptEncoding);
+    for (const auto &header : req.headers) {
+        nr.setRawHeader(header.first, header.second);
+    }
+
+    QNetworkReply *reply;
+    if (req.verb == "GET") {
+        reply = m_http->get(nr);
+    } else if (req.verb == "POST") {
+        reply = m_http->post(nr, body);
+    } else if (req.verb == "PUT") {
+        reply = m_http->put(nr, body);
+    } else if (req.verb == "DELETE") {
+        reply = m_http->deleteResource(nr);
+    } else {
+        reply = m_http->sendCustomRequest(nr, req.verb, body);
+    }
+
+    quint64 id = req.id;
+    bool rawBody = req.rawBody;
+    m_replies.insert(id, reply);
+    if (!req.bodyFile.isEmpty()) {
+        connect(reply, &QNetworkReply::uploadProgress, this, [this, id](qint64 sent, qint64 total) {
+            emit uploadProgress(id, sent, total);
+        });
+    }
+    connect(reply, &QNetworkReply::finished, this, [this, id, reply, rawBody]() {
+        finish(id, reply, rawBody);
+    });
+}
+
+void NetworkWorker::abort(quint64 id)
+{
+    // abort 会同步触发 finished，结果以 OperationCanceledError 返回
+    if (QNetworkReply *reply = m_replies.value(id)) reply->abort();
+}
+
+void NetworkWorker::upload(quint64 id, const QString &filePath)
+{
+    QFile *file = new QFile(filePath);
+    if (!file->open(QIODevice::ReadOnly)) {
+        fail(id, QNetworkReply::ContentNotFoundError, file->errorString());
+        delete file;
+        return;
+    }
+
+    QHttpMultiPart *multiPart = new QHttpMultiPart(QHttpMultiPart::FormDataType);
+    QHttpPart filePart;
+    filePart.setHeader(QNetworkRequest::ContentDispositionHeader,
+        QString("form-data; name=\"file\"; filename=\"%1\"").arg(QFileInfo(filePath).fileName()));
+    filePart.setBodyDevice(file);
+    file->setParent(multiPart);
+    multiPart->append(filePart);
+
+    QNetworkRequest req(QUrl(m_serverUrl + "/api/upload"));
+    auto reply = m_http->post(req, multiPart);
+    multiPart->setParent(reply);
+    m_replies.insert(id, reply);
+    connect(reply, &QNetworkReply::uploadProgress, this, [this, id](qint64 sent, qint64 total) {
+        emit uploadProgress(id, sent, total);
+    });
+
+    connect(reply, &QNetworkReply::finished, this, [this, id, reply]() {
+        finish(id, reply);
+    });
+}
+
+void NetworkWorker::openSocket(const QUrl &url)
+{
+    // 如果已连接，先断开；旧连接的断开不通知，避免被重连状态机当作新的失败
+    if (m_ws->state() != QAbstractSocket::UnconnectedState) {
+        QSignalBlocker blocker(m_ws);
+        m_ws->abort();
+    }
+    m_format = WireCodec::Json;
+    m_compress = false;
+
+    QWebSocketHandshakeOptions options;
+    options.setSubprotocols(WireCodec::subprotocols(m_binaryEnabled, m_compressEnabled));
+    m_ws->open(url, options);
+}
+
+void NetworkWorker::closeSocket()
+{
+    m_ws->close();
+}
+
+void NetworkWorker::sendFrame(const QJsonObject &message, qint64 queuedAt)
+{
+    if (m_ws->state() != QAbstractSocket::ConnectedState) return;
+    if (queuedAt > 0) Latency::record(Latency::SocketWrite, Latency::now() - queuedAt);
+
+    QByteArray frame = WireCodec::encode(message, m_format);
+    ATCHAT_TRACE("ws.frame.out", frame.size(), m_format);
+    m_outFrames.fetch_add(1, std::memory_order_relaxed);
+    m_outDecoded.fetch_add(frame.size(), std::memory_order_relaxed);
+
+    if (m_compress && frame.size() >= WireCodec::COMPRESSION_THRESHOLD) {
+        // 压缩后没有变小（例如内容是 base64 的缩略图）就按原样发送
+        QByteArray packed = WireCodec::compressFrame(frame);
+        if (packed.size() < frame.size()) {
+            m_compressedOut.fetch_add(1, std::memory_order_relaxed);
+            m_outWire.fetch_add(packed.size(), std::memory_order_relaxed);
+            m_ws->sendBinaryMessage(packed);
+            return;
+        }
+    }
+
+    m_outWire.fetch_add(frame.size(), std::memory_order_relaxed);
+    if (m_format == WireCodec::Cbor) {
+        m_ws->sendBinaryMessage(frame);
+    } else {
+        m_ws->sendTextMessage(QString::fromUtf8(frame));
+    }
+}
+
+void NetworkWorker::receiveFrame(const QByteArray &frame, WireCodec::Format format)
+{
+    qint64 receivedAt = Latency::now();
+    m_inFrames.fetch_add(1, std::memory_order_relaxed);
+    m_inWire.fetch_add(frame.size(), std::memory_order_relaxed);
+
+    // 压缩帧总是二进制帧，内容按协商的格式解码
+    if (format == WireCodec::Cbor && WireCodec::isCompressedFrame(frame)) {
+        QByteArray plain = WireCodec::decompressFrame(frame);
+        if (plain.isEmpty()) {
+            qCWarning(lcWs) << "dropping undecodable compressed frame, size" << frame.size();
+            return;
+        }
+        m_compressedIn.fetch_add(1, std::memory_order_relaxed);
+        m_inDecoded.fetch_add(plain.size(), std::memory_order_relaxed);
+        ATCHAT_TRACE("ws.frame.in", plain.size(), m_format);
+        QJsonObject message = WireCodec::decode(plain, m_format);
+        Latency::record(Latency::Parse, Latency::now() - receivedAt);
+        emit socketMessage(message, receivedAt);
+        return;
+    }
+
+    m_inDecoded.fetch_add(frame.size(), std::memory_order_relaxed);
+    ATCHAT_TRACE("ws.frame.in", frame.size(), format);
+    QJsonObject message = WireCodec::decode(frame, format);
+    Latency::record(Latency::Parse, Latency::now() - receivedAt);
+    emit socketMessage(message, receivedAt);
+}
+
+void NetworkWorker::fail(quint64 id, QNetworkReply::NetworkError error, const QString &errorString)
+{
+    HttpResult result;
+    result.id = id;
+    result.error = error;
+    result.errorString = errorString;
+    emit replyFinished(result);
+}
+
+void NetworkWorker::finish(quint64 id, QNetworkReply *reply, bool rawBody)
+{
+    m_replies.remove(id);
+    reply->deleteLater();
+
+    HttpResult result;
+    result.id = id;
+    result.status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    result.error = reply->error();
+    result.errorString = reply->errorString();
+    result.etag = reply->rawHeader("ETag");
+
+    // 304 不读取响应体
+    if (result.status != 304) {
+        QByteArray body = reply->readAll();
+        result.wireBytes = body.size();
+        // 没有可用解码器时由 QNetworkAccessManager 自动解压，读到的已是解码后的内容
+        QByteArray encoding = reply->rawHeader("Content-Encoding");
+        if (!m_acceptEncoding.isEmpty() && !encoding.isEmpty() && !Compression::decode(encoding, body, &body)) {
+            result.error = QNetworkReply::ProtocolFailure;
+            result.errorString = tr("响应解压失败");
+            body.clear();
+        }
+        result.decodedBytes = body.size();
+        ATCHAT_TRACE("http.body", result.wireBytes, result.decodedBytes);
+
+        if (rawBody) result.body = body;
+        else result.json = QJsonDocument::fromJson(body);
+    }
+    emit replyFinished(result);
+}
@@ -0,0 +1,127 @@
+#ifndef NETWORKWORKER_H
+#define NETWORKWORKER_H
+
+#include <QObject>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QWebSocket>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QList>
+#include <QHash>
+#include <QPair>
+#include <QUrl>
+#include <atomic>
+
+#include "WireCodec.h"
+
+struct HttpRequest
+{
+    quint64 id = 0;
+    QByteArray verb;
+    QString path;
+    QByteArray body;
+    QList<QPair<QByteArray, QByteArray>> headers;
+    // 非空时请求体从该文件的指定区间读取，在网络线程完成磁盘 I/O，并上报上传进度
+    QString bodyFile;
+    qint64 bodyOffset = 0;
+    qint64 bodyLength = 0;
+    QByteArray contentType = "application/json";
+    // 为 true 时不解析 JSON，原始响应体放在 HttpResult::body（用于图片等媒体）
+    bool rawBody = false;
+    // 传输超时，0 表示不限；超过时间没有收发数据即中止
+    int timeoutMs = 0;
+};
+
+struct HttpResult
+{
+    quint64 id = 0;
+    int status = 0;
+    QNetworkReply::NetworkError error = QNetworkReply::NoError;
+    QString errorString;
+    QByteArray etag;
+    QJsonDocument json;
+    QByteArray body;
+    // 响应体在线上的字节数与解码后的字节数，未压缩时两者相等
+    qint64 wireBytes = 0;
+    qint64 decodedBytes = 0;
+
+    bool ok() const { return error == QNetworkReply::NoError; }
+};
+
+// WebSocket 帧的累计字节数：wire 为实际收发的帧长度，decoded 为解压后的长度
+struct SocketStats
+{
+    qint64 inFrames = 0;
+    qint64 inWire = 0;
+    qint64 inDecoded = 0;
+    qint64 outFrames = 0;
+    qint64 outWire = 0;
+    qint64 outDecoded = 0;
+    qint64 compressedIn = 0;
+    qint64 compressedOut = 0;
+};
+
+Q_DECLARE_METATYPE(HttpRequest)
+Q_DECLARE_METATYPE(HttpResult)
+
+// 运行在独立网络线程中，持有 QNetworkAccessManager 与 QWebSocket，
+// 负责收发和 JSON 解析，结果通过排队信号交给 GUI 线程的 NetworkManager
+class NetworkWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit NetworkWorker(QObject *parent = nullptr);
+
+    // 可在任意线程读取
+    SocketStats socketStats() const;
+
+public slots:
+    void init();
+    void setServerUrl(const QString &url);
+    void setBinaryProtocolEnabled(bool enabled);
+    void setCompressionEnabled(bool enabled);
+    void request(const HttpRequest &req);
+    void abort(quint64 id);
+    void upload(quint64 id, const QString &filePath);
+    void openSocket(const QUrl &url);
+    void closeSocket();
+    // queuedAt 为主线程交出该帧的时刻（Latency::now()），0 表示不计时
+    void sendFrame(const QJsonObject &message, qint64 queuedAt = 0);
+
+signals:
+    void replyFinished(const HttpResult &result);
+    void uploadProgress(quint64 id, qint64 sent, qint64 total);
+    void socketConnected(const QString &subprotocol);
+    void socketDisconnected();
+    void socketError(const QString &error);
+    // receivedAt 为收到帧的时刻（Latency::now()）
+    void socketMessage(const QJsonObject &message, qint64 receivedAt);
+
+private:
+    void finish(quint64 id, QNetworkReply *reply, bool rawBody = false);
+    void fail(quint64 id, QNetworkReply::NetworkError error, const QString &errorString);
+    void receiveFrame(const QByteArray &frame, WireCodec::Format format);
+
+    QNetworkAccessManager *m_http;
+    QHash<quint64, QNetworkReply *> m_replies;
+    QWebSocket *m_ws;
+    QString m_serverUrl;
+    QByteArray m_acceptEncoding;
+    bool m_binaryEnabled;
+    bool m_compressEnabled;
+    WireCodec::Format m_format;
+    bool m_compress;            // 当前连接是否协商到压缩子协议
+
+    std::atomic<qint64> m_inFrames;
+    std::atomic<qint64> m_inWire;
+    std::atomic<qint64> m_inDecoded;
+    std::atomic<qint64> m_outFrames;
+    std::atomic<qint64> m_outWire;
+    std::atomic<qint64> m_outDecoded;
+    std::atomic<qint64> m_compressedIn;
+    std::atomic<qint64> m_compressedOut;
+};
+
+#endif
@@ -0,0 +1,311 @@
+#include "Outbox.h"
+#include "Logging.h"
+#include "Trace.h"
+#include "Latency.h"
+#include <QStandardPaths>
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QDateTime>
+#include <QUuid>
+
+namespace {
+
+const int BATCH_SIZE = 50;
+const int ACK_TIMEOUT_MS = 5000;
+const int MAX_ACK_TIMEOUT_MS = 60000;
+const int RETRY_CHECK_MS = 1000;
+// 5、10、20、40、60 秒，约两分多钟后放弃
+const int MAX_ATTEMPTS = 5;
+
+}
+
+Outbox::Outbox(QObject *parent)
+    : QObject(parent)
+    , m_nextOrder(0)
+    , m_connected(false)
+    , m_ackSupported(true)
+    , m_saveScheduled(false)
+{
+    m_retryTimer.setInterval(RETRY_CHECK_MS);
+    connect(&m_retryTimer, &QTimer::timeout, this, &Outbox::checkTimeouts);
+}
+
+Outbox::~Outbox()
+{
+    if (m_saveScheduled) save();
+}
+
+void Outbox::open(const QString &accountId)
+{
+    close();
+
+    QString dir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/outbox";
+    QDir().mkpath(dir);
+    m_path = dir + "/" + accountId + ".json";
+    load();
+    flush();
+}
+
+void Outbox::close()
+{
+    if (m_path.isEmpty()) return;
+
+    save();
+    m_entries.clear();
+    m_order.clear();
+    m_nextOrder = 0;
+    m_path.clear();
+    m_retryTimer.stop();
+    emit pendingCountChanged();
+}
+
+QString Outbox::enqueue(const QString &action, const QJsonObject &data)
+{
+    Entry e;
+    e.clientId = QUuid::createUuid().toString(QUuid::WithoutBraces);
+    e.action = action;
+    e.data = data;
+    e.data["client_id"] = e.clientId;
+    e.queuedAt = QDateTime::currentMSecsSinceEpoch();
+    e.queuedNs = Latency::now();
+
+    append(e);
+    emit pendingCountChanged();
+    emit statusChanged(e.clientId, "pending");
+    scheduleSave();
+
+    // 同一事件循环内的连续发送合并为一批
+    QMetaObject::invokeMethod(this, &Outbox::flush, Qt::QueuedConnection);
+    return e.clientId;
+}
+
+void Outbox::append(const Entry &entry)
+{
+    Entry &e = m_entries[entry.clientId];
+    e = entry;
+    e.order = m_nextOrder++;
+    m_order.insert(e.order, e.clientId);
+}
+
+QVector<QJsonObject> Outbox::pending() const
+{
+    QVector<QJsonObject> messages;
+    messages.reserve(m_order.size());
+    for (const QString &clientId : m_order) {
+        const Entry &e = m_entries[clientId];
+        QJsonObject message = e.data;
+        message["timestamp"] = e.queuedAt;
+        message["status"] = e.failed ? "failed" : "pending";
+        messages.append(message);
+    }
+    return messages;
+}
+
+bool Outbox::retry(const QString &clientId)
+{
+    auto it = m_entries.find(clientId);
+    if (it == m_entries.end() || !it->failed) return false;
+
+    it->failed = false;
+    it->attempts = 0;
+    emit statusChanged(clientId, "pending");
+    scheduleSave();
+    flush();
+    return true;
+}
+
+void Outbox::setConnected(bool connected)
+{
+    m_connected = connected;
+    if (!connected) {
+        // 断线后未确认的消息重新排队
+        for (auto it = m_entries.begin(); it != m_entries.end(); ++it) it->inFlight = false;
+        m_retryTimer.stop();
+        return;
+    }
+    flush();
+}
+
+void Outbox::setAckSupported(bool supported)
+{
+    m_ackSupported = supported;
+}
+
+void Outbox::handleAck(const QJsonObject &data)
+{
+    QString status = data["status"].toString("sent");
+    // 批量确认在 acks 里逐条带回 {client_id, id, seq}，旧服务器只有 client_ids
+    if (data.contains("acks")) {
+        for (const QJsonValue &v : data["acks"].toArray()) {
+            QJsonObject ack = v.toObject();
+            acknowledge(ack["client_id"].toString(), status, ack["id"].toInteger(), ack["seq"].toInteger());
+        }
+    } else if (data.contains("client_ids")) {
+        for (const QJsonValue &v : data["client_ids"].toArray()) acknowledge(v.toString(), status);
+    } else {
+        acknowledge(data["client_id"].toString(), status, data["id"].toInteger(), data["seq"].toInteger());
+    }
+}
+
+void Outbox::acknowledge(const QString &clientId, const QString &status, qint64 id, qint64 seq)
+{
+    // 重复的 ack（重发后服务器再次确认）直接忽略
+    auto it = m_entries.find(clientId);
+    if (it == m_entries.end()) {
+        if (status == "delivered") emit statusChanged(clientId, status);
+        return;
+    }
+    qint64 now = Latency::now();
+    if (it->sentNs > 0) Latency::record(Latency::Ack, now - it->sentNs);
+    if (it->queuedNs > 0) Latency::record(Latency::RoundTrip, now - it->queuedNs);
+    const QString action = it->action;
+    const QJsonObject data = it->data;
+    m_order.remove(it->order);
+    m_entries.erase(it);
+    ATCHAT_TRACE("outbox.ack", 0, 0, clientId);
+    emit pendingCountChanged();
+    emit statusChanged(clientId, status);
+    if (id > 0) emit acknowledged(action, data, id, seq);
+    scheduleSave();
+
+    if (m_order.isEmpty()) m_retryTimer.stop();
+}
+
+void Outbox::flush()
+{
+    if (!m_connected || m_order.isEmpty()) return;
+
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    qint64 nowNs = Latency::now();
+    QJsonArray batch;
+    auto send = [this, &batch]() {
+        if (batch.isEmpty()) return;
+        if (batch.size() == 1 || !m_ackSupported) {
+            for (const QJsonValue &frame : std::as_const(batch)) emit frameReady(frame.toObject());
+        } else {
+            QJsonObject data;
+            data["messages"] = batch;
+            QJsonObject frame;
+            frame["action"] = "batch";
+            frame["data"] = data;
+            emit frameReady(frame);
+        }
+        batch = QJsonArray();
+    };
+
+    QStringList written;
+    for (const QString &clientId : std::as_const(m_order)) {
+        Entry &e = m_entries[clientId];
+        if (e.inFlight || e.failed) continue;
+
+        QJsonObject frame;
+        frame["action"] = e.action;
+        frame["data"] = e.data;
+        batch.append(frame);
+        written.append(clientId);
+
+        e.inFlight = true;
+        e.attempts++;
+        e.sentAt = now;
+        e.sentNs = nowNs;
+        if (e.attempts == 1 && e.queuedNs > 0) Latency::record(Latency::Queue, nowNs - e.queuedNs);
+        ATCHAT_TRACE("outbox.send", e.attempts, 0, clientId);
+        if (batch.size() >= BATCH_SIZE) send();
+    }
+    send();
+
+    // 旧服务器不会确认，写出后就从队列里移除
+    if (!m_ackSupported) {
+        for (const QString &clientId : std::as_const(written)) acknowledge(clientId, "sent");
+        return;
+    }
+    if (!written.isEmpty() && !m_retryTimer.isActive()) m_retryTimer.start();
+}
+
+void Outbox::checkTimeouts()
+{
+    if (!m_connected) return;
+
+    // 超时未确认的消息按指数退避重发，次数用完标记为失败
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    bool expired = false;
+    QStringList failed;
+    for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+        if (!it->inFlight) continue;
+        qint64 timeout = qMin<qint64>(qint64(ACK_TIMEOUT_MS) << qMin(it->attempts - 1, 4), MAX_ACK_TIMEOUT_MS);
+        if (now - it->sentAt < timeout) continue;
+
+        ATCHAT_TRACE("outbox.timeout", it->attempts, timeout, it->clientId);
+        it->inFlight = false;
+        if (it->attempts >= MAX_ATTEMPTS) {
+            it->failed = true;
+            failed.append(it->clientId);
+        } else {
+            expired = true;
+        }
+    }
+    for (const QString &clientId : std::as_const(failed)) {
+        qCWarning(lcOutbox) << "giving up on" << clientId << "after" << MAX_ATTEMPTS << "attempts";
+        emit statusChanged(clientId, "failed");
+    }
+    if (!failed.isEmpty()) scheduleSave();
+    if (expired) flush();
+}
+
+void Outbox::scheduleSave()
+{
+    if (m_saveScheduled) return;
+    m_saveScheduled = true;
+    QMetaObject::invokeMethod(this, &Outbox::save, Qt::QueuedConnection);
+}
+
+void Outbox::save()
+{
+    m_saveScheduled = false;
+    if (m_path.isEmpty()) return;
+
+    QJsonArray items;
+    for (const QString &clientId : std::as_const(m_order)) {
+        const Entry &e = m_entries[clientId];
+        QJsonObject item;
+        item["client_id"] = e.clientId;
+        item["action"] = e.action;
+        item["data"] = e.data;
+        item["attempts"] = e.attempts;
+        if (e.failed) item["failed"] = true;
+        item["queued_at"] = e.queuedAt;
+        items.append(item);
+    }
+
+    QSaveFile file(m_path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qCWarning(lcOutbox) << "cannot save outbox" << m_path << file.errorString();
+        return;
+    }
+    file.write(QJsonDocument(items).toJson(QJsonDocument::Compact));
+    if (!file.commit()) qCWarning(lcOutbox) << "cannot save outbox" << m_path << file.errorString();
+}
+
+void Outbox::load()
+{
+    QFile file(m_path);
+    if (!file.open(QIODevice::ReadOnly)) return;
+
+    const QJsonArray items = QJsonDocument::fromJson(file.readAll()).array();
+    for (const QJsonValue &v : items) {
+        auto item = v.toObject();
+        Entry e;
+        e.clientId = item["client_id"].toString();
+        e.action = item["action"].toString();
+        e.data = item["data"].toObject();
+        e.attempts = item["attempts"].toInt();
+        e.queuedAt = qint64(item["queued_at"].toDouble());
+        e.failed = item["failed"].toBool();
+        if (e.clientId.isEmpty() || m_entries.contains(e.clientId)) continue;
+        append(e);
+    }
+    emit pendingCountChanged();
+}
@@ -0,0 +1,78 @@
+#ifndef OUTBOX_H
+#define OUTBOX_H
+
+#include <QObject>
+#include <QHash>
+#include <QMap>
+#include <QStringList>
+#include <QVector>
+#include <QJsonObject>
+#include <QTimer>
+
+// 待发送消息队列：每条消息分配 client_id 并持久化，连接后批量发送，
+// 收到服务器 ack 后移除，超时未确认则以同一 client_id 重发，由服务器去重。
+// 重发 MAX_ATTEMPTS 次仍未确认的消息标记为 failed，不再自动重发，由用户 retry。
+// 没有协商到 atchat 子协议的旧服务器不回 ack、也不认识 batch：逐条发送，写出即视为已发送。
+class Outbox : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit Outbox(QObject *parent = nullptr);
+    ~Outbox();
+
+    void open(const QString &accountId);
+    void close();
+
+    QString enqueue(const QString &action, const QJsonObject &data);
+    void setConnected(bool connected);
+    void setAckSupported(bool supported);
+    // 把 failed 的消息重新排队
+    bool retry(const QString &clientId);
+    void handleAck(const QJsonObject &data);
+    int pendingCount() const { return m_order.size(); }
+    // 尚未被服务器确认的消息，附带入队时间 timestamp 与 status（pending / failed），按入队顺序排列
+    QVector<QJsonObject> pending() const;
+
+signals:
+    void frameReady(const QJsonObject &frame);
+    void statusChanged(const QString &clientId, const QString &status);
+    // 首次确认时带回服务器分配的 id 与 seq；data 为发送时的内容
+    void acknowledged(const QString &action, const QJsonObject &data, qint64 id, qint64 seq);
+    void pendingCountChanged();
+
+private:
+    struct Entry {
+        QString clientId;
+        QString action;
+        QJsonObject data;
+        quint64 order = 0;          // m_order 的键
+        bool inFlight = false;
+        bool failed = false;
+        int attempts = 0;
+        qint64 queuedAt = 0;
+        qint64 sentAt = 0;
+        // Latency::now() 时刻，不持久化；重启后恢复的消息不计时
+        qint64 queuedNs = 0;
+        qint64 sentNs = 0;
+    };
+
+    void flush();
+    void checkTimeouts();
+    void acknowledge(const QString &clientId, const QString &status, qint64 id = 0, qint64 seq = 0);
+    void append(const Entry &entry);
+    void scheduleSave();
+    void save();
+    void load();
+
+    QString m_path;
+    QHash<QString, Entry> m_entries;
+    QMap<quint64, QString> m_order;     // 入队顺序 → client_id，确认时按键删除
+    quint64 m_nextOrder;
+    QTimer m_retryTimer;
+    bool m_connected;
+    bool m_ackSupported;
+    bool m_saveScheduled;
+};
+
+#endif
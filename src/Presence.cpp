@@ -0,0 +1,108 @@
+#include "Presence.h"
+#include "Trace.h"
+#include <QJsonObject>
+
+namespace {
+
+const int FRAME_INTERVAL_MS = 16;
+
+}
+
+Presence::Presence(QObject *parent)
+    : QObject(parent)
+    , m_onlineCount(0)
+    , m_revision(0)
+{
+    m_frame.setSingleShot(true);
+    m_frame.setInterval(FRAME_INTERVAL_MS);
+    m_frame.setTimerType(Qt::PreciseTimer);
+    connect(&m_frame, &QTimer::timeout, this, &Presence::flush);
+}
+
+bool Presence::isOnline(const QString &userId) const
+{
+    return isOnline(userId, false);
+}
+
+bool Presence::isOnline(const QString &userId, bool fallback) const
+{
+    auto it = m_slots.constFind(userId);
+    if (it == m_slots.cend() || m_states.at(*it) == Unknown) return fallback;
+    return m_states.at(*it) == Online;
+}
+
+int Presence::slot(const QString &userId)
+{
+    auto it = m_slots.constFind(userId);
+    if (it != m_slots.cend()) return *it;
+
+    int index = m_ids.size();
+    m_slots.insert(userId, index);
+    m_ids.append(userId);
+    m_states.append(Unknown);
+    return index;
+}
+
+void Presence::set(int index, State state)
+{
+    qint8 &current = m_states[index];
+    if (current == state) return;
+    if (current == Online) m_onlineCount--;
+    if (state == Online) m_onlineCount++;
+    current = state;
+}
+
+void Presence::update(const QString &userId, bool online)
+{
+    if (userId.isEmpty()) return;
+    int index = slot(userId);
+    State state = online ? Online : Offline;
+    if (m_states.at(index) == state) return;
+
+    if (!m_frameStart.contains(index)) m_frameStart.insert(index, m_states.at(index));
+    set(index, state);
+    if (!m_frame.isActive()) m_frame.start();
+}
+
+void Presence::seed(const QJsonArray &users, const QString &idField)
+{
+    for (const QJsonValue &value : users) {
+        QJsonObject user = value.toObject();
+        QString id = user[idField].toString();
+        if (id.isEmpty() || !user.contains("online")) continue;
+
+        // 本帧内已有状态帧的用户以状态帧为准，它比列表响应更新
+        int index = slot(id);
+        if (m_frameStart.contains(index)) continue;
+        set(index, user["online"].toBool() ? Online : Offline);
+    }
+}
+
+void Presence::flush()
+{
+    Diff diff;
+    for (auto it = m_frameStart.cbegin(); it != m_frameStart.cend(); ++it) {
+        qint8 now = m_states.at(it.key());
+        if (now != it.value()) diff.insert(m_ids.at(it.key()), now == Online);
+    }
+    m_frameStart.clear();
+    if (diff.isEmpty()) return;
+
+    ATCHAT_TRACE("presence.flush", diff.size(), m_onlineCount);
+    m_revision++;
+    emit changed(diff);
+    emit revisionChanged();
+}
+
+void Presence::clear()
+{
+    m_frame.stop();
+    m_frameStart.clear();
+    m_slots.clear();
+    m_ids.clear();
+    m_states.clear();
+    m_onlineCount = 0;
+    m_revision++;
+    emit changed(Diff());
+    emit revisionChanged();
+}
@@ -0,0 +1,62 @@
+#ifndef PRESENCE_H
+#define PRESENCE_H
+
+#include <QObject>
+#include <QHash>
+#include <QVector>
+#include <QTimer>
+#include <QJsonArray>
+
+// 在线状态表：用户 id 映射为槽位，状态按槽位存放在紧凑数组中。
+// 一帧（约 16 ms）内收到的状态帧只记录变化，帧结束时合并成一次差异通知；
+// 同一用户在帧内上线又下线不会产生通知，上班高峰的状态风暴每帧只触发一次重绘。
+class Presence : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(int revision READ revision NOTIFY revisionChanged)
+    Q_PROPERTY(int onlineCount READ onlineCount NOTIFY revisionChanged)
+
+public:
+    // 用户 id → 是否在线，只包含本帧内真正变化的用户
+    using Diff = QHash<QString, bool>;
+
+    explicit Presence(QObject *parent = nullptr);
+
+    int revision() const { return m_revision; }
+    int onlineCount() const { return m_onlineCount; }
+
+    Q_INVOKABLE bool isOnline(const QString &userId) const;
+    // 未知用户返回 fallback，用于以列表数据为准
+    bool isOnline(const QString &userId, bool fallback) const;
+
+    // 状态帧到达，变化在本帧结束时统一通知
+    void update(const QString &userId, bool online);
+    // 以列表响应中的 online 字段为准，不产生通知（列表本身会触发模型重建）
+    void seed(const QJsonArray &users, const QString &idField);
+    void clear();
+
+signals:
+    void changed(const Presence::Diff &diff);
+    void revisionChanged();
+
+private:
+    enum State : qint8 {
+        Unknown = -1,
+        Offline = 0,
+        Online = 1
+    };
+
+    int slot(const QString &userId);
+    void set(int slot, State state);
+    void flush();
+
+    QHash<QString, int> m_slots;
+    QVector<QString> m_ids;
+    QVector<qint8> m_states;
+    QHash<int, qint8> m_frameStart;     // 本帧内变化过的槽位 → 帧开始时的状态
+    QTimer m_frame;
+    int m_onlineCount;
+    int m_revision;
+};
+
+#endif
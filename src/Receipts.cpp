@@ -0,0 +1,131 @@
+#include "Receipts.h"
+#include "Trace.h"
+#include <QJsonArray>
+
+namespace {
+
+const int DEBOUNCE_MS = 500;
+const int FRAME_INTERVAL_MS = 16;
+
+}
+
+Receipts::Receipts(QObject *parent)
+    : QObject(parent)
+    , m_connected(false)
+{
+    // 从第一次变化开始计时，不随后续变化顺延，持续收消息时回执也不会一直拖着
+    m_debounce.setSingleShot(true);
+    m_debounce.setInterval(DEBOUNCE_MS);
+    connect(&m_debounce, &QTimer::timeout, this, &Receipts::flush);
+
+    m_frame.setSingleShot(true);
+    m_frame.setInterval(FRAME_INTERVAL_MS);
+    m_frame.setTimerType(Qt::PreciseTimer);
+    connect(&m_frame, &QTimer::timeout, this, &Receipts::notify);
+}
+
+void Receipts::setConnected(bool connected)
+{
+    m_connected = connected;
+    if (connected && !m_dirty.isEmpty()) m_debounce.start();
+}
+
+void Receipts::markDelivered(const QString &conversationId, bool group, qint64 id)
+{
+    advance(conversationId, group, id, 0);
+}
+
+void Receipts::markRead(const QString &conversationId, bool group, qint64 id)
+{
+    advance(conversationId, group, id, id);
+}
+
+void Receipts::advance(const QString &conversationId, bool group, qint64 delivered, qint64 read)
+{
+    if (conversationId.isEmpty() || delivered <= 0) return;
+
+    Outgoing &o = m_outgoing[conversationId];
+    o.group = group;
+    bool moved = false;
+    if (delivered > o.marked.delivered) {
+        o.marked.delivered = delivered;
+        moved = true;
+    }
+    if (read > o.marked.read) {
+        o.marked.read = read;
+        moved = true;
+    }
+    if (!moved) return;
+
+    m_dirty.insert(conversationId);
+    if (m_connected && !m_debounce.isActive()) m_debounce.start();
+}
+
+void Receipts::flush()
+{
+    if (!m_connected || m_dirty.isEmpty()) return;
+
+    QJsonArray receipts;
+    for (const QString &conversationId : std::as_const(m_dirty)) {
+        Outgoing &o = m_outgoing[conversationId];
+        QJsonObject receipt;
+        receipt[o.group ? "group_id" : "to"] = conversationId;
+        // 已读隐含已送达，只发变化的字段
+        if (o.marked.delivered > o.sent.delivered && o.marked.delivered > o.marked.read) {
+            receipt["delivered"] = o.marked.delivered;
+        }
+        if (o.marked.read > o.sent.read) receipt["read"] = o.marked.read;
+        o.sent = o.marked;
+        if (receipt.size() > 1) receipts.append(receipt);
+    }
+    m_dirty.clear();
+    if (receipts.isEmpty()) return;
+
+    ATCHAT_TRACE("receipt.send", receipts.size());
+    emit frameReady(QJsonObject{{"action", "receipt"}, {"data", QJsonObject{{"receipts", receipts}}}});
+}
+
+void Receipts::handleReceipts(const QJsonObject &data)
+{
+    // 自己其他设备发出的回执不改变对方的水位线
+    QString from = data["from"].toString();
+    if (from.isEmpty() || from == m_selfId) return;
+
+    for (const QJsonValue &value : data["receipts"].toArray()) {
+        QJsonObject receipt = value.toObject();
+        QString groupId = receipt["group_id"].toString();
+        QString conversationId = groupId.isEmpty() ? from : groupId;
+        qint64 read = receipt["read"].toInteger();
+        qint64 delivered = qMax(read, receipt["delivered"].toInteger());
+
+        Watermark &w = m_peers[conversationId];
+        if (delivered <= w.delivered && read <= w.read) continue;
+        w.delivered = qMax(w.delivered, delivered);
+        w.read = qMax(w.read, read);
+        m_changed.insert(conversationId);
+    }
+    if (!m_changed.isEmpty() && !m_frame.isActive()) m_frame.start();
+}
+
+void Receipts::notify()
+{
+    if (m_changed.isEmpty()) return;
+    Diff diff;
+    diff.reserve(m_changed.size());
+    for (const QString &conversationId : std::as_const(m_changed)) {
+        diff.insert(conversationId, m_peers.value(conversationId));
+    }
+    m_changed.clear();
+    ATCHAT_TRACE("receipt.apply", diff.size());
+    emit changed(diff);
+}
+
+void Receipts::clear()
+{
+    m_outgoing.clear();
+    m_dirty.clear();
+    m_peers.clear();
+    m_changed.clear();
+    m_debounce.stop();
+    m_frame.stop();
+}
@@ -0,0 +1,65 @@
+#ifndef RECEIPTS_H
+#define RECEIPTS_H
+
+#include <QObject>
+#include <QHash>
+#include <QSet>
+#include <QJsonObject>
+#include <QTimer>
+
+// 已送达 / 已读回执，按会话记录水位线（"已读到 id X"），不逐条发送。
+// 发出：水位线只前进，变化在 500ms 内合并成一个 receipt 帧，一帧可包含多个会话；
+// 收到：对方（群聊中任一成员）的水位线按帧合并后一次通知，消息模型据此批量更新状态。
+class Receipts : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Watermark {
+        qint64 delivered = 0;
+        qint64 read = 0;
+    };
+    // 会话 id → 对方的水位线，只包含本帧内前进过的会话
+    using Diff = QHash<QString, Watermark>;
+
+    explicit Receipts(QObject *parent = nullptr);
+
+    void setSelfId(const QString &userId) { m_selfId = userId; }
+    void setConnected(bool connected);
+
+    // 本端收到 / 看到了会话中 id 及之前的消息
+    void markDelivered(const QString &conversationId, bool group, qint64 id);
+    void markRead(const QString &conversationId, bool group, qint64 id);
+
+    // 对方的回执帧 {from, receipts: [{to | group_id, delivered, read}]}
+    void handleReceipts(const QJsonObject &data);
+    // 对方在该会话中的水位线
+    Watermark watermark(const QString &conversationId) const { return m_peers.value(conversationId); }
+    void clear();
+
+signals:
+    void frameReady(const QJsonObject &frame);
+    void changed(const Receipts::Diff &diff);
+
+private:
+    struct Outgoing {
+        bool group = false;
+        Watermark marked;   // 本端已经到达的位置
+        Watermark sent;     // 已经发出的位置
+    };
+
+    void advance(const QString &conversationId, bool group, qint64 delivered, qint64 read);
+    void flush();
+    void notify();
+
+    QString m_selfId;
+    bool m_connected;
+    QHash<QString, Outgoing> m_outgoing;
+    QSet<QString> m_dirty;
+    QTimer m_debounce;
+    QHash<QString, Watermark> m_peers;
+    QSet<QString> m_changed;
+    QTimer m_frame;
+};
+
+#endif
@@ -0,0 +1,106 @@
+#include "Reconnector.h"
+#include "Trace.h"
+#include <QRandomGenerator>
+
+namespace {
+
+const int BASE_DELAY_MS = 1000;
+const int MAX_DELAY_MS = 60000;
+const int CONNECT_TIMEOUT_MS = 15000;
+
+}
+
+Reconnector::Reconnector(QObject *parent)
+    : QObject(parent)
+    , m_state(Idle)
+    , m_failures(0)
+    , m_attempts(0)
+    , m_lastRecoveryMs(-1)
+{
+    m_retryTimer.setSingleShot(true);
+    connect(&m_retryTimer, &QTimer::timeout, this, &Reconnector::attempt);
+
+    // 握手迟迟没有结果时按失败处理
+    m_connectTimeout.setSingleShot(true);
+    m_connectTimeout.setInterval(CONNECT_TIMEOUT_MS);
+    connect(&m_connectTimeout, &QTimer::timeout, this, &Reconnector::failed);
+}
+
+void Reconnector::start()
+{
+    m_failures = 0;
+    m_attempts = 0;
+    m_lastRecoveryMs = -1;
+    m_outage.invalidate();
+    emit statsChanged();
+    attempt();
+}
+
+void Reconnector::stop()
+{
+    m_retryTimer.stop();
+    m_connectTimeout.stop();
+    m_outage.invalidate();
+    setState(Idle);
+}
+
+void Reconnector::retryNow()
+{
+    if (m_state != Waiting) return;
+    m_retryTimer.stop();
+    attempt();
+}
+
+void Reconnector::connected()
+{
+    if (m_state != Connecting) return;
+
+    m_connectTimeout.stop();
+    m_failures = 0;
+    if (m_outage.isValid()) {
+        m_lastRecoveryMs = m_outage.elapsed();
+        m_outage.invalidate();
+        emit statsChanged();
+    }
+    setState(Connected);
+}
+
+void Reconnector::failed()
+{
+    // 同一次断线可能同时收到 error 与 disconnected，只处理一次
+    if (m_state != Connecting && m_state != Connected) return;
+
+    m_connectTimeout.stop();
+    if (!m_outage.isValid()) m_outage.start();
+
+    int delay = nextDelay();
+    m_failures++;
+    setState(Waiting);
+    m_retryTimer.start(delay);
+    ATCHAT_TRACE("ws.retry", m_attempts + 1, delay);
+    emit retryScheduled(m_attempts + 1, delay);
+}
+
+void Reconnector::attempt()
+{
+    m_attempts++;
+    emit statsChanged();
+    setState(Connecting);
+    m_connectTimeout.start();
+    emit connectRequested();
+}
+
+int Reconnector::nextDelay() const
+{
+    // 指数退避上限内取随机值，下限为基础间隔的一半，避免连续失败时空转
+    qint64 ceiling = qMin<qint64>(qint64(BASE_DELAY_MS) << qMin(m_failures, 16), MAX_DELAY_MS);
+    int floor = BASE_DELAY_MS / 2;
+    return floor + QRandomGenerator::global()->bounded(int(ceiling) - floor + 1);
+}
+
+void Reconnector::setState(State state)
+{
+    if (m_state == state) return;
+    m_state = state;
+    emit stateChanged(state);
+}
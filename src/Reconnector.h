@@ -0,0 +1,59 @@
+#ifndef RECONNECTOR_H
+#define RECONNECTOR_H
+
+#include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+
+// WebSocket 重连状态机：断线后按带随机抖动的指数退避重试，
+// 避免服务器重启后所有客户端在同一时刻重连
+class Reconnector : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum State {
+        Idle,           // 未登录或主动断开
+        Connecting,
+        Connected,
+        Waiting         // 等待下一次重试
+    };
+    Q_ENUM(State)
+
+    explicit Reconnector(QObject *parent = nullptr);
+
+    State state() const { return m_state; }
+    // 自登录以来的连接尝试次数
+    int attempts() const { return m_attempts; }
+    // 最近一次从断线到恢复连接的耗时，未发生过断线为 -1
+    qint64 lastRecoveryMs() const { return m_lastRecoveryMs; }
+
+    void start();
+    void stop();
+    // 跳过剩余等待立即重试，例如用户发送消息时
+    void retryNow();
+
+    void connected();
+    void failed();
+
+signals:
+    void connectRequested();
+    void stateChanged(Reconnector::State state);
+    void retryScheduled(int attempt, int delayMs);
+    void statsChanged();
+
+private:
+    void setState(State state);
+    void attempt();
+    int nextDelay() const;
+
+    State m_state;
+    QTimer m_retryTimer;
+    QTimer m_connectTimeout;
+    QElapsedTimer m_outage;
+    int m_failures;
+    int m_attempts;
+    qint64 m_lastRecoveryMs;
+};
+
+#endif
@@ -0,0 +1,287 @@
+#include "RequestEngine.h"
+#include "Logging.h"
+#include "Trace.h"
+#include <QTimer>
+
+namespace {
+
+const int REQUEST_TIMEOUT_MS = 15000;
+const int SLOW_REQUEST_MS = 2000;
+const int CACHE_PRUNE_THRESHOLD = 256;
+
+struct EndpointInfo {
+    const char *name;
+    int ttlMs;      // 0 表示不缓存
+};
+
+const EndpointInfo ENDPOINTS[] = {
+    {"login", 0},
+    {"register", 0},
+    {"users", 0},               // 用户、好友与分组由 DirectorySync 按版本增量同步
+    {"history", 0},             // 由 ETag 负责重新验证
+    {"groups", 60 * 1000},
+    {"group.create", 0},
+    {"group.members", 30 * 1000},
+    {"profile", 0},
+    {"friend.requests", 15 * 1000},
+    {"friend.request.send", 0},
+    {"friend.request.handle", 0},
+    {"friends", 0},
+    {"friend.update", 0},
+    {"friend.groups", 0},
+    {"user.search", 10 * 1000},
+    {"messages", 0},
+};
+static_assert(sizeof(ENDPOINTS) / sizeof(ENDPOINTS[0]) == int(Endpoint::Count), "endpoint table mismatch");
+
+struct EventRule {
+    const char *action;
+    QList<Endpoint> endpoints;
+};
+
+// 服务器推送的事件与受影响的端点；在线状态由 Presence 覆盖，用户与好友列表由增量同步维护
+const EventRule EVENT_RULES[] = {
+    {"friend_request", {Endpoint::FriendRequests}},
+    {"friend_added", {Endpoint::FriendRequests}},
+    {"group_created", {Endpoint::Groups}},
+    {"group_update", {Endpoint::Groups, Endpoint::GroupMembers}},
+};
+
+bool isTransient(const HttpResult &reply)
+{
+    return reply.status == 0 || reply.status >= 500;
+}
+
+}
+
+RequestEngine::RequestEngine(const Transport &transport, QObject *parent)
+    : QObject(parent)
+    , m_transport(transport)
+{
+    m_clock.start();
+}
+
+const char *RequestEngine::endpointName(Endpoint endpoint)
+{
+    return ENDPOINTS[int(endpoint)].name;
+}
+
+void RequestEngine::get(Endpoint endpoint, const QString &path, const Callback<QJsonDocument> &callback,
+                        CachePolicy policy, const QList<QPair<QByteArray, QByteArray>> &headers)
+{
+    Stats &stats = m_stats[int(endpoint)];
+
+    if (policy == UseCache) {
+        auto cached = m_cache.constFind(path);
+        if (cached != m_cache.cend() && cached->expiresAt > m_clock.elapsed()) {
+            stats.cacheHits++;
+            ATCHAT_TRACE("http.cache", int(endpoint), 0, path);
+            ApiResult<QJsonDocument> result;
+            result.data = cached->json;
+            result.status = 200;
+            result.cached = true;
+            result.etag = cached->etag;
+            if (callback) deliver([callback, result]() { callback(result); });
+            return;
+        }
+    }
+
+    auto inFlight = m_inFlight.find(path);
+    if (inFlight != m_inFlight.end()) {
+        stats.coalesced++;
+        if (callback) inFlight->callbacks.append(callback);
+        return;
+    }
+    m_inFlight.insert(path, InFlight{endpoint, m_generation[int(endpoint)],
+                                     callback ? QList<Callback<QJsonDocument>>{callback}
+                                              : QList<Callback<QJsonDocument>>()});
+
+    HttpRequest req;
+    req.verb = "GET";
+    req.path = path;
+    req.headers = headers;
+    send(endpoint, req, [this, path](const ApiResult<QJsonDocument> &result) {
+        InFlight done = m_inFlight.take(path);
+        int ttl = ENDPOINTS[int(done.endpoint)].ttlMs;
+        // 请求期间端点被失效过，响应可能已经过时，只交给调用方，不进入缓存
+        if (result.ok() && result.status == 200 && ttl > 0
+            && done.generation == m_generation[int(done.endpoint)]) {
+            if (m_cache.size() >= CACHE_PRUNE_THRESHOLD) {
+                qint64 now = m_clock.elapsed();
+                for (auto it = m_cache.begin(); it != m_cache.end();) {
+                    if (it->expiresAt <= now) it = m_cache.erase(it);
+                    else ++it;
+                }
+            }
+            m_cache.insert(path, CacheEntry{done.endpoint, result.data, result.etag, m_clock.elapsed() + ttl});
+        }
+        for (const auto &callback : done.callbacks) callback(result);
+    });
+}
+
+void RequestEngine::getArray(Endpoint endpoint, const QString &path, const Callback<QJsonArray> &callback,
+                             CachePolicy policy)
+{
+    get(endpoint, path, [callback](const ApiResult<QJsonDocument> &reply) {
+        ApiResult<QJsonArray> result;
+        result.status = reply.status;
+        result.error = reply.error;
+        result.timedOut = reply.timedOut;
+        result.cached = reply.cached;
+        result.etag = reply.etag;
+        result.data = reply.data.array();
+        if (result.ok() && !reply.data.isArray()) result.error = tr("服务器响应格式错误");
+        if (callback) callback(result);
+    }, policy);
+}
+
+void RequestEngine::getObject(Endpoint endpoint, const QString &path, const Callback<QJsonObject> &callback,
+                              CachePolicy policy)
+{
+    get(endpoint, path, [callback](const ApiResult<QJsonDocument> &reply) {
+        ApiResult<QJsonObject> result;
+        result.status = reply.status;
+        result.error = reply.error;
+        result.timedOut = reply.timedOut;
+        result.cached = reply.cached;
+        result.etag = reply.etag;
+        result.data = reply.data.object();
+        if (result.ok() && !reply.data.isObject()) result.error = tr("服务器响应格式错误");
+        if (callback) callback(result);
+    }, policy);
+}
+
+void RequestEngine::post(Endpoint endpoint, const QString &path, const QJsonObject &body,
+                         const Callback<QJsonObject> &callback, const QList<Endpoint> &invalidates)
+{
+    mutate(endpoint, "POST", path, QJsonDocument(body).toJson(QJsonDocument::Compact), callback, invalidates);
+}
+
+void RequestEngine::deleteResource(Endpoint endpoint, const QString &path,
+                                   const Callback<QJsonObject> &callback, const QList<Endpoint> &invalidates)
+{
+    mutate(endpoint, "DELETE", path, QByteArray(), callback, invalidates);
+}
+
+void RequestEngine::mutate(Endpoint endpoint, const QByteArray &verb, const QString &path, const QByteArray &body,
+                           const Callback<QJsonObject> &callback, const QList<Endpoint> &invalidates)
+{
+    HttpRequest req;
+    req.verb = verb;
+    req.path = path;
+    req.body = body;
+    send(endpoint, req, [this, callback, invalidates](const ApiResult<QJsonDocument> &reply) {
+        ApiResult<QJsonObject> result;
+        result.status = reply.status;
+        result.error = reply.error;
+        result.timedOut = reply.timedOut;
+        result.data = reply.data.object();
+
+        // 业务失败同样算作失败，但不需要统一上报
+        if (result.ok() && result.data.contains("success") && !result.data["success"].toBool()) {
+            result.error = result.data["error"].toString();
+            if (result.error.isEmpty()) result.error = tr("操作失败");
+        }
+
+        // 即使失败也可能已部分生效，保守地使缓存失效；先失效再回调，回调里的重新获取拿到的是新数据
+        for (Endpoint affected : invalidates) invalidate(affected);
+        if (callback) callback(result);
+    });
+}
+
+void RequestEngine::send(Endpoint endpoint, HttpRequest req, const Callback<QJsonDocument> &callback)
+{
+    req.timeoutMs = REQUEST_TIMEOUT_MS;
+    m_stats[int(endpoint)].requests++;
+    qint64 started = m_clock.elapsed();
+    m_transport(req, [this, endpoint, started, callback](const HttpResult &reply) {
+        callback(toResult(endpoint, reply, m_clock.elapsed() - started));
+    });
+}
+
+ApiResult<QJsonDocument> RequestEngine::toResult(Endpoint endpoint, const HttpResult &reply, qint64 elapsedMs)
+{
+    Stats &stats = m_stats[int(endpoint)];
+    stats.totalMs += elapsedMs;
+    stats.maxMs = qMax(stats.maxMs, elapsedMs);
+    stats.wireBytes += reply.wireBytes;
+    stats.decodedBytes += reply.decodedBytes;
+    ATCHAT_TRACE("http.latency", int(endpoint), elapsedMs);
+
+    ApiResult<QJsonDocument> result;
+    result.data = reply.json;
+    result.status = reply.status;
+    result.etag = reply.etag;
+    if (elapsedMs >= SLOW_REQUEST_MS) {
+        qCInfo(lcNet) << "slow request" << endpointName(endpoint) << elapsedMs << "ms";
+    }
+    if (reply.ok()) return result;
+
+    result.timedOut = reply.error == QNetworkReply::TimeoutError
+        || (reply.error == QNetworkReply::OperationCanceledError && elapsedMs >= REQUEST_TIMEOUT_MS);
+    // 服务器在错误响应里给出的说明比网络层的描述更有用
+    if (reply.json.isObject()) result.error = reply.json.object()["error"].toString();
+    if (result.error.isEmpty()) {
+        result.error = result.timedOut ? tr("请求超时") : reply.errorString;
+    }
+    if (result.error.isEmpty()) result.error = tr("请求失败");
+
+    stats.errors++;
+    if (result.timedOut) stats.timeouts++;
+    qCWarning(lcNet) << endpointName(endpoint) << "failed:" << reply.status << result.error;
+    if (result.timedOut || isTransient(reply)) emit failed(endpointName(endpoint), result.error);
+    return result;
+}
+
+void RequestEngine::deliver(const std::function<void()> &call)
+{
+    QTimer::singleShot(0, this, call);
+}
+
+void RequestEngine::invalidate(Endpoint endpoint)
+{
+    m_generation[int(endpoint)]++;
+    for (auto it = m_cache.begin(); it != m_cache.end();) {
+        if (it->endpoint == endpoint) it = m_cache.erase(it);
+        else ++it;
+    }
+}
+
+bool RequestEngine::invalidateForEvent(const QString &action)
+{
+    for (const EventRule &rule : EVENT_RULES) {
+        if (action != QLatin1String(rule.action)) continue;
+        for (Endpoint endpoint : rule.endpoints) invalidate(endpoint);
+        return true;
+    }
+    return false;
+}
+
+void RequestEngine::clear()
+{
+    // 进行中的请求仍会回调，但结果不再进入缓存
+    for (quint64 &generation : m_generation) generation++;
+    m_cache.clear();
+}
+
+QVariantList RequestEngine::stats() const
+{
+    QVariantList list;
+    for (int i = 0; i < int(Endpoint::Count); ++i) {
+        const Stats &s = m_stats[i];
+        if (s.requests == 0 && s.cacheHits == 0 && s.coalesced == 0) continue;
+        QVariantMap entry;
+        entry["endpoint"] = ENDPOINTS[i].name;
+        entry["requests"] = s.requests;
+        entry["coalesced"] = s.coalesced;
+        entry["cacheHits"] = s.cacheHits;
+        entry["errors"] = s.errors;
+        entry["timeouts"] = s.timeouts;
+        entry["avgMs"] = s.requests > 0 ? s.totalMs / s.requests : 0;
+        entry["maxMs"] = s.maxMs;
+        entry["wireBytes"] = s.wireBytes;
+        entry["decodedBytes"] = s.decodedBytes;
+        list.append(entry);
+    }
+    return list;
+}
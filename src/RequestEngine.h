@@ -0,0 +1,139 @@
+#ifndef REQUESTENGINE_H
+#define REQUESTENGINE_H
+
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QVariant>
+#include <functional>
+
+#include "NetworkWorker.h"
+
+// 业务接口端点，决定缓存时长、统计分组以及哪些 WebSocket 事件会使缓存失效
+enum class Endpoint {
+    Login,
+    Register,
+    Users,
+    History,
+    Groups,
+    GroupCreate,
+    GroupMembers,
+    Profile,
+    FriendRequests,
+    FriendRequestSend,
+    FriendRequestHandle,
+    Friends,
+    FriendUpdate,
+    FriendGroups,
+    UserSearch,
+    Messages,
+    Count
+};
+
+// 请求结果：error 为空表示成功；业务失败（success: false）也填入 error，data 仍保留原始响应
+template <typename T>
+struct ApiResult {
+    T data;
+    int status = 0;
+    QString error;
+    bool timedOut = false;
+    bool cached = false;
+    QByteArray etag;
+
+    bool ok() const { return error.isEmpty(); }
+};
+
+// GUI 线程中的请求引擎：
+// - 相同的 GET 正在进行时不再发出新请求，结果分发给所有调用方；
+// - GET 响应按端点 TTL 缓存，自身的修改请求与服务器推送的事件会使对应端点失效；
+// - 错误、超时与耗时统一在这里记录，网络层面的失败通过 failed 上报一次。
+// 回调总是异步执行，即使命中缓存。
+class RequestEngine : public QObject
+{
+    Q_OBJECT
+
+public:
+    using ReplyHandler = std::function<void(const HttpResult &)>;
+    using Transport = std::function<quint64(const HttpRequest &, const ReplyHandler &)>;
+    template <typename T>
+    using Callback = std::function<void(const ApiResult<T> &)>;
+
+    enum CachePolicy {
+        UseCache,
+        Refresh     // 跳过缓存，但仍会合并进行中的请求并更新缓存
+    };
+
+    explicit RequestEngine(const Transport &transport, QObject *parent = nullptr);
+
+    void get(Endpoint endpoint, const QString &path, const Callback<QJsonDocument> &callback,
+             CachePolicy policy = UseCache, const QList<QPair<QByteArray, QByteArray>> &headers = {});
+    void getArray(Endpoint endpoint, const QString &path, const Callback<QJsonArray> &callback,
+                  CachePolicy policy = UseCache);
+    void getObject(Endpoint endpoint, const QString &path, const Callback<QJsonObject> &callback,
+                   CachePolicy policy = UseCache);
+    // 修改类请求，完成后使 invalidates 中的端点缓存失效
+    void post(Endpoint endpoint, const QString &path, const QJsonObject &body,
+              const Callback<QJsonObject> &callback = Callback<QJsonObject>(),
+              const QList<Endpoint> &invalidates = {});
+    void deleteResource(Endpoint endpoint, const QString &path,
+                        const Callback<QJsonObject> &callback = Callback<QJsonObject>(),
+                        const QList<Endpoint> &invalidates = {});
+
+    void invalidate(Endpoint endpoint);
+    // 服务器推送事件对应的缓存失效，返回是否有端点受影响
+    bool invalidateForEvent(const QString &action);
+    void clear();
+
+    // 每个端点的 {endpoint, requests, coalesced, cacheHits, errors, timeouts, avgMs, maxMs}
+    QVariantList stats() const;
+
+    static const char *endpointName(Endpoint endpoint);
+
+signals:
+    void failed(const QString &endpoint, const QString &error);
+
+private:
+    struct CacheEntry {
+        Endpoint endpoint;
+        QJsonDocument json;
+        QByteArray etag;
+        qint64 expiresAt;
+    };
+
+    struct InFlight {
+        Endpoint endpoint;
+        quint64 generation;
+        QList<Callback<QJsonDocument>> callbacks;
+    };
+
+    struct Stats {
+        qint64 requests = 0;
+        qint64 coalesced = 0;
+        qint64 cacheHits = 0;
+        qint64 errors = 0;
+        qint64 timeouts = 0;
+        qint64 totalMs = 0;
+        qint64 maxMs = 0;
+        qint64 wireBytes = 0;       // 响应体线上字节数
+        qint64 decodedBytes = 0;    // 解压后字节数
+    };
+
+    void send(Endpoint endpoint, HttpRequest req, const Callback<QJsonDocument> &callback);
+    ApiResult<QJsonDocument> toResult(Endpoint endpoint, const HttpResult &reply, qint64 elapsedMs);
+    void mutate(Endpoint endpoint, const QByteArray &verb, const QString &path, const QByteArray &body,
+                const Callback<QJsonObject> &callback, const QList<Endpoint> &invalidates);
+    void deliver(const std::function<void()> &call);
+
+    Transport m_transport;
+    QElapsedTimer m_clock;
+    QHash<QString, CacheEntry> m_cache;
+    QHash<QString, InFlight> m_inFlight;
+    quint64 m_generation[int(Endpoint::Count)] = {};
+    Stats m_stats[int(Endpoint::Count)];
+};
+
+#endif
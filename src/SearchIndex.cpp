@@ -0,0 +1,585 @@
+#include "SearchIndex.h"
+#include "MessageStore.h"
+#include "MessageUtils.h"
+#include "Logging.h"
+#include "Trace.h"
+
+#include <QCborValue>
+#include <QDataStream>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFutureWatcher>
+#include <QSaveFile>
+#include <QtConcurrent>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+const quint32 INDEX_MAGIC = 0x41435349; // "ACSI"
+const quint32 INDEX_VERSION = 1;
+const int MAX_WORD_LENGTH = 32;
+const int PREFIX_EXPANSION_LIMIT = 64;
+const int NEW_TERMS_MERGE_MIN = 1024;
+const int SAVE_INTERVAL = 4096;
+const double BM25_K1 = 1.2;
+const double BM25_B = 0.75;
+
+bool isCjk(uint c)
+{
+    return (c >= 0x3040 && c <= 0x30FF)         // 平假名、片假名
+        || (c >= 0x3400 && c <= 0x4DBF)
+        || (c >= 0x4E00 && c <= 0x9FFF)
+        || (c >= 0xAC00 && c <= 0xD7AF)         // 谚文
+        || (c >= 0xF900 && c <= 0xFAFF)
+        || (c >= 0x20000 && c <= 0x2FA1F);
+}
+
+QString fromUcs4(const uint *data, qsizetype size)
+{
+    return QString::fromUcs4(reinterpret_cast<const char32_t *>(data), size);
+}
+
+// 把文本切成中日韩连续段与单词，标点和空白只起分隔作用
+template<typename OnRun, typename OnWord>
+void segment(const QString &text, OnRun onRun, OnWord onWord)
+{
+    QList<uint> run;
+    QList<uint> word;
+    auto flushRun = [&]() { if (!run.isEmpty()) { onRun(run); run.clear(); } };
+    auto flushWord = [&]() { if (!word.isEmpty()) { onWord(word); word.clear(); } };
+
+    for (uint c : text.toUcs4()) {
+        if (isCjk(c)) {
+            flushWord();
+            run.append(c);
+        } else if (QChar::isLetterOrNumber(c)) {
+            flushRun();
+            if (word.size() < MAX_WORD_LENGTH) word.append(QChar::toCaseFolded(c));
+        } else {
+            flushRun();
+            flushWord();
+        }
+    }
+    flushRun();
+    flushWord();
+}
+
+QStringList documentTerms(const QString &text)
+{
+    QStringList terms;
+    segment(text, [&terms](const QList<uint> &run) {
+        for (qsizetype i = 0; i + 1 < run.size(); ++i) terms.append(fromUcs4(run.constData() + i, 2));
+        terms.append(fromUcs4(run.constData() + run.size() - 1, 1));
+    }, [&terms](const QList<uint> &word) {
+        terms.append(fromUcs4(word.constData(), word.size()));
+    });
+    return terms;
+}
+
+struct QueryTerm {
+    QString term;
+    bool prefix;
+};
+
+// 单个汉字与末尾还没输完的单词按前缀匹配
+QVector<QueryTerm> queryTerms(const QString &query)
+{
+    QVector<QueryTerm> terms;
+    bool endsWithWord = false;
+    auto push = [&terms](const QString &term, bool prefix) {
+        for (const QueryTerm &t : std::as_const(terms)) {
+            if (t.term == term && t.prefix == prefix) return;
+        }
+        terms.append({term, prefix});
+    };
+    segment(query, [&](const QList<uint> &run) {
+        if (run.size() == 1) push(fromUcs4(run.constData(), 1), true);
+        for (qsizetype i = 0; i + 1 < run.size(); ++i) push(fromUcs4(run.constData() + i, 2), false);
+        endsWithWord = false;
+    }, [&](const QList<uint> &word) {
+        push(fromUcs4(word.constData(), word.size()), false);
+        endsWithWord = true;
+    });
+
+    if (endsWithWord && !query.isEmpty() && query.back().isLetterOrNumber()) terms.last().prefix = true;
+    return terms;
+}
+
+template<typename T>
+bool readRaw(QDataStream &in, QVector<T> &data, quint32 size)
+{
+    qint64 bytes = qint64(size) * qint64(sizeof(T));
+    if (bytes > in.device()->bytesAvailable()) return false;
+    data.resize(size);
+    return in.readRawData(reinterpret_cast<char *>(data.data()), bytes) == bytes;
+}
+
+template<typename T>
+void writeRaw(QDataStream &out, const QVector<T> &data)
+{
+    out.writeRawData(reinterpret_cast<const char *>(data.constData()), data.size() * qsizetype(sizeof(T)));
+}
+
+}
+
+quint32 TextIndex::conversationSlot(const QString &conversationId)
+{
+    auto it = m_conversationSlots.constFind(conversationId);
+    if (it != m_conversationSlots.cend()) return *it;
+
+    quint32 slot = m_conversations.size();
+    m_conversationSlots.insert(conversationId, slot);
+    m_conversations.append(conversationId);
+    m_clearedBelow.append(0);
+    return slot;
+}
+
+void TextIndex::addTerm(const QString &term)
+{
+    m_newTerms.append(term);
+    // 新词攒到一定比例再归并，构建时总代价接近一次排序
+    if (m_newTerms.size() < qMax<qsizetype>(NEW_TERMS_MERGE_MIN, m_terms.size() / 8)) return;
+
+    std::sort(m_newTerms.begin(), m_newTerms.end());
+    QStringList merged;
+    merged.reserve(m_terms.size() + m_newTerms.size());
+    std::merge(m_terms.cbegin(), m_terms.cend(), m_newTerms.cbegin(), m_newTerms.cend(),
+               std::back_inserter(merged));
+    m_terms = merged;
+    m_newTerms.clear();
+}
+
+void TextIndex::add(const QString &conversationId, qint64 id, const QString &text)
+{
+    const QStringList terms = documentTerms(text);
+    if (terms.isEmpty()) return;
+
+    quint32 doc = m_docs.size();
+    m_docs.append({id, conversationSlot(conversationId), quint32(terms.size())});
+    m_totalLength += terms.size();
+
+    for (const QString &term : terms) {
+        auto it = m_postings.find(term);
+        if (it == m_postings.end()) {
+            it = m_postings.insert(term, QVector<Posting>());
+            addTerm(term);
+        }
+        // 文档号递增分配，倒排表天然有序
+        QVector<Posting> &list = it.value();
+        if (!list.isEmpty() && list.last().doc == doc) list.last().tf++;
+        else list.append({doc, 1});
+    }
+}
+
+void TextIndex::clearConversation(const QString &conversationId)
+{
+    auto it = m_conversationSlots.constFind(conversationId);
+    if (it == m_conversationSlots.cend()) return;
+    m_clearedBelow[*it] = m_docs.size();
+}
+
+QStringList TextIndex::expand(const QString &prefix, int limit) const
+{
+    QStringList terms;
+    auto it = std::lower_bound(m_terms.cbegin(), m_terms.cend(), prefix);
+    for (; it != m_terms.cend() && terms.size() < limit && it->startsWith(prefix); ++it) terms.append(*it);
+    for (const QString &term : m_newTerms) {
+        if (terms.size() >= limit) break;
+        if (term.startsWith(prefix)) terms.append(term);
+    }
+    return terms;
+}
+
+QVector<TextIndex::Hit> TextIndex::search(const QString &query, int limit, const QString &conversationId) const
+{
+    QVector<Hit> hits;
+    const QVector<QueryTerm> terms = queryTerms(query);
+    if (terms.isEmpty() || m_docs.isEmpty() || limit <= 0) return hits;
+
+    const quint32 anyConversation = std::numeric_limits<quint32>::max();
+    quint32 only = anyConversation;
+    if (!conversationId.isEmpty()) {
+        auto found = m_conversationSlots.constFind(conversationId);
+        if (found == m_conversationSlots.cend()) return hits;
+        only = *found;
+    }
+
+    auto byDoc = [](const Posting &a, const Posting &b) { return a.doc < b.doc; };
+
+    // 每个查询词一张倒排表；前缀词把展开出的多张表按文档号合并
+    struct Group {
+        QVector<Posting> list;
+        double idf;
+    };
+    QVector<Group> groups;
+    const double total = m_docs.size();
+    for (const QueryTerm &term : terms) {
+        Group group;
+        if (!term.prefix) {
+            group.list = m_postings.value(term.term);
+        } else {
+            for (const QString &t : expand(term.term, PREFIX_EXPANSION_LIMIT)) group.list += m_postings.value(t);
+            std::sort(group.list.begin(), group.list.end(), byDoc);
+            int out = 0;
+            for (int i = 0; i < group.list.size(); ++i) {
+                if (out > 0 && group.list[out - 1].doc == group.list[i].doc) group.list[out - 1].tf += group.list[i].tf;
+                else group.list[out++] = group.list[i];
+            }
+            group.list.resize(out);
+        }
+        if (group.list.isEmpty()) return hits;
+
+        double df = group.list.size();
+        group.idf = std::log(1.0 + (total - df + 0.5) / (df + 0.5));
+        groups.append(group);
+    }
+
+    // 从最短的表出发，在其余表中沿游标二分查找
+    std::sort(groups.begin(), groups.end(),
+              [](const Group &a, const Group &b) { return a.list.size() < b.list.size(); });
+    QVector<const Posting *> cursors(groups.size());
+    for (int i = 0; i < groups.size(); ++i) cursors[i] = groups[i].list.constData();
+
+    const double averageLength = double(m_totalLength) / total;
+    auto weight = [averageLength](const Group &group, quint32 tf, quint32 length) {
+        double norm = BM25_K1 * (1.0 - BM25_B + BM25_B * length / averageLength);
+        return group.idf * tf * (BM25_K1 + 1.0) / (tf + norm);
+    };
+
+    struct Candidate {
+        quint32 doc;
+        double score;
+    };
+    QVector<Candidate> candidates;
+    bool exhausted = false;
+    for (const Posting &posting : groups.first().list) {
+        const Doc &doc = m_docs.at(posting.doc);
+        if (only != anyConversation && doc.conversation != only) continue;
+        if (posting.doc < m_clearedBelow.at(doc.conversation)) continue;
+
+        double score = weight(groups.first(), posting.tf, doc.length);
+        bool matched = true;
+        for (int i = 1; i < groups.size() && matched; ++i) {
+            const Posting *end = groups[i].list.constData() + groups[i].list.size();
+            cursors[i] = std::lower_bound(cursors[i], end, posting, byDoc);
+            if (cursors[i] == end) {
+                exhausted = true;
+                matched = false;
+            } else if (cursors[i]->doc != posting.doc) {
+                matched = false;
+            } else {
+                score += weight(groups[i], cursors[i]->tf, doc.length);
+            }
+        }
+        if (matched) candidates.append({posting.doc, score});
+        if (exhausted) break;
+    }
+
+    int count = qMin<qsizetype>(limit, candidates.size());
+    std::partial_sort(candidates.begin(), candidates.begin() + count, candidates.end(),
+                      [](const Candidate &a, const Candidate &b) {
+        return a.score != b.score ? a.score > b.score : a.doc > b.doc;
+    });
+
+    hits.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        const Doc &doc = m_docs.at(candidates.at(i).doc);
+        hits.append({m_conversations.at(doc.conversation), doc.id, float(candidates.at(i).score)});
+    }
+    return hits;
+}
+
+void TextIndex::detach()
+{
+    m_docs.detach();
+    m_conversations.detach();
+    m_conversationSlots.detach();
+    m_clearedBelow.detach();
+    m_terms.detach();
+    m_newTerms.detach();
+    for (auto it = m_postings.begin(); it != m_postings.end(); ++it) it->detach();
+}
+
+bool TextIndex::save(const QString &path, qint64 covered) const
+{
+    static_assert(sizeof(Doc) == 16 && sizeof(Posting) == 8, "search index layout changed");
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) return false;
+
+    // 文档表与倒排表按本机字节序整块写入，快照只在本机使用
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << INDEX_MAGIC << INDEX_VERSION << covered << m_totalLength
+        << m_conversations << m_clearedBelow << quint32(m_docs.size());
+    writeRaw(out, m_docs);
+
+    out << quint32(m_postings.size());
+    for (auto it = m_postings.cbegin(); it != m_postings.cend(); ++it) {
+        out << it.key() << quint32(it->size());
+        writeRaw(out, it.value());
+    }
+
+    return out.status() == QDataStream::Ok && file.commit();
+}
+
+bool TextIndex::load(const QString &path, qint64 *covered)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return false;
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_6_0);
+
+    quint32 magic, version, docs, terms;
+    in >> magic >> version;
+    if (magic != INDEX_MAGIC || version != INDEX_VERSION) return false;
+
+    TextIndex loaded;
+    in >> *covered >> loaded.m_totalLength >> loaded.m_conversations >> loaded.m_clearedBelow >> docs;
+    if (in.status() != QDataStream::Ok || loaded.m_clearedBelow.size() != loaded.m_conversations.size()) return false;
+    if (!readRaw(in, loaded.m_docs, docs)) return false;
+
+    in >> terms;
+    loaded.m_postings.reserve(terms);
+    loaded.m_terms.reserve(terms);
+    for (quint32 i = 0; i < terms && in.status() == QDataStream::Ok; ++i) {
+        QString term;
+        quint32 size;
+        in >> term >> size;
+        if (!readRaw(in, loaded.m_postings[term], size)) return false;
+        loaded.m_terms.append(term);
+    }
+    if (in.status() != QDataStream::Ok) return false;
+
+    for (int i = 0; i < loaded.m_conversations.size(); ++i) {
+        loaded.m_conversationSlots.insert(loaded.m_conversations.at(i), i);
+    }
+    std::sort(loaded.m_terms.begin(), loaded.m_terms.end());
+    *this = loaded;
+    return true;
+}
+
+SearchIndex* SearchIndex::s_instance = nullptr;
+
+SearchIndex::SearchIndex(QObject *parent)
+    : QObject(parent)
+    , m_generation(0)
+    , m_building(false)
+    , m_copying(false)
+    , m_unsaved(0)
+{
+    // 构建与保存串行执行，保存不会和构建读写同一个快照
+    m_pool.setMaxThreadCount(1);
+
+    auto store = MessageStore::instance();
+    connect(store, &MessageStore::opened, this, &SearchIndex::onOpened);
+    connect(store, &MessageStore::closing, this, &SearchIndex::onClosing);
+    connect(store, &MessageStore::messageStored, this, &SearchIndex::onStored);
+    connect(store, &MessageStore::conversationCleared, this, &SearchIndex::onCleared);
+    if (store->isOpen()) onOpened();
+}
+
+SearchIndex* SearchIndex::instance()
+{
+    if (!s_instance) s_instance = new SearchIndex();
+    return s_instance;
+}
+
+SearchIndex* SearchIndex::create(QQmlEngine*, QJSEngine*)
+{
+    return instance();
+}
+
+QString SearchIndex::messageText(const QJsonObject &message)
+{
+    if (message["type"].toString("text") != "text") return QString();
+    return message["content"].toString();
+}
+
+QVector<TextIndex::Hit> SearchIndex::hits(const QString &query, int limit, const QString &conversationId) const
+{
+    QElapsedTimer timer;
+    timer.start();
+    QVector<TextIndex::Hit> result = m_index.search(query, limit, conversationId);
+    ATCHAT_TRACE("search.query", result.size(), timer.nsecsElapsed() / 1000);
+    return result;
+}
+
+QVariantList SearchIndex::search(const QString &query, int limit, const QString &conversationId) const
+{
+    QVariantList list;
+    auto store = MessageStore::instance();
+    for (const TextIndex::Hit &hit : hits(query, limit, conversationId)) {
+        QJsonObject message = store->message(hit.conversationId, hit.messageId);
+        if (message.isEmpty()) continue;
+
+        QVariantMap entry;
+        entry["conversationId"] = hit.conversationId;
+        entry["messageId"] = hit.messageId;
+        entry["from"] = message["from"].toString();
+        entry["content"] = messageText(message);
+        entry["time"] = MessageUtils::timestamp(message["timestamp"]).toString("yyyy-MM-dd hh:mm");
+        entry["score"] = hit.score;
+        list.append(entry);
+    }
+    return list;
+}
+
+SearchIndex::Built SearchIndex::build(const QString &indexPath, const QString &logPath, qint64 logSize,
+                                      const std::shared_ptr<std::atomic_bool> &cancelled)
+{
+    Built built;
+    qint64 covered = 0;
+    if (!built.index.load(indexPath, &covered) || covered > logSize) {
+        built.index = TextIndex();
+        covered = 0;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    int replayed = 0;
+    MessageStore::scanFile(logPath, covered, logSize,
+                           [&](qint64, qint64 id, const QString &conv, const QByteArray &payload) {
+        if (*cancelled) return false;
+        if (id == 0) {
+            built.index.clearConversation(conv);
+        } else {
+            QString text = messageText(QCborValue::fromCbor(payload).toJsonValue().toObject());
+            if (!text.isEmpty()) built.index.add(conv, id, text);
+        }
+        replayed++;
+        return true;
+    });
+
+    built.dirty = replayed > 0;
+    qCInfo(lcStore) << "search index replayed" << replayed << "records in" << timer.elapsed() << "ms";
+    return built;
+}
+
+void SearchIndex::onOpened()
+{
+    auto store = MessageStore::instance();
+    m_indexPath = store->directory() + "/search.dat";
+    m_index = TextIndex();
+    m_pending.clear();
+    m_unsaved = 0;
+    m_copying = false;
+    m_cancelled = std::make_shared<std::atomic_bool>(false);
+    quint64 generation = ++m_generation;
+    setBuilding(true);
+    emit countChanged();
+
+    auto watcher = new QFutureWatcher<Built>(this);
+    connect(watcher, &QFutureWatcher<Built>::finished, this, [this, watcher, generation]() {
+        watcher->deleteLater();
+        // 构建期间账号已切换，结果作废
+        if (generation != m_generation) return;
+        onBuilt(watcher->result());
+    });
+    watcher->setFuture(QtConcurrent::run(&m_pool, &SearchIndex::build, m_indexPath, store->logPath(),
+                                         store->logSize(), m_cancelled));
+}
+
+void SearchIndex::onBuilt(const Built &built)
+{
+    m_index = built.index;
+    bool dirty = built.dirty || !m_pending.isEmpty();
+    applyPending();
+
+    qCInfo(lcStore) << "search index ready:" << m_index.size() << "messages";
+    setBuilding(false);
+    emit countChanged();
+    if (dirty) save();
+}
+
+void SearchIndex::applyPending()
+{
+    // 排队的操作都在快照之后写入日志，按原顺序补上
+    for (const PendingOp &op : std::as_const(m_pending)) {
+        if (op.id == 0) m_index.clearConversation(op.conversationId);
+        else m_index.add(op.conversationId, op.id, op.text);
+    }
+    m_pending.clear();
+}
+
+void SearchIndex::onSnapshotCopied(quint64 generation)
+{
+    if (generation != m_generation) return;
+    m_copying = false;
+    m_unsaved += m_pending.size();
+    applyPending();
+    emit countChanged();
+}
+
+void SearchIndex::onClosing()
+{
+    if (m_building) *m_cancelled = true;
+    else if (m_unsaved > 0) save();
+    m_generation++;
+
+    // 等最后一次保存写完，下一个账号打开时不会读到半截快照
+    m_pool.waitForDone();
+    m_index = TextIndex();
+    m_pending.clear();
+    m_unsaved = 0;
+    m_copying = false;
+    setBuilding(false);
+    emit countChanged();
+}
+
+void SearchIndex::onStored(const QString &conversationId, qint64 id, const QJsonObject &message)
+{
+    QString text = messageText(message);
+    if (text.isEmpty()) return;
+
+    if (m_building || m_copying) {
+        m_pending.append({conversationId, id, text});
+        return;
+    }
+    m_index.add(conversationId, id, text);
+    emit countChanged();
+    if (++m_unsaved >= SAVE_INTERVAL) save();
+}
+
+void SearchIndex::onCleared(const QString &conversationId)
+{
+    if (m_building || m_copying) {
+        m_pending.append({conversationId, 0, QString()});
+        return;
+    }
+    m_index.clearConversation(conversationId);
+    m_unsaved++;
+}
+
+void SearchIndex::setBuilding(bool building)
+{
+    if (m_building == building) return;
+    m_building = building;
+    emit buildingChanged();
+}
+
+void SearchIndex::save()
+{
+    auto store = MessageStore::instance();
+    if (m_building || m_copying || !store->isOpen()) return;
+
+    // 这里只增加引用计数。深复制在后台完成，复制期间主线程不修改索引，否则下一次 add
+    // 会在主线程上分离整个索引；复制完成后共享的引用随即释放，主线程重新独占
+    TextIndex shared = m_index;
+    QString path = m_indexPath;
+    qint64 covered = store->logSize();
+    quint64 generation = m_generation;
+    m_unsaved = 0;
+    m_copying = true;
+    m_pool.start([this, shared, path, covered, generation]() mutable {
+        TextIndex snapshot = shared;
+        snapshot.detach();
+        shared = TextIndex();
+        QMetaObject::invokeMethod(this, [this, generation]() { onSnapshotCopied(generation); },
+                                  Qt::QueuedConnection);
+        if (!snapshot.save(path, covered)) qCWarning(lcStore) << "cannot save search index" << path;
+    });
+}
@@ -0,0 +1,132 @@
+#ifndef SEARCHINDEX_H
+#define SEARCHINDEX_H
+
+#include <QObject>
+#include <QHash>
+#include <QVector>
+#include <QStringList>
+#include <QThreadPool>
+#include <QJsonObject>
+#include <QVariantList>
+#include <QQmlEngine>
+#include <atomic>
+#include <memory>
+
+// 聊天记录的倒排索引。中日韩文字按相邻两字切分，行尾单字另记一项以支持单字前缀查询；
+// 其他文字按单词切分并折叠大小写。查询的所有词都必须命中，按 BM25 排序，同分时新消息在前。
+// 纯数据结构，不涉及线程：后台构建与主线程的增量更新各自持有一份。
+class TextIndex
+{
+public:
+    struct Hit {
+        QString conversationId;
+        qint64 messageId;
+        float score;
+    };
+
+    void add(const QString &conversationId, qint64 id, const QString &text);
+    // 会话之前的文档只做删除标记，倒排表不回收
+    void clearConversation(const QString &conversationId);
+    // conversationId 为空时搜索全部会话
+    QVector<Hit> search(const QString &query, int limit, const QString &conversationId = QString()) const;
+    int size() const { return m_docs.size(); }
+
+    // 复制出不与其他实例共享任何数据的一份，包括每张倒排表
+    void detach();
+
+    bool save(const QString &path, qint64 covered) const;
+    bool load(const QString &path, qint64 *covered);
+
+private:
+    struct Doc {
+        qint64 id;
+        quint32 conversation;
+        quint32 length;
+    };
+
+    struct Posting {
+        quint32 doc;
+        quint32 tf;
+    };
+
+    quint32 conversationSlot(const QString &conversationId);
+    void addTerm(const QString &term);
+    // 前缀展开：返回所有以 prefix 开头的词，最多 limit 个
+    QStringList expand(const QString &prefix, int limit) const;
+
+    QVector<Doc> m_docs;
+    QStringList m_conversations;
+    QHash<QString, quint32> m_conversationSlots;
+    QVector<quint32> m_clearedBelow;            // 每个会话中文档号小于该值的已被清空
+    QHash<QString, QVector<Posting>> m_postings;
+    QStringList m_terms;                        // 有序，用于前缀展开
+    QStringList m_newTerms;                     // 尚未并入 m_terms 的新词
+    qint64 m_totalLength = 0;
+};
+
+// 本地全文搜索：跟随 MessageStore 的日志增量更新，索引快照保存在账号目录下。
+// 打开账号时在后台加载快照并补扫快照之后的日志，期间新到的消息先排队，构建完成后按日志顺序补上。
+// 保存快照时由后台线程复制索引，复制完成前的修改同样排队，主线程不会因写时复制而分离整个索引。
+class SearchIndex : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(bool building READ building NOTIFY buildingChanged)
+    Q_PROPERTY(int count READ count NOTIFY countChanged)
+
+public:
+    static SearchIndex* instance();
+    static SearchIndex* create(QQmlEngine*, QJSEngine*);
+
+    bool building() const { return m_building; }
+    int count() const { return m_index.size(); }
+
+    QVector<TextIndex::Hit> hits(const QString &query, int limit, const QString &conversationId = QString()) const;
+    // 返回 [{conversationId, messageId, from, content, time, score}]，构建期间结果不完整
+    Q_INVOKABLE QVariantList search(const QString &query, int limit = 50,
+                                    const QString &conversationId = QString()) const;
+
+    static QString messageText(const QJsonObject &message);
+
+signals:
+    void buildingChanged();
+    void countChanged();
+
+private:
+    struct PendingOp {
+        QString conversationId;
+        qint64 id;                  // 0 表示清空会话
+        QString text;
+    };
+
+    struct Built {
+        TextIndex index;
+        bool dirty = false;
+    };
+
+    explicit SearchIndex(QObject *parent = nullptr);
+
+    static Built build(const QString &indexPath, const QString &logPath, qint64 logSize,
+                       const std::shared_ptr<std::atomic_bool> &cancelled);
+    void onOpened();
+    void onClosing();
+    void onStored(const QString &conversationId, qint64 id, const QJsonObject &message);
+    void onCleared(const QString &conversationId);
+    void onBuilt(const Built &built);
+    void onSnapshotCopied(quint64 generation);
+    void applyPending();
+    void setBuilding(bool building);
+    void save();
+
+    static SearchIndex *s_instance;
+    QThreadPool m_pool;
+    TextIndex m_index;
+    QVector<PendingOp> m_pending;
+    QString m_indexPath;
+    quint64 m_generation;
+    std::shared_ptr<std::atomic_bool> m_cancelled;
+    bool m_building;
+    bool m_copying;                 // 后台正在复制快照，期间的修改先排队
+    int m_unsaved;
+};
+
+#endif
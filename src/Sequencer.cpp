@@ -0,0 +1,236 @@
+#include "Sequencer.h"
+#include "Logging.h"
+#include "Trace.h"
+#include "MessageUtils.h"
+
+namespace {
+
+const int DEFAULT_WINDOW_MS = 300;
+const int CHECK_INTERVAL_MS = 100;
+const int MAX_HELD = 256;           // 超过后不再等待窗口，立即补拉
+const int MAX_FILL = 200;           // 单次补拉的条数上限，剩余部分在结果回来后继续
+const int MAX_ATTEMPTS = 3;
+
+}
+
+Sequencer::Sequencer(QObject *parent)
+    : QObject(parent)
+    , m_windowMs(DEFAULT_WINDOW_MS)
+    , m_reordered(0)
+    , m_duplicates(0)
+    , m_gapFetches(0)
+    , m_skipped(0)
+{
+    m_clock.start();
+    m_gapTimer.setInterval(CHECK_INTERVAL_MS);
+    connect(&m_gapTimer, &QTimer::timeout, this, &Sequencer::checkGaps);
+}
+
+QString Sequencer::conversationFor(const QJsonObject &message) const
+{
+    QString groupId = message["group_id"].toString();
+    if (!groupId.isEmpty()) return groupId;
+
+    QString from = message["from"].toString();
+    return from == m_selfId ? message["to"].toString() : from;
+}
+
+Sequencer::Stream &Sequencer::stream(const QString &conversationId, bool group)
+{
+    Stream &s = m_streams[conversationId];
+    s.group = group;
+    // held 不为空说明已经查过，本地没有记录
+    if (s.nextSeq == 0 && s.held.isEmpty() && m_baseline) {
+        QJsonObject last = m_baseline(conversationId);
+        qint64 lastSeq = last["seq"].toInteger();
+        if (lastSeq > 0) {
+            s.nextSeq = lastSeq + 1;
+            s.lastId = MessageUtils::messageId(last);
+        }
+    }
+    return s;
+}
+
+void Sequencer::anchor(Stream &s)
+{
+    // 之前的历史由分页加载负责，不补拉
+    s.nextSeq = s.held.firstKey();
+    ATCHAT_TRACE("order.anchor", s.nextSeq, s.held.size());
+    drain(s);
+}
+
+void Sequencer::push(const QJsonObject &message)
+{
+    qint64 seq = message["seq"].toInteger();
+    if (seq <= 0) {
+        emit ready(message);
+        return;
+    }
+
+    QString conversationId = conversationFor(message);
+    Stream &s = stream(conversationId, !message["group_id"].toString().isEmpty());
+    accept(s, message, seq);
+    drain(s);
+    if (s.nextSeq == 0 && s.held.size() > MAX_HELD) anchor(s);
+    if (s.held.isEmpty()) return;
+
+    if (s.held.size() > MAX_HELD && !s.fetching) requestFill(conversationId, s);
+    if (!m_gapTimer.isActive()) m_gapTimer.start();
+}
+
+void Sequencer::advance(const QString &conversationId, bool group, qint64 seq, qint64 id)
+{
+    if (seq <= 0 || conversationId.isEmpty()) return;
+
+    Stream &s = stream(conversationId, group);
+    // 重发后的重复 ack
+    if (seq < s.nextSeq || s.held.contains(seq)) return;
+
+    s.own.insert(seq);
+    accept(s, QJsonObject{{"id", id}, {"seq", seq}}, seq);
+    drain(s);
+    if (!s.held.isEmpty() && !m_gapTimer.isActive()) m_gapTimer.start();
+}
+
+void Sequencer::accept(Stream &s, const QJsonObject &message, qint64 seq)
+{
+    if (seq < s.nextSeq || s.held.contains(seq)) {
+        m_duplicates++;
+        ATCHAT_TRACE("order.duplicate", seq, s.nextSeq);
+        return;
+    }
+    // 会话的 seq 从 1 开始，第一条之前不会再有消息
+    if (s.nextSeq == 0 && seq == 1) s.nextSeq = 1;
+    if (seq == s.nextSeq) {
+        release(s, message, seq);
+        return;
+    }
+    if (s.held.isEmpty()) s.heldSince = m_clock.elapsed();
+    s.held.insert(seq, message);
+    ATCHAT_TRACE("order.hold", seq, s.nextSeq);
+}
+
+void Sequencer::release(Stream &s, const QJsonObject &message, qint64 seq)
+{
+    s.nextSeq = seq + 1;
+    s.lastId = qMax(s.lastId, MessageUtils::messageId(message));
+    if (s.own.remove(seq)) return;
+    emit ready(message);
+}
+
+void Sequencer::drain(Stream &s)
+{
+    while (!s.held.isEmpty() && s.held.firstKey() <= s.nextSeq) {
+        qint64 seq = s.held.firstKey();
+        QJsonObject message = s.held.take(seq);
+        if (seq < s.nextSeq) {
+            s.own.remove(seq);
+            continue;
+        }
+        if (!s.own.contains(seq)) m_reordered++;
+        release(s, message, seq);
+    }
+    if (s.held.isEmpty()) {
+        s.heldSince = 0;
+        s.attempts = 0;
+    }
+}
+
+void Sequencer::requestFill(const QString &conversationId, Stream &s)
+{
+    s.fetching = true;
+    s.attempts++;
+    m_gapFetches++;
+
+    qint64 beforeId = MessageUtils::messageId(s.held.first());
+    int missing = int(qMin<qint64>(s.held.firstKey() - s.nextSeq, MAX_FILL));
+    qCInfo(lcWs) << "gap in" << conversationId << "seq" << s.nextSeq << "to" << s.held.firstKey() - 1
+                 << "attempt" << s.attempts;
+    ATCHAT_TRACE("order.gap", s.nextSeq, missing, conversationId);
+    emit gapDetected(conversationId, s.group, s.lastId, beforeId, missing);
+}
+
+void Sequencer::fill(const QString &conversationId, const QJsonArray &messages, bool ok)
+{
+    auto it = m_streams.find(conversationId);
+    if (it == m_streams.end()) return;
+    Stream &s = it.value();
+    s.fetching = false;
+
+    qint64 start = s.nextSeq;
+    for (const QJsonValue &value : messages) {
+        QJsonObject message = value.toObject();
+        qint64 seq = message["seq"].toInteger();
+        if (seq >= s.nextSeq && !s.held.contains(seq)) s.held.insert(seq, message);
+    }
+    drain(s);
+    if (s.held.isEmpty()) return;
+
+    // 补上了一部分（超过单次上限），接着补剩下的
+    if (s.nextSeq > start) {
+        s.attempts = 0;
+        requestFill(conversationId, s);
+        return;
+    }
+    if (!ok && s.attempts < MAX_ATTEMPTS) {
+        s.heldSince = m_clock.elapsed();
+        if (!m_gapTimer.isActive()) m_gapTimer.start();
+        return;
+    }
+
+    // 服务器上也没有（已撤回或已删除），或多次补拉失败：跳过缺口，不让后面的消息一直等下去
+    qint64 skipped = s.held.firstKey() - s.nextSeq;
+    m_skipped += skipped;
+    qCWarning(lcWs) << "skipping" << skipped << "missing messages in" << conversationId;
+    ATCHAT_TRACE("order.skip", s.nextSeq, skipped, conversationId);
+    s.nextSeq = s.held.firstKey();
+    drain(s);
+}
+
+void Sequencer::checkGaps()
+{
+    qint64 now = m_clock.elapsed();
+    bool waiting = false;
+    QStringList anchoring;
+    for (auto it = m_streams.begin(); it != m_streams.end(); ++it) {
+        Stream &s = it.value();
+        if (s.held.isEmpty()) continue;
+        waiting = true;
+        if (now - s.heldSince < m_windowMs) continue;
+        if (s.nextSeq == 0) {
+            anchoring.append(it.key());
+        } else if (!s.fetching) {
+            requestFill(it.key(), s);
+        }
+    }
+    // ready 的处理可能再推入消息，遍历结束后再放行
+    for (const QString &conversationId : std::as_const(anchoring)) {
+        auto it = m_streams.find(conversationId);
+        if (it != m_streams.end() && it->nextSeq == 0 && !it->held.isEmpty()) anchor(it.value());
+    }
+    if (!waiting) m_gapTimer.stop();
+}
+
+void Sequencer::clear()
+{
+    m_streams.clear();
+    m_gapTimer.stop();
+}
+
+int Sequencer::bufferedCount() const
+{
+    int count = 0;
+    for (const Stream &s : m_streams) count += s.held.size();
+    return count;
+}
+
+QVariantMap Sequencer::stats() const
+{
+    QVariantMap map;
+    map["buffered"] = bufferedCount();
+    map["reordered"] = m_reordered;
+    map["duplicates"] = m_duplicates;
+    map["gapFetches"] = m_gapFetches;
+    map["skipped"] = m_skipped;
+    return map;
+}
@@ -0,0 +1,86 @@
+#ifndef SEQUENCER_H
+#define SEQUENCER_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QMap>
+#include <QSet>
+#include <QTimer>
+#include <QVariantMap>
+#include <functional>
+
+// 按会话把实时消息排回发送顺序：服务器为每个会话的消息分配连续的 seq，
+// 乱序到达的先放进重排缓冲，缺口在等待窗口内没有补上就按 id 区间补拉，而不是重新下载整段历史。
+// 没有 seq 的消息（旧服务器）原样放行；重复的 seq 直接丢弃。
+// 本地没有记录的会话没有起点，先到的几条同样等待一个窗口，以其中最小的 seq 为起点。
+class Sequencer : public QObject
+{
+    Q_OBJECT
+
+public:
+    // 会话最后一条已保存的消息，用作起点；返回空对象表示未知
+    using Baseline = std::function<QJsonObject(const QString &conversationId)>;
+
+    explicit Sequencer(QObject *parent = nullptr);
+
+    void setSelfId(const QString &userId) { m_selfId = userId; }
+    void setBaseline(const Baseline &baseline) { m_baseline = baseline; }
+    // 缺口等待多久后补拉，默认 300ms
+    void setReorderWindow(int ms) { m_windowMs = ms; }
+
+    QString conversationFor(const QJsonObject &message) const;
+
+    void push(const QJsonObject &message);
+    // 自己发出的消息服务器不会推回本连接，按 ack 带回的 seq 占位，界面已经显示过，不再发出 ready
+    void advance(const QString &conversationId, bool group, qint64 seq, qint64 id);
+    // gapDetected 的结果；ok 为 false 表示请求失败，稍后重试
+    void fill(const QString &conversationId, const QJsonArray &messages, bool ok);
+    void clear();
+
+    int bufferedCount() const;
+    // {buffered, reordered, duplicates, gapFetches, skipped}
+    QVariantMap stats() const;
+
+signals:
+    void ready(const QJsonObject &message);
+    // 需要补拉 id 在 (afterId, beforeId) 之间的 missing 条消息；afterId 为 0 时取 beforeId 之前最新的
+    void gapDetected(const QString &conversationId, bool group, qint64 afterId, qint64 beforeId, int missing);
+
+private:
+    struct Stream {
+        bool group = false;
+        qint64 nextSeq = 0;         // 0 表示还没有起点，收到的消息都在 held 中等待
+        qint64 lastId = 0;          // 最后放行的消息 id
+        QMap<qint64, QJsonObject> held;
+        QSet<qint64> own;           // held 中只是 ack 占位的 seq
+        qint64 heldSince = 0;       // 缓冲区开始等待的时刻，重试时顺延
+        bool fetching = false;
+        int attempts = 0;
+    };
+
+    Stream &stream(const QString &conversationId, bool group);
+    // 没有本地记录时，以等待期间收到的最小 seq 为起点
+    void anchor(Stream &s);
+    void accept(Stream &s, const QJsonObject &message, qint64 seq);
+    void release(Stream &s, const QJsonObject &message, qint64 seq);
+    void drain(Stream &s);
+    void requestFill(const QString &conversationId, Stream &s);
+    void checkGaps();
+
+    QString m_selfId;
+    Baseline m_baseline;
+    QHash<QString, Stream> m_streams;
+    QTimer m_gapTimer;
+    QElapsedTimer m_clock;
+    int m_windowMs;
+
+    quint64 m_reordered;
+    quint64 m_duplicates;
+    quint64 m_gapFetches;
+    quint64 m_skipped;
+};
+
+#endif
@@ -0,0 +1,143 @@
+#include "Trace.h"
+#include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <atomic>
+#include <cstring>
+
+namespace {
+
+const quint64 CAPACITY = 4096;     // 必须是 2 的幂
+const quint64 MASK = CAPACITY - 1;
+const int DETAIL_SIZE = 40;
+
+// seq 为奇数表示正在写入，写完为 ticket * 2 + 2；读取方据此丢弃被覆盖或未写完的槽
+struct Slot {
+    std::atomic<quint64> seq{0};
+    qint64 nsecs;
+    const char *event;
+    qint64 a;
+    qint64 b;
+    quint32 thread;
+    char detail[DETAIL_SIZE];
+};
+
+Slot g_slots[CAPACITY];
+std::atomic<quint64> g_head{0};
+std::atomic<quint32> g_nextThread{0};
+
+struct Clock {
+    Clock()
+    {
+        startMs = QDateTime::currentMSecsSinceEpoch();
+        timer.start();
+    }
+    QElapsedTimer timer;
+    qint64 startMs;
+};
+
+const Clock &clock()
+{
+    static Clock c;
+    return c;
+}
+
+quint32 threadTag()
+{
+    thread_local quint32 tag = g_nextThread.fetch_add(1, std::memory_order_relaxed) + 1;
+    return tag;
+}
+
+}
+
+Trace::Trace(QObject *parent)
+    : QObject(parent)
+{
+}
+
+Trace* Trace::create(QQmlEngine*, QJSEngine*)
+{
+    return new Trace();
+}
+
+void Trace::record(const char *event, qint64 a, qint64 b, QStringView detail)
+{
+    qint64 nsecs = clock().timer.nsecsElapsed();
+    quint64 ticket = g_head.fetch_add(1, std::memory_order_relaxed);
+    Slot &slot = g_slots[ticket & MASK];
+
+    slot.seq.store(ticket * 2 + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot.nsecs = nsecs;
+    slot.event = event;
+    slot.a = a;
+    slot.b = b;
+    slot.thread = threadTag();
+    // 只保留 ASCII，避免在热路径上做编码转换
+    int n = qMin(int(detail.size()), DETAIL_SIZE - 1);
+    for (int i = 0; i < n; ++i) {
+        char16_t c = detail[i].unicode();
+        slot.detail[i] = c < 0x80 ? char(c) : '?';
+    }
+    slot.detail[n] = '\0';
+
+    slot.seq.store(ticket * 2 + 2, std::memory_order_release);
+}
+
+QString Trace::dump()
+{
+    const Clock &c = clock();
+    quint64 head = g_head.load(std::memory_order_acquire);
+    quint64 begin = head > CAPACITY ? head - CAPACITY : 0;
+
+    QString out;
+    out += QString("# trace start %1, %2 events, %3 kept\n")
+        .arg(QDateTime::fromMSecsSinceEpoch(c.startMs).toString(Qt::ISODateWithMs))
+        .arg(head)
+        .arg(head - begin);
+
+    for (quint64 ticket = begin; ticket < head; ++ticket) {
+        const Slot &slot = g_slots[ticket & MASK];
+        quint64 seq = slot.seq.load(std::memory_order_acquire);
+        if (seq != ticket * 2 + 2) continue;
+
+        qint64 nsecs = slot.nsecs;
+        const char *event = slot.event;
+        qint64 a = slot.a;
+        qint64 b = slot.b;
+        quint32 thread = slot.thread;
+        char detail[DETAIL_SIZE];
+        std::memcpy(detail, slot.detail, DETAIL_SIZE);
+        detail[DETAIL_SIZE - 1] = '\0';
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.seq.load(std::memory_order_relaxed) != seq) continue;
+
+        QDateTime at = QDateTime::fromMSecsSinceEpoch(c.startMs + nsecs / 1000000);
+        out += QString("%1 +%2us T%3 %4 %5 %6 %7\n")
+            .arg(at.toString("hh:mm:ss.zzz"))
+            .arg(nsecs / 1000)
+            .arg(thread)
+            .arg(QLatin1String(event))
+            .arg(a)
+            .arg(b)
+            .arg(QLatin1String(detail));
+    }
+    return out;
+}
+
+QString Trace::dumpToFile() const
+{
+    QString dir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/logs";
+    QDir().mkpath(dir);
+    QString path = dir + "/trace-" + QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss") + ".log";
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) return QString();
+    file.write(dump().toUtf8());
+    if (!file.commit()) return QString();
+    return path;
+}
@@ -0,0 +1,36 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <QObject>
+#include <QString>
+#include <QStringView>
+#include <QQmlEngine>
+
+// 内存环形缓冲区中的跟踪事件，写入无锁、不格式化字符串，
+// 只在需要时（例如崩溃窗口上报日志）导出为文本。
+// 定义 ATCHAT_NO_TRACE 时 ATCHAT_TRACE 在编译期去除。
+class Trace : public QObject
+{
+    Q_OBJECT
+
+public:
+    // event 必须是字符串字面量等静态存储的字符串，只保存指针
+    static void record(const char *event, qint64 a = 0, qint64 b = 0, QStringView detail = {});
+    static QString dump();
+
+    static Trace* create(QQmlEngine*, QJSEngine*);
+
+    // 把当前缓冲区写入 AppDataLocation/logs，返回文件路径，失败返回空串
+    Q_INVOKABLE QString dumpToFile() const;
+
+private:
+    explicit Trace(QObject *parent = nullptr);
+};
+
+#ifdef ATCHAT_NO_TRACE
+#define ATCHAT_TRACE(...) do { } while (false)
+#else
+#define ATCHAT_TRACE(...) Trace::record(__VA_ARGS__)
+#endif
+
+#endif
@@ -0,0 +1,440 @@
+#include "UploadManager.h"
+#include "NetworkManager.h"
+#include "Logging.h"
+#include "Trace.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QUuid>
+#include <QCryptographicHash>
+#include <QFutureWatcher>
+#include <QtConcurrent>
+
+namespace {
+
+const qint64 CHUNK_SIZE = 1024 * 1024;
+const int MAX_PARALLEL_CHUNKS = 3;
+const int MAX_CHUNK_RETRIES = 5;
+const int RATE_INTERVAL_MS = 1000;
+
+// 在线程池中执行，cancel 置位后尽快放弃
+QString hashFile(const QString &filePath, std::shared_ptr<std::atomic_bool> cancel)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) return QString();
+
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    QByteArray buffer(CHUNK_SIZE, Qt::Uninitialized);
+    while (!file.atEnd()) {
+        if (cancel->load()) return QString();
+        qint64 n = file.read(buffer.data(), buffer.size());
+        if (n < 0) return QString();
+        hash.addData(QByteArrayView(buffer.constData(), n));
+    }
+    return QString::fromLatin1(hash.result().toHex());
+}
+
+}
+
+UploadManager* UploadManager::s_instance = nullptr;
+
+UploadManager::UploadManager(QObject *parent)
+    : QObject(parent)
+{
+    auto net = NetworkManager::instance();
+    connect(net, &NetworkManager::uploadProgress, this, &UploadManager::onUploadProgress);
+
+    // 兼容旧接口：上传结果仍通过 NetworkManager 的信号通知
+    connect(this, &UploadManager::finished, net, [net](const QString &, const QJsonObject &fileInfo) {
+        emit net->fileUploaded(fileInfo);
+    });
+    connect(this, &UploadManager::failed, net, [net](const QString &, const QString &error) {
+        emit net->connectionError(error);
+    });
+
+    m_rateTimer.setInterval(RATE_INTERVAL_MS);
+    connect(&m_rateTimer, &QTimer::timeout, this, &UploadManager::updateThroughput);
+}
+
+UploadManager* UploadManager::instance()
+{
+    if (!s_instance) s_instance = new UploadManager();
+    return s_instance;
+}
+
+UploadManager* UploadManager::create(QQmlEngine*, QJSEngine*)
+{
+    return instance();
+}
+
+int UploadManager::activeCount() const
+{
+    int n = 0;
+    for (const Task &task : m_tasks) {
+        if (task.stage != Failed) n++;
+    }
+    return n;
+}
+
+QString UploadManager::upload(const QString &filePath)
+{
+    QFileInfo info(filePath);
+    Task task;
+    task.id = QUuid::createUuid().toString(QUuid::WithoutBraces);
+    task.filePath = filePath;
+    task.fileName = info.fileName();
+    task.size = info.size();
+    task.cancelHash = std::make_shared<std::atomic_bool>(false);
+    m_tasks.insert(task.id, task);
+    emit activeCountChanged();
+    ATCHAT_TRACE("upload.start", task.size, 0, task.id);
+
+    startHash(m_tasks[task.id]);
+    return task.id;
+}
+
+void UploadManager::startHash(Task &task)
+{
+    task.stage = Hashing;
+    QString taskId = task.id;
+    auto watcher = new QFutureWatcher<QString>(this);
+    connect(watcher, &QFutureWatcher<QString>::finished, this, [this, watcher, taskId]() {
+        watcher->deleteLater();
+        onHashed(taskId, watcher->result());
+    });
+    watcher->setFuture(QtConcurrent::run(hashFile, task.filePath, task.cancelHash));
+}
+
+void UploadManager::onHashed(const QString &taskId, const QString &sha256)
+{
+    auto it = m_tasks.find(taskId);
+    if (it == m_tasks.end()) return;
+
+    if (sha256.isEmpty()) {
+        fail(*it, tr("无法读取文件：%1").arg(it->fileName));
+        return;
+    }
+    it->sha256 = sha256;
+    init(*it);
+}
+
+void UploadManager::init(Task &task)
+{
+    task.stage = Initializing;
+
+    QJsonObject body;
+    body["file_name"] = task.fileName;
+    body["size"] = task.size;
+    body["sha256"] = task.sha256;
+    body["chunk_size"] = CHUNK_SIZE;
+
+    HttpRequest req;
+    req.verb = "POST";
+    req.path = "/api/upload/init";
+    req.body = QJsonDocument(body).toJson(QJsonDocument::Compact);
+
+    QString taskId = task.id;
+    task.controlRequest = NetworkManager::instance()->sendRequest(req, [this, taskId](const HttpResult &reply) {
+        m_requestTask.remove(reply.id);
+        auto it = m_tasks.find(taskId);
+        if (it == m_tasks.end() || it->controlRequest != reply.id) return;
+        Task &task = *it;
+        task.controlRequest = 0;
+
+        // 服务器没有分块接口
+        if (reply.status == 404 || reply.status == 405) {
+            uploadLegacy(task);
+            return;
+        }
+        auto data = reply.json.object();
+        if (!reply.ok() || !data["success"].toBool()) {
+            fail(task, data["error"].toString(reply.errorString));
+            return;
+        }
+
+        // 服务器已有相同内容的文件，无需上传
+        if (data["exists"].toBool()) {
+            ATCHAT_TRACE("upload.dedup", task.size, 0, taskId);
+            finish(taskId, data["file"].toObject());
+            return;
+        }
+
+        task.uploadId = data["upload_id"].toString();
+        task.chunkSize = data["chunk_size"].toInteger(CHUNK_SIZE);
+        if (task.uploadId.isEmpty() || task.chunkSize <= 0) {
+            fail(task, tr("上传初始化失败"));
+            return;
+        }
+
+        int chunkCount = int((task.size + task.chunkSize - 1) / task.chunkSize);
+        task.acked = QVector<bool>(chunkCount, false);
+        task.ackedBytes = 0;
+        for (const QJsonValue &v : data["received"].toArray()) {
+            int index = v.toInt(-1);
+            if (index < 0 || index >= chunkCount || task.acked[index]) continue;
+            task.acked[index] = true;
+            task.ackedBytes += chunkLength(task, index);
+        }
+        task.queue.clear();
+        for (int i = 0; i < chunkCount; ++i) {
+            if (!task.acked[i]) task.queue.append(i);
+        }
+
+        task.stage = Uploading;
+        task.lastBytes = task.ackedBytes;
+        task.rate = 0;
+        emit progress(taskId, task.ackedBytes, task.size);
+        startRateTimer();
+        pump(task);
+    });
+    m_requestTask.insert(task.controlRequest, task.id);
+}
+
+void UploadManager::uploadLegacy(Task &task)
+{
+    task.stage = Uploading;
+    task.ackedBytes = 0;
+    task.lastBytes = 0;
+    task.rate = 0;
+    startRateTimer();
+    QString taskId = task.id;
+    task.controlRequest = NetworkManager::instance()->uploadMultipart(task.filePath, [this, taskId](const HttpResult &reply) {
+        m_requestTask.remove(reply.id);
+        auto it = m_tasks.find(taskId);
+        if (it == m_tasks.end() || it->controlRequest != reply.id) return;
+        it->controlRequest = 0;
+
+        auto data = reply.json.object();
+        if (!reply.ok() || !data["success"].toBool()) {
+            fail(*it, data["error"].toString(reply.errorString));
+            return;
+        }
+        finish(taskId, data);
+    });
+    m_requestTask.insert(task.controlRequest, task.id);
+}
+
+void UploadManager::pump(Task &task)
+{
+    if (task.stage != Uploading) return;
+
+    while (task.inFlight.size() < MAX_PARALLEL_CHUNKS && !task.queue.isEmpty()) {
+        int index = task.queue.takeFirst();
+
+        HttpRequest req;
+        req.verb = "PUT";
+        req.path = QString("/api/upload/%1/chunks/%2").arg(task.uploadId).arg(index);
+        req.contentType = "application/octet-stream";
+        req.bodyFile = task.filePath;
+        req.bodyOffset = index * task.chunkSize;
+        req.bodyLength = chunkLength(task, index);
+
+        QString taskId = task.id;
+        quint64 id = NetworkManager::instance()->sendRequest(req, [this, taskId, index](const HttpResult &reply) {
+            onChunkFinished(taskId, index, reply);
+        });
+        task.inFlight.insert(id, index);
+        m_requestTask.insert(id, taskId);
+    }
+
+    if (task.inFlight.isEmpty() && task.queue.isEmpty()) complete(task);
+}
+
+void UploadManager::onChunkFinished(const QString &taskId, int index, const HttpResult &reply)
+{
+    m_requestTask.remove(reply.id);
+    auto it = m_tasks.find(taskId);
+    if (it == m_tasks.end()) return;
+    Task &task = *it;
+    // 已被取消或属于失败前的旧请求
+    if (!task.inFlight.remove(reply.id)) return;
+    task.inFlightSent.remove(index);
+
+    if (reply.ok() && reply.json.object()["success"].toBool()) {
+        if (!task.acked[index]) {
+            task.acked[index] = true;
+            task.ackedBytes += chunkLength(task, index);
+        }
+        ATCHAT_TRACE("upload.chunk", index, task.ackedBytes, taskId);
+        emit progress(taskId, sentBytes(task), task.size);
+        pump(task);
+        return;
+    }
+
+    // 单个分块失败只重试该分块，其它分块继续上传；
+    // 4xx（超时与限流除外）重试也不会成功，直接失败，由 resume() 重新初始化后续传
+    int attempt = ++task.retries[index];
+    qCWarning(lcNet) << "upload chunk failed" << taskId << index << "attempt" << attempt << reply.errorString;
+    bool transient = reply.status == 0 || reply.status >= 500 || reply.status == 408 || reply.status == 429;
+    if (!transient || attempt > MAX_CHUNK_RETRIES) {
+        fail(task, reply.json.object()["error"].toString(reply.errorString));
+        return;
+    }
+    emit progress(taskId, sentBytes(task), task.size);
+    QTimer::singleShot(500 << qMin(attempt, 5), this, [this, taskId, index]() {
+        auto it = m_tasks.find(taskId);
+        if (it == m_tasks.end() || it->stage != Uploading) return;
+        it->queue.prepend(index);
+        pump(*it);
+    });
+}
+
+void UploadManager::complete(Task &task)
+{
+    task.stage = Completing;
+
+    QJsonObject body;
+    body["sha256"] = task.sha256;
+
+    HttpRequest req;
+    req.verb = "POST";
+    req.path = QString("/api/upload/%1/complete").arg(task.uploadId);
+    req.body = QJsonDocument(body).toJson(QJsonDocument::Compact);
+
+    QString taskId = task.id;
+    task.controlRequest = NetworkManager::instance()->sendRequest(req, [this, taskId](const HttpResult &reply) {
+        m_requestTask.remove(reply.id);
+        auto it = m_tasks.find(taskId);
+        if (it == m_tasks.end() || it->controlRequest != reply.id) return;
+        it->controlRequest = 0;
+
+        auto data = reply.json.object();
+        if (!reply.ok() || !data["success"].toBool()) {
+            fail(*it, data["error"].toString(reply.errorString));
+            return;
+        }
+        finish(taskId, data);
+    });
+    m_requestTask.insert(task.controlRequest, task.id);
+}
+
+void UploadManager::cancel(const QString &taskId)
+{
+    auto it = m_tasks.find(taskId);
+    if (it == m_tasks.end()) return;
+
+    it->cancelHash->store(true);
+    abortRequests(*it);
+
+    // 通知服务器释放已收到的分块
+    if (!it->uploadId.isEmpty()) {
+        HttpRequest req;
+        req.verb = "DELETE";
+        req.path = QString("/api/upload/%1").arg(it->uploadId);
+        NetworkManager::instance()->sendRequest(req, NetworkManager::ReplyHandler());
+    }
+
+    m_tasks.erase(it);
+    ATCHAT_TRACE("upload.cancel", 0, 0, taskId);
+    emit cancelled(taskId);
+    emit activeCountChanged();
+}
+
+void UploadManager::resume(const QString &taskId)
+{
+    auto it = m_tasks.find(taskId);
+    if (it == m_tasks.end() || it->stage != Failed) return;
+
+    it->retries.clear();
+    emit activeCountChanged();
+    if (it->sha256.isEmpty()) {
+        startHash(*it);
+        return;
+    }
+    // 重新初始化，由服务器返回已收到的分块
+    init(*it);
+}
+
+void UploadManager::fail(Task &task, const QString &error)
+{
+    abortRequests(task);
+    task.stage = Failed;
+    task.queue.clear();
+    ATCHAT_TRACE("upload.fail", task.ackedBytes, 0, task.id);
+    qCWarning(lcNet) << "upload failed" << task.fileName << error;
+    emit failed(task.id, error);
+    emit activeCountChanged();
+}
+
+void UploadManager::finish(const QString &taskId, const QJsonObject &fileInfo)
+{
+    auto it = m_tasks.find(taskId);
+    if (it == m_tasks.end()) return;
+
+    qint64 size = it->size;
+    m_tasks.erase(it);
+    ATCHAT_TRACE("upload.done", size, 0, taskId);
+    emit progress(taskId, size, size);
+    emit finished(taskId, fileInfo);
+    emit activeCountChanged();
+}
+
+void UploadManager::abortRequests(Task &task)
+{
+    auto net = NetworkManager::instance();
+    for (auto it = task.inFlight.cbegin(); it != task.inFlight.cend(); ++it) {
+        m_requestTask.remove(it.key());
+        net->abortRequest(it.key());
+    }
+    task.inFlight.clear();
+    task.inFlightSent.clear();
+    if (task.controlRequest) {
+        m_requestTask.remove(task.controlRequest);
+        net->abortRequest(task.controlRequest);
+        task.controlRequest = 0;
+    }
+}
+
+qint64 UploadManager::sentBytes(const Task &task) const
+{
+    qint64 sent = task.ackedBytes;
+    for (qint64 bytes : task.inFlightSent) sent += bytes;
+    return sent;
+}
+
+qint64 UploadManager::chunkLength(const Task &task, int index) const
+{
+    return qMin(task.chunkSize, task.size - index * task.chunkSize);
+}
+
+void UploadManager::onUploadProgress(quint64 requestId, qint64 sent, qint64 total)
+{
+    auto taskId = m_requestTask.constFind(requestId);
+    if (taskId == m_requestTask.cend()) return;
+    auto it = m_tasks.find(*taskId);
+    if (it == m_tasks.end()) return;
+
+    // 旧接口整文件上传，进度直接对应整个文件
+    if (requestId == it->controlRequest) {
+        it->ackedBytes = total > 0 ? it->size * sent / total : 0;
+    } else {
+        int index = it->inFlight.value(requestId, -1);
+        if (index < 0) return;
+        it->inFlightSent.insert(index, sent);
+    }
+    emit progress(it->id, sentBytes(*it), it->size);
+}
+
+void UploadManager::startRateTimer()
+{
+    if (m_rateTimer.isActive()) return;
+    m_rateClock.start();
+    m_rateTimer.start();
+}
+
+void UploadManager::updateThroughput()
+{
+    double seconds = m_rateClock.restart() / 1000.0;
+    bool active = false;
+    for (auto it = m_tasks.begin(); it != m_tasks.end(); ++it) {
+        if (it->stage != Uploading) continue;
+        active = true;
+
+        qint64 sent = sentBytes(*it);
+        double current = seconds > 0 ? (sent - it->lastBytes) / seconds : 0;
+        // 指数平滑，避免分块完成时的跳变
+        it->rate = it->rate > 0 ? it->rate * 0.7 + current * 0.3 : current;
+        it->lastBytes = sent;
+        emit throughput(it->id, it->rate);
+    }
+    if (!active) m_rateTimer.stop();
+}
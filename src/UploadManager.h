@@ -0,0 +1,100 @@
+#ifndef UPLOADMANAGER_H
+#define UPLOADMANAGER_H
+
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QVector>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QQmlEngine>
+#include <atomic>
+#include <memory>
+
+struct HttpResult;
+
+// 分块上传：后台线程计算 SHA-256，服务器已有相同内容时直接秒传；
+// 否则按固定大小分块并发上传，失败的分块单独重试，
+// 断线后 resume() 向服务器查询已收到的分块，从断点继续。
+// 服务器不支持分块接口时退回到旧的整文件 multipart 上传。
+class UploadManager : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(int activeCount READ activeCount NOTIFY activeCountChanged)
+
+public:
+    static UploadManager* instance();
+    static UploadManager* create(QQmlEngine*, QJSEngine*);
+
+    int activeCount() const;
+
+    // 返回任务 id，后续信号都以此区分
+    Q_INVOKABLE QString upload(const QString &filePath);
+    Q_INVOKABLE void cancel(const QString &taskId);
+    Q_INVOKABLE void resume(const QString &taskId);
+
+signals:
+    void progress(const QString &taskId, qint64 sent, qint64 total);
+    void throughput(const QString &taskId, double bytesPerSecond);
+    void finished(const QString &taskId, const QJsonObject &fileInfo);
+    void failed(const QString &taskId, const QString &error);
+    void cancelled(const QString &taskId);
+    void activeCountChanged();
+
+private:
+    enum Stage {
+        Hashing,
+        Initializing,
+        Uploading,
+        Completing,
+        Failed
+    };
+
+    struct Task {
+        QString id;
+        QString filePath;
+        QString fileName;
+        qint64 size = 0;
+        QString sha256;
+        QString uploadId;
+        qint64 chunkSize = 0;
+        Stage stage = Hashing;
+        QVector<bool> acked;
+        QList<int> queue;
+        QHash<quint64, int> inFlight;       // 请求 id → 分块序号
+        QHash<int, qint64> inFlightSent;    // 分块序号 → 已发送字节
+        QHash<int, int> retries;
+        qint64 ackedBytes = 0;
+        quint64 controlRequest = 0;         // init / complete / 旧接口上传
+        std::shared_ptr<std::atomic_bool> cancelHash;
+        qint64 lastBytes = 0;
+        double rate = 0;
+    };
+
+    explicit UploadManager(QObject *parent = nullptr);
+
+    void startHash(Task &task);
+    void onHashed(const QString &taskId, const QString &sha256);
+    void init(Task &task);
+    void uploadLegacy(Task &task);
+    void pump(Task &task);
+    void onChunkFinished(const QString &taskId, int index, const HttpResult &reply);
+    void complete(Task &task);
+    void fail(Task &task, const QString &error);
+    void finish(const QString &taskId, const QJsonObject &fileInfo);
+    void abortRequests(Task &task);
+    qint64 sentBytes(const Task &task) const;
+    qint64 chunkLength(const Task &task, int index) const;
+    void onUploadProgress(quint64 requestId, qint64 sent, qint64 total);
+    void startRateTimer();
+    void updateThroughput();
+
+    static UploadManager *s_instance;
+    QHash<QString, Task> m_tasks;
+    QHash<quint64, QString> m_requestTask;
+    QTimer m_rateTimer;
+    QElapsedTimer m_rateClock;
+};
+
+#endif
@@ -0,0 +1,165 @@
+#include "WireCodec.h"
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QCborMap>
+#include <QCborStreamReader>
+
+namespace {
+
+const char COMPRESSED_MARKER = 0x01;
+// 解压后的上限，防止压缩炸弹
+const quint32 MAX_FRAME_SIZE = 16 * 1024 * 1024;
+
+QJsonValue readValue(QCborStreamReader &reader);
+
+QJsonArray readArray(QCborStreamReader &reader)
+{
+    QJsonArray array;
+    reader.enterContainer();
+    while (reader.lastError() == QCborError::NoError && reader.hasNext()) {
+        array.append(readValue(reader));
+    }
+    reader.leaveContainer();
+    return array;
+}
+
+QJsonObject readMap(QCborStreamReader &reader)
+{
+    QJsonObject object;
+    reader.enterContainer();
+    while (reader.lastError() == QCborError::NoError && reader.hasNext()) {
+        // 本协议的键总是字符串，其它类型的键直接跳过对应的键值
+        if (!reader.isString()) {
+            readValue(reader);
+            readValue(reader);
+            continue;
+        }
+        QString key = reader.readAllString();
+        object.insert(key, readValue(reader));
+    }
+    reader.leaveContainer();
+    return object;
+}
+
+QJsonValue readValue(QCborStreamReader &reader)
+{
+    QJsonValue value;
+    switch (reader.type()) {
+    case QCborStreamReader::UnsignedInteger:
+        value = qint64(reader.toUnsignedInteger());
+        reader.next();
+        break;
+    case QCborStreamReader::NegativeInteger:
+        value = -1 - qint64(quint64(reader.toNegativeInteger()));
+        reader.next();
+        break;
+    case QCborStreamReader::ByteArray:
+        value = QString::fromLatin1(reader.readAllByteArray().toBase64(QByteArray::Base64UrlEncoding
+                                                                       | QByteArray::OmitTrailingEquals));
+        break;
+    case QCborStreamReader::String:
+        value = reader.readAllString();
+        break;
+    case QCborStreamReader::Array:
+        value = readArray(reader);
+        break;
+    case QCborStreamReader::Map:
+        value = readMap(reader);
+        break;
+    case QCborStreamReader::Tag:
+        // 标签不影响 JSON 表示，直接读取被标记的值
+        reader.next();
+        value = readValue(reader);
+        break;
+    case QCborStreamReader::SimpleType:
+        if (reader.isTrue()) value = true;
+        else if (reader.isFalse()) value = false;
+        reader.next();
+        break;
+    case QCborStreamReader::Float16:
+        value = double(reader.toFloat16());
+        reader.next();
+        break;
+    case QCborStreamReader::Float:
+        value = double(reader.toFloat());
+        reader.next();
+        break;
+    case QCborStreamReader::Double:
+        value = reader.toDouble();
+        reader.next();
+        break;
+    default:
+        reader.next();
+        break;
+    }
+    return value;
+}
+
+}
+
+namespace WireCodec {
+
+QStringList subprotocols(bool binary, bool compress)
+{
+    QStringList protocols;
+    if (binary) {
+        if (compress) protocols << QLatin1String(cborSubprotocol()) + QLatin1String(deflateSuffix());
+        protocols << QLatin1String(cborSubprotocol());
+    }
+    if (compress) protocols << QLatin1String(jsonSubprotocol()) + QLatin1String(deflateSuffix());
+    protocols << QLatin1String(jsonSubprotocol());
+    return protocols;
+}
+
+Format formatForSubprotocol(const QString &subprotocol)
+{
+    return subprotocol.startsWith(QLatin1String(cborSubprotocol())) ? Cbor : Json;
+}
+
+bool compressionForSubprotocol(const QString &subprotocol)
+{
+    return subprotocol.endsWith(QLatin1String(deflateSuffix()));
+}
+
+QByteArray compressFrame(const QByteArray &frame)
+{
+    return COMPRESSED_MARKER + qCompress(frame);
+}
+
+bool isCompressedFrame(const QByteArray &frame)
+{
+    return !frame.isEmpty() && frame.at(0) == COMPRESSED_MARKER;
+}
+
+QByteArray decompressFrame(const QByteArray &frame)
+{
+    // qCompress 输出以 4 字节大端的原始长度开头，先检查再解压
+    if (frame.size() < 5) return QByteArray();
+    const uchar *p = reinterpret_cast<const uchar *>(frame.constData()) + 1;
+    quint32 size = (quint32(p[0]) << 24) | (quint32(p[1]) << 16) | (quint32(p[2]) << 8) | quint32(p[3]);
+    if (size > MAX_FRAME_SIZE) return QByteArray();
+    return qUncompress(p, frame.size() - 1);
+}
+
+QByteArray encode(const QJsonObject &message, Format format)
+{
+    if (format == Cbor) {
+        return QCborMap::fromJsonObject(message).toCborValue().toCbor();
+    }
+    return QJsonDocument(message).toJson(QJsonDocument::Compact);
+}
+
+QJsonObject decode(const QByteArray &frame, Format format)
+{
+    if (format == Json) {
+        return QJsonDocument::fromJson(frame).object();
+    }
+
+    QCborStreamReader reader(frame);
+    if (!reader.isMap()) return QJsonObject();
+    QJsonObject object = readMap(reader);
+    if (reader.lastError() != QCborError::NoError) return QJsonObject();
+    return object;
+}
+
+}
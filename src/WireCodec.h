@@ -0,0 +1,44 @@
+#ifndef WIRECODEC_H
+#define WIRECODEC_H
+
+#include <QByteArray>
+#include <QJsonObject>
+#include <QString>
+#include <QStringList>
+
+// WebSocket 帧编解码：默认 JSON 文本帧，握手协商成功后使用 CBOR 二进制帧。
+// QWebSocket 不支持 permessage-deflate，压缩在应用层完成：协商到带 +deflate 的子协议后，
+// 超过阈值的帧以二进制帧发送，首字节为压缩标记，其后是 qCompress 的输出。
+// CBOR 消息总是以 map 开头（首字节 0xa0 以上），JSON 模式下也不会出现其他二进制帧，标记不会混淆。
+namespace WireCodec {
+
+enum Format {
+    Json,
+    Cbor
+};
+
+// 握手时按优先级提供的子协议
+inline const char *cborSubprotocol() { return "atchat.cbor.v1"; }
+inline const char *jsonSubprotocol() { return "atchat.json.v1"; }
+inline const char *deflateSuffix() { return "+deflate"; }
+
+// 小于该长度的帧压缩收益不抵开销，按原样发送
+const int COMPRESSION_THRESHOLD = 1024;
+
+QStringList subprotocols(bool binary, bool compress);
+Format formatForSubprotocol(const QString &subprotocol);
+bool compressionForSubprotocol(const QString &subprotocol);
+
+QByteArray compressFrame(const QByteArray &frame);
+bool isCompressedFrame(const QByteArray &frame);
+// 失败时返回空
+QByteArray decompressFrame(const QByteArray &frame);
+
+QByteArray encode(const QJsonObject &message, Format format);
+
+// CBOR 直接从帧字节流式解码为 QJsonObject，不经过 QCborValue 中间树
+QJsonObject decode(const QByteArray &frame, Format format);
+
+}
+
+#endif
@@ -0,0 +1,136 @@
+#include "MentionIndex.h"
+#include "MessageUtils.h"
+#include <QtTest>
+#include <algorithm>
+
+// @ 补全的前缀索引与收到消息时的 @ 判断：
+// 结构化 mentions 优先；旧消息按正文匹配，英文名必须完整（@bob 不算 @bobby），中文名后可直接接正文。
+class MentionTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+
+    void completePrefix_data();
+    void completePrefix();
+    void completeLimit();
+    void completeAfterSecondBatch();
+    void uncommittedNotVisible();
+
+    void mentions_data();
+    void mentions();
+
+private:
+    MentionIndex m_index;
+};
+
+void MentionTest::init()
+{
+    m_index.clear();
+    m_index.add(0, {"Bob", "bob"});
+    m_index.add(1, {"Bobby"});
+    m_index.add(2, {QString(), "Alice Wang", "alice"});
+    m_index.add(3, {QStringLiteral("张三")});
+    m_index.add(4, {QStringLiteral("张三丰"), "zsf"});
+    m_index.commit();
+}
+
+void MentionTest::completePrefix_data()
+{
+    QTest::addColumn<QString>("prefix");
+    QTest::addColumn<QVector<int>>("expected");
+
+    QTest::newRow("bob matches bob and bobby") << "bob" << QVector<int>{0, 1};
+    QTest::newRow("bobb only bobby") << "bobb" << QVector<int>{1};
+    QTest::newRow("case folded") << "BO" << QVector<int>{0, 1};
+    QTest::newRow("surrounding spaces") << " bob " << QVector<int>{0, 1};
+    QTest::newRow("second word") << "wang" << QVector<int>{2};
+    QTest::newRow("full name") << "alice w" << QVector<int>{2};
+    QTest::newRow("cjk prefix") << QStringLiteral("张三") << QVector<int>{3, 4};
+    QTest::newRow("cjk longer") << QStringLiteral("张三丰") << QVector<int>{4};
+    QTest::newRow("username") << "zs" << QVector<int>{4};
+    QTest::newRow("no match") << "carol" << QVector<int>{};
+}
+
+void MentionTest::completePrefix()
+{
+    QFETCH(QString, prefix);
+    QFETCH(QVector<int>, expected);
+    QCOMPARE(m_index.complete(prefix, 8), expected);
+}
+
+void MentionTest::completeLimit()
+{
+    QCOMPARE(m_index.complete("bob", 1), QVector<int>{0});
+
+    // 空前缀列出全部成员，同一成员的多个名字只出现一次
+    QVector<int> all = m_index.complete(QString(), 100);
+    QCOMPARE(all.size(), 5);
+    std::sort(all.begin(), all.end());
+    QCOMPARE(all, (QVector<int>{0, 1, 2, 3, 4}));
+}
+
+void MentionTest::completeAfterSecondBatch()
+{
+    // 第二页成员单独排序后与已有部分合并
+    m_index.add(5, {"Bobo"});
+    m_index.add(6, {"Aaron"});
+    m_index.commit();
+
+    QCOMPARE(m_index.complete("bob", 8), (QVector<int>{0, 1, 5}));
+    QCOMPARE(m_index.complete("a", 8), (QVector<int>{6, 2}));
+}
+
+void MentionTest::uncommittedNotVisible()
+{
+    m_index.add(5, {"Bobo"});
+    QCOMPARE(m_index.complete("bobo", 8), QVector<int>{});
+    m_index.commit();
+    QCOMPARE(m_index.complete("bobo", 8), QVector<int>{5});
+}
+
+void MentionTest::mentions_data()
+{
+    QTest::addColumn<QJsonObject>("message");
+    QTest::addColumn<QStringList>("names");
+    QTest::addColumn<bool>("expected");
+
+    const QStringList bob{"bob"};
+    auto text = [](const QString &content) {
+        return QJsonObject{{"type", "text"}, {"content", content}};
+    };
+    auto structured = [](const QString &content, const QJsonArray &ids) {
+        return QJsonObject{{"type", "text"}, {"content", content}, {"mentions", ids}};
+    };
+
+    QTest::newRow("@bob") << text("@bob hi") << bob << true;
+    QTest::newRow("@bob at end") << text("hi @bob") << bob << true;
+    QTest::newRow("@Bob, case insensitive") << text("@Bob, hi") << bob << true;
+    QTest::newRow("@bobby is not @bob") << text("@bobby hi") << bob << false;
+    QTest::newRow("@bob is not @bobby") << text("@bob hi") << QStringList{"bobby"} << false;
+    QTest::newRow("second @ matches") << text("@bobby and @bob") << bob << true;
+    QTest::newRow("no @") << text("bob hi") << bob << false;
+    QTest::newRow("@所有人") << text(QStringLiteral("@所有人 下午开会")) << bob << true;
+    QTest::newRow("@all") << text("@all meeting") << bob << true;
+    QTest::newRow("@allen is not @all") << text("@allen hi") << bob << false;
+    QTest::newRow("cjk name followed by text") << text(QStringLiteral("@张三你好")) << QStringList{QStringLiteral("张三")}
+                                               << true;
+    QTest::newRow("image ignored") << QJsonObject{{"type", "image"}, {"content", "@bob"}} << bob << false;
+
+    QTest::newRow("structured self") << structured("hi", {"me"}) << bob << true;
+    QTest::newRow("structured all") << structured("hi", {"all"}) << bob << true;
+    QTest::newRow("structured other wins over text") << structured("@bob hi", {"u2"}) << bob << false;
+    QTest::newRow("structured empty ignores @所有人") << structured(QStringLiteral("@所有人"), {}) << bob << false;
+}
+
+void MentionTest::mentions()
+{
+    QFETCH(QJsonObject, message);
+    QFETCH(QStringList, names);
+    QFETCH(bool, expected);
+    QCOMPARE(MessageUtils::mentions(message, "me", names), expected);
+}
+
+QTEST_GUILESS_MAIN(MentionTest)
+#include "MentionTest.moc"
@@ -0,0 +1,383 @@
+#include "Sequencer.h"
+#include "MockState.h"
+#include <QRandomGenerator>
+#include <QSet>
+#include <QtTest>
+
+namespace {
+
+const QString ALICE_NAME = "alice";
+const QString BOB_NAME = "bob";
+
+}
+
+// 以 tools/MockServer 的 MockState 作为服务器：消息由它分配 id 与 seq，补拉走它的 history()。
+// 推送路径上的乱序、重复与丢失由测试自己安排，补拉结果在下一轮事件循环返回，与真实请求一样是异步的。
+// 与服务器一致，Bob 自己发出的消息不会推给 Bob，只以 ack 的形式经 advance() 到达。
+class SequencerTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void inOrder();
+    void reorderWithinWindow();
+    void duplicates();
+    void selfSentSeenOnlyAsAcks();
+    void ackAfterReply();
+    void lossFilledFromServer();
+    void lossBeyondFillLimit();
+    void permanentLoss();
+    void fillFailureRetries();
+    void baselineFromStore();
+    void firstTwoSwapped();
+    void firstArrivalsWithoutBaseline();
+    void groupConversation();
+    void randomFaults_data();
+    void randomFaults();
+
+private:
+    QJsonObject send(const QString &from, const QString &to, const QString &content);
+    // Bob 收到推送，或者 Bob 自己的消息收到 ack
+    void receive(const QJsonObject &message);
+    QList<qint64> seqsFrom(const QString &from, qint64 first, qint64 last) const;
+    QList<qint64> deliveredSeqs() const;
+    QList<qint64> storedSeqs(int first, int last) const;
+
+    MockState *m_server = nullptr;
+    Sequencer *m_sequencer = nullptr;
+    QString m_alice;
+    QString m_bob;
+    QVector<QJsonObject> m_sent;        // 按服务器分配顺序
+    QVector<QJsonObject> m_delivered;
+    QSet<qint64> m_recalled;            // 补拉时服务器不再返回的 id
+    int m_failFills = 0;                // 接下来若干次补拉返回失败
+    int m_fills = 0;
+};
+
+void SequencerTest::init()
+{
+    m_server = new MockState([](const QString &, const QJsonObject &) {});
+    QString error;
+    m_alice = m_server->login(ALICE_NAME, "password", &error)["id"].toString();
+    m_bob = m_server->login(BOB_NAME, "password", &error)["id"].toString();
+    QVERIFY(!m_alice.isEmpty() && !m_bob.isEmpty());
+
+    m_sequencer = new Sequencer();
+    m_sequencer->setSelfId(m_bob);
+    m_sequencer->setReorderWindow(20);
+    connect(m_sequencer, &Sequencer::ready, this, [this](const QJsonObject &message) {
+        m_delivered.append(message);
+    });
+    connect(m_sequencer, &Sequencer::gapDetected, this,
+            [this](const QString &conversationId, bool group, qint64 afterId, qint64 beforeId, int missing) {
+        m_fills++;
+        QString key = group ? MockState::groupKey(conversationId) : MockState::conversationKey(m_bob, conversationId);
+        bool hasMore = false;
+        QJsonArray messages;
+        bool ok = m_failFills <= 0;
+        if (ok) {
+            for (const QJsonValue &v : m_server->history(key, afterId, beforeId, missing, &hasMore)) {
+                if (!m_recalled.contains(v.toObject()["id"].toInteger())) messages.append(v);
+            }
+        } else {
+            m_failFills--;
+        }
+        QTimer::singleShot(0, m_sequencer, [this, conversationId, messages, ok]() {
+            m_sequencer->fill(conversationId, messages, ok);
+        });
+    });
+}
+
+void SequencerTest::cleanup()
+{
+    delete m_sequencer;
+    delete m_server;
+    m_sequencer = nullptr;
+    m_server = nullptr;
+    m_sent.clear();
+    m_delivered.clear();
+    m_recalled.clear();
+    m_failFills = 0;
+    m_fills = 0;
+}
+
+QJsonObject SequencerTest::send(const QString &from, const QString &to, const QString &content)
+{
+    QJsonObject message = m_server->storeMessage(from, QJsonObject{{"to", to}, {"content", content}}, false);
+    m_sent.append(message);
+    return message;
+}
+
+void SequencerTest::receive(const QJsonObject &message)
+{
+    if (message["from"].toString() != m_bob) {
+        m_sequencer->push(message);
+        return;
+    }
+    QString groupId = message["group_id"].toString();
+    m_sequencer->advance(groupId.isEmpty() ? message["to"].toString() : groupId, !groupId.isEmpty(),
+                         message["seq"].toInteger(), message["id"].toInteger());
+}
+
+QList<qint64> SequencerTest::seqsFrom(const QString &from, qint64 first, qint64 last) const
+{
+    QList<qint64> seqs;
+    for (const QJsonObject &m : m_sent) {
+        qint64 seq = m["seq"].toInteger();
+        if (seq >= first && seq <= last && m["from"].toString() == from) seqs.append(seq);
+    }
+    return seqs;
+}
+
+QList<qint64> SequencerTest::deliveredSeqs() const
+{
+    QList<qint64> seqs;
+    for (const QJsonObject &m : m_delivered) seqs.append(m["seq"].toInteger());
+    return seqs;
+}
+
+QList<qint64> SequencerTest::storedSeqs(int first, int last) const
+{
+    QList<qint64> seqs;
+    for (int seq = first; seq <= last; ++seq) seqs.append(seq);
+    return seqs;
+}
+
+void SequencerTest::inOrder()
+{
+    for (int i = 0; i < 5; ++i) m_sequencer->push(send(m_alice, m_bob, QString::number(i)));
+
+    QCOMPARE(deliveredSeqs(), storedSeqs(1, 5));
+    QCOMPARE(m_sequencer->bufferedCount(), 0);
+    QCOMPARE(m_fills, 0);
+}
+
+void SequencerTest::reorderWithinWindow()
+{
+    for (int i = 0; i < 5; ++i) send(m_alice, m_bob, QString::number(i));
+
+    // 缺口在等待窗口内由后到的推送补上，不需要补拉
+    for (int index : {0, 2, 1, 4, 3}) m_sequencer->push(m_sent.at(index));
+
+    QCOMPARE(deliveredSeqs(), storedSeqs(1, 5));
+    QCOMPARE(m_sequencer->stats()["reordered"].toULongLong(), 2ULL);
+    QTest::qWait(60);
+    QCOMPARE(m_fills, 0);
+}
+
+void SequencerTest::duplicates()
+{
+    for (int i = 0; i < 3; ++i) send(i % 2 ? m_bob : m_alice, i % 2 ? m_alice : m_bob, QString::number(i));
+
+    // 重复的 ack 不计入 duplicates，只有重复推送才算
+    for (int index : {0, 1, 1, 0, 2, 2}) receive(m_sent.at(index));
+
+    QCOMPARE(deliveredSeqs(), (QList<qint64>{1, 3}));
+    QCOMPARE(m_sequencer->stats()["duplicates"].toULongLong(), 2ULL);
+}
+
+void SequencerTest::selfSentSeenOnlyAsAcks()
+{
+    // 一问一答：Bob 的消息只有 ack，不能在 Bob 的序列里留下缺口
+    for (int i = 0; i < 6; ++i) receive(send(i % 2 ? m_bob : m_alice, i % 2 ? m_alice : m_bob, QString::number(i)));
+
+    QCOMPARE(deliveredSeqs(), (QList<qint64>{1, 3, 5}));
+    QCOMPARE(m_sequencer->bufferedCount(), 0);
+    QTest::qWait(60);
+    QCOMPARE(m_fills, 0);
+    QCOMPARE(m_sequencer->stats()["reordered"].toULongLong(), 0ULL);
+}
+
+void SequencerTest::ackAfterReply()
+{
+    for (int i = 0; i < 3; ++i) send(i == 1 ? m_bob : m_alice, i == 1 ? m_alice : m_bob, QString::number(i));
+
+    // 对方的回复先于自己的 ack 到达，在等待窗口内由 ack 补上缺口
+    for (int index : {0, 2, 1}) receive(m_sent.at(index));
+
+    QCOMPARE(deliveredSeqs(), (QList<qint64>{1, 3}));
+    QCOMPARE(m_sequencer->bufferedCount(), 0);
+    QTest::qWait(60);
+    QCOMPARE(m_fills, 0);
+}
+
+void SequencerTest::lossFilledFromServer()
+{
+    for (int i = 0; i < 6; ++i) send(m_alice, m_bob, QString::number(i));
+
+    for (int index : {0, 1, 4, 5}) m_sequencer->push(m_sent.at(index));
+    QCOMPARE(deliveredSeqs(), storedSeqs(1, 2));
+    QCOMPARE(m_sequencer->bufferedCount(), 2);
+
+    QTRY_COMPARE(deliveredSeqs(), storedSeqs(1, 6));
+    QCOMPARE(m_fills, 1);
+    QCOMPARE(m_sequencer->bufferedCount(), 0);
+}
+
+void SequencerTest::lossBeyondFillLimit()
+{
+    // 单次补拉最多 200 条，剩余部分在第一批结果回来后接着补
+    for (int i = 0; i < 450; ++i) send(m_alice, m_bob, QString::number(i));
+
+    m_sequencer->push(m_sent.first());
+    m_sequencer->push(m_sent.last());
+
+    QTRY_COMPARE(m_delivered.size(), 450);
+    QCOMPARE(deliveredSeqs(), storedSeqs(1, 450));
+    QCOMPARE(m_fills, 3);
+}
+
+void SequencerTest::permanentLoss()
+{
+    for (int i = 0; i < 5; ++i) send(m_alice, m_bob, QString::number(i));
+    m_recalled.insert(m_sent.at(2)["id"].toInteger());
+
+    for (int index : {0, 1, 3, 4}) m_sequencer->push(m_sent.at(index));
+
+    // 服务器上也没有的消息被跳过，后面的消息不再等待
+    QTRY_COMPARE(deliveredSeqs(), (QList<qint64>{1, 2, 4, 5}));
+    QCOMPARE(m_sequencer->stats()["skipped"].toULongLong(), 1ULL);
+}
+
+void SequencerTest::fillFailureRetries()
+{
+    for (int i = 0; i < 4; ++i) send(m_alice, m_bob, QString::number(i));
+    m_failFills = 2;
+
+    for (int index : {0, 3}) m_sequencer->push(m_sent.at(index));
+
+    QTRY_COMPARE(deliveredSeqs(), storedSeqs(1, 4));
+    QCOMPARE(m_fills, 3);
+    QCOMPARE(m_sequencer->stats()["skipped"].toULongLong(), 0ULL);
+}
+
+void SequencerTest::baselineFromStore()
+{
+    for (int i = 0; i < 6; ++i) send(m_alice, m_bob, QString::number(i));
+    // 本地已经保存到 seq 3
+    m_sequencer->setBaseline([this](const QString &conversationId) {
+        return conversationId == m_alice ? m_sent.at(2) : QJsonObject();
+    });
+
+    for (int index : {2, 3, 5}) m_sequencer->push(m_sent.at(index));
+    QCOMPARE(deliveredSeqs(), (QList<qint64>{4}));
+    QCOMPARE(m_sequencer->stats()["duplicates"].toULongLong(), 1ULL);
+
+    QTRY_COMPARE(deliveredSeqs(), storedSeqs(4, 6));
+}
+
+void SequencerTest::firstTwoSwapped()
+{
+    for (int i = 0; i < 3; ++i) send(m_alice, m_bob, QString::number(i));
+
+    // 新会话的第二条先到，等到第一条再一起放行，第一条不能被当成重复丢掉
+    m_sequencer->push(m_sent.at(1));
+    QCOMPARE(m_delivered.size(), 0);
+    for (int index : {0, 2}) m_sequencer->push(m_sent.at(index));
+
+    QCOMPARE(deliveredSeqs(), storedSeqs(1, 3));
+    QCOMPARE(m_sequencer->stats()["duplicates"].toULongLong(), 0ULL);
+    QTest::qWait(60);
+    QCOMPARE(m_fills, 0);
+}
+
+void SequencerTest::firstArrivalsWithoutBaseline()
+{
+    // 服务器上已有历史，本地没有记录（例如换了设备）
+    for (int i = 0; i < 6; ++i) send(m_alice, m_bob, QString::number(i));
+    m_sequencer->setBaseline([](const QString &) { return QJsonObject(); });
+
+    for (int index : {4, 3}) m_sequencer->push(m_sent.at(index));
+    QCOMPARE(m_delivered.size(), 0);
+
+    // 等待窗口结束后以最小的 seq 为起点，更早的历史由分页加载负责，不补拉
+    QTRY_COMPARE(deliveredSeqs(), storedSeqs(4, 5));
+    m_sequencer->push(m_sent.at(5));
+    QCOMPARE(deliveredSeqs(), storedSeqs(4, 6));
+    QCOMPARE(m_fills, 0);
+    QCOMPARE(m_sequencer->stats()["duplicates"].toULongLong(), 0ULL);
+}
+
+void SequencerTest::groupConversation()
+{
+    QString error;
+    QString carol = m_server->login("carol", "password", &error)["id"].toString();
+    QString groupId = m_server->createGroup(m_alice, "team", {m_bob, carol})["id"].toString();
+
+    QVector<QJsonObject> messages;
+    for (int i = 0; i < 6; ++i) {
+        const QString &from = i % 3 == 0 ? m_alice : (i % 3 == 1 ? carol : m_bob);
+        messages.append(m_server->storeMessage(from, QJsonObject{{"group_id", groupId},
+                                                                 {"content", QString::number(i)}}, true));
+    }
+    // 群聊与单聊的 seq 各自独立
+    m_sequencer->push(send(m_alice, m_bob, "direct"));
+    // 下标 2、5 是 Bob 自己发的，只有 ack
+    for (int index : {0, 2, 3, 5}) receive(messages.at(index));
+
+    QTRY_COMPARE(m_delivered.size(), 5);
+    QList<qint64> groupSeqs;
+    for (const QJsonObject &m : std::as_const(m_delivered)) {
+        if (m["group_id"].toString() == groupId) groupSeqs.append(m["seq"].toInteger());
+    }
+    QCOMPARE(groupSeqs, (QList<qint64>{1, 2, 4, 5}));
+}
+
+void SequencerTest::randomFaults_data()
+{
+    QTest::addColumn<quint32>("seed");
+    QTest::addColumn<int>("dropPercent");
+    QTest::addColumn<int>("duplicatePercent");
+
+    QTest::newRow("reorder") << 1u << 0 << 0;
+    QTest::newRow("reorder+dup") << 2u << 0 << 20;
+    QTest::newRow("reorder+loss") << 3u << 10 << 0;
+    QTest::newRow("all") << 4u << 10 << 20;
+}
+
+void SequencerTest::randomFaults()
+{
+    QFETCH(quint32, seed);
+    QFETCH(int, dropPercent);
+    QFETCH(int, duplicatePercent);
+
+    // 双方交替发送，推送按小窗口打乱，与 MockServer --drop/--duplicate/--reorder 的效果相同
+    QRandomGenerator rng(seed);
+    const int count = 300;
+    for (int i = 0; i < count; ++i) {
+        bool fromAlice = rng.bounded(2) == 0;
+        send(fromAlice ? m_alice : m_bob, fromAlice ? m_bob : m_alice, QString::number(i));
+    }
+
+    // ack 不会丢：没有确认的消息客户端会一直重发，只会重复或晚到
+    QVector<QJsonObject> wire;
+    for (const QJsonObject &m : std::as_const(m_sent)) {
+        if (m["from"].toString() != m_bob && int(rng.bounded(100)) < dropPercent) continue;
+        wire.append(m);
+        if (int(rng.bounded(100)) < duplicatePercent) wire.append(m);
+    }
+    for (int i = 0; i + 1 < wire.size(); ++i) {
+        int j = qMin(wire.size() - 1, i + int(rng.bounded(4)));
+        std::swap(wire[i], wire[j]);
+    }
+
+    // 没有本地记录时以最先一批中最小的 seq 为起点，开头丢失的由分页加载负责；
+    // 最后几条全部丢失时没有后续推送暴露缺口
+    qint64 head = wire.first()["seq"].toInteger();
+    qint64 tail = 0;
+    for (const QJsonObject &m : std::as_const(wire)) {
+        head = qMin(head, m["seq"].toInteger());
+        tail = qMax(tail, m["seq"].toInteger());
+    }
+    for (const QJsonObject &m : std::as_const(wire)) receive(m);
+
+    QTRY_VERIFY(m_sequencer->bufferedCount() == 0);
+    QCOMPARE(deliveredSeqs(), seqsFrom(m_alice, head, tail));
+    QCOMPARE(m_sequencer->stats()["skipped"].toULongLong(), 0ULL);
+}
+
+QTEST_GUILESS_MAIN(SequencerTest)
+#include "SequencerTest.moc"
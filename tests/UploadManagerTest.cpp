@@ -0,0 +1,309 @@
+#include "UploadManager.h"
+#include "NetworkManager.h"
+#include "MockServer.h"
+#include <QFile>
+#include <QRandomGenerator>
+#include <QSignalSpy>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QtTest>
+
+namespace {
+
+const qint64 CHUNK = 1024 * 1024;
+// 分块失败后第一次重试在 1 秒后，留足余量
+const int UPLOAD_TIMEOUT_MS = 15000;
+
+}
+
+// 以进程内的 MockServer 作为服务器，走真实的 HTTP 往返验证分块上传：
+// 并发分块、失败分块的重试与断点续传、相同内容秒传、旧服务器回退整文件上传以及取消。
+// 服务器在 complete 时核对 SHA-256，内容拼错会直接失败。
+class UploadManagerTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanup();
+
+    void parallelChunks();
+    void retryFailedChunk();
+    void resumeAfterFailedChunk();
+    void resumeAfterFailedComplete();
+    void dedupSkipsUpload();
+    void legacyFallback_data();
+    void legacyFallback();
+    void cancel();
+
+private:
+    void startServer(const MockServer::Options &options);
+    QString writeFile(const QString &name, qint64 size, quint32 seed);
+
+    QTemporaryDir m_dir;
+    MockServer *m_server = nullptr;
+};
+
+void UploadManagerTest::initTestCase()
+{
+    QStandardPaths::setTestModeEnabled(true);
+    QVERIFY(m_dir.isValid());
+}
+
+void UploadManagerTest::cleanup()
+{
+    delete m_server;
+    m_server = nullptr;
+    QCOMPARE(UploadManager::instance()->activeCount(), 0);
+}
+
+void UploadManagerTest::startServer(const MockServer::Options &options)
+{
+    MockServer::Options o = options;
+    o.port = 0;
+    o.statsInterval = 0;
+    m_server = new MockServer(o);
+    QString error;
+    QVERIFY2(m_server->listen(&error), qPrintable(error));
+    NetworkManager::instance()->setServerUrl(QString("http://127.0.0.1:%1").arg(m_server->port()));
+}
+
+QString UploadManagerTest::writeFile(const QString &name, qint64 size, quint32 seed)
+{
+    QByteArray data(size, Qt::Uninitialized);
+    QRandomGenerator rng(seed);
+    rng.fillRange(reinterpret_cast<quint32 *>(data.data()), size / 4);
+
+    QString path = m_dir.filePath(name);
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly) || file.write(data) != size) return QString();
+    return path;
+}
+
+void UploadManagerTest::parallelChunks()
+{
+    MockServer::Options options;
+    options.delayMs = 100;
+    startServer(options);
+
+    // 5 个整块加一个不满的尾块
+    qint64 size = 5 * CHUNK + 300 * 1024;
+    QString path = writeFile("parallel.bin", size, 1);
+    QVERIFY(!path.isEmpty());
+
+    auto uploads = UploadManager::instance();
+    QSignalSpy finished(uploads, &UploadManager::finished);
+    QSignalSpy failed(uploads, &UploadManager::failed);
+    QSignalSpy progress(uploads, &UploadManager::progress);
+
+    QString taskId = uploads->upload(path);
+    QTRY_COMPARE_WITH_TIMEOUT(finished.count(), 1, UPLOAD_TIMEOUT_MS);
+    QCOMPARE(failed.count(), 0);
+    QCOMPARE(finished.at(0).at(0).toString(), taskId);
+    QCOMPARE(finished.at(0).at(1).toJsonObject()["size"].toInteger(), size);
+
+    const MockServer::UploadStats &stats = m_server->uploadStats();
+    QCOMPARE(stats.inits, 1);
+    QCOMPARE(stats.chunks, 6);
+    QCOMPARE(stats.completes, 1);
+    QVERIFY2(stats.maxParallelChunks > 1, "chunks were uploaded one at a time");
+    QVERIFY(stats.maxParallelChunks <= 3);
+
+    // 进度单调不减，最后一次等于文件大小
+    qint64 last = 0;
+    for (const QList<QVariant> &args : progress) {
+        if (args.at(0).toString() != taskId) continue;
+        QVERIFY(args.at(1).toLongLong() >= last);
+        last = args.at(1).toLongLong();
+        QCOMPARE(args.at(2).toLongLong(), size);
+    }
+    QCOMPARE(last, size);
+}
+
+void UploadManagerTest::retryFailedChunk()
+{
+    MockServer::Options options;
+    options.failChunks = 1;
+    options.failChunkStatus = 503;
+    startServer(options);
+
+    QString path = writeFile("retry.bin", 4 * CHUNK, 2);
+    QVERIFY(!path.isEmpty());
+
+    auto uploads = UploadManager::instance();
+    QSignalSpy finished(uploads, &UploadManager::finished);
+    QSignalSpy failed(uploads, &UploadManager::failed);
+
+    uploads->upload(path);
+    QTRY_COMPARE_WITH_TIMEOUT(finished.count(), 1, UPLOAD_TIMEOUT_MS);
+    QCOMPARE(failed.count(), 0);
+
+    // 只有被拒绝的分块重传了一次，其余分块各上传一次
+    const MockServer::UploadStats &stats = m_server->uploadStats();
+    QCOMPARE(stats.failedChunks, 1);
+    QCOMPARE(stats.chunks, 4);
+    QCOMPARE(stats.inits, 1);
+    QCOMPARE(stats.completes, 1);
+}
+
+void UploadManagerTest::resumeAfterFailedChunk()
+{
+    MockServer::Options options;
+    options.delayMs = 50;
+    options.failChunks = 1;
+    options.failChunkStatus = 400;
+    startServer(options);
+
+    qint64 size = 6 * CHUNK;
+    QString path = writeFile("resume.bin", size, 3);
+    QVERIFY(!path.isEmpty());
+
+    auto uploads = UploadManager::instance();
+    QSignalSpy finished(uploads, &UploadManager::finished);
+    QSignalSpy failed(uploads, &UploadManager::failed);
+
+    // 4xx 不重试，任务进入失败状态
+    QString taskId = uploads->upload(path);
+    QTRY_COMPARE_WITH_TIMEOUT(failed.count(), 1, UPLOAD_TIMEOUT_MS);
+    QCOMPARE(failed.at(0).at(0).toString(), taskId);
+    QCOMPARE(finished.count(), 0);
+    QCOMPARE(uploads->activeCount(), 0);
+    int storedBeforeResume = m_server->uploadStats().chunks;
+    QVERIFY(storedBeforeResume < 6);
+
+    // 续传时服务器返回已收到的分块，只补传缺少的部分
+    uploads->resume(taskId);
+    QCOMPARE(uploads->activeCount(), 1);
+    QTRY_COMPARE_WITH_TIMEOUT(finished.count(), 1, UPLOAD_TIMEOUT_MS);
+    QCOMPARE(finished.at(0).at(0).toString(), taskId);
+    QCOMPARE(finished.at(0).at(1).toJsonObject()["size"].toInteger(), size);
+
+    const MockServer::UploadStats &stats = m_server->uploadStats();
+    QCOMPARE(stats.inits, 2);
+    QCOMPARE(stats.failedChunks, 1);
+    QCOMPARE(stats.chunks, 6);
+    QCOMPARE(stats.completes, 1);
+}
+
+void UploadManagerTest::resumeAfterFailedComplete()
+{
+    MockServer::Options options;
+    options.failCompletes = 1;
+    startServer(options);
+
+    QString path = writeFile("complete.bin", 3 * CHUNK, 4);
+    QVERIFY(!path.isEmpty());
+
+    auto uploads = UploadManager::instance();
+    QSignalSpy finished(uploads, &UploadManager::finished);
+    QSignalSpy failed(uploads, &UploadManager::failed);
+
+    QString taskId = uploads->upload(path);
+    QTRY_COMPARE_WITH_TIMEOUT(failed.count(), 1, UPLOAD_TIMEOUT_MS);
+    QCOMPARE(m_server->uploadStats().chunks, 3);
+
+    // 分块都已在服务器上，续传直接 complete，不再上传任何分块
+    uploads->resume(taskId);
+    QTRY_COMPARE_WITH_TIMEOUT(finished.count(), 1, UPLOAD_TIMEOUT_MS);
+    QCOMPARE(m_server->uploadStats().chunks, 3);
+    QCOMPARE(m_server->uploadStats().completes, 1);
+}
+
+void UploadManagerTest::dedupSkipsUpload()
+{
+    startServer(MockServer::Options());
+
+    QString first = writeFile("original.bin", 2 * CHUNK, 5);
+    QString second = writeFile("copy.bin", 2 * CHUNK, 5);
+    QVERIFY(!first.isEmpty() && !second.isEmpty());
+
+    auto uploads = UploadManager::instance();
+    QSignalSpy finished(uploads, &UploadManager::finished);
+    QSignalSpy failed(uploads, &UploadManager::failed);
+
+    uploads->upload(first);
+    QTRY_COMPARE_WITH_TIMEOUT(finished.count(), 1, UPLOAD_TIMEOUT_MS);
+    QCOMPARE(m_server->uploadStats().chunks, 2);
+
+    // 内容相同，init 直接返回已有文件
+    QString taskId = uploads->upload(second);
+    QTRY_COMPARE_WITH_TIMEOUT(finished.count(), 2, UPLOAD_TIMEOUT_MS);
+    QCOMPARE(failed.count(), 0);
+    QCOMPARE(finished.at(1).at(0).toString(), taskId);
+    QCOMPARE(finished.at(1).at(1).toJsonObject()["url"].toString(),
+             finished.at(0).at(1).toJsonObject()["url"].toString());
+
+    const MockServer::UploadStats &stats = m_server->uploadStats();
+    QCOMPARE(stats.inits, 2);
+    QCOMPARE(stats.chunks, 2);
+    QCOMPARE(stats.completes, 1);
+}
+
+void UploadManagerTest::legacyFallback_data()
+{
+    QTest::addColumn<int>("status");
+    QTest::newRow("404") << 404;
+    QTest::newRow("405") << 405;
+}
+
+void UploadManagerTest::legacyFallback()
+{
+    QFETCH(int, status);
+    MockServer::Options options;
+    options.legacyUploadStatus = status;
+    startServer(options);
+
+    qint64 size = CHUNK + 4096;
+    QString path = writeFile("legacy.bin", size, 6);
+    QVERIFY(!path.isEmpty());
+
+    auto uploads = UploadManager::instance();
+    QSignalSpy finished(uploads, &UploadManager::finished);
+    QSignalSpy failed(uploads, &UploadManager::failed);
+
+    uploads->upload(path);
+    QTRY_COMPARE_WITH_TIMEOUT(finished.count(), 1, UPLOAD_TIMEOUT_MS);
+    QCOMPARE(failed.count(), 0);
+    QCOMPARE(finished.at(0).at(1).toJsonObject()["size"].toInteger(), size);
+    QCOMPARE(finished.at(0).at(1).toJsonObject()["file_name"].toString(), QString("legacy.bin"));
+
+    const MockServer::UploadStats &stats = m_server->uploadStats();
+    QCOMPARE(stats.legacy, 1);
+    QCOMPARE(stats.chunks, 0);
+}
+
+void UploadManagerTest::cancel()
+{
+    MockServer::Options options;
+    options.delayMs = 200;
+    startServer(options);
+
+    QString path = writeFile("cancel.bin", 8 * CHUNK, 7);
+    QVERIFY(!path.isEmpty());
+
+    auto uploads = UploadManager::instance();
+    QSignalSpy finished(uploads, &UploadManager::finished);
+    QSignalSpy failed(uploads, &UploadManager::failed);
+    QSignalSpy cancelled(uploads, &UploadManager::cancelled);
+
+    QString taskId = uploads->upload(path);
+    QTRY_VERIFY_WITH_TIMEOUT(m_server->uploadStats().chunks > 0, UPLOAD_TIMEOUT_MS);
+
+    uploads->cancel(taskId);
+    QCOMPARE(cancelled.count(), 1);
+    QCOMPARE(cancelled.at(0).at(0).toString(), taskId);
+    QCOMPARE(uploads->activeCount(), 0);
+
+    // 服务器收到 DELETE 释放分块，之后不再有新的分块到达
+    QTRY_COMPARE_WITH_TIMEOUT(m_server->uploadStats().cancelled, 1, UPLOAD_TIMEOUT_MS);
+    int chunks = m_server->uploadStats().chunks;
+    QVERIFY(chunks <= 3);
+    QTest::qWait(500);
+    QCOMPARE(m_server->uploadStats().chunks, chunks);
+    QCOMPARE(m_server->uploadStats().completes, 0);
+    QCOMPARE(finished.count(), 0);
+    QCOMPARE(failed.count(), 0);
+}
+
+QTEST_GUILESS_MAIN(UploadManagerTest)
+#include "UploadManagerTest.moc"
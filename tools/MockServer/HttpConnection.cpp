@@ -0,0 +1,145 @@
+#include "HttpConnection.h"
+#include <QTcpSocket>
+#include <QUrl>
+
+namespace {
+
+const qsizetype MAX_HEADER_SIZE = 64 * 1024;
+const qsizetype MAX_BODY_SIZE = 64 * 1024 * 1024;
+const qsizetype COMPRESSION_THRESHOLD = 1024;
+
+const char *reason(int status)
+{
+    switch (status) {
+    case 200: return "OK";
+    case 201: return "Created";
+    case 204: return "No Content";
+    case 206: return "Partial Content";
+    case 304: return "Not Modified";
+    case 400: return "Bad Request";
+    case 401: return "Unauthorized";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 409: return "Conflict";
+    case 411: return "Length Required";
+    case 413: return "Payload Too Large";
+    default: return status < 400 ? "OK" : "Error";
+    }
+}
+
+}
+
+HttpConnection::HttpConnection(QTcpSocket *socket, QObject *parent)
+    : QObject(parent)
+    , m_socket(socket)
+    , m_first(true)
+    , m_compress(true)
+{
+    socket->setParent(this);
+    connect(socket, &QTcpSocket::readyRead, this, &HttpConnection::onReadyRead);
+    connect(socket, &QTcpSocket::disconnected, this, &QObject::deleteLater);
+}
+
+void HttpConnection::onReadyRead()
+{
+    if (m_first && checkUpgrade()) return;
+
+    m_buffer += m_socket->readAll();
+    for (;;) {
+        qsizetype headerEnd = m_buffer.indexOf("\r\n\r\n");
+        if (headerEnd < 0) {
+            if (m_buffer.size() > MAX_HEADER_SIZE) fail(413);
+            return;
+        }
+
+        QList<QByteArray> lines = m_buffer.left(headerEnd).split('\n');
+        QList<QByteArray> requestLine = lines.takeFirst().trimmed().split(' ');
+        if (requestLine.size() < 2) {
+            fail(400);
+            return;
+        }
+
+        Request request;
+        request.method = requestLine.at(0);
+        QUrl url(QString::fromLatin1(requestLine.at(1)));
+        request.path = url.path();
+        request.query = QUrlQuery(url);
+        for (const QByteArray &line : std::as_const(lines)) {
+            qsizetype colon = line.indexOf(':');
+            if (colon <= 0) continue;
+            request.headers.insert(line.left(colon).trimmed().toLower(), line.mid(colon + 1).trimmed());
+        }
+        if (request.header("transfer-encoding").contains("chunked")) {
+            fail(411);
+            return;
+        }
+
+        qsizetype length = request.header("content-length").toLongLong();
+        if (length < 0 || length > MAX_BODY_SIZE) {
+            fail(413);
+            return;
+        }
+        qsizetype total = headerEnd + 4 + length;
+        if (m_buffer.size() < total) return;
+
+        request.body = m_buffer.mid(headerEnd + 4, length);
+        m_buffer.remove(0, total);
+        m_first = false;
+        emit requestReceived(this, request);
+        if (m_socket->state() != QAbstractSocket::ConnectedState) return;
+    }
+}
+
+bool HttpConnection::checkUpgrade()
+{
+    QByteArray head = m_socket->peek(MAX_HEADER_SIZE);
+    qsizetype headerEnd = head.indexOf("\r\n\r\n");
+    if (headerEnd < 0) return head.size() < MAX_HEADER_SIZE;
+    if (!head.left(headerEnd).toLower().contains("upgrade: websocket")) return false;
+
+    // 升级后由 QWebSocketServer 接管套接字，本对象随之销毁
+    disconnect(m_socket, nullptr, this, nullptr);
+    m_socket->setParent(nullptr);
+    QTcpSocket *socket = m_socket;
+    m_socket = nullptr;
+    emit upgradeRequested(socket);
+    deleteLater();
+    return true;
+}
+
+void HttpConnection::respond(const Request &request, int status, const QByteArray &body,
+                             const QByteArray &contentType, const Headers &headers)
+{
+    if (!m_socket) return;
+
+    QByteArray payload = body;
+    bool deflated = false;
+    // qCompress 的输出去掉 4 字节长度前缀就是 zlib 格式，正是 Content-Encoding: deflate
+    if (m_compress && payload.size() >= COMPRESSION_THRESHOLD
+        && request.header("accept-encoding").contains("deflate")) {
+        QByteArray packed = qCompress(payload).mid(4);
+        if (packed.size() < payload.size()) {
+            payload = packed;
+            deflated = true;
+        }
+    }
+
+    QByteArray response = "HTTP/1.1 " + QByteArray::number(status) + ' ' + reason(status) + "\r\n";
+    if (status != 304 && status != 204) {
+        response += "Content-Type: " + contentType + "\r\n";
+        response += "Content-Length: " + QByteArray::number(payload.size()) + "\r\n";
+    }
+    if (deflated) response += "Content-Encoding: deflate\r\n";
+    for (const auto &header : headers) response += header.first + ": " + header.second + "\r\n";
+    response += "Connection: keep-alive\r\n\r\n";
+    if (status != 304 && status != 204) response += payload;
+    m_socket->write(response);
+}
+
+void HttpConnection::fail(int status)
+{
+    QByteArray response = "HTTP/1.1 " + QByteArray::number(status) + ' ' + reason(status)
+        + "\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+    m_socket->write(response);
+    m_socket->disconnectFromHost();
+}
@@ -0,0 +1,54 @@
+#ifndef HTTPCONNECTION_H
+#define HTTPCONNECTION_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QUrlQuery>
+
+class QTcpSocket;
+
+// 最小的 HTTP/1.1 服务端连接：支持 keep-alive 与 Content-Length 请求体，不支持分块编码与流水线。
+// 第一个请求是 WebSocket 升级时不读取任何字节，把套接字原样交给 QWebSocketServer。
+class HttpConnection : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Request {
+        QByteArray method;
+        QString path;
+        QUrlQuery query;
+        QHash<QByteArray, QByteArray> headers;  // 键为小写
+        QByteArray body;
+
+        QByteArray header(const QByteArray &name) const { return headers.value(name.toLower()); }
+    };
+
+    using Headers = QList<QPair<QByteArray, QByteArray>>;
+
+    explicit HttpConnection(QTcpSocket *socket, QObject *parent = nullptr);
+
+    // 请求体不小于 1KB 且客户端接受 deflate 时压缩
+    void setCompressionEnabled(bool enabled) { m_compress = enabled; }
+    void respond(const Request &request, int status, const QByteArray &body,
+                 const QByteArray &contentType = "application/json", const Headers &headers = Headers());
+
+signals:
+    void requestReceived(HttpConnection *connection, const HttpConnection::Request &request);
+    void upgradeRequested(QTcpSocket *socket);
+
+private:
+    void onReadyRead();
+    bool checkUpgrade();
+    void fail(int status);
+
+    QTcpSocket *m_socket;
+    QByteArray m_buffer;
+    bool m_first;
+    bool m_compress;
+};
+
+#endif
@@ -0,0 +1,365 @@
+#include "LoadGenerator.h"
+#include <QCoreApplication>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QNetworkReply>
+#include <QTextStream>
+#include <QWebSocket>
+#include <QWebSocketHandshakeOptions>
+#include <algorithm>
+
+namespace {
+
+const int TICK_MS = 10;
+
+double ms(qint64 us)
+{
+    return us / 1000.0;
+}
+
+}
+
+void LoadGenerator::Window::merge(const Window &other)
+{
+    sent += other.sent;
+    acked += other.acked;
+    delivered += other.delivered;
+    reconnects += other.reconnects;
+    bytesOut += other.bytesOut;
+    bytesIn += other.bytesIn;
+    ackUs += other.ackUs;
+    deliveryUs += other.deliveryUs;
+}
+
+LoadGenerator::LoadGenerator(const Options &options, QObject *parent)
+    : QObject(parent)
+    , m_options(options)
+    , m_targetIndex(-1)
+    , m_loggedIn(0)
+    , m_rng(20240101)
+    , m_lastTick(0)
+    , m_budget(0)
+    , m_churnBudget(0)
+    , m_nextClientId(1)
+{
+    m_body = QByteArray(qMax(1, options.payload), 'x');
+    m_tickTimer.setInterval(TICK_MS);
+    m_tickTimer.setTimerType(Qt::PreciseTimer);
+    connect(&m_tickTimer, &QTimer::timeout, this, &LoadGenerator::tick);
+    m_reportTimer.setInterval(1000);
+    connect(&m_reportTimer, &QTimer::timeout, this, &LoadGenerator::report);
+}
+
+void LoadGenerator::start()
+{
+    m_clock.start();
+    m_clients.resize(m_options.users);
+    for (int i = 0; i < m_options.users; ++i) {
+        m_clients[i].username = m_options.userPrefix + QString::number(i);
+        login(i);
+    }
+}
+
+void LoadGenerator::login(int index)
+{
+    QNetworkRequest request(m_options.server.resolved(QUrl("/api/login")));
+    request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+    QJsonObject body{{"username", m_clients[index].username}, {"password", "password"}};
+    QNetworkReply *reply = m_http.post(request, QJsonDocument(body).toJson(QJsonDocument::Compact));
+    connect(reply, &QNetworkReply::finished, this, [this, reply, index]() {
+        reply->deleteLater();
+        QJsonObject data = QJsonDocument::fromJson(reply->readAll()).object();
+        QString userId = data["user"].toObject()["id"].toString();
+        if (userId.isEmpty()) {
+            QTextStream(stderr) << "login failed for " << m_clients[index].username << ": "
+                                << data["error"].toString(reply->errorString()) << Qt::endl;
+            emit finished(1);
+            return;
+        }
+        m_clients[index].userId = userId;
+        m_byUserId.insert(userId, index);
+        if (++m_loggedIn == m_clients.size()) onLoggedIn();
+    });
+}
+
+void LoadGenerator::onLoggedIn()
+{
+    // 目标用户只作为收件人，由真实客户端登录，压测工具不替它建立连接
+    if (!m_options.target.isEmpty()) {
+        QNetworkRequest request(m_options.server.resolved(QUrl("/api/login")));
+        request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+        QJsonObject body{{"username", m_options.target}, {"password", "password"}};
+        QNetworkReply *reply = m_http.post(request, QJsonDocument(body).toJson(QJsonDocument::Compact));
+        connect(reply, &QNetworkReply::finished, this, [this, reply]() {
+            reply->deleteLater();
+            QString userId = QJsonDocument::fromJson(reply->readAll()).object()["user"].toObject()["id"].toString();
+            if (userId.isEmpty()) {
+                QTextStream(stderr) << "target user " << m_options.target << " not found" << Qt::endl;
+                emit finished(1);
+                return;
+            }
+            Client target;
+            target.username = m_options.target;
+            target.userId = userId;
+            m_targetIndex = m_clients.size();
+            m_clients.append(target);
+            createGroups();
+        });
+        return;
+    }
+    createGroups();
+}
+
+void LoadGenerator::createGroups()
+{
+    if (m_groupIds.size() >= m_options.groups) {
+        QTextStream(stdout) << "logged in " << m_options.users << " users in " << m_clock.elapsed() << " ms"
+                            << Qt::endl;
+        for (int i = 0; i < m_options.users; ++i) connectClient(i);
+        m_lastTick = m_clock.nsecsElapsed();
+        m_tickTimer.start();
+        m_reportTimer.start();
+        if (m_options.duration > 0) QTimer::singleShot(m_options.duration * 1000, this, &LoadGenerator::finish);
+        return;
+    }
+
+    // 每个群随机取 20 名成员，包含目标用户
+    QJsonArray members;
+    for (int i = 0; i < qMin(20, m_options.users); ++i) {
+        members.append(m_clients[m_rng.bounded(m_options.users)].userId);
+    }
+    if (m_targetIndex >= 0) members.append(m_clients[m_targetIndex].userId);
+
+    const QString owner = m_clients[m_rng.bounded(m_options.users)].userId;
+    QUrl url = m_options.server.resolved(QUrl("/api/groups"));
+    url.setQuery("user_id=" + owner);
+    QNetworkRequest request(url);
+    request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+    QJsonObject body{{"name", QString("load-%1").arg(m_groupIds.size())}, {"members", members}};
+    QNetworkReply *reply = m_http.post(request, QJsonDocument(body).toJson(QJsonDocument::Compact));
+    connect(reply, &QNetworkReply::finished, this, [this, reply]() {
+        reply->deleteLater();
+        QString id = QJsonDocument::fromJson(reply->readAll()).object()["group"].toObject()["id"].toString();
+        if (id.isEmpty()) {
+            QTextStream(stderr) << "group creation failed: " << reply->errorString() << Qt::endl;
+            emit finished(1);
+            return;
+        }
+        m_groupIds.append(id);
+        createGroups();
+    });
+}
+
+void LoadGenerator::connectClient(int index)
+{
+    Client &client = m_clients[index];
+    if (!client.socket) {
+        client.socket = new QWebSocket(QString(), QWebSocketProtocol::VersionLatest, this);
+        QWebSocket *socket = client.socket;
+        connect(socket, &QWebSocket::connected, this, [this, index]() {
+            Client &client = m_clients[index];
+            client.format = WireCodec::formatForSubprotocol(client.socket->subprotocol());
+            client.compress = WireCodec::compressionForSubprotocol(client.socket->subprotocol());
+            client.connected = true;
+        });
+        connect(socket, &QWebSocket::disconnected, this, [this, index]() { m_clients[index].connected = false; });
+        connect(socket, &QWebSocket::textMessageReceived, this, [this, index](const QString &message) {
+            onFrame(index, message.toUtf8(), WireCodec::Json);
+        });
+        connect(socket, &QWebSocket::binaryMessageReceived, this, [this, index](const QByteArray &frame) {
+            onFrame(index, frame, WireCodec::Cbor);
+        });
+    }
+
+    QUrl url = m_options.server;
+    url.setScheme(url.scheme() == "https" ? "wss" : "ws");
+    url.setPath("/ws");
+    url.setQuery("user_id=" + client.userId);
+    QWebSocketHandshakeOptions handshake;
+    handshake.setSubprotocols(WireCodec::subprotocols(m_options.binary, m_options.compress));
+    client.socket->open(url, handshake);
+}
+
+void LoadGenerator::onFrame(int index, const QByteArray &frame, WireCodec::Format format)
+{
+    const Client &client = m_clients[index];
+    m_window.bytesIn += frame.size();
+    QJsonObject message = format == WireCodec::Cbor && WireCodec::isCompressedFrame(frame)
+        ? WireCodec::decode(WireCodec::decompressFrame(frame), client.format)
+        : WireCodec::decode(frame, format);
+
+    const QString action = message["action"].toString();
+    const QJsonObject data = message["data"].toObject();
+    const qint64 now = m_clock.nsecsElapsed();
+
+    if (action == "ack") {
+        if (data["status"].toString() != "sent") return;
+        QJsonArray ids = data.contains("client_ids") ? data["client_ids"].toArray() : QJsonArray{data["client_id"]};
+        for (const QJsonValue &id : std::as_const(ids)) {
+            auto it = m_inFlight.find(id.toString());
+            if (it == m_inFlight.end()) continue;
+            m_window.ackUs.append((now - *it) / 1000);
+            m_window.acked++;
+            m_inFlight.erase(it);
+        }
+    } else if (action == "message" || action == "group_message") {
+        // 只统计本进程发出的消息，发送时刻写在 bench_ns 字段里
+        if (!data.contains("bench_ns") || data["from"].toString() == client.userId) return;
+        m_window.deliveryUs.append((now - data["bench_ns"].toInteger()) / 1000);
+        m_window.delivered++;
+    }
+}
+
+void LoadGenerator::sendFrame(Client &client, const QJsonObject &frame)
+{
+    QByteArray bytes = WireCodec::encode(frame, client.format);
+    if (client.compress && bytes.size() >= WireCodec::COMPRESSION_THRESHOLD) {
+        QByteArray packed = WireCodec::compressFrame(bytes);
+        if (packed.size() < bytes.size()) {
+            m_window.bytesOut += packed.size();
+            client.socket->sendBinaryMessage(packed);
+            return;
+        }
+    }
+    m_window.bytesOut += bytes.size();
+    if (client.format == WireCodec::Cbor) client.socket->sendBinaryMessage(bytes);
+    else client.socket->sendTextMessage(QString::fromUtf8(bytes));
+}
+
+void LoadGenerator::tick()
+{
+    // 按实际经过的时间累积配额，定时器抖动不影响平均速率
+    qint64 now = m_clock.nsecsElapsed();
+    double elapsed = (now - m_lastTick) / 1e9;
+    m_lastTick = now;
+
+    m_budget += m_options.rate * elapsed;
+    while (m_budget >= 1) {
+        m_budget -= 1;
+        sendOne();
+    }
+    m_churnBudget += m_options.churn * elapsed;
+    while (m_churnBudget >= 1) {
+        m_churnBudget -= 1;
+        churn();
+    }
+}
+
+void LoadGenerator::sendOne()
+{
+    const int users = m_options.users;
+    // 最多尝试几次找到在线的发送者，全部离线时本次配额作废
+    int from = -1;
+    for (int attempt = 0; attempt < 8 && from < 0; ++attempt) {
+        int candidate = m_rng.bounded(users);
+        if (m_clients[candidate].connected) from = candidate;
+    }
+    if (from < 0) return;
+    Client &sender = m_clients[from];
+
+    QString clientId = QString("load-%1").arg(m_nextClientId++);
+    QJsonObject data;
+    data["client_id"] = clientId;
+    data["content"] = QString::fromLatin1(m_body);
+    data["type"] = "text";
+    data["bench_ns"] = m_clock.nsecsElapsed();
+
+    QString action = "message";
+    if (!m_groupIds.isEmpty() && m_rng.generateDouble() < m_options.groupShare) {
+        action = "group_message";
+        data["group_id"] = m_groupIds.at(m_rng.bounded(m_groupIds.size()));
+    } else if (m_targetIndex >= 0 && m_rng.generateDouble() < m_options.targetShare) {
+        data["to"] = m_clients[m_targetIndex].userId;
+    } else {
+        int to = m_rng.bounded(users - 1);
+        if (to >= from) to++;
+        data["to"] = m_clients[to].userId;
+    }
+
+    m_inFlight.insert(clientId, data["bench_ns"].toInteger());
+    m_window.sent++;
+    sendFrame(sender, QJsonObject{{"action", action}, {"data", data}});
+}
+
+void LoadGenerator::churn()
+{
+    int index = m_rng.bounded(m_options.users);
+    Client &client = m_clients[index];
+    if (!client.connected) return;
+    client.socket->close();
+    m_window.reconnects++;
+    // 离线 0.5～3 秒后重新上线
+    QTimer::singleShot(500 + m_rng.bounded(2500), this, [this, index]() { connectClient(index); });
+}
+
+void LoadGenerator::report()
+{
+    int connected = 0;
+    for (const Client &client : std::as_const(m_clients)) connected += client.connected;
+
+    QTextStream(stdout) << QString("t=%1s conn=%2 sent=%3/s acked=%4/s delivered=%5/s ack p50=%6ms p99=%7ms "
+                                   "delivery p50=%8ms p99=%9ms pending=%10 out=%11KB/s in=%12KB/s")
+        .arg(m_clock.elapsed() / 1000)
+        .arg(connected)
+        .arg(m_window.sent)
+        .arg(m_window.acked)
+        .arg(m_window.delivered)
+        .arg(ms(percentile(m_window.ackUs, 0.5)), 0, 'f', 2)
+        .arg(ms(percentile(m_window.ackUs, 0.99)), 0, 'f', 2)
+        .arg(ms(percentile(m_window.deliveryUs, 0.5)), 0, 'f', 2)
+        .arg(ms(percentile(m_window.deliveryUs, 0.99)), 0, 'f', 2)
+        .arg(m_inFlight.size())
+        .arg(m_window.bytesOut / 1024)
+        .arg(m_window.bytesIn / 1024)
+        << Qt::endl;
+    m_total.merge(m_window);
+    m_window = Window();
+}
+
+void LoadGenerator::finish()
+{
+    m_tickTimer.stop();
+    m_reportTimer.stop();
+    report();
+
+    double seconds = m_clock.elapsed() / 1000.0;
+    QJsonObject summary;
+    summary["users"] = m_options.users;
+    summary["rate"] = m_options.rate;
+    summary["churn"] = m_options.churn;
+    summary["seconds"] = seconds;
+    summary["sent"] = m_total.sent;
+    summary["acked"] = m_total.acked;
+    summary["delivered"] = m_total.delivered;
+    summary["unacked"] = qint64(m_inFlight.size());
+    summary["reconnects"] = m_total.reconnects;
+    summary["bytes_out"] = m_total.bytesOut;
+    summary["bytes_in"] = m_total.bytesIn;
+    for (double p : {0.5, 0.9, 0.99, 0.999}) {
+        QString suffix = QString::number(p * 100);
+        summary["ack_p" + suffix + "_ms"] = ms(percentile(m_total.ackUs, p));
+        summary["delivery_p" + suffix + "_ms"] = ms(percentile(m_total.deliveryUs, p));
+    }
+
+    QByteArray json = QJsonDocument(summary).toJson();
+    if (m_options.report.isEmpty()) {
+        QTextStream(stdout) << json;
+    } else {
+        QFile file(m_options.report);
+        if (file.open(QIODevice::WriteOnly)) file.write(json);
+    }
+
+    for (Client &client : m_clients) {
+        if (client.socket) client.socket->close();
+    }
+    emit finished(0);
+}
+
+qint64 LoadGenerator::percentile(QVector<qint64> samples, double p)
+{
+    if (samples.isEmpty()) return 0;
+    qsizetype n = qMin(samples.size() - 1, qsizetype(p * samples.size()));
+    std::nth_element(samples.begin(), samples.begin() + n, samples.end());
+    return samples.at(n);
+}
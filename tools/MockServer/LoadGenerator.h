@@ -0,0 +1,109 @@
+#ifndef LOADGENERATOR_H
+#define LOADGENERATOR_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QJsonObject>
+#include <QNetworkAccessManager>
+#include <QRandomGenerator>
+#include <QStringList>
+#include <QTimer>
+#include <QUrl>
+#include <QVector>
+
+#include "WireCodec.h"
+
+class QWebSocket;
+
+// 多用户压测：登录 N 个用户并各自建立 WebSocket，按给定速率随机互发消息，同时让部分用户反复上下线。
+// 统计服务器确认延迟（发送到 ack）与投递延迟（发送到对端收到），每秒输出一行，结束时输出 JSON 汇总。
+// 指定 target 时一部分消息发给该用户，用真实客户端登录该账号即可观察客户端在负载下的表现。
+class LoadGenerator : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Options {
+        QUrl server = QUrl("http://127.0.0.1:8080");
+        int users = 100;
+        QString userPrefix = "user";
+        double rate = 100;          // 每秒发送的消息总数
+        double churn = 0;           // 每秒断开重连的用户数
+        int groups = 0;             // 启动时创建的群组数
+        double groupShare = 0;      // 群消息占比
+        QString target;             // 用户名，非空时 targetShare 的消息发给该用户
+        double targetShare = 0.5;
+        int payload = 32;           // 消息正文字节数
+        int duration = 60;          // 秒，0 为一直运行
+        bool binary = true;
+        bool compress = true;
+        QString report;             // JSON 汇总输出路径，为空时写到标准输出
+    };
+
+    explicit LoadGenerator(const Options &options, QObject *parent = nullptr);
+
+    void start();
+
+signals:
+    void finished(int exitCode);
+
+private:
+    struct Client {
+        QString username;
+        QString userId;
+        QWebSocket *socket = nullptr;
+        WireCodec::Format format = WireCodec::Json;
+        bool compress = false;
+        bool connected = false;
+    };
+
+    struct Window {
+        qint64 sent = 0;
+        qint64 acked = 0;
+        qint64 delivered = 0;
+        qint64 reconnects = 0;
+        qint64 bytesOut = 0;
+        qint64 bytesIn = 0;
+        QVector<qint64> ackUs;
+        QVector<qint64> deliveryUs;
+
+        void merge(const Window &other);
+    };
+
+    void login(int index);
+    void onLoggedIn();
+    void createGroups();
+    void connectClient(int index);
+    void onFrame(int index, const QByteArray &frame, WireCodec::Format format);
+    void sendFrame(Client &client, const QJsonObject &frame);
+    void tick();
+    void sendOne();
+    void churn();
+    void report();
+    void finish();
+
+    static qint64 percentile(QVector<qint64> samples, double p);
+
+    Options m_options;
+    QNetworkAccessManager m_http;
+    QVector<Client> m_clients;
+    QHash<QString, int> m_byUserId;
+    QStringList m_groupIds;
+    int m_targetIndex;
+    int m_loggedIn;
+    QRandomGenerator m_rng;
+    QElapsedTimer m_clock;
+    qint64 m_lastTick;
+    double m_budget;
+    double m_churnBudget;
+    qint64 m_nextClientId;
+    QHash<QString, qint64> m_inFlight;  // client_id → 发送时刻（纳秒）
+    QTimer m_tickTimer;
+    QTimer m_reportTimer;
+    Window m_window;
+    Window m_total;
+    QByteArray m_body;
+};
+
+#endif
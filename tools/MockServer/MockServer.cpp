@@ -0,0 +1,654 @@
+#include "MockServer.h"
+#include <QCryptographicHash>
+#include <QJsonDocument>
+#include <QPointer>
+#include <QRandomGenerator>
+#include <QTcpSocket>
+#include <QTextStream>
+#include <QUrlQuery>
+#include <QWebSocket>
+
+namespace {
+
+const qint64 CHUNK_SIZE = 1024 * 1024;
+
+QByteArray toJson(const QJsonObject &object)
+{
+    return QJsonDocument(object).toJson(QJsonDocument::Compact);
+}
+
+QByteArray toJson(const QJsonArray &array)
+{
+    return QJsonDocument(array).toJson(QJsonDocument::Compact);
+}
+
+QJsonObject error(const QString &message)
+{
+    return QJsonObject{{"success", false}, {"error", message}};
+}
+
+QJsonObject success(QJsonObject object = QJsonObject())
+{
+    object["success"] = true;
+    return object;
+}
+
+qint64 queryId(const QUrlQuery &query, const char *name)
+{
+    return query.queryItemValue(QLatin1String(name)).toLongLong();
+}
+
+QJsonArray chunkIndexes(const QMap<int, QByteArray> &chunks)
+{
+    QJsonArray indexes;
+    for (auto it = chunks.cbegin(); it != chunks.cend(); ++it) indexes.append(it.key());
+    return indexes;
+}
+
+}
+
+MockServer::MockServer(const Options &options, QObject *parent)
+    : QObject(parent)
+    , m_options(options)
+    , m_ws(QStringLiteral("AtChatMock"), QWebSocketServer::NonSecureMode)
+    , m_state([this](const QString &userId, const QJsonObject &frame) { push(userId, frame); })
+    , m_nextUpload(1)
+    , m_chunksInFlight(0)
+    , m_requests(0)
+    , m_framesIn(0)
+    , m_framesOut(0)
+    , m_messages(0)
+    , m_lastMessages(0)
+{
+    m_state.seed(options.users, options.friends, options.history);
+    m_ws.setSupportedSubprotocols(WireCodec::subprotocols(options.binary, options.compress));
+
+    connect(&m_http, &QTcpServer::newConnection, this, &MockServer::onHttpConnection);
+    connect(&m_ws, &QWebSocketServer::newConnection, this, &MockServer::onSocketConnection);
+
+    if (options.statsInterval > 0) {
+        m_statsTimer.setInterval(options.statsInterval * 1000);
+        connect(&m_statsTimer, &QTimer::timeout, this, &MockServer::printStats);
+        m_statsTimer.start();
+    }
+}
+
+bool MockServer::listen(QString *error)
+{
+    if (m_http.listen(QHostAddress::Any, m_options.port)) return true;
+    *error = m_http.errorString();
+    return false;
+}
+
+quint16 MockServer::port() const
+{
+    return m_http.serverPort();
+}
+
+const MockServer::UploadStats &MockServer::uploadStats() const
+{
+    return m_uploadStats;
+}
+
+void MockServer::onHttpConnection()
+{
+    while (QTcpSocket *socket = m_http.nextPendingConnection()) {
+        auto connection = new HttpConnection(socket, this);
+        connection->setCompressionEnabled(m_options.compress);
+        connect(connection, &HttpConnection::requestReceived, this, &MockServer::onRequest);
+        connect(connection, &HttpConnection::upgradeRequested, &m_ws, &QWebSocketServer::handleConnection);
+    }
+}
+
+void MockServer::onRequest(HttpConnection *connection, const HttpConnection::Request &request)
+{
+    m_requests++;
+    Reply reply = route(request);
+    // 分块请求从收到到响应之间计为处理中，开启延迟后可以看到客户端的并行度
+    bool chunk = request.method == "PUT" && request.path.contains("/chunks/");
+    if (chunk) {
+        m_chunksInFlight++;
+        m_uploadStats.maxParallelChunks = qMax(m_uploadStats.maxParallelChunks, m_chunksInFlight);
+    }
+    if (m_options.delayMs <= 0) {
+        if (chunk) m_chunksInFlight--;
+        connection->respond(request, reply.status, reply.body, reply.contentType, reply.headers);
+        return;
+    }
+    QPointer<HttpConnection> guard(connection);
+    QTimer::singleShot(m_options.delayMs, this, [this, guard, request, reply, chunk]() {
+        if (chunk) m_chunksInFlight--;
+        if (guard) guard->respond(request, reply.status, reply.body, reply.contentType, reply.headers);
+    });
+}
+
+MockServer::Reply MockServer::route(const HttpConnection::Request &request)
+{
+    Reply reply;
+    QStringList parts = request.path.split('/', Qt::SkipEmptyParts);
+    if (parts.size() >= 2 && parts.at(0) == "uploads") return serveFile(request, parts.at(1));
+    if (parts.size() < 2 || parts.at(0) != "api") {
+        reply.status = 404;
+        reply.body = toJson(error("not found"));
+        return reply;
+    }
+
+    const QString userId = request.query.queryItemValue("user_id");
+    const QJsonObject body = QJsonDocument::fromJson(request.body).object();
+    const QByteArray &method = request.method;
+    const QString &resource = parts.at(1);
+
+    if (resource == "login" && method == "POST") {
+        QString message;
+        QJsonObject user = m_state.login(body["username"].toString(), body["password"].toString(), &message);
+        if (user.isEmpty()) {
+            reply.status = 401;
+            reply.body = toJson(error(message));
+        } else {
+            reply.body = toJson(success({{"token", "mock-" + user["id"].toString()}, {"user", user}}));
+        }
+    } else if (resource == "register" && method == "POST") {
+        QString message;
+        QJsonObject user = m_state.registerUser(body["username"].toString(), body["password"].toString(),
+                                                body["nickname"].toString(), &message);
+        if (user.isEmpty()) {
+            reply.status = 409;
+            reply.body = toJson(error(message));
+        } else {
+            reply.body = toJson(success({{"user", user}}));
+        }
+    } else if (resource == "users" && method == "GET") {
+        reply.body = toJson(m_state.sync(MockState::Users, QString(), queryId(request.query, "since")));
+    } else if (resource == "friends") {
+        return routeFriends(request, parts, body);
+    } else if (resource == "history" && method == "GET") {
+        return history(request, MockState::conversationKey(request.query.queryItemValue("user1"),
+                                                           request.query.queryItemValue("user2")));
+    } else if (resource == "groups" && parts.size() == 3 && parts.at(2) == "history") {
+        return history(request, MockState::groupKey(request.query.queryItemValue("group_id")));
+    } else if (resource == "groups" && parts.size() == 3 && parts.at(2) == "members" && method == "GET") {
+        reply.body = toJson(m_state.groupMembersPage(request.query.queryItemValue("group_id"),
+                                                     int(queryId(request.query, "offset")),
+                                                     int(queryId(request.query, "limit"))));
+    } else if (resource == "groups" && method == "GET") {
+        reply.body = toJson(m_state.groups(userId));
+    } else if (resource == "groups" && method == "POST") {
+        QStringList members;
+        for (const QJsonValue &v : body["members"].toArray()) members << v.toString();
+        reply.body = toJson(success({{"group", m_state.createGroup(userId, body["name"].toString(), members)}}));
+    } else if (resource == "profile" && parts.size() == 3 && method == "POST") {
+        const QString field = parts.at(2);
+        if (field == "password") {
+            bool ok = m_state.changePassword(userId, body["old_password"].toString(), body["new_password"].toString());
+            reply.status = ok ? 200 : 400;
+            reply.body = toJson(ok ? success() : error(QStringLiteral("原密码错误")));
+        } else if (body.contains(field)) {
+            m_state.updateProfile(userId, field, body[field]);
+            reply.body = toJson(success());
+        } else {
+            reply.status = 400;
+            reply.body = toJson(error("missing " + field));
+        }
+    } else if (resource == "messages" && method == "DELETE") {
+        int count = m_state.deleteConversation(userId, request.query.queryItemValue("other_user"));
+        reply.body = toJson(success({{"deleted", count}}));
+    } else if (resource == "upload") {
+        return routeUpload(request, parts, body);
+    } else {
+        reply.status = 404;
+        reply.body = toJson(error("not found"));
+    }
+    return reply;
+}
+
+MockServer::Reply MockServer::routeFriends(const HttpConnection::Request &request, const QStringList &parts,
+                                           const QJsonObject &body)
+{
+    Reply reply;
+    const QString userId = request.query.queryItemValue("user_id");
+    const QByteArray &method = request.method;
+    const QString sub = parts.value(2);
+
+    if (parts.size() == 2 && method == "GET") {
+        reply.body = toJson(m_state.sync(MockState::Friends, userId, queryId(request.query, "since")));
+    } else if (sub == "groups" && parts.size() == 3 && method == "GET") {
+        reply.body = toJson(m_state.sync(MockState::FriendGroups, userId, queryId(request.query, "since")));
+    } else if (sub == "groups" && parts.size() == 3 && method == "POST") {
+        reply.body = toJson(success({{"group", m_state.createFriendGroup(userId, body["name"].toString())}}));
+    } else if (sub == "groups" && parts.size() == 4 && method == "DELETE") {
+        bool ok = m_state.deleteFriendGroup(userId, parts.at(3));
+        reply.status = ok ? 200 : 404;
+        reply.body = toJson(ok ? success() : error("not found"));
+    } else if (sub == "request" && method == "POST") {
+        QString id = m_state.sendFriendRequest(userId, body["friend_id"].toString(), body["message"].toString());
+        reply.status = id.isEmpty() ? 400 : 200;
+        reply.body = toJson(id.isEmpty() ? error(QStringLiteral("无法发送好友请求")) : success({{"request_id", id}}));
+    } else if (sub == "requests" && method == "GET") {
+        reply.body = toJson(m_state.friendRequests(userId));
+    } else if (sub == "handle" && method == "POST") {
+        bool ok = m_state.handleFriendRequest(userId, body["request_id"].toVariant().toString(),
+                                              body["accept"].toBool(), body["group_id"].toVariant().toString());
+        reply.status = ok ? 200 : 404;
+        reply.body = toJson(ok ? success() : error("not found"));
+    } else if (sub == "search" && method == "GET") {
+        QJsonObject user = m_state.user(request.query.queryItemValue("target_id"));
+        reply.status = user.isEmpty() ? 404 : 200;
+        reply.body = toJson(user.isEmpty() ? error(QStringLiteral("用户不存在")) : user);
+    } else if (parts.size() == 3 && method == "DELETE") {
+        bool ok = m_state.removeFriend(userId, sub);
+        reply.status = ok ? 200 : 404;
+        reply.body = toJson(ok ? success() : error("not found"));
+    } else if (parts.size() == 4 && method == "POST") {
+        const QString field = parts.at(3) == "group" ? QStringLiteral("group_id") : parts.at(3);
+        bool ok = m_state.updateFriend(userId, sub, field, body[field]);
+        reply.status = ok ? 200 : 404;
+        reply.body = toJson(ok ? success() : error("not found"));
+    } else {
+        reply.status = 404;
+        reply.body = toJson(error("not found"));
+    }
+    return reply;
+}
+
+MockServer::Reply MockServer::history(const HttpConnection::Request &request, const QString &key)
+{
+    Reply reply;
+    bool hasMore = false;
+    QJsonArray messages = m_state.history(key, queryId(request.query, "since"), queryId(request.query, "before"),
+                                          int(queryId(request.query, "limit")), &hasMore);
+    reply.body = toJson(QJsonObject{{"messages", messages}, {"has_more", hasMore}});
+
+    // 与正式服务器一样带 ETag，客户端可用 If-None-Match 得到 304
+    QByteArray etag = '"' + QCryptographicHash::hash(reply.body, QCryptographicHash::Md5).toHex() + '"';
+    reply.headers.append({"ETag", etag});
+    if (request.header("if-none-match") == etag) {
+        reply.status = 304;
+        reply.body.clear();
+    }
+    return reply;
+}
+
+MockServer::Reply MockServer::routeUpload(const HttpConnection::Request &request, const QStringList &parts,
+                                          const QJsonObject &body)
+{
+    Reply reply;
+    const QByteArray &method = request.method;
+
+    if (m_options.legacyUploadStatus != 0 && parts.size() > 2) {
+        reply.status = m_options.legacyUploadStatus;
+        reply.body = toJson(error("not found"));
+        return reply;
+    }
+
+    if (parts.size() == 2 && method == "POST") {
+        // 旧的整文件 multipart 上传：只取第一个分段
+        QByteArray type = request.header("content-type");
+        QByteArray boundary = "--" + type.mid(type.indexOf("boundary=") + 9).replace('"', "");
+        qsizetype start = request.body.indexOf(boundary);
+        qsizetype headerEnd = request.body.indexOf("\r\n\r\n", start);
+        qsizetype end = request.body.indexOf("\r\n" + boundary, headerEnd);
+        if (start < 0 || headerEnd < 0 || end < 0) {
+            reply.status = 400;
+            reply.body = toJson(error("bad multipart body"));
+            return reply;
+        }
+        QByteArray headers = request.body.mid(start, headerEnd - start);
+        qsizetype nameAt = headers.indexOf("filename=\"");
+        QString fileName = nameAt < 0 ? QStringLiteral("file")
+            : QString::fromUtf8(headers.mid(nameAt + 10, headers.indexOf('"', nameAt + 10) - nameAt - 10));
+        m_uploadStats.legacy++;
+        reply.body = toJson(success(storeFile(fileName, request.body.mid(headerEnd + 4, end - headerEnd - 4))));
+        return reply;
+    }
+
+    const QString sub = parts.value(2);
+    if (sub == "init" && method == "POST") {
+        m_uploadStats.inits++;
+        QByteArray sha = body["sha256"].toString().toLatin1();
+        if (m_filesBySha.contains(sha)) {
+            reply.body = toJson(success({{"exists", true}, {"file", m_filesBySha.value(sha)}}));
+            return reply;
+        }
+        // 相同内容尚未完成的上传直接续传，返回已收到的分块
+        qint64 size = body["size"].toInteger();
+        for (auto u = m_uploads.cbegin(); u != m_uploads.cend(); ++u) {
+            if (u->sha256 != sha || u->size != size) continue;
+            reply.body = toJson(success({{"upload_id", u.key()}, {"chunk_size", u->chunkSize},
+                                         {"received", chunkIndexes(u->chunks)}}));
+            return reply;
+        }
+        Upload upload;
+        upload.fileName = body["file_name"].toString();
+        upload.size = size;
+        upload.chunkSize = qBound<qint64>(64 * 1024, body["chunk_size"].toInteger(CHUNK_SIZE), 8 * CHUNK_SIZE);
+        upload.sha256 = sha;
+        QString id = QString("up%1").arg(m_nextUpload++);
+        m_uploads.insert(id, upload);
+        reply.body = toJson(success({{"upload_id", id}, {"chunk_size", upload.chunkSize}, {"received", QJsonArray()}}));
+        return reply;
+    }
+
+    auto it = m_uploads.find(sub);
+    if (it == m_uploads.end()) {
+        reply.status = 404;
+        reply.body = toJson(error("unknown upload"));
+        return reply;
+    }
+
+    if (parts.size() == 5 && parts.at(3) == "chunks" && method == "PUT") {
+        if (m_options.failChunks > 0) {
+            m_options.failChunks--;
+            m_uploadStats.failedChunks++;
+            reply.status = m_options.failChunkStatus;
+            reply.body = toJson(error("injected chunk failure"));
+            return reply;
+        }
+        m_uploadStats.chunks++;
+        it->chunks.insert(parts.at(4).toInt(), request.body);
+        reply.body = toJson(success());
+    } else if (parts.size() == 4 && parts.at(3) == "complete" && method == "POST") {
+        if (m_options.failCompletes > 0) {
+            m_options.failCompletes--;
+            reply.status = 500;
+            reply.body = toJson(error("injected complete failure"));
+            return reply;
+        }
+        QByteArray content;
+        for (const QByteArray &chunk : std::as_const(it->chunks)) content += chunk;
+        if (content.size() != it->size) {
+            reply.status = 400;
+            reply.body = toJson(error(QStringLiteral("分块不完整")));
+            return reply;
+        }
+        if (QCryptographicHash::hash(content, QCryptographicHash::Sha256).toHex() != it->sha256) {
+            reply.status = 400;
+            reply.body = toJson(error(QStringLiteral("内容校验失败")));
+            return reply;
+        }
+        m_uploadStats.completes++;
+        QJsonObject file = storeFile(it->fileName, content);
+        m_filesBySha.insert(it->sha256, file);
+        m_uploads.erase(it);
+        reply.body = toJson(success(file));
+    } else if (parts.size() == 3 && method == "GET") {
+        reply.body = toJson(success({{"upload_id", sub}, {"chunk_size", it->chunkSize},
+                                     {"received", chunkIndexes(it->chunks)}}));
+    } else if (parts.size() == 3 && method == "DELETE") {
+        m_uploadStats.cancelled++;
+        m_uploads.erase(it);
+        reply.body = toJson(success());
+    } else {
+        reply.status = 405;
+        reply.body = toJson(error("method not allowed"));
+    }
+    return reply;
+}
+
+QJsonObject MockServer::storeFile(const QString &fileName, const QByteArray &content)
+{
+    QString name = QString("%1_%2").arg(m_files.size() + 1).arg(fileName);
+    m_files.insert(name, content);
+    QString url = QString("http://127.0.0.1:%1/uploads/%2").arg(m_http.serverPort())
+        .arg(QString::fromLatin1(QUrl::toPercentEncoding(name)));
+    return QJsonObject{{"url", url}, {"file_name", fileName}, {"size", content.size()}};
+}
+
+MockServer::Reply MockServer::serveFile(const HttpConnection::Request &request, const QString &name)
+{
+    Reply reply;
+    auto it = m_files.constFind(QUrl::fromPercentEncoding(name.toUtf8()));
+    if (it == m_files.cend()) {
+        reply.status = 404;
+        return reply;
+    }
+    reply.contentType = "application/octet-stream";
+    reply.headers.append({"Accept-Ranges", "bytes"});
+
+    // 只支持单个区间，媒体分段下载足够
+    QByteArray range = request.header("range");
+    if (range.startsWith("bytes=")) {
+        QList<QByteArray> bounds = range.mid(6).split('-');
+        qint64 size = it->size();
+        qint64 from = bounds.value(0).toLongLong();
+        qint64 to = bounds.value(1).isEmpty() ? size - 1 : qMin(size - 1, bounds.value(1).toLongLong());
+        if (from < size && from <= to) {
+            reply.status = 206;
+            reply.body = it->mid(from, to - from + 1);
+            reply.headers.append({"Content-Range", QString("bytes %1-%2/%3").arg(from).arg(to).arg(size).toLatin1()});
+            return reply;
+        }
+    }
+    reply.body = *it;
+    return reply;
+}
+
+void MockServer::onSocketConnection()
+{
+    while (QWebSocket *socket = m_ws.nextPendingConnection()) {
+        QUrlQuery query(socket->requestUrl());
+        QString userId = query.queryItemValue("user_id");
+        if (!m_state.hasUser(userId)) {
+            socket->close(QWebSocketProtocol::ClosePolicyViolated, "unknown user");
+            socket->deleteLater();
+            continue;
+        }
+
+        Client client;
+        client.userId = userId;
+        client.format = WireCodec::formatForSubprotocol(socket->subprotocol());
+        client.compress = WireCodec::compressionForSubprotocol(socket->subprotocol());
+        m_clients.insert(socket, client);
+        bool first = !m_sessions.contains(userId);
+        m_sessions.insert(userId, socket);
+
+        connect(socket, &QWebSocket::textMessageReceived, this, [this, socket](const QString &message) {
+            onFrame(socket, message.toUtf8(), WireCodec::Json);
+        });
+        connect(socket, &QWebSocket::binaryMessageReceived, this, [this, socket](const QByteArray &frame) {
+            onFrame(socket, frame, WireCodec::Cbor);
+        });
+        connect(socket, &QWebSocket::disconnected, this, [this, socket]() { onSocketClosed(socket); });
+
+        if (first) {
+            m_state.online.insert(userId);
+            broadcastStatus(userId, true);
+        }
+
+        // 补发断线期间的消息
+        qint64 lastId = queryId(query, "last_id");
+        if (lastId > 0) {
+            for (const QJsonValue &v : m_state.messagesAfter(userId, lastId)) {
+                QJsonObject m = v.toObject();
+                send(socket, QJsonObject{{"action", m.contains("group_id") ? "group_message" : "message"},
+                                         {"data", m}});
+            }
+        }
+    }
+}
+
+void MockServer::onFrame(QWebSocket *socket, const QByteArray &frame, WireCodec::Format format)
+{
+    auto it = m_clients.constFind(socket);
+    if (it == m_clients.cend()) return;
+    m_framesIn++;
+
+    QJsonObject message;
+    if (format == WireCodec::Cbor && WireCodec::isCompressedFrame(frame)) {
+        message = WireCodec::decode(WireCodec::decompressFrame(frame), it->format);
+    } else {
+        message = WireCodec::decode(frame, format);
+    }
+    if (message.isEmpty()) return;
+
+    // 先确认收到，再通知已送达，与正式服务器的顺序一致
+    Acks acks;
+    handleAction(socket, message, &acks);
+    // 确认里带回 id 与 seq，发送方据此推进自己的序列，服务器不会把消息推回发送它的连接
+    if (acks.sent.size() == 1) {
+        QJsonObject data = acks.sent.first().toObject();
+        data["status"] = "sent";
+        send(socket, QJsonObject{{"action", "ack"}, {"data", data}});
+    } else if (!acks.sent.isEmpty()) {
+        QJsonArray clientIds;
+        for (const QJsonValue &v : std::as_const(acks.sent)) clientIds.append(v.toObject()["client_id"]);
+        send(socket, QJsonObject{{"action", "ack"},
+                                 {"data", QJsonObject{{"client_ids", clientIds}, {"acks", acks.sent},
+                                                      {"status", "sent"}}}});
+    }
+    if (!acks.delivered.isEmpty()) {
+        send(socket, QJsonObject{{"action", "ack"},
+                                 {"data", QJsonObject{{"client_ids", QJsonArray::fromStringList(acks.delivered)},
+                                                      {"status", "delivered"}}}});
+    }
+}
+
+void MockServer::handleAction(QWebSocket *socket, const QJsonObject &frame, Acks *acks)
+{
+    const QString action = frame["action"].toString();
+    const QJsonObject data = frame["data"].toObject();
+    const QString from = m_clients.value(socket).userId;
+
+    if (action == "batch") {
+        // 批量发送合并为一个 ack
+        for (const QJsonValue &v : data["messages"].toArray()) handleAction(socket, v.toObject(), acks);
+        return;
+    }
+    if (action == "receipt") {
+        relayReceipts(from, data["receipts"].toArray());
+        return;
+    }
+    if (action != "message" && action != "group_message") return;
+
+    const bool group = action == "group_message";
+    const QString clientId = data["client_id"].toString();
+
+    // 客户端超时重发的消息只重新确认
+    if (!clientId.isEmpty() && m_clientIds.contains(clientId)) {
+        acks->sent.append(m_clientIds.value(clientId));
+        return;
+    }
+
+    QJsonObject message = m_state.storeMessage(from, data, group);
+    const QJsonObject ack{{"client_id", clientId}, {"id", message["id"]}, {"seq", message["seq"]}};
+    if (!clientId.isEmpty()) m_clientIds.insert(clientId, ack);
+    m_messages++;
+
+    QStringList recipients;
+    if (group) recipients = m_state.groupMembers(data["group_id"].toString());
+    else recipients << data["to"].toString() << from;
+
+    const QJsonObject out{{"action", action}, {"data", message}};
+    bool delivered = false;
+    for (const QString &userId : std::as_const(recipients)) {
+        for (QWebSocket *target : m_sessions.values(userId)) {
+            if (target == socket) continue;
+            pushMessage(target, out);
+            if (userId != from) delivered = true;
+        }
+    }
+
+    if (clientId.isEmpty()) return;
+    acks->sent.append(ack);
+    // 对方在线时再补一个 delivered，客户端据此更新发送状态
+    if (delivered) acks->delivered.append(clientId);
+}
+
+void MockServer::relayReceipts(const QString &from, const QJsonArray &receipts)
+{
+    // 按接收方归并，一个回执帧对每个接收方只转发一次
+    QHash<QString, QJsonArray> byTarget;
+    for (const QJsonValue &v : receipts) {
+        QJsonObject receipt = v.toObject();
+        QString groupId = receipt["group_id"].toString();
+        if (groupId.isEmpty()) {
+            QString to = receipt["to"].toString();
+            if (to.isEmpty()) continue;
+            if (receipt.contains("read")) m_state.markRead(from, to, receipt["read"].toInteger());
+            byTarget[to].append(receipt);
+            continue;
+        }
+        for (const QString &member : m_state.groupMembers(groupId)) {
+            if (member != from) byTarget[member].append(receipt);
+        }
+    }
+    for (auto it = byTarget.cbegin(); it != byTarget.cend(); ++it) {
+        push(it.key(), QJsonObject{{"action", "receipt"},
+                                   {"data", QJsonObject{{"from", from}, {"receipts", it.value()}}}});
+    }
+}
+
+void MockServer::onSocketClosed(QWebSocket *socket)
+{
+    Client client = m_clients.take(socket);
+    socket->deleteLater();
+    if (client.userId.isEmpty()) return;
+
+    m_sessions.remove(client.userId, socket);
+    if (!m_sessions.contains(client.userId)) {
+        m_state.online.remove(client.userId);
+        broadcastStatus(client.userId, false);
+    }
+}
+
+void MockServer::send(QWebSocket *socket, const QJsonObject &frame)
+{
+    auto it = m_clients.constFind(socket);
+    if (it == m_clients.cend()) return;
+    m_framesOut++;
+
+    QByteArray bytes = WireCodec::encode(frame, it->format);
+    if (it->compress && bytes.size() >= WireCodec::COMPRESSION_THRESHOLD) {
+        QByteArray packed = WireCodec::compressFrame(bytes);
+        if (packed.size() < bytes.size()) {
+            socket->sendBinaryMessage(packed);
+            return;
+        }
+    }
+    if (it->format == WireCodec::Cbor) socket->sendBinaryMessage(bytes);
+    else socket->sendTextMessage(QString::fromUtf8(bytes));
+}
+
+void MockServer::push(const QString &userId, const QJsonObject &frame)
+{
+    if (userId.isEmpty()) {
+        for (auto it = m_clients.cbegin(); it != m_clients.cend(); ++it) send(it.key(), frame);
+        return;
+    }
+    for (QWebSocket *socket : m_sessions.values(userId)) send(socket, frame);
+}
+
+void MockServer::pushMessage(QWebSocket *socket, const QJsonObject &frame)
+{
+    QRandomGenerator *rng = QRandomGenerator::global();
+    if (m_options.dropPercent > 0 && int(rng->bounded(100)) < m_options.dropPercent) return;
+    int copies = m_options.duplicatePercent > 0 && int(rng->bounded(100)) < m_options.duplicatePercent ? 2 : 1;
+
+    for (int i = 0; i < copies; ++i) {
+        if (m_options.reorderPercent > 0 && int(rng->bounded(100)) < m_options.reorderPercent) {
+            QPointer<QWebSocket> guard(socket);
+            QTimer::singleShot(50 + rng->bounded(250), this, [this, guard, frame]() {
+                if (guard) send(guard, frame);
+            });
+        } else {
+            send(socket, frame);
+        }
+    }
+}
+
+void MockServer::broadcastStatus(const QString &userId, bool online)
+{
+    const QJsonObject frame{{"action", "status"}, {"data", QJsonObject{{"user_id", userId}, {"online", online}}}};
+    for (auto it = m_clients.cbegin(); it != m_clients.cend(); ++it) {
+        if (it->userId != userId) send(it.key(), frame);
+    }
+}
+
+void MockServer::printStats()
+{
+    qint64 interval = m_options.statsInterval;
+    QTextStream(stdout) << "connections " << m_clients.size() << "  users online " << m_state.online.size()
+                        << "  http " << m_requests << "  frames in " << m_framesIn << " out " << m_framesOut
+                        << "  messages " << m_messages << " (" << (m_messages - m_lastMessages) / interval
+                        << "/s)" << Qt::endl;
+    m_lastMessages = m_messages;
+}
@@ -0,0 +1,133 @@
+#ifndef MOCKSERVER_H
+#define MOCKSERVER_H
+
+#include <QObject>
+#include <QHash>
+#include <QJsonArray>
+#include <QMap>
+#include <QMultiHash>
+#include <QTcpServer>
+#include <QTimer>
+#include <QWebSocketServer>
+
+#include "HttpConnection.h"
+#include "MockState.h"
+#include "WireCodec.h"
+
+class QWebSocket;
+
+// 单端口模拟服务器：HTTP 实现客户端用到的 /api/*，/ws 升级为 WebSocket 收发消息与推送。
+// 不做鉴权，user_id 以查询参数为准；所有数据在内存中，进程退出即丢弃。
+class MockServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Options {
+        quint16 port = 8080;
+        int users = 0;          // 预置用户 user0..userN-1，密码 password
+        int friends = 0;        // 每个预置用户的好友数
+        int history = 0;        // 相邻用户之间预置的历史消息数
+        int delayMs = 0;        // HTTP 响应的模拟延迟
+        bool compress = true;   // HTTP 响应与 WebSocket 帧压缩
+        bool binary = true;     // 接受 CBOR 子协议
+        int statsInterval = 10; // 秒，0 为不输出
+        // 实时消息推送的故障注入，百分比；用于验证客户端的重排、去重与补拉
+        int dropPercent = 0;
+        int duplicatePercent = 0;
+        int reorderPercent = 0; // 延后 50~300ms 发送
+        // 上传接口的故障注入：前 N 个分块请求返回 failChunkStatus，前 N 次 complete 返回 500；
+        // legacyUploadStatus 非 0 时分块接口一律返回该状态码，模拟只支持整文件上传的旧服务器
+        int failChunks = 0;
+        int failChunkStatus = 500;
+        int failCompletes = 0;
+        int legacyUploadStatus = 0;
+    };
+
+    // 上传接口的计数，供测试核对客户端行为
+    struct UploadStats {
+        int inits = 0;
+        int chunks = 0;             // 成功写入的分块
+        int failedChunks = 0;       // 故障注入拒绝的分块
+        int maxParallelChunks = 0;  // 同时处理中的分块请求数峰值，需配合 delayMs 观察
+        int completes = 0;
+        int legacy = 0;
+        int cancelled = 0;
+    };
+
+    explicit MockServer(const Options &options, QObject *parent = nullptr);
+
+    bool listen(QString *error);
+    quint16 port() const;
+    const UploadStats &uploadStats() const;
+
+private:
+    struct Client {
+        QString userId;
+        WireCodec::Format format = WireCodec::Json;
+        bool compress = false;
+    };
+
+    struct Upload {
+        QString fileName;
+        qint64 size = 0;
+        qint64 chunkSize = 0;
+        QByteArray sha256;
+        QMap<int, QByteArray> chunks;
+    };
+
+    struct Acks {
+        QJsonArray sent;            // {client_id, id, seq}
+        QStringList delivered;
+    };
+
+    struct Reply {
+        int status = 200;
+        QByteArray body;
+        QByteArray contentType = "application/json";
+        HttpConnection::Headers headers;
+    };
+
+    void onHttpConnection();
+    void onRequest(HttpConnection *connection, const HttpConnection::Request &request);
+    Reply route(const HttpConnection::Request &request);
+    Reply routeFriends(const HttpConnection::Request &request, const QStringList &parts, const QJsonObject &body);
+    Reply routeUpload(const HttpConnection::Request &request, const QStringList &parts, const QJsonObject &body);
+    Reply history(const HttpConnection::Request &request, const QString &key);
+    Reply serveFile(const HttpConnection::Request &request, const QString &name);
+    QJsonObject storeFile(const QString &fileName, const QByteArray &content);
+
+    void onSocketConnection();
+    void onFrame(QWebSocket *socket, const QByteArray &frame, WireCodec::Format format);
+    void handleAction(QWebSocket *socket, const QJsonObject &frame, Acks *acks);
+    void relayReceipts(const QString &from, const QJsonArray &receipts);
+    void onSocketClosed(QWebSocket *socket);
+    void send(QWebSocket *socket, const QJsonObject &frame);
+    void push(const QString &userId, const QJsonObject &frame);
+    void pushMessage(QWebSocket *socket, const QJsonObject &frame);
+    void broadcastStatus(const QString &userId, bool online);
+    void printStats();
+
+    Options m_options;
+    QTcpServer m_http;
+    QWebSocketServer m_ws;
+    MockState m_state;
+    QHash<QWebSocket *, Client> m_clients;
+    QMultiHash<QString, QWebSocket *> m_sessions;   // userId → 连接，同一账号可多端在线
+    QHash<QString, QJsonObject> m_clientIds;        // client_id → {client_id, id, seq}，重发去重并重新确认
+    QHash<QString, Upload> m_uploads;
+    QHash<QString, QByteArray> m_files;             // 文件名 → 内容
+    QHash<QByteArray, QJsonObject> m_filesBySha;
+    int m_nextUpload;
+    UploadStats m_uploadStats;
+    int m_chunksInFlight;
+    QTimer m_statsTimer;
+
+    qint64 m_requests;
+    qint64 m_framesIn;
+    qint64 m_framesOut;
+    qint64 m_messages;
+    qint64 m_lastMessages;
+};
+
+#endif
@@ -0,0 +1,440 @@
+#include "MockState.h"
+#include <QDateTime>
+#include <QRandomGenerator>
+#include <algorithm>
+
+namespace {
+
+const char *collectionName(MockState::Collection collection)
+{
+    switch (collection) {
+    case MockState::Users: return "users";
+    case MockState::Friends: return "friends";
+    case MockState::FriendGroups: return "friend_groups";
+    }
+    return "";
+}
+
+const QString DEFAULT_GROUP = QStringLiteral("default");
+
+}
+
+QJsonObject MockState::Table::upsert(const QString &id, const QJsonObject &item)
+{
+    m_items.insert(id, item);
+    m_log.append({++m_version, id});
+    return QJsonObject{{"base_version", m_version - 1}, {"version", m_version},
+                       {"upserts", QJsonArray{item}}, {"removed", QJsonArray()}};
+}
+
+QJsonObject MockState::Table::remove(const QString &id)
+{
+    if (!m_items.remove(id)) return QJsonObject();
+    m_log.append({++m_version, id});
+    return QJsonObject{{"base_version", m_version - 1}, {"version", m_version},
+                       {"upserts", QJsonArray()}, {"removed", QJsonArray{id}}};
+}
+
+QJsonObject MockState::Table::since(qint64 since) const
+{
+    QJsonObject response;
+    response["version"] = m_version;
+    QJsonArray upserts;
+    QJsonArray removed;
+
+    // 日志从版本 1 开始连续记录，since 不超过当前版本即可增量返回
+    if (since <= 0 || since > m_version) {
+        response["reset"] = true;
+        for (const QJsonObject &item : m_items) upserts.append(item);
+    } else {
+        auto first = std::upper_bound(m_log.cbegin(), m_log.cend(), since,
+                                      [](qint64 v, const QPair<qint64, QString> &e) { return v < e.first; });
+        QSet<QString> seen;
+        for (auto it = first; it != m_log.cend(); ++it) {
+            if (seen.contains(it->second)) continue;
+            seen.insert(it->second);
+            auto item = m_items.constFind(it->second);
+            if (item != m_items.cend()) upserts.append(*item);
+            else removed.append(it->second);
+        }
+    }
+    response["upserts"] = upserts;
+    response["removed"] = removed;
+    return response;
+}
+
+MockState::MockState(const Push &push)
+    : m_push(push)
+    , m_nextId(1)
+{
+}
+
+void MockState::seed(int users, int friends, int history)
+{
+    QStringList ids;
+    for (int i = 0; i < users; ++i) {
+        QString error;
+        ids << login(QString("user%1").arg(i), "password", &error)["id"].toString();
+    }
+    // 每个用户与其后的 friends 个用户互为好友，形成环状关系
+    for (int i = 0; i < users; ++i) {
+        for (int k = 1; k <= friends / 2 && k < users; ++k) {
+            const QString &other = ids.at((i + k) % users);
+            if (!friendsOf(ids.at(i)).contains(other)) addFriend(ids.at(i), other);
+        }
+    }
+    for (int i = 0; i < users && history > 0; ++i) {
+        const QString &other = ids.at((i + 1) % users);
+        for (int n = 0; n < history; ++n) {
+            bool forward = n % 2 == 0;
+            storeMessage(forward ? ids.at(i) : other,
+                         QJsonObject{{"to", forward ? other : ids.at(i)},
+                                     {"content", QString("历史消息 %1").arg(n)}, {"type", "text"}},
+                         false);
+        }
+    }
+}
+
+QJsonObject MockState::registerUser(const QString &username, const QString &password, const QString &nickname,
+                                    QString *error)
+{
+    if (username.isEmpty() || password.isEmpty()) {
+        *error = QStringLiteral("用户名和密码不能为空");
+        return QJsonObject();
+    }
+    if (m_usernames.contains(username)) {
+        *error = QStringLiteral("用户名已存在");
+        return QJsonObject();
+    }
+
+    QString id = newId("u");
+    QJsonObject user;
+    user["id"] = id;
+    user["username"] = username;
+    user["nickname"] = nickname.isEmpty() ? username : nickname;
+    user["signature"] = QString();
+    user["status"] = 0;
+    user["avatar"] = QString();
+    m_usernames.insert(username, id);
+    m_passwords.insert(id, password);
+    pushSync(QString(), Users, m_users.upsert(id, user));
+    return user;
+}
+
+QJsonObject MockState::login(const QString &username, const QString &password, QString *error)
+{
+    QString id = m_usernames.value(username);
+    if (id.isEmpty()) return registerUser(username, password, username, error);
+    if (m_passwords.value(id) != password) {
+        *error = QStringLiteral("用户名或密码错误");
+        return QJsonObject();
+    }
+    return m_users.item(id);
+}
+
+void MockState::updateProfile(const QString &userId, const QString &field, const QJsonValue &value)
+{
+    QJsonObject user = m_users.item(userId);
+    if (user.isEmpty() || user[field] == value) return;
+    user[field] = value;
+    pushSync(QString(), Users, m_users.upsert(userId, user));
+
+    // 好友列表里冗余保存了昵称与签名
+    if (field != "nickname" && field != "signature") return;
+    for (auto it = m_friends.begin(); it != m_friends.end(); ++it) {
+        if (!it->contains(userId)) continue;
+        QJsonObject f = it->item(userId);
+        f[field] = value;
+        pushSync(it.key(), Friends, it->upsert(userId, f));
+    }
+}
+
+bool MockState::changePassword(const QString &userId, const QString &oldPassword, const QString &newPassword)
+{
+    if (m_passwords.value(userId) != oldPassword || newPassword.isEmpty()) return false;
+    m_passwords.insert(userId, newPassword);
+    return true;
+}
+
+QJsonObject MockState::sync(Collection collection, const QString &userId, qint64 since)
+{
+    QJsonObject response;
+    const char *idField = "id";
+    switch (collection) {
+    case Users:
+        response = m_users.since(since);
+        break;
+    case Friends:
+        response = friendsOf(userId).since(since);
+        idField = "friend_id";
+        break;
+    case FriendGroups:
+        return friendGroupsOf(userId).since(since);
+    }
+
+    // 在线状态不进版本号，返回时按当前连接填写
+    QJsonArray upserts;
+    for (const QJsonValue &v : response["upserts"].toArray()) upserts.append(withPresence(v.toObject(), idField));
+    response["upserts"] = upserts;
+    return response;
+}
+
+void MockState::addFriend(const QString &userId, const QString &friendId, const QString &groupId)
+{
+    auto entry = [this](const QString &friendId, const QString &groupId) {
+        QJsonObject user = m_users.item(friendId);
+        QJsonObject f;
+        f["friend_id"] = friendId;
+        f["nickname"] = user["nickname"];
+        f["signature"] = user["signature"];
+        f["remark"] = QString();
+        f["note"] = QString();
+        f["group_id"] = groupId.isEmpty() ? DEFAULT_GROUP : groupId;
+        f["is_mutual"] = true;
+        return f;
+    };
+    friendGroupsOf(userId);
+    friendGroupsOf(friendId);
+    pushSync(userId, Friends, friendsOf(userId).upsert(friendId, entry(friendId, groupId)));
+    pushSync(friendId, Friends, friendsOf(friendId).upsert(userId, entry(userId, QString())));
+}
+
+bool MockState::removeFriend(const QString &userId, const QString &friendId)
+{
+    QJsonObject delta = friendsOf(userId).remove(friendId);
+    if (delta.isEmpty()) return false;
+    pushSync(userId, Friends, delta);
+    pushSync(friendId, Friends, friendsOf(friendId).remove(userId));
+    return true;
+}
+
+bool MockState::updateFriend(const QString &userId, const QString &friendId, const QString &field,
+                             const QJsonValue &value)
+{
+    Table &friends = friendsOf(userId);
+    if (!friends.contains(friendId)) return false;
+    QJsonObject f = friends.item(friendId);
+    if (f[field] == value) return true;
+    f[field] = value;
+    pushSync(userId, Friends, friends.upsert(friendId, f));
+    return true;
+}
+
+QString MockState::sendFriendRequest(const QString &userId, const QString &friendId, const QString &message)
+{
+    if (!hasUser(friendId) || userId == friendId || friendsOf(userId).contains(friendId)) return QString();
+    QString id = newId("r");
+    QJsonObject request;
+    request["id"] = id;
+    request["from_user_id"] = userId;
+    request["to_user_id"] = friendId;
+    request["from_nickname"] = m_users.item(userId)["nickname"];
+    request["message"] = message;
+    request["status"] = 0;
+    request["created_at"] = QDateTime::currentMSecsSinceEpoch();
+    m_requests.insert(id, request);
+    m_push(friendId, QJsonObject{{"action", "friend_request"}, {"data", request}});
+    return id;
+}
+
+QJsonArray MockState::friendRequests(const QString &userId) const
+{
+    QJsonArray array;
+    for (const QJsonObject &request : m_requests) {
+        if (request["to_user_id"].toString() == userId && request["status"].toInt() == 0) array.append(request);
+    }
+    return array;
+}
+
+bool MockState::handleFriendRequest(const QString &userId, const QString &requestId, bool accept,
+                                    const QString &groupId)
+{
+    auto it = m_requests.find(requestId);
+    if (it == m_requests.end() || (*it)["to_user_id"].toString() != userId) return false;
+    (*it)["status"] = accept ? 1 : 2;
+    if (accept) addFriend(userId, (*it)["from_user_id"].toString(), groupId);
+    return true;
+}
+
+QJsonObject MockState::createFriendGroup(const QString &userId, const QString &name)
+{
+    Table &groups = friendGroupsOf(userId);
+    QString id = newId("fg");
+    QJsonObject group{{"id", id}, {"name", name}, {"sort_order", groups.items().size()}};
+    pushSync(userId, FriendGroups, groups.upsert(id, group));
+    return group;
+}
+
+bool MockState::deleteFriendGroup(const QString &userId, const QString &groupId)
+{
+    if (groupId == DEFAULT_GROUP) return false;
+    QJsonObject delta = friendGroupsOf(userId).remove(groupId);
+    if (delta.isEmpty()) return false;
+    pushSync(userId, FriendGroups, delta);
+    // 分组内的好友移回默认分组
+    Table &friends = friendsOf(userId);
+    for (const QJsonObject &f : friends.items()) {
+        if (f["group_id"].toString() == groupId) updateFriend(userId, f["friend_id"].toString(), "group_id", DEFAULT_GROUP);
+    }
+    return true;
+}
+
+QJsonObject MockState::createGroup(const QString &ownerId, const QString &name, const QStringList &members)
+{
+    QString id = newId("g");
+    QStringList all = members;
+    if (!all.contains(ownerId)) all.prepend(ownerId);
+    QJsonObject group;
+    group["id"] = id;
+    group["name"] = name;
+    group["owner_id"] = ownerId;
+    group["member_count"] = all.size();
+    group["created_at"] = QDateTime::currentMSecsSinceEpoch();
+    m_groups.insert(id, group);
+    m_groupMembers.insert(id, all);
+    for (const QString &member : std::as_const(all)) {
+        m_push(member, QJsonObject{{"action", "group_created"}, {"data", group}});
+    }
+    return group;
+}
+
+QJsonArray MockState::groups(const QString &userId) const
+{
+    QJsonArray array;
+    for (auto it = m_groupMembers.cbegin(); it != m_groupMembers.cend(); ++it) {
+        if (it->contains(userId)) array.append(m_groups.value(it.key()));
+    }
+    return array;
+}
+
+QJsonObject MockState::groupMembersPage(const QString &groupId, int offset, int limit) const
+{
+    const QStringList members = m_groupMembers.value(groupId);
+    const QString ownerId = m_groups.value(groupId)["owner_id"].toString();
+    offset = qMax(0, offset);
+    if (limit <= 0) limit = 100;
+
+    QJsonArray page;
+    for (int i = offset; i < members.size() && i < offset + limit; ++i) {
+        QJsonObject info = user(members.at(i));
+        page.append(QJsonObject{
+            {"user_id", members.at(i)},
+            {"nickname", info["nickname"]},
+            {"username", info["username"]},
+            {"role", members.at(i) == ownerId ? "owner" : "member"}
+        });
+    }
+    return QJsonObject{{"members", page}, {"total", int(members.size())}};
+}
+
+QJsonObject MockState::storeMessage(const QString &from, const QJsonObject &data, bool group)
+{
+    QJsonObject message = data;
+    qint64 id = qint64(m_messages.size()) + 1;
+    QString key = group ? groupKey(message["group_id"].toString())
+                        : conversationKey(from, message["to"].toString());
+    message["id"] = id;
+    message["seq"] = ++m_seqs[key];
+    message["from"] = from;
+    message["timestamp"] = QDateTime::currentMSecsSinceEpoch();
+    if (!message.contains("type")) message["type"] = "text";
+    m_messages.append(message);
+    m_conversations[key].append(int(id - 1));
+    return message;
+}
+
+QJsonArray MockState::history(const QString &key, qint64 since, qint64 before, int limit, bool *hasMore) const
+{
+    const QVector<int> rows = m_conversations.value(key);
+    if (limit <= 0) limit = rows.size();
+    // 下标与 id 同序，按 id 二分定位
+    auto byId = [this](int row, qint64 id) { return m_messages.at(row)["id"].toInteger() < id; };
+
+    qsizetype first, last;
+    if (since > 0) {
+        first = std::lower_bound(rows.cbegin(), rows.cend(), since + 1, byId) - rows.cbegin();
+        last = qMin(rows.size(), first + limit);
+        *hasMore = last < rows.size();
+    } else {
+        last = before > 0 ? std::lower_bound(rows.cbegin(), rows.cend(), before, byId) - rows.cbegin()
+                          : rows.size();
+        first = qMax<qsizetype>(0, last - limit);
+        *hasMore = first > 0;
+    }
+
+    QJsonArray array;
+    for (qsizetype i = first; i < last; ++i) array.append(m_messages.at(rows.at(i)));
+    return array;
+}
+
+QJsonArray MockState::messagesAfter(const QString &userId, qint64 lastId) const
+{
+    QJsonArray array;
+    for (qsizetype i = qMax<qint64>(0, lastId); i < m_messages.size(); ++i) {
+        const QJsonObject &m = m_messages.at(i);
+        if (m["deleted"].toBool()) continue;
+        bool mine = m["from"].toString() == userId || m["to"].toString() == userId;
+        if (!mine && m.contains("group_id")) mine = m_groupMembers.value(m["group_id"].toString()).contains(userId);
+        if (mine) array.append(m);
+    }
+    return array;
+}
+
+int MockState::deleteConversation(const QString &userId, const QString &otherId)
+{
+    QVector<int> rows = m_conversations.take(conversationKey(userId, otherId));
+    for (int row : std::as_const(rows)) m_messages[row]["deleted"] = true;
+    return rows.size();
+}
+
+void MockState::markRead(const QString &userId, const QString &otherId, qint64 upToId)
+{
+    const QVector<int> rows = m_conversations.value(conversationKey(userId, otherId));
+    // 从新往旧，遇到已读的即停止
+    for (auto it = rows.crbegin(); it != rows.crend(); ++it) {
+        QJsonObject &m = m_messages[*it];
+        if (m["id"].toInteger() > upToId || m["from"].toString() == userId) continue;
+        if (m["is_read"].toBool()) break;
+        m["is_read"] = true;
+    }
+}
+
+QString MockState::conversationKey(const QString &a, const QString &b)
+{
+    return a < b ? a + '|' + b : b + '|' + a;
+}
+
+MockState::Table &MockState::friendGroupsOf(const QString &userId)
+{
+    auto it = m_friendGroups.find(userId);
+    if (it == m_friendGroups.end()) {
+        it = m_friendGroups.insert(userId, Table());
+        it->upsert(DEFAULT_GROUP, QJsonObject{{"id", DEFAULT_GROUP}, {"name", QStringLiteral("我的好友")},
+                                              {"sort_order", 0}});
+    }
+    return *it;
+}
+
+void MockState::pushSync(const QString &userId, Collection collection, QJsonObject delta)
+{
+    if (delta.isEmpty()) return;
+    if (collection != FriendGroups) {
+        const char *idField = collection == Friends ? "friend_id" : "id";
+        QJsonArray upserts;
+        for (const QJsonValue &v : delta["upserts"].toArray()) upserts.append(withPresence(v.toObject(), idField));
+        delta["upserts"] = upserts;
+    }
+    delta["collection"] = collectionName(collection);
+    m_push(userId, QJsonObject{{"action", "sync"}, {"data", delta}});
+}
+
+QJsonObject MockState::withPresence(QJsonObject item, const char *idField) const
+{
+    if (item.contains(QLatin1String(idField))) item["online"] = online.contains(item[idField].toString());
+    return item;
+}
+
+QString MockState::newId(const char *prefix)
+{
+    return QString::fromLatin1(prefix) + QString::number(m_nextId++);
+}
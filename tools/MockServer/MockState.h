@@ -0,0 +1,114 @@
+#ifndef MOCKSTATE_H
+#define MOCKSTATE_H
+
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QSet>
+#include <QString>
+#include <QVector>
+#include <functional>
+
+// 模拟服务器的内存数据：用户、好友、分组、群组与消息。
+// 用户、好友、好友分组按版本号记录变更，支持客户端的 since 增量同步与 sync 推送。
+class MockState
+{
+public:
+    enum Collection {
+        Users,
+        Friends,
+        FriendGroups
+    };
+
+    // 带版本的集合：每次变化版本号加一，并记下变化的 id
+    class Table
+    {
+    public:
+        qint64 version() const { return m_version; }
+        bool contains(const QString &id) const { return m_items.contains(id); }
+        QJsonObject item(const QString &id) const { return m_items.value(id); }
+        QList<QJsonObject> items() const { return m_items.values(); }
+
+        // 返回推送用的 {base_version, version, upserts, removed}
+        QJsonObject upsert(const QString &id, const QJsonObject &item);
+        QJsonObject remove(const QString &id);
+        // since 为 0、超前或早于日志时返回完整列表
+        QJsonObject since(qint64 since) const;
+
+    private:
+        qint64 m_version = 0;
+        QHash<QString, QJsonObject> m_items;
+        QVector<QPair<qint64, QString>> m_log;
+    };
+
+    // userId 为空表示推送给所有在线用户
+    using Push = std::function<void(const QString &userId, const QJsonObject &frame)>;
+
+    explicit MockState(const Push &push);
+
+    void seed(int users, int friends, int history);
+
+    QJsonObject registerUser(const QString &username, const QString &password, const QString &nickname,
+                             QString *error);
+    // 模拟环境中未注册的用户名直接创建，便于压测工具批量登录
+    QJsonObject login(const QString &username, const QString &password, QString *error);
+    bool hasUser(const QString &userId) const { return m_users.contains(userId); }
+    QJsonObject user(const QString &userId) const { return m_users.item(userId); }
+    void updateProfile(const QString &userId, const QString &field, const QJsonValue &value);
+    bool changePassword(const QString &userId, const QString &oldPassword, const QString &newPassword);
+
+    QJsonObject sync(Collection collection, const QString &userId, qint64 since);
+
+    void addFriend(const QString &userId, const QString &friendId, const QString &groupId = QString());
+    bool removeFriend(const QString &userId, const QString &friendId);
+    bool updateFriend(const QString &userId, const QString &friendId, const QString &field, const QJsonValue &value);
+    QString sendFriendRequest(const QString &userId, const QString &friendId, const QString &message);
+    QJsonArray friendRequests(const QString &userId) const;
+    bool handleFriendRequest(const QString &userId, const QString &requestId, bool accept, const QString &groupId);
+    QJsonObject createFriendGroup(const QString &userId, const QString &name);
+    bool deleteFriendGroup(const QString &userId, const QString &groupId);
+
+    QJsonObject createGroup(const QString &ownerId, const QString &name, const QStringList &members);
+    QJsonArray groups(const QString &userId) const;
+    QStringList groupMembers(const QString &groupId) const { return m_groupMembers.value(groupId); }
+    // 按加入顺序分页的成员资料 {members, total}
+    QJsonObject groupMembersPage(const QString &groupId, int offset, int limit) const;
+
+    // 分配 id 与时间戳并保存，返回完整消息
+    QJsonObject storeMessage(const QString &from, const QJsonObject &data, bool group);
+    // since > 0 时返回之后最早的 limit 条，否则返回 before 之前最新的 limit 条；结果按 id 升序
+    QJsonArray history(const QString &key, qint64 since, qint64 before, int limit, bool *hasMore) const;
+    // 断线重连时补发 lastId 之后与该用户有关的消息
+    QJsonArray messagesAfter(const QString &userId, qint64 lastId) const;
+    int deleteConversation(const QString &userId, const QString &otherId);
+    // userId 已读到 upToId：对方发出的、id 不超过它的私聊消息标记 is_read
+    void markRead(const QString &userId, const QString &otherId, qint64 upToId);
+
+    static QString conversationKey(const QString &a, const QString &b);
+    static QString groupKey(const QString &groupId) { return "g:" + groupId; }
+
+    QSet<QString> online;
+
+private:
+    Table &friendsOf(const QString &userId) { return m_friends[userId]; }
+    Table &friendGroupsOf(const QString &userId);
+    void pushSync(const QString &userId, Collection collection, QJsonObject delta);
+    QJsonObject withPresence(QJsonObject item, const char *idField) const;
+    QString newId(const char *prefix);
+
+    Push m_push;
+    Table m_users;
+    QHash<QString, QString> m_usernames;    // username → id
+    QHash<QString, QString> m_passwords;    // id → password
+    QHash<QString, Table> m_friends;
+    QHash<QString, Table> m_friendGroups;
+    QHash<QString, QJsonObject> m_requests; // request id → {id, from, to, message, status}
+    QHash<QString, QJsonObject> m_groups;
+    QHash<QString, QStringList> m_groupMembers;
+    QVector<QJsonObject> m_messages;
+    QHash<QString, QVector<int>> m_conversations;   // 会话 → m_messages 下标
+    QHash<QString, qint64> m_seqs;                  // 会话 → 最后分配的 seq，删除会话后继续递增
+    qint64 m_nextId;
+};
+
+#endif
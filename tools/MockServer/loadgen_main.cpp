@@ -0,0 +1,58 @@
+#include "LoadGenerator.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QTextStream>
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    app.setApplicationName("LoadGenerator");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("AtChat multi-user load generator");
+    parser.addHelpOption();
+    QCommandLineOption server("server", "Server base URL.", "url", "http://127.0.0.1:8080");
+    QCommandLineOption users("users", "Simulated users (logged in as <prefix>0..N-1).", "n", "100");
+    QCommandLineOption prefix("prefix", "Username prefix.", "prefix", "user");
+    QCommandLineOption rate("rate", "Messages per second across all users.", "n", "100");
+    QCommandLineOption churn("churn", "Users disconnecting and reconnecting per second.", "n", "0");
+    QCommandLineOption groups("groups", "Groups to create before sending.", "n", "0");
+    QCommandLineOption groupShare("group-share", "Fraction of messages sent to groups.", "f", "0");
+    QCommandLineOption target("target", "Username that receives a share of the messages (the client under test).",
+                              "username");
+    QCommandLineOption targetShare("target-share", "Fraction of direct messages sent to the target.", "f", "0.5");
+    QCommandLineOption payload("payload", "Message body size in bytes.", "bytes", "32");
+    QCommandLineOption duration("duration", "Run time in seconds, 0 to run until interrupted.", "s", "60");
+    QCommandLineOption jsonOnly("json-only", "Do not offer the CBOR subprotocol.");
+    QCommandLineOption noCompress("no-compress", "Do not offer compressed subprotocols.");
+    QCommandLineOption report("report", "Write the JSON summary to this file instead of stdout.", "file");
+    parser.addOptions({server, users, prefix, rate, churn, groups, groupShare, target, targetShare, payload,
+                       duration, jsonOnly, noCompress, report});
+    parser.process(app);
+
+    LoadGenerator::Options options;
+    options.server = QUrl(parser.value(server));
+    options.users = parser.value(users).toInt();
+    options.userPrefix = parser.value(prefix);
+    options.rate = parser.value(rate).toDouble();
+    options.churn = parser.value(churn).toDouble();
+    options.groups = parser.value(groups).toInt();
+    options.groupShare = parser.value(groupShare).toDouble();
+    options.target = parser.value(target);
+    options.targetShare = parser.value(targetShare).toDouble();
+    options.payload = parser.value(payload).toInt();
+    options.duration = parser.value(duration).toInt();
+    options.binary = !parser.isSet(jsonOnly);
+    options.compress = !parser.isSet(noCompress);
+    options.report = parser.value(report);
+
+    if (options.users < 2) {
+        QTextStream(stderr) << "at least 2 users are required" << Qt::endl;
+        return 1;
+    }
+
+    LoadGenerator generator(options);
+    QObject::connect(&generator, &LoadGenerator::finished, &app, &QCoreApplication::exit, Qt::QueuedConnection);
+    generator.start();
+    return app.exec();
+}
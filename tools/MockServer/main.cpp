@@ -0,0 +1,55 @@
+#include "MockServer.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QTextStream>
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    app.setApplicationName("MockServer");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("AtChat local mock server (HTTP /api/* + WebSocket /ws)");
+    parser.addHelpOption();
+    QCommandLineOption port({"p", "port"}, "Listen port.", "port", "8080");
+    QCommandLineOption users("users", "Seed users user0..userN-1 (password: password).", "n", "0");
+    QCommandLineOption friends("friends", "Friends per seeded user.", "n", "0");
+    QCommandLineOption history("history", "Seeded messages between neighbouring users.", "n", "0");
+    QCommandLineOption delay("delay", "Artificial HTTP response delay in ms.", "ms", "0");
+    QCommandLineOption noCompress("no-compress", "Disable HTTP and WebSocket compression.");
+    QCommandLineOption jsonOnly("json-only", "Do not accept the CBOR subprotocol.");
+    QCommandLineOption stats("stats", "Print counters every N seconds (0 to disable).", "s", "10");
+    QCommandLineOption drop("drop", "Drop N% of live message pushes.", "percent", "0");
+    QCommandLineOption duplicate("duplicate", "Send N% of live message pushes twice.", "percent", "0");
+    QCommandLineOption reorder("reorder", "Delay N% of live message pushes by 50-300 ms.", "percent", "0");
+    QCommandLineOption failChunks("fail-chunks", "Reject the first N upload chunks with HTTP 500.", "n", "0");
+    QCommandLineOption legacyUpload("legacy-upload", "Answer the chunked upload API with 404 (whole-file upload only).");
+    parser.addOptions({port, users, friends, history, delay, noCompress, jsonOnly, stats, drop, duplicate, reorder,
+                       failChunks, legacyUpload});
+    parser.process(app);
+
+    MockServer::Options options;
+    options.port = quint16(parser.value(port).toUInt());
+    options.users = parser.value(users).toInt();
+    options.friends = parser.value(friends).toInt();
+    options.history = parser.value(history).toInt();
+    options.delayMs = parser.value(delay).toInt();
+    options.compress = !parser.isSet(noCompress);
+    options.binary = !parser.isSet(jsonOnly);
+    options.statsInterval = parser.value(stats).toInt();
+    options.dropPercent = parser.value(drop).toInt();
+    options.duplicatePercent = parser.value(duplicate).toInt();
+    options.reorderPercent = parser.value(reorder).toInt();
+    options.failChunks = parser.value(failChunks).toInt();
+    options.legacyUploadStatus = parser.isSet(legacyUpload) ? 404 : 0;
+
+    MockServer server(options);
+    QString error;
+    if (!server.listen(&error)) {
+        QTextStream(stderr) << "listen failed: " << error << Qt::endl;
+        return 1;
+    }
+    QTextStream(stdout) << "MockServer listening on http://127.0.0.1:" << options.port
+                        << "  users " << options.users << Qt::endl;
+    return app.exec();
+}